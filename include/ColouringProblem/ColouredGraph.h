@@ -13,8 +13,14 @@
 #define COCA_COLOURED_GRAPH_H
 
 #include <stdbool.h>
+#include <stdint.h>
 #include "Graph.h"
 
+/**
+ * @brief Number of nodes stored in one word of a node bitset (see cg_neighbour_mask).
+ */
+#define CG_NODES_PER_WORD 64
+
 /**
  * @brief The struct containing a graph, and a colour for each node.
  */
@@ -79,6 +85,43 @@ int cg_get_num_edges(ColouredGraph graph);
  */
 bool cg_is_edge(ColouredGraph graph, int source, int target);
 
+/**
+ * @brief Gets the neighbours of @p node in @p graph, sorted by increasing number.
+ *
+ * @param graph A ColouredGraph.
+ * @param node A node.
+ * @param count Set to the number of neighbours of @p node.
+ * @return const int* The neighbours (owned by @p graph).
+ */
+const int *cg_neighbours(ColouredGraph graph, int node, int *count);
+
+/**
+ * @brief Returns the number of words of a node bitset of @p graph: node n is the bit n % CG_NODES_PER_WORD of the word n / CG_NODES_PER_WORD.
+ *
+ * @param graph A ColouredGraph.
+ * @return int The number of words.
+ */
+int cg_get_num_words(ColouredGraph graph);
+
+/**
+ * @brief Gets the neighbours of @p node in @p graph as a node bitset, so that a set of nodes can be intersected with them a word (64 nodes) at a time.
+ *
+ * @param graph A ColouredGraph.
+ * @param node A node.
+ * @return const uint64_t* The cg_get_num_words(@p graph) words of the bitset (owned by @p graph).
+ */
+const uint64_t *cg_neighbour_mask(ColouredGraph graph, int node);
+
+/**
+ * @brief Gets the indices of the non-zero words of the bitset of the neighbours of @p node, so that sparse graphs only go through the words holding some neighbour.
+ *
+ * @param graph A ColouredGraph.
+ * @param node A node.
+ * @param count Set to the number of non-zero words.
+ * @return const int* The indices, increasing (owned by @p graph).
+ */
+const int *cg_neighbour_words(ColouredGraph graph, int node, int *count);
+
 /**
  * @brief Gets the name of @p node in @p graph. The name is what appears in the .dot file, while its number is local to this program.
  *
@@ -17,6 +17,22 @@
 #include "ColouredGraph.h"
 #include <z3.h>
 
+/**
+ * @brief Selects whether colouring_reduction adds symmetry-breaking constraints (disabled by default): the nodes of a clique found greedily get fixed colours,
+ * and the other colours must appear in order among the other nodes (value precedence). They keep the formula equisatisfiable, and remove most of the
+ * colourings that only differ by a renaming of the colours.
+ *
+ * @param enabled Whether the constraints are added.
+ */
+void set_colouring_symmetry_breaking(bool enabled);
+
+/**
+ * @brief Tells if colouring_reduction adds symmetry-breaking constraints.
+ *
+ * @return bool
+ */
+bool get_colouring_symmetry_breaking(void);
+
 /**
  * @brief Generates a propositional formula satisfiable if and only if there is a partition which satisfies every player and all components are connected.
  *
@@ -52,4 +68,29 @@ void colour_graph_from_model(Z3_context ctx, Z3_model model, ColouredGraph graph
  */
 void colouring_print_model(Z3_context ctx, Z3_model model, ColouredGraph graph, int num_colours);
 
-#endif
\ No newline at end of file
+/**
+ * @brief The result of the search of the chromatic number.
+ *
+ */
+typedef struct
+{
+    int clique_size;    ///< The size of the clique found greedily (a lower bound).
+    int greedy_colours; ///< The number of colours of the greedy colouring (an upper bound).
+    int num_colours;    ///< The smallest number of colours of a colouring found: the chromatic number if the search is complete.
+    int num_checks;     ///< The number of calls to the solver.
+} ChromaticResult;
+
+/**
+ * @brief Computes the chromatic number of @p graph. The bounds given by a greedy clique and a greedy colouring are tightened with a single incremental solver,
+ * whose formula has one colour less than the greedy colouring: a k-colouring is sought by disabling the colours from k on with an assumption literal.
+ * Each colouring found gives the next k, until no k-colouring exists or k reaches the size of the clique.
+ * At the return, @p graph is coloured with result->num_colours colours (with the symmetry-breaking constraints if set_colouring_symmetry_breaking enabled them).
+ *
+ * @param ctx The solver context.
+ * @param graph A ColouredGraph.
+ * @param result Filled with the bounds and the number of colours found.
+ * @return Z3_lbool Z3_L_TRUE if result->num_colours is the chromatic number, Z3_L_UNDEF if the solver could not decide if fewer colours are enough.
+ */
+Z3_lbool colouring_chromatic_number(Z3_context ctx, ColouredGraph graph, ChromaticResult *result);
+
+#endif
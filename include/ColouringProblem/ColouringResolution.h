@@ -13,6 +13,7 @@
 #define COCA_COLOURING_RESOLUTION_H
 
 #include "ColouredGraph.h"
+#include <stdatomic.h>
 
 /**
  * @brief Brute Force Algorithm to solve the colouring problem. If it is solvable, @p graph is modified so at the return of the algorithm, the nodes are coloured. If there is no solution, @p graph has all colours set to -1.
@@ -27,4 +28,43 @@
  */
 bool colouring_brute_force(ColouredGraph graph, int num_colours);
 
-#endif
\ No newline at end of file
+/**
+ * @brief Same as colouring_brute_force, but gives up (returning false) as soon as @p stop is raised. Used to cancel the brute force from another thread.
+ *
+ * @param graph A ColouredGraph.
+ * @param num_colours The number of colours available.
+ * @param stop A flag stopping the search when raised, or NULL.
+ * @return true if there is a solution.
+ * @return false if there is no solution, or if the search was stopped.
+ */
+bool colouring_brute_force_interruptible(ColouredGraph graph, int num_colours, const atomic_bool *stop);
+
+/**
+ * @brief Colours @p graph greedily: the next node coloured is the one whose neighbours have the most colours (DSATUR order), with the smallest colour
+ * none of its neighbours has. The number of colours used is an upper bound of the chromatic number of @p graph.
+ *
+ * @param graph A ColouredGraph.
+ * @return int The number of colours used (the colours of @p graph go from 0 to this number minus 1).
+ */
+int colouring_greedy(ColouredGraph graph);
+
+/**
+ * @brief Finds a clique of @p graph greedily: starts from a node of maximal degree, and adds the node of maximal degree adjacent to all the nodes already chosen,
+ * as long as there is one. Its size is a lower bound of the chromatic number of @p graph.
+ *
+ * @param graph A ColouredGraph.
+ * @param clique Filled with the nodes of the clique. Must have a size of at least the number of nodes of @p graph.
+ * @return int The size of the clique.
+ */
+int colouring_greedy_clique(const ColouredGraph graph, int *clique);
+
+/**
+ * @brief Computes the chromatic number of @p graph: tries the brute force with every number of colours from the size of a greedy clique,
+ * up to the number of colours of a greedy colouring. @p graph is coloured with that number of colours at the return of the algorithm.
+ *
+ * @param graph A ColouredGraph.
+ * @return int The chromatic number of @p graph.
+ */
+int colouring_chromatic_brute_force(ColouredGraph graph);
+
+#endif
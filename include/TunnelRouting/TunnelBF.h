@@ -13,6 +13,7 @@
 #define TUNNEL_BF_H
 
 #include "TunnelNetwork.h"
+#include <stdatomic.h>
 
 /**
  * @brief Brute force that decides if there is a valid simple path of length at most @p length in @p network. If there is such a path, it will be present in @p path after the call, otherwise, path is not modified.
@@ -27,4 +28,32 @@
  */
 int tn_brute_force(TunnelNetwork network, int length, tn_step *path);
 
+/**
+ * @brief Same as tn_brute_force, but gives up (returning 0) as soon as @p stop is raised. Used to cancel the brute force from another thread.
+ *
+ * @param network The network.
+ * @param length The max length of the path sought
+ * @param path Array to return a path if one is found.
+ * @param stop A flag stopping the search when raised, or NULL.
+ * @return int The length of the path found. Returns 0 if no path has been found or if the search was stopped.
+ */
+int tn_brute_force_interruptible(TunnelNetwork network, int length, tn_step *path, const atomic_bool *stop);
+
+/**
+ * @brief Brute force looking for the shortest valid path of length at most @p length from @p initial to each of the nodes @p targets (the initial and final
+ * nodes of @p network are not used). A single exploration serves every target: the paths of each length are enumerated once, from @p initial, and the
+ * search stops as soon as every target is reached.
+ *
+ * @param network The network.
+ * @param initial The initial node.
+ * @param num_targets The number of targets.
+ * @param targets The final nodes sought.
+ * @param length The max length of the paths sought.
+ * @param lengths Set to the length of the path found to each target (0 if none has been found).
+ * @param paths The arrays receiving the path found to each target (an entry can be NULL if the path is not needed).
+ * @return int The number of targets reached.
+ * @pre Each non-NULL entry of @p paths must be an array of size at least @p length.
+ */
+int tn_brute_force_targets(TunnelNetwork network, int initial, int num_targets, const int *targets, int length, int *lengths, tn_step *const *paths);
+
 #endif
\ No newline at end of file
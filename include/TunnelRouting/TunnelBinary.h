@@ -0,0 +1,49 @@
+/**
+ * @file TunnelBinary.h
+ * @brief Binary cache of parsed Tunnel Networks. The file holds everything needed to solve and display a network (node count, initial and final nodes,
+ * node actions, successor and predecessor index, names and node parameters) together with a hash of the source .dot file, in a layout that is used
+ * in place once the file is memory-mapped: loading does not parse anything.
+ * The format uses the byte order and int size of the machine writing it; a file written elsewhere is rejected.
+ * @version 1
+ * @date 2025-12-04
+ *
+ * @copyright Creative Commons
+ *
+ */
+
+#ifndef TUNNEL_BINARY_H
+#define TUNNEL_BINARY_H
+
+#include "TunnelNetwork.h"
+#include <stdint.h>
+
+/**
+ * @brief Computes the hash of the content of @p file (64-bit FNV-1a), to detect that a cache is out of date.
+ *
+ * @param file The name of a file.
+ * @param hash Set to the hash of the content of @p file.
+ * @return bool false if @p file cannot be read.
+ */
+bool tn_hash_file(const char *file, uint64_t *hash);
+
+/**
+ * @brief Writes @p network in @p file in the binary format. The file is written aside then renamed, so that it is replaced at once: a process mapping the previous file is not affected.
+ *
+ * @param network A Tunnel Network.
+ * @param source_hash The hash of the .dot file @p network was parsed from.
+ * @param file The name of the binary file.
+ * @return bool false if the file cannot be written.
+ */
+bool tn_save_binary(TunnelNetwork network, uint64_t source_hash, const char *file);
+
+/**
+ * @brief Memory-maps the binary file @p file and builds the network it describes, without copying the names or the successor index.
+ *
+ * @param file The name of a binary file written by tn_save_binary.
+ * @param expected_hash If not NULL, the file is only loaded if it was written from a .dot file with this hash.
+ * @param graph Set to the graph supporting the network. It owns the mapping: it must be deleted with graph_delete after the network.
+ * @return TunnelNetwork The network, or NULL if the file is missing, invalid, written on an incompatible machine or out of date.
+ */
+TunnelNetwork tn_load_binary(const char *file, const uint64_t *expected_hash, Graph *graph);
+
+#endif
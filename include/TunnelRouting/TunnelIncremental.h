@@ -0,0 +1,165 @@
+/**
+ * @file TunnelIncremental.h
+ * @brief Incremental version of the reduction of the Tunnel Routing problem to SAT. A single Z3 solver is kept alive for every length tried, so that
+ * constraints shared by several lengths are encoded once and clauses learnt for one length are reused for the others.
+ * Positions are activated by literals: "position pos is part of the path" is an assumption of the check, so that any length (up to the maximal one) can be tried in any order.
+ * @version 1
+ * @date 2025-11-20
+ *
+ * @copyright Creative Commons
+ *
+ */
+
+#ifndef TUNNEL_INCREMENTAL_H
+#define TUNNEL_INCREMENTAL_H
+
+#include "TunnelNetwork.h"
+#include <z3.h>
+#include <stdbool.h>
+
+/**
+ * @brief The struct containing the persistent solver and the bookkeeping of which positions are already encoded.
+ *
+ */
+typedef struct TunnelIncremental_s *TunnelIncremental;
+
+/**
+ * @brief Creates an incremental solver for paths of length at most @p max_length in @p network. No constraint is added before the first call to tn_incremental_solve.
+ * The stack size is the one of @p max_length for every length: heights above length/2 cannot be reached by a path of size length, so this does not change the answer.
+ *
+ * @param ctx The solver context. Must outlive the returned structure.
+ * @param network A Tunnel Network.
+ * @param max_length The largest length that will be tried.
+ * @return TunnelIncremental The incremental solver.
+ * @pre @p network must be initialized.
+ */
+TunnelIncremental tn_incremental_create(Z3_context ctx, TunnelNetwork network, int max_length);
+
+/**
+ * @brief Creates an incremental solver for paths of length at most @p max_length in @p network between the initial and final nodes of several pairs
+ * (those of @p network are not used). The constraints that do not depend on the pair (φ1, φ3 to φ11) are shared: only φ2 is chosen by the activation
+ * literals of the pair, so that what is learnt on one pair serves the others.
+ * Only tn_incremental_solve_pair and tn_incremental_solve_pairs can be used on it.
+ *
+ * @param ctx The solver context. Must outlive the returned structure.
+ * @param network A Tunnel Network.
+ * @param max_length The largest length that will be tried.
+ * @param num_pairs The number of pairs that will be asked.
+ * @param initials The initial nodes of the pairs.
+ * @param finals The final nodes of the pairs.
+ * @return TunnelIncremental The incremental solver.
+ * @pre @p network must be initialized.
+ */
+TunnelIncremental tn_incremental_create_for_pairs(Z3_context ctx, TunnelNetwork network, int max_length, int num_pairs, const int *initials, const int *finals);
+
+/**
+ * @brief Decides if there is a well-formed path of size @p length, adding first the constraints of the positions up to @p length not yet encoded.
+ * The model, if any, uses the same variables as tn_reduction, so tn_get_path_from_model and tn_print_model can be used on it.
+ *
+ * @param solver The incremental solver.
+ * @param length The size of the path sought.
+ * @param model A pointer towards a model. Will contain a model if there is such a path (otherwise, will not be modified). If NULL, the model is not read
+ *              (tn_incremental_get_model can get it afterwards).
+ * @return Z3_lbool Z3_L_TRUE if there is such a path, Z3_L_FALSE if there is none, and Z3_L_UNDEF if the solver could not decide.
+ * @pre 1 <= @p length <= the max_length given at creation, and @p solver is not created for pairs.
+ */
+Z3_lbool tn_incremental_solve(TunnelIncremental solver, int length, Z3_model *model);
+
+/**
+ * @brief Decides if there is a well-formed path of size @p length from @p initial to @p final, with a solver created by tn_incremental_create_for_pairs.
+ *
+ * @param solver The incremental solver.
+ * @param initial The initial node, one of the pairs given at creation.
+ * @param final The final node, one of the pairs given at creation.
+ * @param length The size of the path sought.
+ * @param model A pointer towards a model. Will contain a model if there is such a path (otherwise, will not be modified).
+ * @return Z3_lbool Z3_L_TRUE if there is such a path, Z3_L_FALSE if there is none, and Z3_L_UNDEF if the solver could not decide.
+ * @pre 1 <= @p length <= the max_length given at creation.
+ */
+Z3_lbool tn_incremental_solve_pair(TunnelIncremental solver, int initial, int final, int length, Z3_model *model);
+
+/**
+ * @brief Finds the size of the shortest well-formed path up to the max_length given at creation of each pair, with a solver created by
+ * tn_incremental_create_for_pairs. The sizes are tried in increasing order, each one for every pair not decided yet.
+ *
+ * @param solver The incremental solver.
+ * @param num_pairs The number of pairs.
+ * @param initials The initial nodes of the pairs.
+ * @param finals The final nodes of the pairs.
+ * @param results Set to the result of each pair: Z3_L_TRUE if it has a path, Z3_L_FALSE if it has none, Z3_L_UNDEF if the solver could not decide one of its sizes.
+ * @param lengths Set to the size of the shortest path of each pair (0 if it has none).
+ * @param models Set to a model of the shortest path of each pair that has one (to be released with Z3_model_dec_ref).
+ */
+void tn_incremental_solve_pairs(TunnelIncremental solver, int num_pairs, const int *initials, const int *finals, Z3_lbool *results, int *lengths, Z3_model *models);
+
+/**
+ * @brief Decides if there is a well-formed path of size at most @p max_length. Unlike the existence of a path of an exact size, this is monotone in @p max_length,
+ * so the shortest size can be found by bisection.
+ *
+ * @param solver The incremental solver.
+ * @param max_length The largest size of the path sought.
+ * @param length Set to the size of the path described by @p model if there is one.
+ * @param model A pointer towards a model. Will contain a model if there is such a path (otherwise, will not be modified).
+ * @return Z3_lbool Z3_L_TRUE if there is such a path, Z3_L_FALSE if there is none, and Z3_L_UNDEF if the solver could not decide.
+ * @pre 1 <= @p max_length <= the max_length given at creation, and @p solver is not created for pairs.
+ */
+Z3_lbool tn_incremental_solve_at_most(TunnelIncremental solver, int max_length, int *length, Z3_model *model);
+
+/**
+ * @brief The orders in which the sizes are tried to find the shortest path.
+ *
+ */
+typedef enum
+{
+    tn_search_linear,      ///< Every size from 1, until a path is found.
+    tn_search_exponential, ///< Sizes at most 1, 2, 4, 8... until a path is found, then a binary search below the size of that path.
+    tn_search_descending   ///< Sizes at most the maximal one, then at most the size of the last path found minus one, until there is none.
+} tn_search_strategy;
+
+/**
+ * @brief Gets the strategy named @p name ("linear", "exponential" or "descending").
+ *
+ * @param name A string.
+ * @param strategy Set to the strategy if @p name is valid.
+ * @return bool true if @p name is valid.
+ */
+bool tn_search_strategy_of_string(const char *name, tn_search_strategy *strategy);
+
+/**
+ * @brief Finds the size of the shortest well-formed path up to the max_length given at creation, trying the sizes in the order given by @p strategy.
+ * The linear strategy needs as many calls to the solver as the size of the shortest path, the others a number logarithmic in max_length
+ * (exponential) or in the number of sizes having a path (descending).
+ *
+ * @param solver The incremental solver.
+ * @param strategy The order in which the sizes are tried.
+ * @param length Set to the size of the shortest path if there is one.
+ * @param model A pointer towards a model. Will contain a model of the shortest path if there is one (otherwise, will not be modified).
+ * @return Z3_lbool Z3_L_TRUE if there is a path, Z3_L_FALSE if there is none, and Z3_L_UNDEF if the solver could not decide one of the sizes tried.
+ */
+Z3_lbool tn_incremental_search(TunnelIncremental solver, tn_search_strategy strategy, int *length, Z3_model *model);
+
+/**
+ * @brief Gets the model of the last call to the solver, if it was satisfiable.
+ *
+ * @param solver The incremental solver.
+ * @return Z3_model The model, with a reference.
+ * @pre The last call to the solver of @p solver answered Z3_L_TRUE.
+ */
+Z3_model tn_incremental_get_model(TunnelIncremental solver);
+
+/**
+ * @brief Gets the number of calls to the solver made by @p solver so far.
+ *
+ * @param solver The incremental solver.
+ * @return int
+ */
+int tn_incremental_get_num_checks(TunnelIncremental solver);
+
+/**
+ * @brief Deallocates @p solver and its Z3 solver. Does NOT delete the context nor the network.
+ *
+ * @param solver The incremental solver.
+ */
+void tn_incremental_delete(TunnelIncremental solver);
+
+#endif
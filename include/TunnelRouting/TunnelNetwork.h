@@ -65,6 +65,26 @@ typedef struct tn_step
  */
 TunnelNetwork tn_initialize(Graph graph);
 
+/**
+ * @brief Initializes a Tunnel Network from a Graph whose initial node, final node and actions are already known (no parameter is parsed).
+ * The graph is NOT copied.
+ *
+ * @param graph The Graph supporting the network.
+ * @param initial The initial node.
+ * @param final The final node.
+ * @param node_actions The actions of each node, as the masks returned by tn_get_node_actions (copied).
+ * @return TunnelNetwork
+ */
+TunnelNetwork tn_initialize_with_actions(Graph graph, int initial, int final, const int *node_actions);
+
+/**
+ * @brief Gets the graph supporting @p network.
+ *
+ * @param network
+ * @return const Graph* The graph (owned by the caller of tn_initialize).
+ */
+const Graph *tn_get_graph(TunnelNetwork network);
+
 /**
  * @brief Deallocates memory used by @p network. Does NOT deallocates the graph.
  *
@@ -114,6 +134,28 @@ int tn_get_num_edges(TunnelNetwork network);
  */
 bool tn_is_edge(TunnelNetwork network, int source, int target);
 
+/**
+ * @brief Returns the successors of @p node in @p network, sorted by increasing number.
+ *
+ * @pre @p node must be between 0 and tn_get_num_nodes(@p network)-1.
+ * @param network
+ * @param node
+ * @param count Set to the number of successors.
+ * @return const int* The successors (owned by @p network).
+ */
+const int *tn_successors(TunnelNetwork network, int node, int *count);
+
+/**
+ * @brief Returns the predecessors of @p node in @p network, sorted by increasing number.
+ *
+ * @pre @p node must be between 0 and tn_get_num_nodes(@p network)-1.
+ * @param network
+ * @param node
+ * @param count Set to the number of predecessors.
+ * @return const int* The predecessors (owned by @p network).
+ */
+const int *tn_predecessors(TunnelNetwork network, int node, int *count);
+
 /**
  * @brief Returns the name of @p node in @p network.
  *
@@ -136,6 +178,15 @@ char *tn_get_node_name(TunnelNetwork network, int node);
  */
 bool tn_node_has_action(TunnelNetwork network, int node, stack_action action);
 
+/**
+ * @brief Returns the actions of @p node as a mask: bit number action is set iff the node @p node can perform action.
+ * @pre @p node must be between 0 and tn_get_num_nodes(@p network)-1.
+ * @param network
+ * @param node
+ * @return int
+ */
+int tn_get_node_actions(TunnelNetwork network, int node);
+
 /**
  * @brief Gets the initial node of @p network.
  *
@@ -0,0 +1,51 @@
+/**
+ * @file TunnelParallel.h
+ * @brief Parallel version of the sweep over the sizes of the path: several threads build and solve the reductions of different sizes at the same time,
+ * each with its own Z3 context (contexts are not thread-safe). Sizes are handed out in increasing order, and the sizes larger than a size proven
+ * satisfiable are cancelled, so that the answer is the same as the one of the sequential sweep.
+ * A single size can also be split into cubes (cube and conquer): each cube fixes the state at the middle of the path, and the cubes are solved as
+ * assumptions by the workers until one of them is satisfiable.
+ * @version 1
+ * @date 2025-11-27
+ *
+ * @copyright Creative Commons
+ *
+ */
+
+#ifndef TUNNEL_PARALLEL_H
+#define TUNNEL_PARALLEL_H
+
+#include "TunnelNetwork.h"
+#include <z3.h>
+
+/**
+ * @brief Looks for the smallest size from 1 to @p bound for which there is a well-formed simple path in @p network, solving up to @p num_threads sizes at the same time.
+ *
+ * @param network A Tunnel Network.
+ * @param bound The largest size tried.
+ * @param num_threads The number of worker threads.
+ * @param path Array to return the path found.
+ * @param length Set to the size of the path found (0 if there is none).
+ * @return Z3_lbool Z3_L_TRUE if a path was found (it is then in @p path), Z3_L_FALSE if every size up to @p bound is unsatisfiable,
+ *         and Z3_L_UNDEF if the solver could not decide some size smaller than the first satisfiable one.
+ * @pre @p path must be an array of size at least @p bound.
+ */
+Z3_lbool tn_parallel_sweep(TunnelNetwork network, int bound, int num_threads, tn_step *path, int *length);
+
+/**
+ * @brief Decides if there is a well-formed simple path of size @p length in @p network by cube and conquer: each live state at the middle position of the
+ *        path is a cube (see tn_state_cubes), and @p num_threads workers solve the cubes, each with its own context and a single solver for all its cubes,
+ *        until one of them is satisfiable.
+ *
+ * @param network A Tunnel Network.
+ * @param length The size of the path sought.
+ * @param num_threads The number of worker threads.
+ * @param path Array to return the path found.
+ * @param num_cubes Set to the number of cubes.
+ * @return Z3_lbool Z3_L_TRUE if a path was found (it is then in @p path), Z3_L_FALSE if every cube is unsatisfiable, and Z3_L_UNDEF if the solver could not
+ *         decide some cube and no cube is satisfiable.
+ * @pre @p path must be an array of size at least @p length.
+ */
+Z3_lbool tn_parallel_cubes(TunnelNetwork network, int length, int num_threads, tn_step *path, int *num_cubes);
+
+#endif
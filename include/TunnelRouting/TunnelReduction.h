@@ -15,6 +15,98 @@
 
 #include "TunnelNetwork.h"
 #include <z3.h>
+#include <stdbool.h>
+
+/**
+ * @brief How the content of a stack cell is encoded.
+ *
+ */
+typedef enum
+{
+    tn_stack_pair,   ///< Two variables y_{pos,h,4} and y_{pos,h,6} per cell, exactly one of them being true (φ6).
+    tn_stack_compact ///< A single variable per cell, true for 6 and false for 4: y_{pos,h,4} is its negation, and φ6 is not needed.
+} tn_stack_encoding;
+
+/**
+ * @brief Sets the encoding of the stack cells used by the encodings created afterwards (tn_stack_pair by default). Meant to be called once at the start
+ * of the program, the models must be decoded with the encoding they were solved with.
+ *
+ * @param encoding The encoding.
+ */
+void tn_set_stack_encoding(tn_stack_encoding encoding);
+
+/**
+ * @brief Gets the encoding of the stack cells.
+ *
+ * @return tn_stack_encoding The current encoding.
+ */
+tn_stack_encoding tn_get_stack_encoding(void);
+
+/**
+ * @brief Gets the encoding of the stack cells named @p name ("pair" or "compact").
+ *
+ * @param name A string.
+ * @param encoding Set to the encoding if @p name is valid.
+ * @return bool true if @p name is valid.
+ */
+bool tn_stack_encoding_of_string(const char *name, tn_stack_encoding *encoding);
+
+/**
+ * @brief The state of one reduction: the solver context, the network, the length of the sought path, and the table of the variables of the reduction.
+ * Every formula builder reads its variables from this table, so each variable is created only once.
+ *
+ */
+typedef struct TunnelEncoding_s *TunnelEncoding;
+
+/**
+ * @brief Creates the encoding of paths of size @p length in @p network. Variables are only created when first used.
+ * Variables have integer names that do not depend on @p length: two encodings over the same network and context share their variables.
+ * The states (node, position, height) that no path of size @p length can go through (computed by forward and backward reachability along the actions of the nodes)
+ * are dead: their variables are the constant false, and the formulae leave them out.
+ *
+ * @param ctx The solver context.
+ * @param network A Tunnel Network.
+ * @param length The size of the target path (positions go from 0 to @p length, the stack has length/2+1 cells).
+ * @return TunnelEncoding The encoding.
+ * @pre @p network must be initialized.
+ */
+TunnelEncoding tn_encoding_create(Z3_context ctx, const TunnelNetwork network, int length);
+
+/**
+ * @brief Creates the encoding of paths of size at most @p max_length in @p network, for solving several sizes with the same variables (see TunnelIncremental.h).
+ * A state is only dead if no path of size up to @p max_length can go through it.
+ *
+ * @param ctx The solver context.
+ * @param network A Tunnel Network.
+ * @param max_length The largest size of path (it fixes the stack size).
+ * @return TunnelEncoding The encoding.
+ * @pre @p network must be initialized.
+ */
+TunnelEncoding tn_encoding_create_up_to(Z3_context ctx, const TunnelNetwork network, int max_length);
+
+/**
+ * @brief Creates the encoding of paths of size at most @p max_length in @p network between the initial and final nodes of any of the pairs given, for
+ * solving several pairs with the same variables (the initial and final nodes of @p network are not used). Only φ2 depends on the pair: it is built by
+ * tn_initial_stack_at and tn_final_stack_at, while the other formulae are shared by all the pairs.
+ * A state is only dead if no path of size up to @p max_length from an initial node of the pairs to a final node of the pairs can go through it.
+ *
+ * @param ctx The solver context.
+ * @param network A Tunnel Network.
+ * @param max_length The largest size of path (it fixes the stack size).
+ * @param num_pairs The number of pairs.
+ * @param initials The initial nodes of the pairs.
+ * @param finals The final nodes of the pairs.
+ * @return TunnelEncoding The encoding.
+ * @pre @p network must be initialized.
+ */
+TunnelEncoding tn_encoding_create_for_pairs(Z3_context ctx, const TunnelNetwork network, int max_length, int num_pairs, const int *initials, const int *finals);
+
+/**
+ * @brief Deallocates the table of @p enc. Formulae built with it stay valid (they belong to the context).
+ *
+ * @param enc The encoding.
+ */
+void tn_encoding_delete(TunnelEncoding enc);
 
 /**
  * @brief Generates a propositional formula satisfiable if and only if there is a well-formed simple path of size @p bound from the initial node of @p network to its final node.
@@ -53,93 +145,159 @@ void tn_print_model(Z3_context ctx, Z3_model model, TunnelNetwork network, int b
 /**
  * @brief φ1 : Existence, single operation, and single height.
  * 
- * @param ctx The solver context.
- * @param network The graph
- * @param length The length of the sought path.
+ * @param enc The encoding.
  * @return Z3_ast
  */
-Z3_ast tn_exist_uniqueOp_uniqueHeight(Z3_context ctx, const TunnelNetwork network, int length);
+Z3_ast tn_exist_uniqueOp_uniqueHeight(TunnelEncoding enc);
 
 
 /**
  * @brief φ2 : Initial and final stack
  * 
- * @param ctx The solver context.
- * @param network The graph
- * @param length The length of the sought path.
+ * @param enc The encoding.
+ * @return Z3_ast
+ */
+Z3_ast tn_init_final_stack(TunnelEncoding enc);
+
+
+/**
+ * @brief First half of φ2 : the path starts at the initial node with the stack containing only 4.
+ *
+ * @param enc The encoding.
  * @return Z3_ast
  */
-Z3_ast tn_init_final_stack(Z3_context ctx, const TunnelNetwork network, int length);
+Z3_ast tn_initial_stack(TunnelEncoding enc);
 
+/**
+ * @brief Second half of φ2 : the path is at the final node at position @p pos with the stack containing only 4.
+ *
+ * @param enc The encoding.
+ * @param pos The last position of the path (i.e. its length).
+ * @return Z3_ast
+ */
+Z3_ast tn_final_stack(TunnelEncoding enc, int pos);
+
+/**
+ * @brief First half of φ2 for the initial node @p node instead of the one of the network.
+ *
+ * @param enc The encoding.
+ * @param node The initial node.
+ * @return Z3_ast
+ */
+Z3_ast tn_initial_stack_at(TunnelEncoding enc, int node);
+
+/**
+ * @brief Second half of φ2 for the final node @p node instead of the one of the network.
+ *
+ * @param enc The encoding.
+ * @param node The final node.
+ * @param pos The last position of the path (i.e. its length).
+ * @return Z3_ast
+ */
+Z3_ast tn_final_stack_at(TunnelEncoding enc, int node, int pos);
 
 /**
  * @brief φ3 : Stack height transition rule for Transmission
  * 
- * @param length The length of the sought path.
+ * @param enc The encoding.
  * @param pos The current position of the path.
  * @return Z3_ast
  */
-Z3_ast tn_transition_stack_height(Z3_context ctx, TunnelNetwork network, int length, int pos);
+Z3_ast tn_transition_stack_height(TunnelEncoding enc, int pos);
 
 /**
  * @brief φ4 : Stack height transition rule for Encapsulation
  * 
- * @param length The length of the sought path.
+ * @param enc The encoding.
  * @param pos The current position in the path.
  * @return Z3_ast
  */
-Z3_ast tn_encapsulation_stack_height(Z3_context ctx, TunnelNetwork network, int length, int pos);
+Z3_ast tn_encapsulation_stack_height(TunnelEncoding enc, int pos);
 
 /**
  * @brief φ5 : Stack height transition rule for Decapsulation
  * 
- * @param length The length of the sought path.
+ * @param enc The encoding.
  * @param pos The current position in the path.
  * @return Z3_ast
  */
-Z3_ast tn_decapsulation_stack_height(Z3_context ctx, TunnelNetwork network, int length, int pos);
+Z3_ast tn_decapsulation_stack_height(TunnelEncoding enc, int pos);
 
 /**
- * @brief φ6 : Stack content coherence (exactly with one protocol (4 or 6))
+ * @brief φ6 : Stack content coherence (exactly with one protocol (4 or 6)). It is true with compact cells.
  * 
- * @param ctx The solver context.
- * @param length The length of the sought path.
+ * @param enc The encoding.
  * @param pos The current position in the path.
  * @return Z3_ast 
  */
-Z3_ast tn_stack_content_coherence(Z3_context ctx, int length, int pos);
+Z3_ast tn_stack_content_coherence(TunnelEncoding enc, int pos);
 
 /**
  * @brief φ7 :  Conditions necessary for an operation to be feasible
  * 
- * @param ctx The solver context.
- * @param network The graph.
- * @param length The length of the sought path.
+ * @param enc The encoding.
  * @param pos The current position in the path.
  * @return Z3_ast 
  */
-Z3_ast tn_operation_feasibility(Z3_context ctx, TunnelNetwork network, int length, int pos);
+Z3_ast tn_operation_feasibility(TunnelEncoding enc, int pos);
 
 /**
  * @brief φ8  φ9  φ10 : Stack preservation logic for Transmission, Encapsulation, and Decapsulation
  * 
- * @param ctx The solver context.
- * @param network The graph
- * @param length The length of the sought path.
+ * @param enc The encoding.
  * @return Z3_ast
  */
-Z3_ast tn_stack_preservation_logic(Z3_context ctx, const TunnelNetwork network, int length);
+Z3_ast tn_stack_preservation_logic(TunnelEncoding enc);
 
 /**
  * @brief φ11 : Verification of constraints on transitions
  * 
  * @details if we are at (u, pos, h), then at pos+1 we must be in a successor of u
- * @param ctx The solver context.
- * @param network The graph
- * @param length The length of the sought path.
+ * @param enc The encoding.
+ * @return Z3_ast
+ */
+
+Z3_ast tn_edge_constraints(TunnelEncoding enc);
+
+/**
+ * @brief Definitions of the height variables at position @p pos : H_{pos,h} is true if and only if some node is active at (pos, h).
+ * φ3, φ4, φ5 and φ8  φ9  φ10 refer to H_{pos,h} instead of repeating the disjunction over the nodes.
+ *
+ * @param enc The encoding.
+ * @param pos The position.
+ * @return Z3_ast
+ */
+Z3_ast tn_height_definitions(TunnelEncoding enc, int pos);
+
+/**
+ * @brief Constraints on the state at position @p pos alone : φ1 (a single pair node, height), φ6 (stack content coherence) and the definitions of the height variables, restricted to @p pos.
+ * The conjunction of these for every position, of the transition constraints and of φ2 is equivalent to tn_reduction.
+ *
+ * @param enc The encoding.
+ * @param pos The position constrained.
  * @return Z3_ast
  */
+Z3_ast tn_state_constraints(TunnelEncoding enc, int pos);
 
-Z3_ast tn_edge_constraints(Z3_context ctx, const TunnelNetwork network, int length);
+/**
+ * @brief Constraints on the transition from position @p pos to position @p pos+1 : φ3, φ4, φ5, φ7, φ8, φ9, φ10 and φ11 restricted to @p pos.
+ *
+ * @param enc The encoding.
+ * @param pos The source position of the transition.
+ * @return Z3_ast
+ */
+Z3_ast tn_transition_constraints(TunnelEncoding enc, int pos);
+
+/**
+ * @brief Splits the paths of @p enc by their state at position @p pos: each cube is the variable x_{node,pos,height} of a live state. φ1 makes exactly one
+ * of them true in any model of the reduction, so the reduction is satisfiable if and only if it is under one of the cubes, and the cubes can be solved
+ * independently (as assumptions).
+ *
+ * @param enc The encoding.
+ * @param pos The path position split on.
+ * @param num_cubes Set to the number of cubes.
+ * @return Z3_ast* The cubes, to be freed with free.
+ */
+Z3_ast *tn_state_cubes(TunnelEncoding enc, int pos, int *num_cubes);
 
 #endif
\ No newline at end of file
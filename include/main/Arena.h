@@ -0,0 +1,84 @@
+/**
+ * @file Arena.h
+ * @brief Bump allocator: memory is taken from large blocks, and only released all at once when the arena is reset or deleted.
+ *        Used to store the lists built while parsing a file, and the parts of the resulting Graph that can be shared with them,
+ *        and as scratch memory for the temporary arrays of the reductions.
+ * @version 1
+ * @date 2025-12-03
+ *
+ * @copyright Creative Commons
+ *
+ */
+
+#ifndef COCA_ARENA_H_
+#define COCA_ARENA_H_
+
+#include <stddef.h>
+#include <stdbool.h>
+
+/**
+ * @brief An arena.
+ *
+ */
+typedef struct Arena_s *Arena;
+
+/**
+ * @brief Creates an empty arena.
+ *
+ * @param block_size The size of its blocks (allocations larger than this get their own block).
+ * @return Arena The arena, or NULL in case of no memory.
+ */
+Arena arena_create(size_t block_size);
+
+/**
+ * @brief Allocates @p size bytes in @p arena, aligned for any type. The memory is not initialized.
+ *
+ * @param arena An arena.
+ * @param size A number of bytes.
+ * @return void* The memory, valid until the arena is deleted, or NULL in case of no memory.
+ */
+void *arena_alloc(Arena arena, size_t size);
+
+/**
+ * @brief Copies @p string in @p arena.
+ *
+ * @param arena An arena.
+ * @param string A string.
+ * @return char* The copy, or NULL in case of no memory.
+ */
+char *arena_strdup(Arena arena, const char *string);
+
+/**
+ * @brief Gives @p arena the ownership of a memory mapping: it is unmapped when the arena is deleted.
+ *
+ * @param arena An arena.
+ * @param address The start of the mapping (as returned by mmap).
+ * @param length The length of the mapping.
+ * @return bool false in case of no memory (the mapping is then not owned by @p arena).
+ */
+bool arena_attach_mapping(Arena arena, void *address, size_t length);
+
+/**
+ * @brief Releases all the memory given by @p arena (and its mappings), but keeps its blocks for the next allocations: an arena reset between
+ *        similar uses (a scratch arena) only calls malloc until it has reached the size they need.
+ *
+ * @param arena An arena.
+ */
+void arena_reset(Arena arena);
+
+/**
+ * @brief Gets the number of bytes reserved by @p arena.
+ *
+ * @param arena An arena.
+ * @return size_t
+ */
+size_t arena_get_size(Arena arena);
+
+/**
+ * @brief Releases all the memory of @p arena.
+ *
+ * @param arena An arena (may be NULL).
+ */
+void arena_delete(Arena arena);
+
+#endif
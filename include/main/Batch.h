@@ -0,0 +1,73 @@
+/**
+ * @file Batch.h
+ * @brief Batch mode: solves the selected problem (with its reduction) on many inputs with a pool of worker threads, each owning its Z3 context,
+ *        and writes one machine-readable result line per input (CSV or JSON Lines).
+ *        Inputs are files in dot format, directories (all their .dot files) or manifests (written @FILE, one path per line, lines starting with # ignored).
+ * @version 1
+ * @date 2025-11-28
+ *
+ * @copyright Creative Commons
+ *
+ */
+
+#ifndef COCA_BATCH_H_
+#define COCA_BATCH_H_
+
+#include <stdio.h>
+#include <stdbool.h>
+
+/**
+ * @brief The problems that can be solved in batch.
+ *
+ */
+typedef enum
+{
+    batch_colouring, ///< Colouring, the value is the number of colours.
+    batch_tunnel     ///< Tunnel, the value is the largest size of path tried.
+} batch_problem;
+
+/**
+ * @brief The formats of the results.
+ *
+ */
+typedef enum
+{
+    batch_csv,  ///< A header line then one comma separated line per input.
+    batch_jsonl ///< One JSON object per line.
+} batch_format;
+
+/**
+ * @brief The configuration of a batch.
+ *
+ */
+typedef struct
+{
+    batch_problem problem; ///< The problem solved on every input.
+    int value;             ///< The value associated with the problem (see batch_problem).
+    bool incremental;      ///< For Tunnel: use the incremental solver for the sizes of each input.
+    int num_threads;       ///< The number of workers.
+    batch_format format;   ///< The format of the results.
+    FILE *output;          ///< Where the results are written.
+} BatchConfig;
+
+/**
+ * @brief Gets the format named @p name ("csv" or "jsonl").
+ *
+ * @param name A string.
+ * @param format Set to the format if @p name is valid.
+ * @return bool true if @p name is valid.
+ */
+bool batch_format_of_string(const char *name, batch_format *format);
+
+/**
+ * @brief Solves @p config->problem on every input named in @p inputs, and writes the results in @p config->output, in the order in which they finish.
+ *        An input that cannot be read gives a result "error".
+ *
+ * @param inputs Names of files, directories or manifests.
+ * @param num_inputs The size of @p inputs.
+ * @param config The configuration.
+ * @return int The number of instances solved.
+ */
+int batch_run(char **inputs, int num_inputs, const BatchConfig *config);
+
+#endif
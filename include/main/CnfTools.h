@@ -0,0 +1,96 @@
+/**
+ * @file CnfTools.h
+ * @brief Clausal back end for the reductions: translates a propositional formula built with Z3 into clauses (Tseitin transformation) stored in a
+ *        compact buffer of integer literals, writes them in DIMACS format, and solves them with an external SAT solver (CaDiCaL, Kissat, Glucose, ...).
+ *        The assignment found by the external solver is turned back into a Z3_model, so that the functions decoding models of the reductions can be used unchanged.
+ * @version 1
+ * @date 2025-11-24
+ *
+ * @copyright Creative Commons
+ *
+ */
+
+#ifndef COCA_CNFTOOLS_H_
+#define COCA_CNFTOOLS_H_
+
+#include <z3.h>
+#include <stdio.h>
+
+/**
+ * @brief A set of clauses. Variables are numbered from 1, a literal is a variable or its opposite, and the clauses are stored one after the other, each ended by a 0 (as in DIMACS).
+ *
+ */
+typedef struct CnfFormula_s *CnfFormula;
+
+/**
+ * @brief Creates an empty set of clauses whose variables will come from formulae of @p ctx.
+ *
+ * @param ctx The solver context.
+ * @return CnfFormula The set of clauses. Must be freed with cnf_delete.
+ */
+CnfFormula cnf_create(Z3_context ctx);
+
+/**
+ * @brief Frees @p cnf.
+ *
+ * @param cnf A set of clauses.
+ */
+void cnf_delete(CnfFormula cnf);
+
+/**
+ * @brief Adds to @p cnf clauses equisatisfiable with @p formula. Each variable of @p formula gets a single DIMACS variable, each connective a fresh one defined by its Tseitin clauses.
+ *        Supported connectives are true, false, not, and, or, implies, iff (or equality between booleans), xor and if-then-else: pseudo-boolean constraints
+ *        (the "native" at most one encoding) are not, and exit the program.
+ *
+ * @param cnf A set of clauses.
+ * @param formula A propositional formula.
+ */
+void cnf_add_formula(CnfFormula cnf, Z3_ast formula);
+
+/**
+ * @brief The number of variables of @p cnf.
+ *
+ * @param cnf A set of clauses.
+ * @return int
+ */
+int cnf_get_num_vars(CnfFormula cnf);
+
+/**
+ * @brief The number of clauses of @p cnf.
+ *
+ * @param cnf A set of clauses.
+ * @return int
+ */
+int cnf_get_num_clauses(CnfFormula cnf);
+
+/**
+ * @brief Writes @p cnf in DIMACS format in @p file.
+ *
+ * @param cnf A set of clauses.
+ * @param file An open file.
+ */
+void cnf_write_dimacs(CnfFormula cnf, FILE *file);
+
+/**
+ * @brief Solves @p cnf with the external solver @p solver, called as "solver file.cnf". Its output must follow the format of the SAT competitions
+ *        ("s SATISFIABLE" or "s UNSATISFIABLE", and the assignment on lines starting with "v").
+ *
+ * @param cnf A set of clauses.
+ * @param solver The command of the solver (it can contain options, e.g. "kissat -q").
+ * @param model Set to a model giving to each variable of the formulae added to @p cnf its value, if the result is Z3_L_TRUE. Its reference count is incremented, as in solve_formula.
+ * @return Z3_lbool Z3_L_TRUE if @p cnf is satisfiable, Z3_L_FALSE if it is not, and Z3_L_UNDEF if the solver could not be run or gave no answer.
+ */
+Z3_lbool cnf_solve(CnfFormula cnf, const char *solver, Z3_model *model);
+
+/**
+ * @brief Same as solve_formula, but translates @p formula into clauses and solves them with the external solver @p solver (see cnf_solve).
+ *
+ * @param ctx The solver context.
+ * @param formula A propositional formula.
+ * @param solver The command of the solver.
+ * @param model Set to a model of @p formula if the result is Z3_L_TRUE.
+ * @return Z3_lbool Z3_L_FALSE if @p formula is unsatisfiable, Z3_L_TRUE if @p formula is satisfiable and Z3_L_UNDEF if the solver cannot decide.
+ */
+Z3_lbool cnf_solve_formula(Z3_context ctx, Z3_ast formula, const char *solver, Z3_model *model);
+
+#endif
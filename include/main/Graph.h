@@ -15,6 +15,7 @@
 
 #include <stdbool.h>
 #include <stdio.h>
+#include "Arena.h"
 
 /**
  * @brief List of arbitrary parameters
@@ -33,6 +34,16 @@ typedef struct tag_paramList
  */
 parameterList *parameter_list_add_parameter(parameterList *list, char *name, char *value);
 
+/**
+ * @brief Creates a list containing only the parameter (@p name, @p value), allocated in @p arena. The strings are not copied.
+ *
+ * @param arena The arena owning the list.
+ * @param name The name of the parameter (must live as long as @p arena).
+ * @param value The value of the parameter (must live as long as @p arena).
+ * @return parameterList* The list, or NULL in case of no memory.
+ */
+parameterList *parameter_list_create_in_arena(Arena arena, char *name, char *value);
+
 /**
  * @brief Appends tail to head and returns a pointer to the result.
  *
@@ -74,11 +85,41 @@ typedef struct
 	bool *edges;  ///< The edges of the graph.
 
 	parameterList **parameters;		 ///< Parameters of the nodes.
-	parameterList **edge_parameters; ///< Parameters of the edges
+	int numEdgeParameterLists;			  ///< The number of distinct lists of parameters of the edges.
+	parameterList **edge_parameter_lists; ///< The distinct lists of parameters of the edges (edges with the same parameters share their list).
+	int *edge_parameters;				  ///< Parameters of the edges, aligned with successors: the parameters of the edge successors[i] are edge_parameter_lists[edge_parameters[i]] (none if -1).
+
+	int *successor_offsets;	  ///< The successors of node u are successors[successor_offsets[u]] to successors[successor_offsets[u+1]-1] (numNodes+1 cells).
+	int *successors;		  ///< The targets of the edges, grouped by source and sorted (compressed sparse rows).
+	int *predecessor_offsets; ///< The predecessors of node u are predecessors[predecessor_offsets[u]] to predecessors[predecessor_offsets[u+1]-1] (numNodes+1 cells).
+	int *predecessors;		  ///< The sources of the edges, grouped by target and sorted.
+
+	Arena arena; ///< If not NULL, owns the name, the names of the nodes, the lists of parameters (shared with the lists of the parser) and all the arrays above, which are then released all at once.
 } Graph;
 
 /**
- * @brief Creates a copy of the graph passed in argument.
+ * @brief Allocates @p size bytes for an array of @p graph: in its arena if it has one, with malloc otherwise. Either way, graph_delete releases it.
+ *
+ * @param graph A graph.
+ * @param size A number of bytes.
+ * @return void* The memory (not initialized).
+ */
+void *graph_alloc(Graph *graph, size_t size);
+
+/**
+ * @brief Builds the successor and predecessor index of @p graph (and its edge parameters) from a list of arcs. The dense matrix of edges is not modified.
+ *        If an arc appears several times, its last occurrence gives its parameters.
+ *
+ * @param graph A graph whose nodes are set.
+ * @param num_arcs The number of arcs.
+ * @param sources The sources of the arcs.
+ * @param targets The targets of the arcs.
+ * @param parameters The parameters of the arcs (may contain NULL). If graph->arena is NULL, they are copied, once for all the arcs having the same parameters (same names and values in the same order). Otherwise they must belong to the arena, and are shared.
+ */
+void graph_build_adjacency(Graph *graph, int num_arcs, const int *sources, const int *targets, parameterList **parameters);
+
+/**
+ * @brief Creates a copy of the graph passed in argument. The copy owns all its fields (it does not share the arena of @p graph).
  *
  * @param graph A graph.
  * @return graph A copy of graph.
@@ -158,6 +199,30 @@ bool graph_is_edge(Graph graph, int source, int target);
  */
 parameterList *graph_get_edge_parameter(Graph graph, int source, int target);
 
+/**
+ * @brief Returns the successors of @p node in @p graph, sorted by increasing number. For an undirected graph, these are its neighbours.
+ *
+ * @param graph A graph.
+ * @param node A node.
+ * @param count Set to the number of successors.
+ * @return const int* The successors (owned by @p graph).
+ * @pre @p graph must be a valid graph.
+ * @pre 0 <= @p node < @p graph.numNodes
+ */
+const int *graph_successors(Graph graph, int node, int *count);
+
+/**
+ * @brief Returns the predecessors of @p node in @p graph, sorted by increasing number.
+ *
+ * @param graph A graph.
+ * @param node A node.
+ * @param count Set to the number of predecessors.
+ * @return const int* The predecessors (owned by @p graph).
+ * @pre @p graph must be a valid graph.
+ * @pre 0 <= @p node < @p graph.numNodes
+ */
+const int *graph_predecessors(Graph graph, int node, int *count);
+
 /**
  * @brief Return the parameter list associated to node @p node. Returns NULL if no parameter exists.
  *
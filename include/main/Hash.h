@@ -0,0 +1,42 @@
+/**
+ * @file Hash.h
+ * @brief 64-bit FNV-1a hash, shared by the indexes of the parser and of the graphs and by the hash of the files of the binary cache.
+ *        A hash is computed by starting from HASH_INIT and feeding it the bytes one piece after the other.
+ * @version 1
+ * @date 2025-12-10
+ *
+ * @copyright Creative Commons
+ *
+ */
+
+#ifndef COCA_HASH_H_
+#define COCA_HASH_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * @brief The hash of no byte (the FNV-1a offset basis).
+ */
+#define HASH_INIT 14695981039346656037ULL
+
+/**
+ * @brief Feeds @p size bytes to @p hash.
+ *
+ * @param hash The hash of the bytes before.
+ * @param bytes The bytes.
+ * @param size The number of bytes.
+ * @return uint64_t The hash of the bytes before followed by @p bytes.
+ */
+uint64_t hash_bytes(uint64_t hash, const void *bytes, size_t size);
+
+/**
+ * @brief Feeds the characters of @p string (without its null byte) to @p hash.
+ *
+ * @param hash The hash of the bytes before.
+ * @param string A string.
+ * @return uint64_t The hash of the bytes before followed by @p string.
+ */
+uint64_t hash_string(uint64_t hash, const char *string);
+
+#endif
@@ -24,4 +24,13 @@
  */
 Graph get_graph_from_file(char *toRead);
 
+/**
+ * @brief Same as get_graph_from_file, but reports the files that cannot be read or parsed instead of exiting. The messages of the parser are written on the standard error.
+ *
+ * @param toRead the name of a file in graphviz format.
+ * @param graph Set to the parsed Graph if the result is true (otherwise, will not be modified).
+ * @return bool false if @p toRead cannot be opened or is not a valid graphviz file.
+ */
+bool try_get_graph_from_file(char *toRead, Graph *graph);
+
 #endif
\ No newline at end of file
@@ -0,0 +1,88 @@
+/**
+ * @file Portfolio.h
+ * @brief Races the brute force and the reduction of a problem on two threads: the first one to finish gives the answer, and the other one is cancelled.
+ *        The brute force is cancelled through a stop flag it polls, the reduction by interrupting the Z3 context it registered.
+ * @version 1
+ * @date 2025-11-26
+ *
+ * @copyright Creative Commons
+ *
+ */
+
+#ifndef COCA_PORTFOLIO_H_
+#define COCA_PORTFOLIO_H_
+
+#include <z3.h>
+#include <stdbool.h>
+#include <stdatomic.h>
+
+/**
+ * @brief The engines of a race.
+ *
+ */
+typedef enum
+{
+    engine_brute_force, ///< The brute force algorithm.
+    engine_reduction    ///< The reduction to SAT.
+} portfolio_engine;
+
+/**
+ * @brief The state of a race, shared by both engines.
+ *
+ */
+typedef struct Portfolio_s *Portfolio;
+
+/**
+ * @brief A task run by an engine. It writes its result in @p data (each engine must use its own part of it).
+ *
+ * @param portfolio The race, to get the stop flag or register a context.
+ * @param data The data given to portfolio_race.
+ */
+typedef void (*portfolio_task)(Portfolio portfolio, void *data);
+
+/**
+ * @brief Runs @p brute_force and @p reduction on two threads and waits for the first one to finish. The other one is then cancelled, and both threads are joined before returning.
+ *
+ * @param brute_force The task of the brute force.
+ * @param reduction The task of the reduction.
+ * @param data The data given to both tasks.
+ * @return portfolio_engine The engine that finished first.
+ */
+portfolio_engine portfolio_race(portfolio_task brute_force, portfolio_task reduction, void *data);
+
+/**
+ * @brief The flag raised when @p engine has to stop. Brute forces poll it.
+ *
+ * @param portfolio The race.
+ * @param engine An engine.
+ * @return const atomic_bool*
+ */
+const atomic_bool *portfolio_stop_flag(Portfolio portfolio, portfolio_engine engine);
+
+/**
+ * @brief Registers the context used by the reduction, so that it can be interrupted if the brute force finishes first. The context must stay alive until portfolio_race returns,
+ *        or be unregistered (with NULL) before being deleted.
+ *
+ * @param portfolio The race.
+ * @param ctx The context of the reduction, or NULL.
+ */
+void portfolio_set_context(Portfolio portfolio, Z3_context ctx);
+
+/**
+ * @brief Claims the answer of the reduction once its solver returned: unless the reduction was asked to stop, its context is unregistered, so that it is no
+ *        longer interrupted while the model is read and decoded (an interrupted context fails on the next calls, such as getting the model).
+ *
+ * @param portfolio The race.
+ * @return bool true if the answer can be used, false if the reduction was asked to stop (the answer is then discarded).
+ */
+bool portfolio_claim(Portfolio portfolio);
+
+/**
+ * @brief Gets the name of @p engine.
+ *
+ * @param engine An engine.
+ * @return char*
+ */
+char *portfolio_string_of_engine(portfolio_engine engine);
+
+#endif
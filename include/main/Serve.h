@@ -0,0 +1,44 @@
+/**
+ * @file Serve.h
+ * @brief Service mode of the Tunnel problem (--serve): a long-running process reading requests as JSON Lines (on the standard input or on the
+ *        connections of a Unix socket) and streaming one JSON result line per request.
+ *        Networks are cached by the hash of the content of their file, each with its own Z3 context, and each (initial, final) pair asked on a network
+ *        keeps its incremental solver and what it already proved: repeating a query, or asking it again with a larger bound, does not parse the
+ *        file again and does not re-check the sizes already decided.
+ *
+ *        A request is an object with the members "file" (the .dot or .tnb file of the network, required), "bound" (the largest size of path tried),
+ *        "initial" and "final" (a node name, or a node index, overriding the nodes given by the shapes of the file) and "id" (any string or number,
+ *        copied into the result). A request {"stop": true} ends the service. The result has the members "id", "file", "result" ("sat", "unsat", "unknown" or "error"), "bound", "length" and
+ *        "path" (the shortest path found, as its steps), "reused" ("answer", "solver", "network" or "none": the most that was taken from the cache),
+ *        "time" (in seconds) and, for an error, "error".
+ * @version 1
+ * @date 2025-12-08
+ *
+ * @copyright Creative Commons
+ *
+ */
+
+#ifndef COCA_SERVE_H_
+#define COCA_SERVE_H_
+
+/**
+ * @brief The configuration of the service.
+ *
+ */
+typedef struct
+{
+    int bound;          ///< The bound of the requests that do not give one.
+    int max_networks;   ///< The number of networks kept in the cache (the least recently used one is dropped first).
+    const char *socket; ///< The path of the Unix socket to listen on, or NULL to serve the standard input.
+} ServeConfig;
+
+/**
+ * @brief Serves the requests until the end of the standard input or, with a socket, forever (the connections are served one after the other).
+ *        On the standard input, the results are the only output: the messages of the solvers, if any, are written on the standard error.
+ *
+ * @param config The configuration.
+ * @return int The number of requests served, or -1 if the socket could not be opened.
+ */
+int serve_run(const ServeConfig *config);
+
+#endif
@@ -0,0 +1,69 @@
+/**
+ * @file Statistics.h
+ * @brief Instrumentation of the reductions and of the solver (--stats): build time, number of AST nodes, of variables and of clauses of each part of a
+ *        formula, and the statistics of Z3 after each check. Each measure is written as one JSON object per line, so that it can be extracted from the
+ *        output and aggregated (by the bench harness for instance).
+ * @version 1
+ * @date 2025-12-06
+ *
+ * @copyright Creative Commons
+ *
+ */
+
+#ifndef COCA_STATISTICS_H_
+#define COCA_STATISTICS_H_
+
+#include <z3.h>
+#include <stdio.h>
+#include <stdbool.h>
+#include <time.h>
+
+/**
+ * @brief Sets where the statistics are written (NULL by default, which disables them). Meant to be called once at the start of the program.
+ *
+ * @param output A stream, or NULL.
+ */
+void set_statistics_output(FILE *output);
+
+/**
+ * @brief Tells if the statistics are enabled.
+ *
+ * @return bool
+ */
+bool statistics_enabled(void);
+
+/**
+ * @brief Wall-clock time elapsed since @p start, which is then set to now: successive calls give the time of successive steps.
+ *
+ * @param start A time taken with clock_gettime(CLOCK_MONOTONIC, ...).
+ * @return double The time elapsed, in milliseconds.
+ */
+double statistics_lap(struct timespec *start);
+
+/**
+ * @brief Writes the statistics of a formula built in parts (if enabled): for each part and for their conjunction, the build time, the number of distinct
+ *        AST nodes, the number of distinct variables and the number of clauses of its Tseitin transformation (-1 with the native at most one encoding,
+ *        which has no clausal form).
+ *
+ * @param ctx The solver context.
+ * @param reduction The name of the reduction.
+ * @param bound The bound of the reduction (number of colours, size of path).
+ * @param num_parts The number of parts.
+ * @param names The names of the parts.
+ * @param parts The parts.
+ * @param times The build time of each part, in milliseconds.
+ */
+void statistics_print_formula(Z3_context ctx, const char *reduction, int bound, int num_parts, const char *const *names, const Z3_ast *parts, const double *times);
+
+/**
+ * @brief Writes the statistics of @p solver after a check (if enabled): its result, its time, and the numbers of conflicts, decisions and propagations
+ *        and the memory reported by Z3.
+ *
+ * @param ctx The solver context.
+ * @param solver A solver that has just been checked.
+ * @param result The result of the check.
+ * @param time The time of the check, in milliseconds.
+ */
+void statistics_print_solver(Z3_context ctx, Z3_solver solver, Z3_lbool result, double time);
+
+#endif
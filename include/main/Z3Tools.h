@@ -16,14 +16,78 @@
 
 #include <z3.h>
 #include <stdbool.h>
+#include <stdio.h>
 
 /**
- * @brief Creates a basic Z3 context with basic config (sufficient for this project). Must be freed at end of program with Z3_del_context.
+ * @brief Creates a basic Z3 context with basic config (sufficient for this project), and the timeout set by set_solver_limits as the default timeout of its
+ *        solvers. Must be freed at end of program with Z3_del_context.
  * 
  * @return Z3_context The created context
  */
 Z3_context make_context(void);
 
+/**
+ * @brief The configurations of the solvers created by mk_solver.
+ *
+ */
+typedef enum
+{
+    solver_default,    ///< The general solver of Z3 (Z3_mk_solver), which picks its engine from the formula.
+    solver_sat,        ///< The solver of Z3 for finite domains (logic QF_FD), which goes straight to the SAT engine on propositional formulae.
+    solver_preprocess, ///< The tactics simplify, propagate-values, solve-eqs, elim-uncnstr and simplify again before the smt tactic.
+    solver_parallel    ///< The general solver, with the parallel SAT and SMT engines on the number of threads set by set_solver_threads.
+} solver_profile;
+
+/**
+ * @brief Sets the configuration of the solvers created by mk_solver (solver_default by default). Meant to be called once at the start of the program.
+ *
+ * @param profile The profile to use from now on.
+ */
+void set_solver_profile(solver_profile profile);
+
+/**
+ * @brief Gets the configuration of the solvers created by mk_solver.
+ *
+ * @return solver_profile The current profile.
+ */
+solver_profile get_solver_profile(void);
+
+/**
+ * @brief Gets the profile whose name is @p name ("default", "sat", "preprocess" or "parallel").
+ *
+ * @param name A name of profile.
+ * @param profile Will contain the profile named @p name if it exists (otherwise, will not be modified).
+ * @return true if @p name is the name of a profile.
+ * @return false otherwise.
+ */
+bool solver_profile_of_string(const char *name, solver_profile *profile);
+
+/**
+ * @brief Sets the number of threads of the solver_parallel profile (0, the default, for the number of processors). Meant to be called once at the start of the
+ *        program.
+ *
+ * @param threads A number of threads.
+ */
+void set_solver_threads(unsigned threads);
+
+/**
+ * @brief Sets the limits of each call to a solver created by mk_solver: past them, the call gives up and answers Z3_L_UNDEF. Meant to be called once at the
+ *        start of the program.
+ *
+ * @param timeout The time limit of a call, in milliseconds (0, the default, for none).
+ * @param memory The memory limit of the SAT engine, in megabytes (0, the default, for none).
+ */
+void set_solver_limits(unsigned timeout, unsigned memory);
+
+/**
+ * @brief Creates a solver with the profile and the limits set by set_solver_profile, set_solver_threads and set_solver_limits. Every solver of the program
+ *        should be created by this function.
+ *
+ * @param ctx The solver context.
+ * @return Z3_solver The solver, already referenced: must be released with Z3_solver_dec_ref.
+ */
+Z3_solver mk_solver(Z3_context ctx);
+
 /**
  * @brief Creates a formula containing a single variable whose name is given in parameter. Example mk_bool_var(ctx,"toto") will create the formula «toto». Each call with
  *        same name will produce the same formula (so it can be used to have the same variable in different formulae.)
@@ -35,7 +99,62 @@ Z3_context make_context(void);
 Z3_ast mk_bool_var(Z3_context ctx, const char *name);
 
 /**
- * @brief Generates a formula stating that at most one of the formulae from @p formulae is true.
+ * @brief Bound (excluded) on the integer names accepted by mk_indexed_bool_var (limit of Z3_mk_int_symbol).
+ *
+ */
+#define MAX_INDEXED_VAR (1 << 30)
+
+/**
+ * @brief Creates a formula containing a single variable whose name is the integer @p index. Cheaper than mk_bool_var (no string to hash), and never equal
+ *        to a variable created by mk_bool_var. Each call with same index will produce the same formula.
+ *
+ * @param ctx The context of the solver.
+ * @param index The name of the variable.
+ * @return Z3_ast The formula consisting in the variable.
+ * @pre 0 <= @p index < MAX_INDEXED_VAR.
+ */
+Z3_ast mk_indexed_bool_var(Z3_context ctx, int index);
+
+/**
+ * @brief The ways of encoding "at most one of these formulae is true".
+ *
+ */
+typedef enum
+{
+    amo_auto,       ///< Pairwise for small sizes, sequential counter otherwise.
+    amo_pairwise,   ///< One binary clause per pair: quadratic size, no auxiliary variable.
+    amo_sequential, ///< Sequential counter (Sinz): 3n clauses, n-1 auxiliary variables.
+    amo_commander,  ///< Commander encoding with groups of 3: linear size, about n/2 auxiliary variables.
+    amo_native      ///< Z3 pseudo-boolean constraints (Z3_mk_atmost, Z3_mk_pbeq): constant size.
+} amo_encoding;
+
+/**
+ * @brief Sets the encoding used by at_most_formula and uniqueFormula (amo_auto by default). Meant to be called once at the start of the program.
+ *
+ * @param encoding The encoding to use from now on.
+ */
+void set_amo_encoding(amo_encoding encoding);
+
+/**
+ * @brief Gets the encoding used by at_most_formula and uniqueFormula.
+ *
+ * @return amo_encoding The current encoding.
+ */
+amo_encoding get_amo_encoding(void);
+
+/**
+ * @brief Gets the encoding whose name is @p name ("auto", "pairwise", "sequential", "commander" or "native").
+ *
+ * @param name A name of encoding.
+ * @param encoding Will contain the encoding named @p name if it exists (otherwise, will not be modified).
+ * @return true if @p name is the name of an encoding.
+ * @return false otherwise.
+ */
+bool amo_encoding_of_string(const char *name, amo_encoding *encoding);
+
+/**
+ * @brief Generates a formula stating that at most one of the formulae from @p formulae is true, with the encoding set by set_amo_encoding.
+ * Sequential and commander encodings introduce fresh auxiliary variables.
  *
  * @param ctx The solver context.
  * @param formulae The formulae.
@@ -45,7 +164,7 @@ Z3_ast mk_bool_var(Z3_context ctx, const char *name);
 Z3_ast at_most_formula(Z3_context ctx, Z3_ast *formulae, int size);
 
 /**
- * @brief Generates a formula stating that exactly one of the formulae from @p formulae is true.
+ * @brief Generates a formula stating that exactly one of the formulae from @p formulae is true, with the encoding set by set_amo_encoding.
  *
  * @param ctx The solver context.
  * @param formulae The formulae.
@@ -73,6 +192,16 @@ Z3_lbool is_formula_sat(Z3_context ctx, Z3_ast formula);
  */
 Z3_model get_model_from_sat_formula(Z3_context ctx, Z3_ast formula);
 
+/**
+ * @brief Asserts @p formula in @p solver and checks it. Unlike solve_formula, the model is not read: it can be got afterwards with Z3_solver_get_model.
+ *
+ * @param ctx The context of the solver.
+ * @param solver A solver of @p ctx.
+ * @param formula The formula to check.
+ * @return Z3_lbool Z3_L_FALSE if @p formula is unsatisfiable, Z3_L_TRUE if @p formula is satisfiable and Z3_L_UNDEF if the solver cannot decide if @p formula is satisfiable or not.
+ */
+Z3_lbool check_formula(Z3_context ctx, Z3_solver solver, Z3_ast formula);
+
 /**
  * @brief Checks if a formula is satisfiable, unsatisfiable, or cannot be decided. If it is decidable, puts a model in the formula in model.
  * 
@@ -95,4 +224,63 @@ Z3_lbool solve_formula(Z3_context ctx, Z3_ast formula, Z3_model *model);
  */
 bool value_of_var_in_model(Z3_context ctx, Z3_model model, Z3_ast variable);
 
+/**
+ * @brief Gets the names of the variables created by mk_indexed_bool_var that are true in @p model, in a single pass over the constants of @p model: much
+ *        cheaper than calling value_of_var_in_model on every variable when few of them are true. A variable without value in @p model is false.
+ *
+ * @param ctx The context of the solver.
+ * @param model A variable assignment.
+ * @param num_true Set to the number of true variables.
+ * @return int* Their names, in no particular order. Must be freed with free.
+ */
+int *true_indexed_vars_in_model(Z3_context ctx, Z3_model model, int *num_true);
+
+/**
+ * @brief A set of AST ids (Z3_get_ast_id), to go through each node of a formula once: a formula is a DAG whose shared sub-formulae would be repeated in a tree.
+ *
+ */
+typedef struct AstIdSet_s *AstIdSet;
+
+/**
+ * @brief Creates an empty set of AST ids.
+ *
+ * @return AstIdSet The set. Must be freed with ast_id_set_delete.
+ */
+AstIdSet ast_id_set_create(void);
+
+/**
+ * @brief Adds @p id to @p set.
+ *
+ * @param set A set of AST ids.
+ * @param id An AST id.
+ * @return bool false if @p id was already in @p set.
+ */
+bool ast_id_set_add(AstIdSet set, unsigned id);
+
+/**
+ * @brief The number of ids in @p set.
+ *
+ * @param set A set of AST ids.
+ * @return int
+ */
+int ast_id_set_size(AstIdSet set);
+
+/**
+ * @brief Frees @p set.
+ *
+ * @param set A set of AST ids.
+ */
+void ast_id_set_delete(AstIdSet set);
+
+/**
+ * @brief Writes @p formula in SMT-LIB 2 format in @p file, with the commands asserting it and checking its satisfiability: one declare-const per variable,
+ *        then one define-fun per connective, in an order where each definition only uses the previous ones. Each node of the DAG of @p formula is written once,
+ *        so the size of the output is linear in the size of the DAG, and the formula is written as it is traversed, without being held in memory as a string.
+ *
+ * @param ctx The solver context.
+ * @param formula A propositional formula (pseudo-boolean constraints are written with their indexed SMT-LIB names, e.g. (_ at-most 1)).
+ * @param file A file open for writing.
+ */
+void write_formula_smt2(Z3_context ctx, Z3_ast formula, FILE *file);
+
 #endif
\ No newline at end of file
@@ -8,8 +8,12 @@
 
 struct ColouredGraph_s
 {
-    Graph graph;  ///< The graph.
-    int *colours; ///< The colours associated to each node.
+    Graph graph;          ///< The graph.
+    int *colours;         ///< The colours associated to each node.
+    int num_words;        ///< The number of words of a node bitset.
+    uint64_t *adjacency;  ///< The bitsets of the neighbours of each node, num_words words per node.
+    int *word_offsets;    ///< The non-zero words of the bitset of node are words[word_offsets[node]] to words[word_offsets[node+1]-1].
+    int *words;           ///< The indices of the non-zero words of the bitsets of the neighbours.
 };
 
 ColouredGraph cg_initialize(Graph graph)
@@ -20,6 +24,37 @@ ColouredGraph cg_initialize(Graph graph)
     result->colours = (int *)malloc(num_nodes * sizeof(int));
     for (int node = 0; node < num_nodes; node++)
         result->colours[node] = -1;
+
+    int num_words = (num_nodes + CG_NODES_PER_WORD - 1) / CG_NODES_PER_WORD;
+    result->num_words = num_words;
+    result->adjacency = (uint64_t *)calloc((size_t)num_nodes * num_words + 1, sizeof(uint64_t));
+    result->word_offsets = (int *)malloc((num_nodes + 1) * sizeof(int));
+    // A node has at most one non-zero word per neighbour.
+    int num_arcs = 0;
+    for (int node = 0; node < num_nodes; node++)
+    {
+        int num_neighbours;
+        graph_successors(graph, node, &num_neighbours);
+        num_arcs += num_neighbours;
+    }
+    result->words = (int *)malloc((num_arcs + 1) * sizeof(int));
+    int num_non_zero = 0;
+    for (int node = 0; node < num_nodes; node++)
+    {
+        result->word_offsets[node] = num_non_zero;
+        uint64_t *mask = result->adjacency + (size_t)node * num_words;
+        int num_neighbours;
+        const int *neighbours = graph_successors(graph, node, &num_neighbours);
+        // The neighbours are sorted: the words of a node are found in increasing order.
+        for (int i = 0; i < num_neighbours; i++)
+        {
+            int word = neighbours[i] / CG_NODES_PER_WORD;
+            if (mask[word] == 0)
+                result->words[num_non_zero++] = word;
+            mask[word] |= (uint64_t)1 << (neighbours[i] % CG_NODES_PER_WORD);
+        }
+    }
+    result->word_offsets[num_nodes] = num_non_zero;
     return result;
 }
 
@@ -41,6 +76,9 @@ void cg_print_colors(ColouredGraph graph)
 void cg_delete(ColouredGraph graph)
 {
     free(graph->colours);
+    free(graph->adjacency);
+    free(graph->word_offsets);
+    free(graph->words);
     free(graph);
 }
 
@@ -56,7 +94,28 @@ int cg_get_num_edges(ColouredGraph graph)
 
 bool cg_is_edge(ColouredGraph graph, int source, int target)
 {
-    return (graph_is_edge(graph->graph, source, target));
+    return (graph->adjacency[(size_t)source * graph->num_words + target / CG_NODES_PER_WORD] >> (target % CG_NODES_PER_WORD)) & 1;
+}
+
+const int *cg_neighbours(ColouredGraph graph, int node, int *count)
+{
+    return graph_successors(graph->graph, node, count);
+}
+
+int cg_get_num_words(ColouredGraph graph)
+{
+    return graph->num_words;
+}
+
+const uint64_t *cg_neighbour_mask(ColouredGraph graph, int node)
+{
+    return graph->adjacency + (size_t)node * graph->num_words;
+}
+
+const int *cg_neighbour_words(ColouredGraph graph, int node, int *count)
+{
+    *count = graph->word_offsets[node + 1] - graph->word_offsets[node];
+    return graph->words + graph->word_offsets[node];
 }
 
 char *cg_get_node_name(ColouredGraph graph, int node)
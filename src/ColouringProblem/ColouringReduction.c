@@ -1,5 +1,8 @@
 #include "ColouringReduction.h"
 #include "Z3Tools.h"
+#include "Statistics.h"
+#include "ColouringResolution.h"
+#include "Arena.h"
 #include <sys/types.h>
 #include <sys/stat.h>
 #include <unistd.h>
@@ -8,37 +11,115 @@
 #include <assert.h>
 
 /**
- * @brief Creates a formula containing only the variable representing that node @p node has color @p color.
- * 
+ * @brief Whether colouring_reduction adds the symmetry-breaking constraints.
+ */
+static bool symmetry_breaking = false;
+
+void set_colouring_symmetry_breaking(bool enabled)
+{
+    symmetry_breaking = enabled;
+}
+
+bool get_colouring_symmetry_breaking(void)
+{
+    return symmetry_breaking;
+}
+
+/**
+ * @brief Table of the variables of the reduction, so that each variable is created only once.
+ *
+ */
+typedef struct
+{
+    Z3_context ctx;  ///< The solver context.
+    int num_nodes;   ///< The number of nodes of the graph.
+    int num_colours; ///< The number of colours.
+    Z3_ast *vars;    ///< The variables, indexed [node][colour]. A cell is NULL until the variable is first used.
+    Arena scratch;   ///< The temporary arrays of the formula builders, reset after each part of the reduction (see colouring_scratch).
+} ColouringVariables;
+
+/**
+ * @brief Size of the blocks of the scratch arena of a table of variables.
+ */
+#define COLOURING_SCRATCH_BLOCK_SIZE (64 * 1024)
+
+/**
+ * @brief Creates an empty table of variables.
+ *
  * @param ctx The solver context.
+ * @param num_nodes The number of nodes.
+ * @param num_colours The number of colours.
+ * @return ColouringVariables The table.
+ */
+static ColouringVariables colouring_variables_create(Z3_context ctx, int num_nodes, int num_colours)
+{
+    ColouringVariables vars;
+    vars.ctx = ctx;
+    vars.num_nodes = num_nodes;
+    vars.num_colours = num_colours;
+    vars.vars = (Z3_ast *)calloc(num_nodes * num_colours, sizeof(Z3_ast));
+    vars.scratch = arena_create(COLOURING_SCRATCH_BLOCK_SIZE);
+    return vars;
+}
+
+/**
+ * @brief Deallocates a table of variables.
+ *
+ * @param vars The table.
+ */
+static void colouring_variables_delete(ColouringVariables *vars)
+{
+    free(vars->vars);
+    arena_delete(vars->scratch);
+}
+
+/**
+ * @brief Allocates a temporary array of @p size formulae for a formula builder. It is valid until the scratch arena of @p vars is reset, after the part
+ * of the reduction being built, so builders do not free it.
+ *
+ * @param vars The table of variables.
+ * @param size The number of formulae.
+ * @return Z3_ast* The array.
+ */
+static Z3_ast *colouring_scratch(ColouringVariables *vars, int size)
+{
+    return (Z3_ast *)arena_alloc(vars->scratch, (size_t)size * sizeof(Z3_ast));
+}
+
+/**
+ * @brief Gets the variable representing that node @p node has color @p color. Its integer name does not depend on the number of colours.
+ * 
+ * @param vars The table of variables.
  * @param node A node.
  * @param color A color.
  * @return Z3_ast 
  */
-Z3_ast variable_node_color(Z3_context ctx, int node, int color)
+Z3_ast variable_node_color(ColouringVariables *vars, int node, int color)
 {
-    char name[40];
-    snprintf(name, 40, "node %d, color %d", node, color);
-    return mk_bool_var(ctx, name);
+    Z3_ast *var = &vars->vars[node * vars->num_colours + color];
+    if (*var == NULL)
+        *var = mk_indexed_bool_var(vars->ctx, color * vars->num_nodes + node);
+    return *var;
 }
 
 /**
  * @brief Creates the formula stating that the edge (@p node1,@p node2) has its ends of different colours.
  * 
- * @param ctx The solver context.
+ * @param vars The table of variables.
  * @param node1 A node.
  * @param node2 A node.
- * @param num_colours The expected number of colours.
  * @return Z3_ast The formula.
  */
-Z3_ast edge_formula(Z3_context ctx, int node1, int node2, int num_colours)
+Z3_ast edge_formula(ColouringVariables *vars, int node1, int node2)
 {
-    Z3_ast edge_diff[num_colours];
+    Z3_context ctx = vars->ctx;
+    int num_colours = vars->num_colours;
+    Z3_ast *edge_diff = colouring_scratch(vars, num_colours);
     for (int colour = 0; colour < num_colours; colour++)
     {
         Z3_ast col_diff[2];
-        col_diff[0] = Z3_mk_not(ctx, variable_node_color(ctx, node1, colour));
-        col_diff[1] = Z3_mk_not(ctx, variable_node_color(ctx, node2, colour));
+        col_diff[0] = Z3_mk_not(ctx, variable_node_color(vars, node1, colour));
+        col_diff[1] = Z3_mk_not(ctx, variable_node_color(vars, node2, colour));
         edge_diff[colour] = Z3_mk_or(ctx, 2, col_diff);
     }
     return Z3_mk_and(ctx, num_colours, edge_diff);
@@ -47,23 +128,27 @@ Z3_ast edge_formula(Z3_context ctx, int node1, int node2, int num_colours)
 /**
  * @brief Creates the formula stating that all edges have their ends of different colours.
  * 
- * @param ctx The solver context.
+ * @param vars The table of variables.
  * @param graph A ColouredGraph.
- * @param num_colours The expected number of colours.
  * @return Z3_ast The formula.
  */
-Z3_ast edges_have_different_colours_formula(Z3_context ctx, const ColouredGraph graph, int num_colours)
+Z3_ast edges_have_different_colours_formula(ColouringVariables *vars, const ColouredGraph graph)
 {
+    Z3_context ctx = vars->ctx;
     int num_nodes = cg_get_num_nodes(graph);
     int current = 0;
-    Z3_ast edges_formula[num_nodes * num_nodes];
+    // Each edge of the list gives at most one pair node1 < node2.
+    Z3_ast *edges_formula = colouring_scratch(vars, cg_get_num_edges(graph));
     for (int node1 = 0; node1 < num_nodes; node1++)
     {
-        for (int node2 = node1 + 1; node2 < num_nodes; node2++)
+        int num_neighbours;
+        const int *neighbours = cg_neighbours(graph, node1, &num_neighbours);
+        for (int i = 0; i < num_neighbours; i++)
         {
-            if (!cg_is_edge(graph, node1, node2))
+            int node2 = neighbours[i];
+            if (node2 <= node1)
                 continue;
-            edges_formula[current] = edge_formula(ctx, node1, node2, num_colours);
+            edges_formula[current] = edge_formula(vars, node1, node2);
             current++;
         }
     }
@@ -73,56 +158,260 @@ Z3_ast edges_have_different_colours_formula(Z3_context ctx, const ColouredGraph
 /**
  * @brief Creates a formula stating that every node has exactly one colour.
  * 
- * @param ctx The solver context.
- * @param num_nodes The number of nodes.
- * @param num_colours The expected number of colours.
+ * @param vars The table of variables.
  * @return Z3_ast The formula.
  */
-Z3_ast each_node_has_one_colour_formula(Z3_context ctx, int num_nodes, int num_colours)
+Z3_ast each_node_has_one_colour_formula(ColouringVariables *vars)
 {
+    Z3_context ctx = vars->ctx;
+    int num_nodes = vars->num_nodes;
+    int num_colours = vars->num_colours;
 
-    Z3_ast nodes_coloured[num_nodes];
+    Z3_ast *nodes_coloured = colouring_scratch(vars, num_nodes);
+    Z3_ast *node_color_vars = colouring_scratch(vars, num_colours);
     for (int node = 0; node < num_nodes; node++)
     {
-        Z3_ast node_color_vars[num_colours];
         for (int colour = 0; colour < num_colours; colour++)
         {
-            node_color_vars[colour] = variable_node_color(ctx, node, colour);
+            node_color_vars[colour] = variable_node_color(vars, node, colour);
         }
         nodes_coloured[node] = uniqueFormula(ctx, node_color_vars, num_colours);
     }
     return Z3_mk_and(ctx, num_nodes, nodes_coloured);
 }
 
+/**
+ * @brief Gets the auxiliary variable stating that colour @p colour is used by one of the first @p rank+1 nodes outside of the clique (see symmetry_breaking_formula).
+ *
+ * @param ctx The solver context.
+ * @param colour A colour.
+ * @param rank A rank among the nodes outside of the clique.
+ * @return Z3_ast
+ */
+static Z3_ast colour_used_before_variable(Z3_context ctx, int colour, int rank)
+{
+    char name[48];
+    snprintf(name, 48, "colour %d used up to %d", colour, rank);
+    return mk_bool_var(ctx, name);
+}
+
+/**
+ * @brief Creates the symmetry-breaking constraints. Colours are interchangeable, so every colouring can be renamed such that:
+ * the nodes of a clique found greedily have the colours 0, 1, 2..., and the other colours appear in order among the other nodes (value precedence):
+ * a node can only have colour c+1 if an earlier node has colour c.
+ *
+ * @param vars The table of variables.
+ * @param graph A ColouredGraph.
+ * @return Z3_ast The formula.
+ */
+Z3_ast symmetry_breaking_formula(ColouringVariables *vars, const ColouredGraph graph)
+{
+    Z3_context ctx = vars->ctx;
+    int num_nodes = vars->num_nodes;
+    int num_colours = vars->num_colours;
+    int *clique = (int *)arena_alloc(vars->scratch, num_nodes * sizeof(int));
+    int clique_size = colouring_greedy_clique(graph, clique);
+    if (clique_size > num_colours)
+        return Z3_mk_false(ctx);
+
+    bool *in_clique = (bool *)arena_alloc(vars->scratch, num_nodes * sizeof(bool));
+    memset(in_clique, 0, num_nodes * sizeof(bool));
+    for (int i = 0; i < clique_size; i++)
+        in_clique[clique[i]] = true;
+    int num_precedence = num_colours - clique_size - 1 > 0 ? num_colours - clique_size - 1 : 0;
+    Z3_ast *constraints = colouring_scratch(vars, clique_size + 2 * num_nodes * num_precedence);
+    int count = 0;
+
+    for (int i = 0; i < clique_size; i++)
+        constraints[count++] = variable_node_color(vars, clique[i], i);
+
+    // Colour clique_size is free (every smaller colour is used in the clique). For a larger one, the previous colour must be used before.
+    for (int colour = clique_size; colour < num_colours - 1; colour++)
+    {
+        int rank = 0;
+        for (int node = 0; node < num_nodes; node++)
+        {
+            if (in_clique[node])
+                continue;
+            Z3_ast used = colour_used_before_variable(ctx, colour, rank);
+            Z3_ast node_has_colour = variable_node_color(vars, node, colour);
+            Z3_ast node_has_next = variable_node_color(vars, node, colour + 1);
+            if (rank == 0)
+            {
+                constraints[count++] = Z3_mk_implies(ctx, used, node_has_colour);
+                constraints[count++] = Z3_mk_not(ctx, node_has_next);
+            }
+            else
+            {
+                Z3_ast used_before = colour_used_before_variable(ctx, colour, rank - 1);
+                constraints[count++] = Z3_mk_implies(ctx, used, Z3_mk_or(ctx, 2, (Z3_ast[]){used_before, node_has_colour}));
+                constraints[count++] = Z3_mk_implies(ctx, node_has_next, used_before);
+            }
+            rank++;
+        }
+    }
+
+    return Z3_mk_and(ctx, count, constraints);
+}
+
 Z3_ast colouring_reduction(Z3_context ctx, const ColouredGraph graph, int num_colours)
+{
+    struct timespec start;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    ColouringVariables vars = colouring_variables_create(ctx, cg_get_num_nodes(graph), num_colours);
+    Z3_ast result[3];
+    double times[3];
+    // The temporary arrays of a part are given back once it is built, for the next one.
+    result[0] = edges_have_different_colours_formula(&vars, graph);
+    arena_reset(vars.scratch);
+    times[0] = statistics_lap(&start);
+    result[1] = each_node_has_one_colour_formula(&vars);
+    arena_reset(vars.scratch);
+    times[1] = statistics_lap(&start);
+    int num_parts = 2;
+    if (symmetry_breaking)
+    {
+        result[num_parts] = symmetry_breaking_formula(&vars, graph);
+        arena_reset(vars.scratch);
+        times[num_parts++] = statistics_lap(&start);
+    }
+    colouring_variables_delete(&vars);
+    const char *names[3] = {"edges", "unique_colour", "symmetry"};
+    statistics_print_formula(ctx, "colouring", num_colours, num_parts, names, result, times);
+    return Z3_mk_and(ctx, num_parts, result);
+}
+
+/**
+ * @brief Gets the assumption literal disabling colour @p colour and every larger one.
+ *
+ * @param ctx The solver context.
+ * @param colour A colour.
+ * @return Z3_ast
+ */
+static Z3_ast colours_disabled_from_variable(Z3_context ctx, int colour)
+{
+    char name[40];
+    snprintf(name, 40, "colours from %d disabled", colour);
+    return mk_bool_var(ctx, name);
+}
+
+/**
+ * @brief Renames the colours of @p graph to 0, 1, 2... in the order of their first appearance.
+ *
+ * @param graph A coloured ColouredGraph.
+ * @param num_colours The colours of @p graph are smaller than @p num_colours.
+ * @return int The number of different colours of @p graph.
+ */
+static int compact_colours(ColouredGraph graph, int num_colours)
+{
+    int *renaming = (int *)malloc(num_colours * sizeof(int));
+    for (int colour = 0; colour < num_colours; colour++)
+        renaming[colour] = -1;
+    int num_used = 0;
+    for (int node = 0; node < cg_get_num_nodes(graph); node++)
+    {
+        int colour = cg_get_node_colour(graph, node);
+        if (renaming[colour] == -1)
+            renaming[colour] = num_used++;
+        cg_set_node_colour(graph, node, renaming[colour]);
+    }
+    free(renaming);
+    return num_used;
+}
+
+Z3_lbool colouring_chromatic_number(Z3_context ctx, ColouredGraph graph, ChromaticResult *result)
 {
     int num_nodes = cg_get_num_nodes(graph);
-    Z3_ast result[2];
-    result[0] = edges_have_different_colours_formula(ctx, graph, num_colours);
-    result[1] = each_node_has_one_colour_formula(ctx, num_nodes, num_colours);
-    return Z3_mk_and(ctx, 2, result);
+    int *clique = (int *)malloc((num_nodes + 1) * sizeof(int));
+    result->clique_size = colouring_greedy_clique(graph, clique);
+    free(clique);
+    result->greedy_colours = colouring_greedy(graph);
+    result->num_colours = result->greedy_colours;
+    result->num_checks = 0;
+    if (result->num_colours <= result->clique_size)
+        return Z3_L_TRUE;
+
+    // Only colourings better than the greedy one are sought: colours from k on are disabled to look for a k-colouring.
+    int max_colours = result->num_colours - 1;
+    ColouringVariables vars = colouring_variables_create(ctx, num_nodes, max_colours);
+    Z3_solver solver = mk_solver(ctx);
+    Z3_solver_assert(ctx, solver, edges_have_different_colours_formula(&vars, graph));
+    arena_reset(vars.scratch);
+    Z3_solver_assert(ctx, solver, each_node_has_one_colour_formula(&vars));
+    arena_reset(vars.scratch);
+    if (symmetry_breaking)
+        Z3_solver_assert(ctx, solver, symmetry_breaking_formula(&vars, graph));
+    for (int colour = 0; colour < max_colours; colour++)
+    {
+        Z3_ast disabled = colours_disabled_from_variable(ctx, colour);
+        if (colour + 1 < max_colours)
+            Z3_solver_assert(ctx, solver, Z3_mk_implies(ctx, disabled, colours_disabled_from_variable(ctx, colour + 1)));
+        for (int node = 0; node < num_nodes; node++)
+            Z3_solver_assert(ctx, solver, Z3_mk_implies(ctx, disabled, Z3_mk_not(ctx, variable_node_color(&vars, node, colour))));
+    }
+
+    Z3_lbool status = Z3_L_TRUE;
+    while (result->num_colours > result->clique_size)
+    {
+        int num_colours = result->num_colours - 1;
+        Z3_ast assumption = colours_disabled_from_variable(ctx, num_colours);
+        struct timespec start;
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        Z3_lbool res = Z3_solver_check_assumptions(ctx, solver, num_colours < max_colours ? 1 : 0, &assumption);
+        statistics_print_solver(ctx, solver, res, statistics_lap(&start));
+        result->num_checks++;
+        if (res == Z3_L_FALSE)
+            break;
+        if (res == Z3_L_UNDEF)
+        {
+            status = Z3_L_UNDEF;
+            break;
+        }
+        // The colouring found may use even fewer colours.
+        Z3_model model = Z3_solver_get_model(ctx, solver);
+        Z3_model_inc_ref(ctx, model);
+        colour_graph_from_model(ctx, model, graph, max_colours);
+        Z3_model_dec_ref(ctx, model);
+        result->num_colours = compact_colours(graph, max_colours);
+    }
+
+    // graph keeps the greedy colouring until the solver finds a better one.
+    Z3_solver_dec_ref(ctx, solver);
+    colouring_variables_delete(&vars);
+    return status;
 }
 
 void colour_graph_from_model(Z3_context ctx, Z3_model model, ColouredGraph graph, int num_colours)
 {
     int num_nodes = cg_get_num_nodes(graph);
+    if (num_nodes == 0)
+        return;
+    // The variable of (node, colour) is named colour * num_nodes + node (see variable_node_color): each node takes its smallest true colour.
+    int *colours = (int *)malloc((num_nodes + 1) * sizeof(int));
     for (int node = 0; node < num_nodes; node++)
+        colours[node] = num_colours;
+    int num_true;
+    int *indices = true_indexed_vars_in_model(ctx, model, &num_true);
+    for (int i = 0; i < num_true; i++)
     {
-        for (int colour = 0; colour < num_colours; colour++)
-        {
-            if (value_of_var_in_model(ctx, model, variable_node_color(ctx, node, colour)))
-            {
-                cg_set_node_colour(graph, node, colour);
-                break;
-            }
-        }
+        int node = indices[i] % num_nodes;
+        int colour = indices[i] / num_nodes;
+        if (colour < colours[node])
+            colours[node] = colour;
     }
+    for (int node = 0; node < num_nodes; node++)
+        if (colours[node] < num_colours)
+            cg_set_node_colour(graph, node, colours[node]);
+    free(indices);
+    free(colours);
 }
 
 void colouring_print_model(Z3_context ctx, Z3_model model, ColouredGraph graph, int num_colours)
 {
     int num_nodes = cg_get_num_nodes(graph);
+    ColouringVariables vars = colouring_variables_create(ctx, num_nodes, num_colours);
     for (int node = 0; node < num_nodes; node++)
         for (int colour = 0; colour < num_colours; colour++)
-            printf("[%d:%d] = %d\n", node, colour, value_of_var_in_model(ctx, model, variable_node_color(ctx, node, colour)));
+            printf("[%d:%d] = %d\n", node, colour, value_of_var_in_model(ctx, model, variable_node_color(&vars, node, colour)));
+    colouring_variables_delete(&vars);
 }
\ No newline at end of file
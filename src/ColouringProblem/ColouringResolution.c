@@ -1,51 +1,362 @@
 #include "ColouringResolution.h"
 #include <stdlib.h>
 #include <stdio.h>
+#include <stdint.h>
 
 /**
- * @brief Recursive implementation of a brute force. Performs a depth-first search of a colouring, and prunes branches as soon as an inconsistency is detected. As such, if a full colouring is reached, it is a correct one.
- * Puts the colouring inside @p graph if a valid one exists, otherwise sets all colours to -1.
- * 
- * @param graph A ColouredGraph.
- * @param num_colours The expected number of colours.
- * @param node The node we are trying to colour.
- * @return true If there exist a colouring starting with the partial colouring given.
- * @return false Otherwise.
- * @pre All nodes smaller than @p node are already coloured without contradiction.
+ * @brief State of the DSATUR backtracking search.
+ *
+ * Sets of nodes are bitsets, as the neighbour masks of the graph (see cg_neighbour_mask): for each colour, near holds the nodes having a neighbour of that
+ * colour, so that a conflict check is a bit test, and colouring a node goes through the non-zero words of its neighbour mask, 64 neighbours at a time.
+ * The bits that the colouring of a node adds to near are pushed on an undo stack, so that undoing it only has to clear them.
  */
-bool recursive_bf(ColouredGraph graph, int num_colours, int node)
+typedef struct
 {
-    int num_nodes = cg_get_num_nodes(graph);
-    if (node == num_nodes)
-        return true;
-    for (int col = 0; col < num_colours; col++)
+    ColouredGraph graph;
+    int num_nodes;           ///< The number of nodes of the graph.
+    int num_colours;         ///< The number of colours available.
+    int num_words;           ///< The number of words of a node bitset.
+    uint64_t *near;          ///< The nodes having a neighbour of each colour, num_words words per colour.
+    uint64_t *uncoloured;    ///< The uncoloured nodes.
+    int *saturation;         ///< The number of different colours of the neighbours of each uncoloured node.
+    int *trail;              ///< The stack of the coloured nodes, in the order of the search.
+    int num_coloured;        ///< The size of trail.
+    int *undo_offsets;       ///< The bits added to near by the colouring of trail[i] are the entries undo_offsets[i] to undo_offsets[i+1]-1 of the undo stack.
+    int *undo_words;         ///< The word of near changed by each entry of the undo stack.
+    uint64_t *undo_bits;     ///< The bits added to that word.
+    int num_used;            ///< The colours 0 to num_used-1 appear in the current colouring.
+    const atomic_bool *stop; ///< A flag stopping the search when raised, or NULL.
+} DsaturSearch;
+
+/**
+ * @brief Tells if @p colour is the colour of some neighbour of @p node.
+ *
+ * @param search The search.
+ * @param node A node.
+ * @param colour A colour.
+ * @return bool
+ */
+static bool dsatur_is_forbidden(DsaturSearch *search, int node, int colour)
+{
+    return (search->near[colour * search->num_words + node / CG_NODES_PER_WORD] >> (node % CG_NODES_PER_WORD)) & 1;
+}
+
+/**
+ * @brief Colours @p node with @p colour, pushes it on the trail and adds its neighbours to the nodes near @p colour.
+ *
+ * @param search The search.
+ * @param node An uncoloured node.
+ * @param colour A colour not forbidden for @p node.
+ */
+static void dsatur_colour(DsaturSearch *search, int node, int colour)
+{
+    cg_set_node_colour(search->graph, node, colour);
+    search->uncoloured[node / CG_NODES_PER_WORD] &= ~((uint64_t)1 << (node % CG_NODES_PER_WORD));
+    int top = search->undo_offsets[search->num_coloured];
+    search->trail[search->num_coloured++] = node;
+
+    uint64_t *near = search->near + colour * search->num_words;
+    const uint64_t *mask = cg_neighbour_mask(search->graph, node);
+    int num_words;
+    const int *words = cg_neighbour_words(search->graph, node, &num_words);
+    for (int i = 0; i < num_words; i++)
+    {
+        int word = words[i];
+        uint64_t added = mask[word] & ~near[word];
+        if (added == 0)
+            continue;
+        near[word] |= added;
+        search->undo_words[top] = word;
+        search->undo_bits[top++] = added;
+        // The uncoloured nodes among them see one more colour.
+        for (uint64_t bits = added & search->uncoloured[word]; bits != 0; bits &= bits - 1)
+            search->saturation[word * CG_NODES_PER_WORD + __builtin_ctzll(bits)]++;
+    }
+    search->undo_offsets[search->num_coloured] = top;
+}
+
+/**
+ * @brief Pops the last coloured node of the trail, and removes from the nodes near its colour the ones it added.
+ *
+ * @param search The search.
+ */
+static void dsatur_undo(DsaturSearch *search)
+{
+    int node = search->trail[--search->num_coloured];
+    int colour = cg_get_node_colour(search->graph, node);
+    uint64_t *near = search->near + colour * search->num_words;
+    for (int entry = search->undo_offsets[search->num_coloured]; entry < search->undo_offsets[search->num_coloured + 1]; entry++)
+    {
+        int word = search->undo_words[entry];
+        near[word] &= ~search->undo_bits[entry];
+        for (uint64_t bits = search->undo_bits[entry] & search->uncoloured[word]; bits != 0; bits &= bits - 1)
+            search->saturation[word * CG_NODES_PER_WORD + __builtin_ctzll(bits)]--;
+    }
+    // Only now: node did not count its own colour (it has one if it has a loop).
+    search->uncoloured[node / CG_NODES_PER_WORD] |= (uint64_t)1 << (node % CG_NODES_PER_WORD);
+    cg_set_node_colour(search->graph, node, -1);
+}
+
+/**
+ * @brief Counts the uncoloured neighbours of @p node, other than itself.
+ *
+ * @param search The search.
+ * @param node A node.
+ * @return int
+ */
+static int dsatur_uncoloured_degree(DsaturSearch *search, int node)
+{
+    const uint64_t *mask = cg_neighbour_mask(search->graph, node);
+    int num_words;
+    const int *words = cg_neighbour_words(search->graph, node, &num_words);
+    int degree = 0;
+    for (int i = 0; i < num_words; i++)
     {
-        cg_set_node_colour(graph, node, col);
-        bool same_colour_as_neighbour = false;
-        for (int n = 0; n < node; n++)
+        uint64_t bits = mask[words[i]] & search->uncoloured[words[i]];
+        if (words[i] == node / CG_NODES_PER_WORD)
+            bits &= ~((uint64_t)1 << (node % CG_NODES_PER_WORD));
+        degree += __builtin_popcountll(bits);
+    }
+    return degree;
+}
+
+/**
+ * @brief Chooses the next node to colour: the uncoloured node whose neighbours have the most different colours, and among them, the one with the most uncoloured neighbours.
+ *
+ * @param search The search.
+ * @return int The node, or -1 if every node is coloured.
+ */
+static int dsatur_select(DsaturSearch *search)
+{
+    int best = -1;
+    // The number of uncoloured neighbours is only counted between nodes of same saturation, -1 until then.
+    int best_degree = -1;
+    for (int word = 0; word < search->num_words; word++)
+        for (uint64_t bits = search->uncoloured[word]; bits != 0; bits &= bits - 1)
         {
-            if (!cg_is_edge(graph, node, n))
-                continue;
-            int col_n = cg_get_node_colour(graph, n);
-            if (col_n == col)
+            int node = word * CG_NODES_PER_WORD + __builtin_ctzll(bits);
+            if (best == -1 || search->saturation[node] > search->saturation[best])
             {
-                same_colour_as_neighbour = true;
-                break;
+                best = node;
+                best_degree = -1;
+            }
+            else if (search->saturation[node] == search->saturation[best])
+            {
+                if (best_degree == -1)
+                    best_degree = dsatur_uncoloured_degree(search, best);
+                int degree = dsatur_uncoloured_degree(search, node);
+                if (degree > best_degree)
+                {
+                    best = node;
+                    best_degree = degree;
+                }
             }
         }
-        if (same_colour_as_neighbour)
+    return best;
+}
+
+/**
+ * @brief Looks for a colouring extending the current one. Colours are interchangeable: a node is only tried with the colours already used and the first unused one.
+ *
+ * @param search The search.
+ * @return true if a colouring was found (it is then in search->graph).
+ * @return false otherwise, or if search->stop was raised.
+ */
+static bool dsatur_search(DsaturSearch *search)
+{
+    if (search->stop != NULL && atomic_load_explicit(search->stop, memory_order_relaxed))
+        return false;
+    int node = dsatur_select(search);
+    if (node == -1)
+        return true;
+    // A node whose neighbours use every colour cannot be coloured.
+    if (search->saturation[node] == search->num_colours)
+        return false;
+
+    int num_used = search->num_used;
+    int max_colour = num_used < search->num_colours ? num_used : search->num_colours - 1;
+    for (int col = 0; col <= max_colour; col++)
+    {
+        if (dsatur_is_forbidden(search, node, col))
             continue;
-        bool res = recursive_bf(graph, num_colours, node + 1);
+        dsatur_colour(search, node, col);
+        if (col == num_used)
+            search->num_used++;
+        bool res = dsatur_search(search);
         if (res)
             return true;
-        if (node == 0)
-            return false;
+        search->num_used = num_used;
+        dsatur_undo(search);
     }
-    cg_set_node_colour(graph, node, -1);
     return false;
 }
 
+/**
+ * @brief Initializes the search for a colouring of @p graph with @p num_colours colours, every node being uncoloured.
+ *
+ * @param search The search.
+ * @param graph A ColouredGraph.
+ * @param num_colours The number of colours available (at least 1).
+ * @param stop A flag stopping the search when raised, or NULL.
+ */
+static void dsatur_init(DsaturSearch *search, ColouredGraph graph, int num_colours, const atomic_bool *stop)
+{
+    search->graph = graph;
+    search->stop = stop;
+    search->num_nodes = cg_get_num_nodes(graph);
+    search->num_colours = num_colours;
+    search->num_words = cg_get_num_words(graph);
+    search->near = (uint64_t *)calloc((size_t)num_colours * search->num_words + 1, sizeof(uint64_t));
+    search->uncoloured = (uint64_t *)calloc(search->num_words + 1, sizeof(uint64_t));
+    search->saturation = (int *)calloc(search->num_nodes + 1, sizeof(int));
+    search->trail = (int *)malloc((search->num_nodes + 1) * sizeof(int));
+    search->undo_offsets = (int *)malloc((search->num_nodes + 1) * sizeof(int));
+    search->undo_offsets[0] = 0;
+    search->num_coloured = 0;
+    search->num_used = 0;
+    // Each node is on the trail at most once, with at most one entry per non-zero word of its neighbour mask.
+    int undo_size = 0;
+    for (int node = 0; node < search->num_nodes; node++)
+    {
+        cg_set_node_colour(graph, node, -1);
+        search->uncoloured[node / CG_NODES_PER_WORD] |= (uint64_t)1 << (node % CG_NODES_PER_WORD);
+        int num_words;
+        cg_neighbour_words(graph, node, &num_words);
+        undo_size += num_words;
+    }
+    search->undo_words = (int *)malloc((undo_size + 1) * sizeof(int));
+    search->undo_bits = (uint64_t *)malloc((undo_size + 1) * sizeof(uint64_t));
+}
+
+/**
+ * @brief Deallocates the tables of @p search.
+ *
+ * @param search The search.
+ */
+static void dsatur_delete(DsaturSearch *search)
+{
+    free(search->near);
+    free(search->uncoloured);
+    free(search->saturation);
+    free(search->trail);
+    free(search->undo_offsets);
+    free(search->undo_words);
+    free(search->undo_bits);
+}
+
 bool colouring_brute_force(ColouredGraph graph, int num_colours)
 {
-    return recursive_bf(graph, num_colours, 0);
-}
\ No newline at end of file
+    return colouring_brute_force_interruptible(graph, num_colours, NULL);
+}
+
+bool colouring_brute_force_interruptible(ColouredGraph graph, int num_colours, const atomic_bool *stop)
+{
+    int num_nodes = cg_get_num_nodes(graph);
+    if (num_colours <= 0)
+    {
+        for (int node = 0; node < num_nodes; node++)
+            cg_set_node_colour(graph, node, -1);
+        return num_nodes == 0;
+    }
+
+    DsaturSearch search;
+    dsatur_init(&search, graph, num_colours, stop);
+    bool res = dsatur_search(&search);
+    if (!res)
+        for (int node = 0; node < num_nodes; node++)
+            cg_set_node_colour(graph, node, -1);
+    dsatur_delete(&search);
+    return res;
+}
+
+int colouring_greedy(ColouredGraph graph)
+{
+    int num_nodes = cg_get_num_nodes(graph);
+    // A node never needs more colours than its number of neighbours plus one.
+    int max_degree = 0;
+    for (int node = 0; node < num_nodes; node++)
+    {
+        int degree;
+        cg_neighbours(graph, node, &degree);
+        if (degree > max_degree)
+            max_degree = degree;
+    }
+
+    DsaturSearch search;
+    dsatur_init(&search, graph, max_degree + 1, NULL);
+    for (int node = dsatur_select(&search); node != -1; node = dsatur_select(&search))
+    {
+        int col = 0;
+        while (dsatur_is_forbidden(&search, node, col))
+            col++;
+        dsatur_colour(&search, node, col);
+        if (col == search.num_used)
+            search.num_used++;
+    }
+    int res = search.num_used;
+    dsatur_delete(&search);
+    return res;
+}
+
+int colouring_greedy_clique(const ColouredGraph graph, int *clique)
+{
+    int num_nodes = cg_get_num_nodes(graph);
+    int num_words = cg_get_num_words(graph);
+    // The candidates are the neighbours of every node of the clique, other than these nodes.
+    uint64_t *candidates = (uint64_t *)calloc(num_words + 1, sizeof(uint64_t));
+    for (int node = 0; node < num_nodes; node++)
+        candidates[node / CG_NODES_PER_WORD] |= (uint64_t)1 << (node % CG_NODES_PER_WORD);
+    int size = 0;
+    while (true)
+    {
+        int best = -1;
+        int best_degree = -1;
+        for (int word = 0; word < num_words; word++)
+            for (uint64_t bits = candidates[word]; bits != 0; bits &= bits - 1)
+            {
+                int node = word * CG_NODES_PER_WORD + __builtin_ctzll(bits);
+                int degree;
+                cg_neighbours(graph, node, &degree);
+                if (degree > best_degree)
+                {
+                    best = node;
+                    best_degree = degree;
+                }
+            }
+        if (best == -1)
+            break;
+        clique[size++] = best;
+        const uint64_t *mask = cg_neighbour_mask(graph, best);
+        for (int word = 0; word < num_words; word++)
+            candidates[word] &= mask[word];
+        candidates[best / CG_NODES_PER_WORD] &= ~((uint64_t)1 << (best % CG_NODES_PER_WORD));
+    }
+    free(candidates);
+    return size;
+}
+
+int colouring_chromatic_brute_force(ColouredGraph graph)
+{
+    int num_nodes = cg_get_num_nodes(graph);
+    int *clique = (int *)malloc((num_nodes + 1) * sizeof(int));
+    int lower_bound = colouring_greedy_clique(graph, clique);
+    free(clique);
+
+    int upper_bound = colouring_greedy(graph);
+    int *greedy_colours = (int *)malloc((num_nodes + 1) * sizeof(int));
+    for (int node = 0; node < num_nodes; node++)
+        greedy_colours[node] = cg_get_node_colour(graph, node);
+
+    // Every number of colours below the one of the greedy colouring, from the size of the clique, until one is enough.
+    for (int num_colours = lower_bound; num_colours < upper_bound; num_colours++)
+        if (colouring_brute_force(graph, num_colours))
+        {
+            free(greedy_colours);
+            return num_colours;
+        }
+
+    for (int node = 0; node < num_nodes; node++)
+        cg_set_node_colour(graph, node, greedy_colours[node]);
+    free(greedy_colours);
+    return upper_bound;
+}
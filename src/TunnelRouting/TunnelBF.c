@@ -1,10 +1,290 @@
 #include "TunnelBF.h"
 #include <stdlib.h>
 #include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+
+/**
+ * @brief Number of stack cells stored in one word of a bit-packed stack.
+ */
+#define CELLS_PER_WORD 64
+
+/**
+ * @brief Mask of the actions requiring a 4 on top of the stack.
+ */
+#define TOP_4_ACTIONS ((1 << transmit_4) | (1 << push_4_4) | (1 << push_4_6) | (1 << pop_4_4) | (1 << pop_6_4))
+
+/**
+ * @brief Mask of the actions requiring a 6 on top of the stack.
+ */
+#define TOP_6_ACTIONS ((1 << transmit_6) | (1 << push_6_4) | (1 << push_6_6) | (1 << pop_4_6) | (1 << pop_6_6))
+
+/**
+ * @brief State of the depth-first search for paths of a fixed length, from one initial node to a set of final nodes (the targets).
+ *
+ * The stack at position pos is kept bit-packed in stacks[pos]: bit h is set iff cell h contains 6. Only heights 0 to stack_size-1 are possible,
+ * since a path of size length has to pop what it pushed. The bits above the top are always cleared, so that equal stacks have equal words.
+ */
+typedef struct
+{
+    TunnelNetwork network;
+    int length;          ///< The length of the paths sought.
+    int num_nodes;       ///< The number of nodes of the network.
+    int stack_size;      ///< The number of cells of the stack (length/2+1).
+    int num_words;       ///< The number of words of a bit-packed stack.
+    uint64_t *stacks;    ///< The stacks at each position, num_words words per position.
+    int *nodes;          ///< The node at each position.
+    int *heights;        ///< The height of the top of the stack at each position.
+    tn_step *path;       ///< The steps of the path being explored.
+    const atomic_bool *stop; ///< A flag stopping the search when raised, or NULL.
+    int max_length;      ///< The largest length tried.
+    bool *wanted;        ///< Whether each node is a target not reached yet.
+    int num_wanted;      ///< The number of targets not reached yet.
+    int *found_lengths;  ///< The size of the shortest path found to each node (0 if none).
+    tn_step *found_paths; ///< The shortest path found to each node, max_length steps per node.
+} TunnelSearch;
+
+/**
+ * @brief Gets the bit-packed stack at position @p pos.
+ *
+ * @param search The search.
+ * @param pos A position.
+ * @return uint64_t*
+ */
+static uint64_t *tn_bf_stack(TunnelSearch *search, int pos)
+{
+    return search->stacks + pos * search->num_words;
+}
+
+/**
+ * @brief Tells if cell @p height of @p stack contains 6.
+ *
+ * @param stack A bit-packed stack.
+ * @param height A height.
+ * @return bool
+ */
+static bool tn_bf_is_6(const uint64_t *stack, int height)
+{
+    return (stack[height / CELLS_PER_WORD] >> (height % CELLS_PER_WORD)) & 1;
+}
+
+/**
+ * @brief Sets cell @p height of @p stack to 6 if @p is_6, and to 4 otherwise.
+ *
+ * @param stack A bit-packed stack.
+ * @param height A height.
+ * @param is_6 The new content of the cell.
+ */
+static void tn_bf_set_cell(uint64_t *stack, int height, bool is_6)
+{
+    uint64_t bit = (uint64_t)1 << (height % CELLS_PER_WORD);
+    if (is_6)
+        stack[height / CELLS_PER_WORD] |= bit;
+    else
+        stack[height / CELLS_PER_WORD] &= ~bit;
+}
+
+/**
+ * @brief Applies @p action to the stack at position @p pos, writing the result at position @p pos+1.
+ *
+ * @param search The search.
+ * @param pos The position of the node performing @p action.
+ * @param action An action whose condition on the top of the stack holds.
+ * @return bool false if @p action cannot be performed at @p pos (cell under the top not matching, or height out of bounds).
+ */
+static bool tn_bf_apply_action(TunnelSearch *search, int pos, stack_action action)
+{
+    int height = search->heights[pos];
+    uint64_t *stack = tn_bf_stack(search, pos);
+    uint64_t *next = tn_bf_stack(search, pos + 1);
+    memcpy(next, stack, search->num_words * sizeof(uint64_t));
+    switch (action)
+    {
+    case transmit_4:
+    case transmit_6:
+        search->heights[pos + 1] = height;
+        return true;
+    case push_4_4:
+    case push_6_4:
+    case push_4_6:
+    case push_6_6:
+        if (height + 1 >= search->stack_size)
+            return false;
+        tn_bf_set_cell(next, height + 1, action == push_4_6 || action == push_6_6);
+        search->heights[pos + 1] = height + 1;
+        return true;
+    default:
+        // pop_a_b removes the top b and requires a under it.
+        if (height == 0 || tn_bf_is_6(stack, height - 1) != (action == pop_6_4 || action == pop_6_6))
+            return false;
+        tn_bf_set_cell(next, height, false);
+        search->heights[pos + 1] = height - 1;
+        return true;
+    }
+}
+
+/**
+ * @brief Tells if the state (node, stack) at position @p pos already appears earlier on the path. A shortest path never goes twice through the same state.
+ *
+ * @param search The search.
+ * @param pos A position.
+ * @return bool
+ */
+static bool tn_bf_state_repeated(TunnelSearch *search, int pos)
+{
+    const uint64_t *stack = tn_bf_stack(search, pos);
+    for (int previous = 0; previous < pos; previous++)
+        if (search->nodes[previous] == search->nodes[pos] && search->heights[previous] == search->heights[pos]
+            && memcmp(tn_bf_stack(search, previous), stack, search->num_words * sizeof(uint64_t)) == 0)
+            return true;
+    return false;
+}
+
+/**
+ * @brief Records the path being explored as the shortest path to @p node if @p node is a target not reached yet: the lengths are tried in increasing order.
+ *
+ * @param search The search, at the end of a path of size search->length with the stack containing only 4.
+ * @param node The end of the path.
+ * @return bool true if every target is now reached.
+ */
+static bool tn_bf_reach(TunnelSearch *search, int node)
+{
+    if (!search->wanted[node])
+        return false;
+    memcpy(search->found_paths + node * search->max_length, search->path, search->length * sizeof(tn_step));
+    search->found_lengths[node] = search->length;
+    search->wanted[node] = false;
+    search->num_wanted--;
+    return search->num_wanted == 0;
+}
+
+/**
+ * @brief Looks for the ends of the paths of size search->length, whose first @p pos steps are fixed, reaching the targets.
+ *
+ * @param search The search.
+ * @param pos The current position.
+ * @return bool true if the last target was reached (the search can stop).
+ */
+static bool tn_bf_search(TunnelSearch *search, int pos)
+{
+    int node = search->nodes[pos];
+    int height = search->heights[pos];
+    const uint64_t *stack = tn_bf_stack(search, pos);
+
+    if (search->stop != NULL && atomic_load_explicit(search->stop, memory_order_relaxed))
+        return false;
+
+    if (pos == search->length)
+        return height == 0 && !tn_bf_is_6(stack, 0) && tn_bf_reach(search, node);
+
+    // Each step pops at most one cell: the stack must be emptied down to the first cell in time.
+    if (height > search->length - pos)
+        return false;
+
+    int num_successors;
+    const int *successors = tn_successors(search->network, node, &num_successors);
+    int actions = tn_get_node_actions(search->network, node) & (tn_bf_is_6(stack, height) ? TOP_6_ACTIONS : TOP_4_ACTIONS);
+    for (int action = 0; action < NumActions; action++)
+    {
+        if (!(actions & (1 << action)) || !tn_bf_apply_action(search, pos, action))
+            continue;
+        for (int i = 0; i < num_successors; i++)
+        {
+            int next = successors[i];
+            search->nodes[pos + 1] = next;
+            if (tn_bf_state_repeated(search, pos + 1))
+                continue;
+            search->path[pos] = tn_step_create(action, node, next);
+            if (tn_bf_search(search, pos + 1))
+                return true;
+        }
+    }
+    return false;
+}
+
+/**
+ * @brief Looks for the shortest paths of size at most @p length from @p initial to each of @p targets, with a single exploration for all of them:
+ * the paths of each size are enumerated once, and each one ending at a target not reached yet is kept.
+ *
+ * @param network The network.
+ * @param initial The initial node.
+ * @param num_targets The number of targets.
+ * @param targets The final nodes sought.
+ * @param length The max length of the paths sought.
+ * @param lengths Set to the length of the path found to each target (0 if none).
+ * @param paths The arrays where the paths found are written (NULL entries are allowed when the path is not needed).
+ * @param stop A flag stopping the search when raised, or NULL.
+ * @return int The number of targets reached.
+ */
+static int tn_bf_run(TunnelNetwork network, int initial, int num_targets, const int *targets, int length, int *lengths, tn_step *const *paths,
+                     const atomic_bool *stop)
+{
+    TunnelSearch search;
+    search.network = network;
+    search.stop = stop;
+    search.num_nodes = tn_get_num_nodes(network);
+    search.stack_size = length / 2 + 1;
+    search.num_words = (search.stack_size + CELLS_PER_WORD - 1) / CELLS_PER_WORD;
+    search.stacks = (uint64_t *)calloc((length + 1) * search.num_words, sizeof(uint64_t));
+    search.nodes = (int *)malloc((length + 1) * sizeof(int));
+    search.heights = (int *)malloc((length + 1) * sizeof(int));
+    search.path = (tn_step *)malloc((length > 0 ? length : 1) * sizeof(tn_step));
+    search.max_length = length;
+    search.wanted = (bool *)calloc(search.num_nodes > 0 ? search.num_nodes : 1, sizeof(bool));
+    search.found_lengths = (int *)calloc(search.num_nodes > 0 ? search.num_nodes : 1, sizeof(int));
+    search.found_paths = (tn_step *)malloc(((size_t)search.num_nodes * length > 0 ? (size_t)search.num_nodes * length : 1) * sizeof(tn_step));
+    search.num_wanted = 0;
+    for (int i = 0; i < num_targets; i++)
+        if (!search.wanted[targets[i]])
+        {
+            search.wanted[targets[i]] = true;
+            search.num_wanted++;
+        }
+    search.nodes[0] = initial;
+    search.heights[0] = 0;
+
+    // Iterative deepening: the first length for which a path to a target exists is the size of a shortest path to it.
+    for (int l = 1; l <= length && search.num_wanted > 0 && !(stop != NULL && atomic_load(stop)); l++)
+    {
+        search.length = l;
+        tn_bf_search(&search, 0);
+    }
+
+    int num_reached = 0;
+    for (int i = 0; i < num_targets; i++)
+    {
+        lengths[i] = search.found_lengths[targets[i]];
+        if (lengths[i] == 0)
+            continue;
+        num_reached++;
+        if (paths[i] != NULL)
+            memcpy(paths[i], search.found_paths + targets[i] * length, lengths[i] * sizeof(tn_step));
+    }
+
+    free(search.stacks);
+    free(search.nodes);
+    free(search.heights);
+    free(search.path);
+    free(search.wanted);
+    free(search.found_lengths);
+    free(search.found_paths);
+    return num_reached;
+}
 
 int tn_brute_force(TunnelNetwork network, int length, tn_step *path)
 {
-    /* Nous n’attendons pas que cette fonction soit implémentée pour la partie principale du projet.
-    Néanmoins, si vous voulez tester vos idée pour un brute-force, vous pouvez le faire ici, ou même simplement tester diverses choses sur une instance : cette fonction sera appelée si vous lancez le programme avec l’option -B, et le contenu de path sera affiché (de la taille de l’entier renvoyé). */
-    return 0;
-}
\ No newline at end of file
+    return tn_brute_force_interruptible(network, length, path, NULL);
+}
+
+int tn_brute_force_interruptible(TunnelNetwork network, int length, tn_step *path, const atomic_bool *stop)
+{
+    int final = tn_get_final(network);
+    int result;
+    tn_bf_run(network, tn_get_initial(network), 1, &final, length, &result, &path, stop);
+    return result;
+}
+
+int tn_brute_force_targets(TunnelNetwork network, int initial, int num_targets, const int *targets, int length, int *lengths, tn_step *const *paths)
+{
+    return tn_bf_run(network, initial, num_targets, targets, length, lengths, paths, NULL);
+}
@@ -0,0 +1,296 @@
+#include "TunnelBinary.h"
+#include "Hash.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+/**
+ * @brief The first four bytes of a binary file ("TNB" and the version).
+ */
+#define TN_BINARY_MAGIC 0x31424E54u
+
+/**
+ * @brief Written in every file, to detect a file written with another byte order.
+ */
+#define TN_BINARY_BYTE_ORDER 0x01020304u
+
+/**
+ * @brief Header of a binary file. It is followed by int arrays, in this order:
+ * node_actions (num_nodes), successor_offsets (num_nodes+1), successors (num_arcs), predecessor_offsets (num_nodes+1), predecessors (num_arcs),
+ * node_names (num_nodes), parameter_offsets (num_nodes+1) and parameters (2*num_parameters: name and value of each parameter of each node, in order),
+ * and then by the strings (null-terminated). Names and parameters are given by their offset in the strings.
+ */
+typedef struct
+{
+    uint32_t magic;       ///< TN_BINARY_MAGIC.
+    uint32_t byte_order;  ///< TN_BINARY_BYTE_ORDER.
+    uint64_t source_hash; ///< The hash of the .dot file.
+    uint64_t file_size;   ///< The size of the whole file.
+    uint64_t strings_size; ///< The size of the strings.
+    int32_t int_size;     ///< sizeof(int) on the machine writing the file.
+    int32_t num_nodes;    ///< The number of nodes.
+    int32_t num_edges;    ///< The number of edges of the graph (graph_num_edges).
+    int32_t num_arcs;     ///< The size of the successor index.
+    int32_t num_parameters; ///< The number of parameters of all the nodes.
+    int32_t initial;      ///< The initial node.
+    int32_t final;        ///< The final node.
+    int32_t name;         ///< The offset of the name of the graph, -1 if it has none.
+} TunnelBinaryHeader;
+
+bool tn_hash_file(const char *file, uint64_t *hash)
+{
+    FILE *input = fopen(file, "rb");
+    if (input == NULL)
+        return false;
+    uint64_t result = HASH_INIT;
+    unsigned char buffer[1 << 16];
+    size_t read;
+    while ((read = fread(buffer, 1, sizeof(buffer), input)) > 0)
+        result = hash_bytes(result, buffer, read);
+    fclose(input);
+    *hash = result;
+    return true;
+}
+
+/**
+ * @brief Gives the offset of @p string in the strings of the file, and advances @p size past it.
+ *
+ * @param string A string.
+ * @param size The size of the strings before @p string.
+ * @return int
+ */
+static int tn_binary_string_offset(const char *string, uint64_t *size)
+{
+    int offset = (int)*size;
+    *size += strlen(string) + 1;
+    return offset;
+}
+
+bool tn_save_binary(TunnelNetwork network, uint64_t source_hash, const char *file)
+{
+    const Graph *graph = tn_get_graph(network);
+    int num_nodes = graph->numNodes;
+    int num_arcs = graph->successor_offsets[num_nodes];
+
+    TunnelBinaryHeader header;
+    memset(&header, 0, sizeof(header));
+    header.magic = TN_BINARY_MAGIC;
+    header.byte_order = TN_BINARY_BYTE_ORDER;
+    header.source_hash = source_hash;
+    header.int_size = sizeof(int);
+    header.num_nodes = num_nodes;
+    header.num_edges = graph->numEdges;
+    header.num_arcs = num_arcs;
+    header.initial = tn_get_initial(network);
+    header.final = tn_get_final(network);
+
+    // Offsets of the strings, in the order they are written.
+    int *node_actions = (int *)malloc((num_nodes + 1) * sizeof(int));
+    int *node_names = (int *)malloc((num_nodes + 1) * sizeof(int));
+    int *parameter_offsets = (int *)malloc((num_nodes + 1) * sizeof(int));
+    uint64_t strings_size = 0;
+    header.name = graph->name != NULL ? tn_binary_string_offset(graph->name, &strings_size) : -1;
+    for (int node = 0; node < num_nodes; node++)
+    {
+        node_actions[node] = tn_get_node_actions(network, node);
+        node_names[node] = tn_binary_string_offset(graph->nodes[node], &strings_size);
+        parameter_offsets[node] = header.num_parameters;
+        for (parameterList *param = graph->parameters[node]; param != NULL; param = param->next)
+            header.num_parameters++;
+    }
+    parameter_offsets[num_nodes] = header.num_parameters;
+    int *parameters = (int *)malloc((2 * header.num_parameters + 1) * sizeof(int));
+    int count = 0;
+    for (int node = 0; node < num_nodes; node++)
+        for (parameterList *param = graph->parameters[node]; param != NULL; param = param->next)
+        {
+            parameters[count++] = tn_binary_string_offset(param->name, &strings_size);
+            parameters[count++] = tn_binary_string_offset(param->value, &strings_size);
+        }
+    header.strings_size = strings_size;
+    header.file_size = sizeof(header) + (5 * (uint64_t)num_nodes + 3 + 2 * (uint64_t)num_arcs + 2 * (uint64_t)header.num_parameters) * sizeof(int) + strings_size;
+
+    // The file is written aside and renamed over the cache: a process that has the old cache mapped keeps reading it whole.
+    size_t length = strlen(file);
+    char temporary[length + 8];
+    snprintf(temporary, length + 8, "%s.XXXXXX", file);
+    int fd = mkstemp(temporary);
+    bool ok = false;
+    FILE *output = NULL;
+    if (fd >= 0)
+    {
+        fchmod(fd, S_IRUSR | S_IWUSR | S_IRGRP | S_IROTH);
+        output = fdopen(fd, "wb");
+        if (output == NULL)
+            close(fd);
+    }
+    if (output != NULL)
+    {
+        fwrite(&header, sizeof(header), 1, output);
+        fwrite(node_actions, sizeof(int), num_nodes, output);
+        fwrite(graph->successor_offsets, sizeof(int), num_nodes + 1, output);
+        fwrite(graph->successors, sizeof(int), num_arcs, output);
+        fwrite(graph->predecessor_offsets, sizeof(int), num_nodes + 1, output);
+        fwrite(graph->predecessors, sizeof(int), num_arcs, output);
+        fwrite(node_names, sizeof(int), num_nodes, output);
+        fwrite(parameter_offsets, sizeof(int), num_nodes + 1, output);
+        fwrite(parameters, sizeof(int), 2 * header.num_parameters, output);
+        if (graph->name != NULL)
+            fwrite(graph->name, 1, strlen(graph->name) + 1, output);
+        for (int node = 0; node < num_nodes; node++)
+            fwrite(graph->nodes[node], 1, strlen(graph->nodes[node]) + 1, output);
+        for (int node = 0; node < num_nodes; node++)
+            for (parameterList *param = graph->parameters[node]; param != NULL; param = param->next)
+            {
+                fwrite(param->name, 1, strlen(param->name) + 1, output);
+                fwrite(param->value, 1, strlen(param->value) + 1, output);
+            }
+        ok = ferror(output) == 0;
+        ok = fclose(output) == 0 && ok;
+        ok = ok && rename(temporary, file) == 0;
+    }
+    if (fd >= 0 && !ok)
+        unlink(temporary);
+
+    free(node_actions);
+    free(node_names);
+    free(parameter_offsets);
+    free(parameters);
+    return ok;
+}
+
+/**
+ * @brief Tells if @p offsets is an index of @p size cells over @p num_rows rows (non decreasing, from 0 to @p size), whose values are all below @p bound.
+ *
+ * @param offsets The offsets of the rows (num_rows+1 cells).
+ * @param values The values of the rows (@p size cells), or NULL to not check them.
+ * @param num_rows The number of rows.
+ * @param size The number of values.
+ * @param bound The bound on the values.
+ * @return bool
+ */
+static bool tn_binary_valid_index(const int *offsets, const int *values, int num_rows, int size, int bound)
+{
+    if (offsets[0] != 0 || offsets[num_rows] != size)
+        return false;
+    for (int row = 0; row < num_rows; row++)
+        if (offsets[row] > offsets[row + 1])
+            return false;
+    for (int i = 0; values != NULL && i < size; i++)
+        if (values[i] < 0 || values[i] >= bound)
+            return false;
+    return true;
+}
+
+/**
+ * @brief Tells if all the @p num_offsets offsets of @p offsets are valid offsets of strings.
+ *
+ * @param offsets Offsets of strings.
+ * @param num_offsets Their number.
+ * @param strings_size The size of the strings.
+ * @return bool
+ */
+static bool tn_binary_valid_strings(const int *offsets, int num_offsets, uint64_t strings_size)
+{
+    for (int i = 0; i < num_offsets; i++)
+        if (offsets[i] < 0 || (uint64_t)offsets[i] >= strings_size)
+            return false;
+    return true;
+}
+
+TunnelNetwork tn_load_binary(const char *file, const uint64_t *expected_hash, Graph *graph)
+{
+    int fd = open(file, O_RDONLY);
+    if (fd < 0)
+        return NULL;
+    struct stat status;
+    if (fstat(fd, &status) != 0 || (size_t)status.st_size < sizeof(TunnelBinaryHeader))
+    {
+        close(fd);
+        return NULL;
+    }
+    size_t length = status.st_size;
+    const char *data = (const char *)mmap(NULL, length, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED)
+        return NULL;
+
+    const TunnelBinaryHeader *header = (const TunnelBinaryHeader *)data;
+    int num_nodes = header->num_nodes;
+    int num_arcs = header->num_arcs;
+    bool valid = header->magic == TN_BINARY_MAGIC && header->byte_order == TN_BINARY_BYTE_ORDER && header->int_size == sizeof(int)
+                 && header->file_size == length && num_nodes >= 0 && num_arcs >= 0 && header->num_parameters >= 0
+                 && (expected_hash == NULL || header->source_hash == *expected_hash)
+                 && header->file_size == sizeof(TunnelBinaryHeader) + (uint64_t)(5 * (uint64_t)num_nodes + 3 + 2 * (uint64_t)num_arcs + 2 * (uint64_t)header->num_parameters) * sizeof(int) + header->strings_size
+                 && (num_nodes == 0 || (header->initial >= 0 && header->initial < num_nodes && header->final >= 0 && header->final < num_nodes));
+    if (!valid)
+    {
+        munmap((void *)data, length);
+        return NULL;
+    }
+
+    const int *node_actions = (const int *)(data + sizeof(TunnelBinaryHeader));
+    const int *successor_offsets = node_actions + num_nodes;
+    const int *successors = successor_offsets + num_nodes + 1;
+    const int *predecessor_offsets = successors + num_arcs;
+    const int *predecessors = predecessor_offsets + num_nodes + 1;
+    const int *node_names = predecessors + num_arcs;
+    const int *parameter_offsets = node_names + num_nodes;
+    const int *parameters = parameter_offsets + num_nodes + 1;
+    const char *strings = (const char *)(parameters + 2 * header->num_parameters);
+
+    valid = tn_binary_valid_index(successor_offsets, successors, num_nodes, num_arcs, num_nodes)
+            && tn_binary_valid_index(predecessor_offsets, predecessors, num_nodes, num_arcs, num_nodes)
+            && tn_binary_valid_index(parameter_offsets, NULL, num_nodes, header->num_parameters, 0)
+            && tn_binary_valid_strings(node_names, num_nodes, header->strings_size)
+            && tn_binary_valid_strings(parameters, 2 * header->num_parameters, header->strings_size)
+            && (header->name == -1 || tn_binary_valid_strings(&header->name, 1, header->strings_size))
+            && (header->strings_size == 0 || strings[header->strings_size - 1] == '\0');
+    if (!valid)
+    {
+        munmap((void *)data, length);
+        return NULL;
+    }
+
+    // The graph owns the mapping: the index and the strings are used in place.
+    Graph result;
+    result.arena = arena_create(1 << 16);
+    arena_attach_mapping(result.arena, (void *)data, length);
+    result.name = header->name == -1 ? NULL : (char *)strings + header->name;
+    result.numNodes = num_nodes;
+    result.numEdges = header->num_edges;
+    result.successor_offsets = (int *)successor_offsets;
+    result.successors = (int *)successors;
+    result.predecessor_offsets = (int *)predecessor_offsets;
+    result.predecessors = (int *)predecessors;
+    result.numEdgeParameterLists = 0;
+    result.edge_parameter_lists = (parameterList **)graph_alloc(&result, 0);
+    result.edge_parameters = (int *)graph_alloc(&result, num_arcs * sizeof(int));
+    for (int arc = 0; arc < num_arcs; arc++)
+        result.edge_parameters[arc] = -1;
+
+    result.nodes = (char **)graph_alloc(&result, num_nodes * sizeof(char *));
+    result.parameters = (parameterList **)graph_alloc(&result, num_nodes * sizeof(parameterList *));
+    result.edges = (bool *)graph_alloc(&result, (size_t)num_nodes * num_nodes * sizeof(bool));
+    memset(result.edges, 0, (size_t)num_nodes * num_nodes * sizeof(bool));
+    for (int node = 0; node < num_nodes; node++)
+    {
+        result.nodes[node] = (char *)strings + node_names[node];
+        parameterList **last = &result.parameters[node];
+        *last = NULL;
+        for (int param = parameter_offsets[node]; param < parameter_offsets[node + 1]; param++)
+        {
+            *last = parameter_list_create_in_arena(result.arena, (char *)strings + parameters[2 * param], (char *)strings + parameters[2 * param + 1]);
+            last = &(*last)->next;
+        }
+        for (int arc = successor_offsets[node]; arc < successor_offsets[node + 1]; arc++)
+            result.edges[(size_t)node * num_nodes + successors[arc]] = true;
+    }
+
+    *graph = result;
+    return tn_initialize_with_actions(result, header->initial, header->final, node_actions);
+}
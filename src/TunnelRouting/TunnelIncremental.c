@@ -0,0 +1,425 @@
+#include "TunnelIncremental.h"
+#include "TunnelReduction.h"
+#include "Z3Tools.h"
+#include "Statistics.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+
+struct TunnelIncremental_s
+{
+    Z3_context ctx;        ///< The solver context.
+    TunnelNetwork network; ///< The network.
+    TunnelEncoding enc;    ///< The variables, shared by every length (its live states are those of paths of any size up to max_length).
+    Z3_solver solver;      ///< The persistent solver.
+    int max_length;        ///< The largest length allowed (fixes the stack size).
+    int encoded;           ///< Positions 0..encoded-1 have their constraints in the solver.
+    int ended;             ///< Lengths 1..ended have the constraints of their end in the solver.
+    int num_checks;        ///< The number of calls to the solver so far.
+    bool pairs;            ///< Whether the initial and final nodes are assumptions of each check (see tn_incremental_create_for_pairs).
+    bool *started;         ///< For pairs: whether the start literal of each node has its constraint in the solver.
+    bool *finished;        ///< For pairs: whether the end literal of each node at each length has its constraint in the solver, indexed [length][node].
+};
+
+/**
+ * @brief Creates the activation literal stating that position @p pos is part of the path.
+ *
+ * @param ctx The solver context.
+ * @param pos A position.
+ * @return Z3_ast
+ */
+static Z3_ast tn_position_literal(Z3_context ctx, int pos)
+{
+    char name[40];
+    snprintf(name, 40, "active pos %d", pos);
+    return mk_bool_var(ctx, name);
+}
+
+/**
+ * @brief Creates the activation literal stating that the path has size @p length (i.e. ends at the final node at position @p length).
+ *
+ * @param ctx The solver context.
+ * @param length A length.
+ * @return Z3_ast
+ */
+static Z3_ast tn_length_literal(Z3_context ctx, int length)
+{
+    char name[40];
+    snprintf(name, 40, "length %d", length);
+    return mk_bool_var(ctx, name);
+}
+
+/**
+ * @brief Creates the activation literal stating that the path has size at most @p max_length.
+ *
+ * @param ctx The solver context.
+ * @param max_length A length.
+ * @return Z3_ast
+ */
+static Z3_ast tn_bound_literal(Z3_context ctx, int max_length)
+{
+    char name[40];
+    snprintf(name, 40, "at most %d", max_length);
+    return mk_bool_var(ctx, name);
+}
+
+/**
+ * @brief Gets the activation literal stating that the path starts at @p node, asserting what it implies the first time.
+ *
+ * @param solver The incremental solver, created for pairs.
+ * @param node A node.
+ * @return Z3_ast
+ */
+static Z3_ast tn_start_literal(TunnelIncremental solver, int node)
+{
+    Z3_context ctx = solver->ctx;
+    char name[40];
+    snprintf(name, 40, "start %d", node);
+    Z3_ast literal = mk_bool_var(ctx, name);
+    if (!solver->started[node])
+    {
+        Z3_solver_assert(ctx, solver->solver, Z3_mk_implies(ctx, literal, tn_initial_stack_at(solver->enc, node)));
+        solver->started[node] = true;
+    }
+    return literal;
+}
+
+/**
+ * @brief Gets the activation literal stating that the path ends at @p node at position @p length, asserting what it implies the first time.
+ *
+ * @param solver The incremental solver, created for pairs.
+ * @param node A node.
+ * @param length A length.
+ * @return Z3_ast
+ */
+static Z3_ast tn_end_literal(TunnelIncremental solver, int node, int length)
+{
+    Z3_context ctx = solver->ctx;
+    char name[40];
+    snprintf(name, 40, "end %d at %d", node, length);
+    Z3_ast literal = mk_bool_var(ctx, name);
+    bool *finished = &solver->finished[length * tn_get_num_nodes(solver->network) + node];
+    if (!*finished)
+    {
+        Z3_solver_assert(ctx, solver->solver, Z3_mk_implies(ctx, literal, tn_final_stack_at(solver->enc, node, length)));
+        *finished = true;
+    }
+    return literal;
+}
+
+/**
+ * @brief Asserts the guarded constraints of position @p pos: its state constraints, the transition reaching it, and the fact that an active position implies the previous one is active.
+ *
+ * @param solver The incremental solver.
+ * @param pos The position to encode.
+ */
+static void tn_incremental_encode_position(TunnelIncremental solver, int pos)
+{
+    Z3_context ctx = solver->ctx;
+    Z3_ast active = tn_position_literal(ctx, pos);
+    Z3_solver_assert(ctx, solver->solver, Z3_mk_implies(ctx, active, tn_state_constraints(solver->enc, pos)));
+    if (pos == 0)
+    {
+        // With pairs, the start is given by the start literal of the check.
+        if (!solver->pairs)
+            Z3_solver_assert(ctx, solver->solver, tn_initial_stack(solver->enc));
+        return;
+    }
+    Z3_ast previous = tn_position_literal(ctx, pos - 1);
+    Z3_solver_assert(ctx, solver->solver, Z3_mk_implies(ctx, active, previous));
+    Z3_solver_assert(ctx, solver->solver, Z3_mk_implies(ctx, active, tn_transition_constraints(solver->enc, pos - 1)));
+}
+
+/**
+ * @brief Encodes the positions up to @p length, and the ends of the paths of size up to @p length: the length literal of a size activates the final state
+ * (with pairs, it is activated by the end literal instead) and, through the chain of position literals, every position up to that size.
+ *
+ * @param solver The incremental solver.
+ * @param length A length.
+ */
+static void tn_incremental_encode_up_to(TunnelIncremental solver, int length)
+{
+    Z3_context ctx = solver->ctx;
+    for (; solver->encoded <= length; solver->encoded++)
+        tn_incremental_encode_position(solver, solver->encoded);
+    for (; solver->ended < length; solver->ended++)
+    {
+        int end_length = solver->ended + 1;
+        Z3_ast end = tn_position_literal(ctx, end_length);
+        if (!solver->pairs)
+            end = Z3_mk_and(ctx, 2, (Z3_ast[]){end, tn_final_stack(solver->enc, end_length)});
+        Z3_solver_assert(ctx, solver->solver, Z3_mk_implies(ctx, tn_length_literal(ctx, end_length), end));
+    }
+}
+
+/**
+ * @brief Allocates an incremental solver whose encoding is @p enc.
+ *
+ * @param ctx The solver context.
+ * @param network The network.
+ * @param max_length The largest length allowed.
+ * @param enc The encoding.
+ * @param pairs Whether the initial and final nodes are assumptions of each check.
+ * @return TunnelIncremental
+ */
+static TunnelIncremental tn_incremental_create_with_encoding(Z3_context ctx, TunnelNetwork network, int max_length, TunnelEncoding enc, bool pairs)
+{
+    TunnelIncremental result = (TunnelIncremental)malloc(sizeof(*result));
+    result->ctx = ctx;
+    result->network = network;
+    result->max_length = max_length;
+    result->encoded = 0;
+    result->ended = 0;
+    result->num_checks = 0;
+    result->enc = enc;
+    result->solver = mk_solver(ctx);
+    result->pairs = pairs;
+    result->started = NULL;
+    result->finished = NULL;
+    if (pairs)
+    {
+        int num_nodes = tn_get_num_nodes(network);
+        result->started = (bool *)calloc(num_nodes > 0 ? num_nodes : 1, sizeof(bool));
+        result->finished = (bool *)calloc((max_length + 1) * (num_nodes > 0 ? num_nodes : 1), sizeof(bool));
+    }
+    return result;
+}
+
+TunnelIncremental tn_incremental_create(Z3_context ctx, TunnelNetwork network, int max_length)
+{
+    return tn_incremental_create_with_encoding(ctx, network, max_length, tn_encoding_create_up_to(ctx, network, max_length), false);
+}
+
+TunnelIncremental tn_incremental_create_for_pairs(Z3_context ctx, TunnelNetwork network, int max_length, int num_pairs, const int *initials, const int *finals)
+{
+    TunnelEncoding enc = tn_encoding_create_for_pairs(ctx, network, max_length, num_pairs, initials, finals);
+    return tn_incremental_create_with_encoding(ctx, network, max_length, enc, true);
+}
+
+/**
+ * @brief Calls the solver under @p assumptions, and gets its model if they are satisfiable.
+ *
+ * @param solver The incremental solver.
+ * @param num_assumptions The number of assumptions.
+ * @param assumptions The activation literals assumed.
+ * @param model Set to the model (with a reference) if the result is Z3_L_TRUE, unless it is NULL.
+ * @return Z3_lbool
+ */
+static Z3_lbool tn_incremental_check(TunnelIncremental solver, int num_assumptions, const Z3_ast *assumptions, Z3_model *model)
+{
+    Z3_context ctx = solver->ctx;
+    struct timespec start;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    Z3_lbool result = Z3_solver_check_assumptions(ctx, solver->solver, num_assumptions, assumptions);
+    statistics_print_solver(ctx, solver->solver, result, statistics_lap(&start));
+    solver->num_checks++;
+
+    if (result == Z3_L_UNDEF && model != NULL)
+        fprintf(stderr, "Warning: Getting a partial model from a formula of unknown satisfiability.\n");
+    else if (result == Z3_L_TRUE && model != NULL)
+        *model = tn_incremental_get_model(solver);
+    return result;
+}
+
+Z3_lbool tn_incremental_solve(TunnelIncremental solver, int length, Z3_model *model)
+{
+    assert(!solver->pairs && length >= 1 && length <= solver->max_length);
+    Z3_context ctx = solver->ctx;
+
+    tn_incremental_encode_up_to(solver, length);
+
+    Z3_ast length_literal = tn_length_literal(ctx, length);
+    Z3_lbool result = tn_incremental_check(solver, 1, &length_literal, model);
+    // Lets the solver discard the clauses guarded by this length.
+    if (result == Z3_L_FALSE)
+        Z3_solver_assert(ctx, solver->solver, Z3_mk_not(ctx, length_literal));
+    return result;
+}
+
+Z3_lbool tn_incremental_solve_pair(TunnelIncremental solver, int initial, int final, int length, Z3_model *model)
+{
+    assert(solver->pairs && length >= 1 && length <= solver->max_length);
+    Z3_context ctx = solver->ctx;
+
+    tn_incremental_encode_up_to(solver, length);
+
+    Z3_ast literals[3] = {tn_length_literal(ctx, length), tn_start_literal(solver, initial), tn_end_literal(solver, final, length)};
+    Z3_lbool result = tn_incremental_check(solver, 3, literals, model);
+    // Only this pair has no path of this size: the clause keeps the size for the other pairs.
+    if (result == Z3_L_FALSE)
+    {
+        Z3_ast negations[3];
+        for (int i = 0; i < 3; i++)
+            negations[i] = Z3_mk_not(ctx, literals[i]);
+        Z3_solver_assert(ctx, solver->solver, Z3_mk_or(ctx, 3, negations));
+    }
+    return result;
+}
+
+void tn_incremental_solve_pairs(TunnelIncremental solver, int num_pairs, const int *initials, const int *finals, Z3_lbool *results, int *lengths, Z3_model *models)
+{
+    bool *open = (bool *)malloc((num_pairs > 0 ? num_pairs : 1) * sizeof(bool));
+    int num_open = num_pairs;
+    for (int pair = 0; pair < num_pairs; pair++)
+    {
+        results[pair] = Z3_L_FALSE;
+        lengths[pair] = 0;
+        open[pair] = true;
+    }
+    // Size by size, so that the clauses learnt on a size serve every pair before the next size is encoded.
+    for (int l = 1; l <= solver->max_length && num_open > 0; l++)
+        for (int pair = 0; pair < num_pairs; pair++)
+        {
+            if (!open[pair])
+                continue;
+            Z3_lbool result = tn_incremental_solve_pair(solver, initials[pair], finals[pair], l, &models[pair]);
+            if (result == Z3_L_FALSE)
+                continue;
+            results[pair] = result;
+            if (result == Z3_L_TRUE)
+                lengths[pair] = l;
+            open[pair] = false;
+            num_open--;
+        }
+    free(open);
+}
+
+Z3_lbool tn_incremental_solve_at_most(TunnelIncremental solver, int max_length, int *length, Z3_model *model)
+{
+    assert(!solver->pairs && max_length >= 1 && max_length <= solver->max_length);
+    Z3_context ctx = solver->ctx;
+
+    tn_incremental_encode_up_to(solver, max_length);
+
+    Z3_ast *length_literals = (Z3_ast *)malloc(max_length * sizeof(Z3_ast));
+    for (int l = 1; l <= max_length; l++)
+        length_literals[l - 1] = tn_length_literal(ctx, l);
+    Z3_ast bound_literal = tn_bound_literal(ctx, max_length);
+    Z3_solver_assert(ctx, solver->solver, Z3_mk_implies(ctx, bound_literal, Z3_mk_or(ctx, max_length, length_literals)));
+
+    Z3_lbool result = tn_incremental_check(solver, 1, &bound_literal, model);
+    switch (result)
+    {
+    case Z3_L_FALSE:
+        // No size up to max_length has a path: their clauses can all be discarded.
+        for (int l = 0; l < max_length; l++)
+            Z3_solver_assert(ctx, solver->solver, Z3_mk_not(ctx, length_literals[l]));
+        break;
+    case Z3_L_UNDEF:
+        break;
+    case Z3_L_TRUE:
+        // Every true length literal is the end of a path: the model describes a path of the smallest of them.
+        *length = max_length;
+        for (int l = 1; l < max_length; l++)
+            if (value_of_var_in_model(ctx, *model, length_literals[l - 1]))
+            {
+                *length = l;
+                break;
+            }
+    }
+    free(length_literals);
+    return result;
+}
+
+bool tn_search_strategy_of_string(const char *name, tn_search_strategy *strategy)
+{
+    if (strcmp(name, "linear") == 0)
+        *strategy = tn_search_linear;
+    else if (strcmp(name, "exponential") == 0)
+        *strategy = tn_search_exponential;
+    else if (strcmp(name, "descending") == 0)
+        *strategy = tn_search_descending;
+    else
+        return false;
+    return true;
+}
+
+Z3_lbool tn_incremental_search(TunnelIncremental solver, tn_search_strategy strategy, int *length, Z3_model *model)
+{
+    if (strategy == tn_search_linear)
+    {
+        for (int l = 1; l <= solver->max_length; l++)
+        {
+            Z3_lbool result = tn_incremental_solve(solver, l, model);
+            if (result == Z3_L_TRUE)
+                *length = l;
+            if (result != Z3_L_FALSE)
+                return result;
+        }
+        return Z3_L_FALSE;
+    }
+
+    Z3_context ctx = solver->ctx;
+    int low = 1;  // No path is shorter than low.
+    int high = 0; // The size of the shortest path found so far (0 if none).
+    Z3_model best = NULL;
+    Z3_lbool result;
+
+    // First probe: sizes up to 1, 2, 4, 8... for the exponential strategy, and up to the maximal size for the descending one.
+    int probe = strategy == tn_search_exponential ? 1 : solver->max_length;
+    while (high == 0)
+    {
+        if (probe > solver->max_length)
+            probe = solver->max_length;
+        result = tn_incremental_solve_at_most(solver, probe, &high, &best);
+        if (result == Z3_L_UNDEF)
+            return result;
+        if (result == Z3_L_FALSE)
+        {
+            if (probe == solver->max_length)
+                return result;
+            low = probe + 1;
+            probe *= 2;
+        }
+    }
+
+    // The shortest size is in [low, high]: halve the interval, or only try a smaller size than the last path found for the descending strategy.
+    while (low < high)
+    {
+        int middle = strategy == tn_search_exponential ? low + (high - low - 1) / 2 : high - 1;
+        int found;
+        Z3_model middle_model;
+        result = tn_incremental_solve_at_most(solver, middle, &found, &middle_model);
+        if (result == Z3_L_UNDEF)
+        {
+            if (best)
+                Z3_model_dec_ref(ctx, best);
+            return result;
+        }
+        if (result == Z3_L_FALSE)
+            low = middle + 1;
+        else
+        {
+            if (best)
+                Z3_model_dec_ref(ctx, best);
+            best = middle_model;
+            high = found;
+        }
+    }
+    *length = high;
+    *model = best;
+    return Z3_L_TRUE;
+}
+
+Z3_model tn_incremental_get_model(TunnelIncremental solver)
+{
+    Z3_model model = Z3_solver_get_model(solver->ctx, solver->solver);
+    if (model)
+        Z3_model_inc_ref(solver->ctx, model);
+    return model;
+}
+
+int tn_incremental_get_num_checks(TunnelIncremental solver)
+{
+    return solver->num_checks;
+}
+
+void tn_incremental_delete(TunnelIncremental solver)
+{
+    Z3_solver_dec_ref(solver->ctx, solver->solver);
+    tn_encoding_delete(solver->enc);
+    free(solver->started);
+    free(solver->finished);
+    free(solver);
+}
@@ -19,7 +19,7 @@ TunnelNetwork tn_initialize(Graph graph)
     TunnelNetwork result = (TunnelNetwork)malloc(sizeof(*result));
     result->graph = graph;
     int num_nodes = graph_num_nodes(graph);
-    result->node_actions = (int *)malloc(num_nodes * sizeof(int));
+    result->node_actions = (int *)calloc(num_nodes, sizeof(int));
     result->initial = 0; // dummy value
     result->final = 0;   // dummy value
     for (int node = 0; node < num_nodes; node++)
@@ -72,6 +72,23 @@ TunnelNetwork tn_initialize(Graph graph)
     return result;
 }
 
+TunnelNetwork tn_initialize_with_actions(Graph graph, int initial, int final, const int *node_actions)
+{
+    TunnelNetwork result = (TunnelNetwork)malloc(sizeof(*result));
+    result->graph = graph;
+    int num_nodes = graph_num_nodes(graph);
+    result->node_actions = (int *)malloc((num_nodes > 0 ? num_nodes : 1) * sizeof(int));
+    memcpy(result->node_actions, node_actions, num_nodes * sizeof(int));
+    result->initial = initial;
+    result->final = final;
+    return result;
+}
+
+const Graph *tn_get_graph(TunnelNetwork network)
+{
+    return &network->graph;
+}
+
 void tn_delete(TunnelNetwork network)
 {
     free(network->node_actions);
@@ -139,6 +156,16 @@ bool tn_is_edge(TunnelNetwork network, int source, int target)
     return graph_is_edge(network->graph, source, target);
 }
 
+const int *tn_successors(TunnelNetwork network, int node, int *count)
+{
+    return graph_successors(network->graph, node, count);
+}
+
+const int *tn_predecessors(TunnelNetwork network, int node, int *count)
+{
+    return graph_predecessors(network->graph, node, count);
+}
+
 char *tn_get_node_name(TunnelNetwork network, int node)
 {
     return graph_get_node_name(network->graph, node);
@@ -149,6 +176,11 @@ bool tn_node_has_action(TunnelNetwork network, int node, stack_action action)
     return (((1 << action) & network->node_actions[node]) != 0);
 }
 
+int tn_get_node_actions(TunnelNetwork network, int node)
+{
+    return network->node_actions[node];
+}
+
 int tn_get_initial(TunnelNetwork network)
 {
     return network->initial;
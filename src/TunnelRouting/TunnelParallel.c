@@ -0,0 +1,424 @@
+#include "TunnelParallel.h"
+#include "TunnelReduction.h"
+#include "Z3Tools.h"
+#include "Statistics.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <time.h>
+
+/**
+ * @brief Delay between two interruptions of the workers solving cancelled sizes (an interruption is lost if Z3 is not solving yet).
+ */
+#define INTERRUPT_PERIOD_NS 1000000
+
+/**
+ * @brief State shared by the coordinator and the workers. Every field is protected by lock.
+ *
+ */
+typedef struct
+{
+    pthread_mutex_t lock;
+    pthread_cond_t changed;   ///< Signaled when a size is solved or a worker stops.
+    TunnelNetwork network;
+    int bound;                ///< The largest size tried.
+    int next_size;            ///< The next size to hand out.
+    int best;                 ///< The smallest size proven satisfiable so far (bound+1 if none).
+    int undecided;            ///< The smallest size that could not be decided (bound+1 if none).
+    int active_workers;       ///< The number of workers still running.
+    int *sizes;               ///< sizes[worker] is the size being solved by worker, or 0.
+    Z3_context *contexts;     ///< contexts[worker] is the context of worker while it solves, or NULL.
+    tn_step *path;            ///< The path of size best.
+} TunnelSweep;
+
+/**
+ * @brief The argument of a worker thread.
+ *
+ */
+typedef struct
+{
+    TunnelSweep *sweep;
+    int worker;
+} TunnelWorker;
+
+/**
+ * @brief Solves the reduction of size @p size in @p solver, a fresh solver of @p ctx.
+ *
+ * @param ctx The context of the worker.
+ * @param solver The solver.
+ * @param network The network.
+ * @param size The size of the path sought.
+ * @return Z3_lbool
+ */
+static Z3_lbool tn_parallel_solve_size(Z3_context ctx, Z3_solver solver, TunnelNetwork network, int size)
+{
+    Z3_ast formula = tn_reduction(ctx, network, size);
+    Z3_solver_assert(ctx, solver, formula);
+    struct timespec start;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    Z3_lbool result = Z3_solver_check(ctx, solver);
+    statistics_print_solver(ctx, solver, result, statistics_lap(&start));
+    return result;
+}
+
+/**
+ * @brief Claims the path found by @p worker on @p size: if @p size is still smaller than the best one, the worker is no longer interrupted
+ *        (an interrupted context fails on the next calls, such as getting the model).
+ *
+ * @param sweep The sweep.
+ * @param worker The worker.
+ * @param size The size solved by @p worker.
+ * @return bool true if the path is still wanted and can be decoded.
+ */
+static bool tn_parallel_claim(TunnelSweep *sweep, int worker, int size)
+{
+    pthread_mutex_lock(&sweep->lock);
+    bool wanted = size < sweep->best;
+    if (wanted)
+        sweep->contexts[worker] = NULL;
+    pthread_mutex_unlock(&sweep->lock);
+    return wanted;
+}
+
+/**
+ * @brief Body of a worker: takes the next size, solves it, and records the result, until no size smaller than the best one is left.
+ *
+ * @param arg A TunnelWorker.
+ * @return void* NULL.
+ */
+static void *tn_parallel_worker(void *arg)
+{
+    TunnelSweep *sweep = ((TunnelWorker *)arg)->sweep;
+    int worker = ((TunnelWorker *)arg)->worker;
+    tn_step *path = (tn_step *)malloc(sweep->bound * sizeof(tn_step));
+
+    pthread_mutex_lock(&sweep->lock);
+    while (sweep->next_size < sweep->best)
+    {
+        int size = sweep->next_size++;
+        Z3_context ctx = make_context();
+        sweep->sizes[worker] = size;
+        sweep->contexts[worker] = ctx;
+        pthread_mutex_unlock(&sweep->lock);
+
+        Z3_solver solver = mk_solver(ctx);
+        Z3_lbool result = tn_parallel_solve_size(ctx, solver, sweep->network, size);
+        bool decoded = false;
+        if (result == Z3_L_TRUE && tn_parallel_claim(sweep, worker, size))
+        {
+            Z3_model model = Z3_solver_get_model(ctx, solver);
+            Z3_model_inc_ref(ctx, model);
+            tn_get_path_from_model(ctx, model, sweep->network, size, path);
+            Z3_model_dec_ref(ctx, model);
+            decoded = true;
+        }
+        Z3_solver_dec_ref(ctx, solver);
+
+        pthread_mutex_lock(&sweep->lock);
+        sweep->sizes[worker] = 0;
+        sweep->contexts[worker] = NULL;
+        // A result on a size larger than the best one is discarded: it may come from an interruption.
+        if (size < sweep->best)
+        {
+            if (decoded)
+            {
+                sweep->best = size;
+                memcpy(sweep->path, path, size * sizeof(tn_step));
+            }
+            else if (result == Z3_L_UNDEF && size < sweep->undecided)
+                sweep->undecided = size;
+        }
+        pthread_cond_broadcast(&sweep->changed);
+        Z3_del_context(ctx);
+    }
+    sweep->active_workers--;
+    pthread_cond_broadcast(&sweep->changed);
+    pthread_mutex_unlock(&sweep->lock);
+    free(path);
+    return NULL;
+}
+
+/**
+ * @brief Interrupts the workers solving sizes larger than the best one.
+ *
+ * @param sweep The sweep.
+ * @param num_threads The number of workers.
+ * @return bool true if some worker was interrupted.
+ * @pre The lock of @p sweep is held.
+ */
+static bool tn_parallel_interrupt_larger(TunnelSweep *sweep, int num_threads)
+{
+    bool interrupted = false;
+    for (int worker = 0; worker < num_threads; worker++)
+    {
+        if (sweep->contexts[worker] != NULL && sweep->sizes[worker] > sweep->best)
+        {
+            Z3_interrupt(sweep->contexts[worker]);
+            interrupted = true;
+        }
+    }
+    return interrupted;
+}
+
+/**
+ * @brief Waits for @p changed at most INTERRUPT_PERIOD_NS, so that interruptions lost by workers not solving yet are repeated.
+ *
+ * @param changed A condition.
+ * @param lock The lock associated with @p changed, held.
+ */
+static void tn_parallel_wait_period(pthread_cond_t *changed, pthread_mutex_t *lock)
+{
+    struct timespec deadline;
+    clock_gettime(CLOCK_REALTIME, &deadline);
+    deadline.tv_nsec += INTERRUPT_PERIOD_NS;
+    if (deadline.tv_nsec >= 1000000000)
+    {
+        deadline.tv_sec++;
+        deadline.tv_nsec -= 1000000000;
+    }
+    pthread_cond_timedwait(changed, lock, &deadline);
+}
+
+Z3_lbool tn_parallel_sweep(TunnelNetwork network, int bound, int num_threads, tn_step *path, int *length)
+{
+    TunnelSweep sweep;
+    pthread_mutex_init(&sweep.lock, NULL);
+    pthread_cond_init(&sweep.changed, NULL);
+    sweep.network = network;
+    sweep.bound = bound;
+    sweep.next_size = 1;
+    sweep.best = bound + 1;
+    sweep.undecided = bound + 1;
+    sweep.active_workers = num_threads;
+    sweep.sizes = (int *)calloc(num_threads, sizeof(int));
+    sweep.contexts = (Z3_context *)calloc(num_threads, sizeof(Z3_context));
+    sweep.path = path;
+
+    pthread_t threads[num_threads];
+    TunnelWorker workers[num_threads];
+    for (int worker = 0; worker < num_threads; worker++)
+    {
+        workers[worker] = (TunnelWorker){&sweep, worker};
+        pthread_create(&threads[worker], NULL, tn_parallel_worker, &workers[worker]);
+    }
+
+    // The coordinator cancels the sizes made useless by a smaller satisfiable one, until every worker stopped.
+    pthread_mutex_lock(&sweep.lock);
+    while (sweep.active_workers > 0)
+    {
+        if (!tn_parallel_interrupt_larger(&sweep, num_threads))
+        {
+            pthread_cond_wait(&sweep.changed, &sweep.lock);
+            continue;
+        }
+        tn_parallel_wait_period(&sweep.changed, &sweep.lock);
+    }
+    pthread_mutex_unlock(&sweep.lock);
+
+    for (int worker = 0; worker < num_threads; worker++)
+        pthread_join(threads[worker], NULL);
+
+    Z3_lbool result = Z3_L_FALSE;
+    *length = 0;
+    // An undecided size only matters if it is smaller than the path found: otherwise, that path is still the shortest one.
+    if (sweep.undecided < sweep.best)
+        result = Z3_L_UNDEF;
+    else if (sweep.best <= bound)
+    {
+        result = Z3_L_TRUE;
+        *length = sweep.best;
+    }
+
+    free(sweep.sizes);
+    free(sweep.contexts);
+    pthread_cond_destroy(&sweep.changed);
+    pthread_mutex_destroy(&sweep.lock);
+    return result;
+}
+
+/**
+ * @brief State shared by the coordinator and the workers of a cube and conquer. Every field is protected by lock.
+ *
+ */
+typedef struct
+{
+    pthread_mutex_t lock;
+    pthread_cond_t changed;   ///< Signaled when a path is found or a worker stops.
+    TunnelNetwork network;
+    int length;               ///< The size of the path sought.
+    int num_cubes;            ///< The number of cubes.
+    int next_cube;            ///< The next cube to hand out.
+    bool found;               ///< Whether some cube is satisfiable (its path is then in path).
+    bool undecided;           ///< Whether some cube could not be decided.
+    int active_workers;       ///< The number of workers still running.
+    Z3_context *contexts;     ///< contexts[worker] is the context of worker while it solves, or NULL.
+    tn_step *path;            ///< The path found.
+} TunnelCubes;
+
+/**
+ * @brief The argument of a cube worker thread.
+ *
+ */
+typedef struct
+{
+    TunnelCubes *cubes;
+    int worker;
+} TunnelCubeWorker;
+
+/**
+ * @brief The position whose states are the cubes: the middle of the path, where the most states are usually live.
+ *
+ * @param length The size of the path.
+ * @return int
+ */
+static int tn_cube_position(int length)
+{
+    return length / 2;
+}
+
+/**
+ * @brief Body of a cube worker: builds the reduction once in its own context, then takes the next cube and checks the reduction under it, until a cube is
+ *        satisfiable or none is left. The learnt clauses of a cube are kept for the next ones.
+ *
+ * @param arg A TunnelCubeWorker.
+ * @return void* NULL.
+ */
+static void *tn_cube_worker(void *arg)
+{
+    TunnelCubes *shared = ((TunnelCubeWorker *)arg)->cubes;
+    int worker = ((TunnelCubeWorker *)arg)->worker;
+    int length = shared->length;
+    Z3_context ctx = make_context();
+    TunnelEncoding enc = tn_encoding_create(ctx, shared->network, length);
+    int num_cubes;
+    Z3_ast *cubes = tn_state_cubes(enc, tn_cube_position(length), &num_cubes);
+    tn_encoding_delete(enc);
+    Z3_solver solver = mk_solver(ctx);
+    Z3_solver_assert(ctx, solver, tn_reduction(ctx, shared->network, length));
+    tn_step *path = (tn_step *)malloc((length + 1) * sizeof(tn_step));
+
+    pthread_mutex_lock(&shared->lock);
+    shared->contexts[worker] = ctx;
+    while (!shared->found && shared->next_cube < shared->num_cubes)
+    {
+        int cube = shared->next_cube++;
+        pthread_mutex_unlock(&shared->lock);
+
+        struct timespec start;
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        Z3_lbool result = Z3_solver_check_assumptions(ctx, solver, 1, &cubes[cube]);
+        statistics_print_solver(ctx, solver, result, statistics_lap(&start));
+
+        pthread_mutex_lock(&shared->lock);
+        // Once a path is found, the other results are discarded: they may come from an interruption.
+        if (!shared->found)
+        {
+            if (result == Z3_L_TRUE)
+            {
+                // The first worker to find a path is no longer interrupted: an interrupted context fails on the next calls, such as getting the model.
+                shared->found = true;
+                shared->contexts[worker] = NULL;
+                pthread_mutex_unlock(&shared->lock);
+                Z3_model model = Z3_solver_get_model(ctx, solver);
+                Z3_model_inc_ref(ctx, model);
+                tn_get_path_from_model(ctx, model, shared->network, length, path);
+                Z3_model_dec_ref(ctx, model);
+                pthread_mutex_lock(&shared->lock);
+                memcpy(shared->path, path, length * sizeof(tn_step));
+                pthread_cond_broadcast(&shared->changed);
+            }
+            else if (result == Z3_L_UNDEF)
+                shared->undecided = true;
+        }
+    }
+    shared->contexts[worker] = NULL;
+    shared->active_workers--;
+    pthread_cond_broadcast(&shared->changed);
+    pthread_mutex_unlock(&shared->lock);
+
+    free(path);
+    free(cubes);
+    Z3_solver_dec_ref(ctx, solver);
+    Z3_del_context(ctx);
+    return NULL;
+}
+
+/**
+ * @brief Interrupts every worker still solving once a path is found.
+ *
+ * @param shared The cube and conquer.
+ * @param num_threads The number of workers.
+ * @return bool true if some worker was interrupted.
+ * @pre The lock of @p shared is held.
+ */
+static bool tn_cubes_interrupt(TunnelCubes *shared, int num_threads)
+{
+    if (!shared->found)
+        return false;
+    bool interrupted = false;
+    for (int worker = 0; worker < num_threads; worker++)
+    {
+        if (shared->contexts[worker] != NULL)
+        {
+            Z3_interrupt(shared->contexts[worker]);
+            interrupted = true;
+        }
+    }
+    return interrupted;
+}
+
+Z3_lbool tn_parallel_cubes(TunnelNetwork network, int length, int num_threads, tn_step *path, int *num_cubes)
+{
+    // The cubes are counted in a context of their own: each worker makes the same ones in its context.
+    Z3_context ctx = make_context();
+    TunnelEncoding enc = tn_encoding_create(ctx, network, length);
+    free(tn_state_cubes(enc, tn_cube_position(length), num_cubes));
+    tn_encoding_delete(enc);
+    Z3_del_context(ctx);
+
+    TunnelCubes shared;
+    pthread_mutex_init(&shared.lock, NULL);
+    pthread_cond_init(&shared.changed, NULL);
+    shared.network = network;
+    shared.length = length;
+    shared.num_cubes = *num_cubes;
+    shared.next_cube = 0;
+    shared.found = false;
+    shared.undecided = false;
+    // No more workers than cubes, each of them building the whole reduction.
+    if (num_threads > *num_cubes)
+        num_threads = *num_cubes > 0 ? *num_cubes : 1;
+    shared.active_workers = num_threads;
+    shared.contexts = (Z3_context *)calloc(num_threads, sizeof(Z3_context));
+    shared.path = path;
+
+    pthread_t threads[num_threads];
+    TunnelCubeWorker workers[num_threads];
+    for (int worker = 0; worker < num_threads; worker++)
+    {
+        workers[worker] = (TunnelCubeWorker){&shared, worker};
+        pthread_create(&threads[worker], NULL, tn_cube_worker, &workers[worker]);
+    }
+
+    pthread_mutex_lock(&shared.lock);
+    while (shared.active_workers > 0)
+    {
+        if (!tn_cubes_interrupt(&shared, num_threads))
+        {
+            pthread_cond_wait(&shared.changed, &shared.lock);
+            continue;
+        }
+        tn_parallel_wait_period(&shared.changed, &shared.lock);
+    }
+    pthread_mutex_unlock(&shared.lock);
+
+    for (int worker = 0; worker < num_threads; worker++)
+        pthread_join(threads[worker], NULL);
+
+    Z3_lbool result = shared.found ? Z3_L_TRUE : shared.undecided ? Z3_L_UNDEF : Z3_L_FALSE;
+    free(shared.contexts);
+    pthread_cond_destroy(&shared.changed);
+    pthread_mutex_destroy(&shared.lock);
+    return result;
+}
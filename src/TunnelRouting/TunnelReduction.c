@@ -1,163 +1,529 @@
 #include "TunnelReduction.h"
 #include "Z3Tools.h"
+#include "Statistics.h"
+#include "Arena.h"
 #include "stdio.h"
 #include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+
+/**
+ * @brief The encoding of the stack cells of the encodings created from now on.
+ */
+static tn_stack_encoding current_stack_encoding = tn_stack_pair;
+
+void tn_set_stack_encoding(tn_stack_encoding encoding)
+{
+    current_stack_encoding = encoding;
+}
+
+tn_stack_encoding tn_get_stack_encoding(void)
+{
+    return current_stack_encoding;
+}
+
+bool tn_stack_encoding_of_string(const char *name, tn_stack_encoding *encoding)
+{
+    if (strcmp(name, "pair") == 0)
+        *encoding = tn_stack_pair;
+    else if (strcmp(name, "compact") == 0)
+        *encoding = tn_stack_compact;
+    else
+        return false;
+    return true;
+}
+
+struct TunnelEncoding_s
+{
+    Z3_context ctx;        ///< The solver context.
+    TunnelNetwork network; ///< The network.
+    int length;            ///< The length of the sought path (positions go from 0 to length).
+    int num_nodes;         ///< The number of nodes of the network.
+    int stack_size;        ///< The number of cells of the stack.
+    bool compact;          ///< Whether a stack cell is a single variable (see tn_stack_compact).
+    Z3_ast *path_vars;     ///< The variables x_{node,pos,height}, indexed [pos][height][node]. A cell is NULL until the variable is first used.
+    Z3_ast *stack_vars;    ///< The variables y_{pos,height,4} and y_{pos,height,6}, indexed [pos][height][protocol]. A cell is NULL until the variable is first used.
+    Z3_ast *height_vars;   ///< The variables H_{pos,height}, indexed [pos][height]. A cell is NULL until the variable is first used.
+    Z3_ast *prefix_vars;   ///< The variables E_{pos,height}, indexed [pos][height]. A cell is NULL until the variable is first used.
+    unsigned char *live;   ///< The possible tops of the stack (LIVE_TOP_4, LIVE_TOP_6) of the states (node, pos, height) of some path, indexed [pos][height][node]. 0 for a dead state.
+    unsigned char *live_cells; ///< The union of live over the nodes, indexed [pos][height].
+    int *max_height;       ///< The highest live height at each position, or -1 if no state is live there.
+    Arena scratch;         ///< The temporary arrays of the formula builders, reset after each part of the reduction (see tn_scratch).
+};
+
+/**
+ * @brief Bit of a live state whose top of stack can be 4.
+ */
+#define LIVE_TOP_4 1
+
+/**
+ * @brief Bit of a live state whose top of stack can be 6.
+ */
+#define LIVE_TOP_6 2
+
+/**
+ * @brief Size of the blocks of the scratch arena of an encoding.
+ */
+#define TN_SCRATCH_BLOCK_SIZE (64 * 1024)
 
 // --- Variables ---
 
 /**
- * @brief Creates the variable "x_{node,pos,stack_height}" of the reduction (described in the subject).
+ * @brief Wrapper to have the correct size of the array representing the stack (correct cells of the stack will be from 0 to (get_stack_size(length)-1)).
+ *
+ * @param length The length of the sought path.
+ * @return int
+ */
+int get_stack_size(int length)
+{
+    return length / 2 + 1;
+}
+
+/**
+ * @brief Integer name of a variable of the reduction. It does not depend on the length of the encoding, so that encodings of different lengths over
+ * the same network share their variables: the cell (pos, height) is numbered along diagonals (Cantor pairing), and each cell has num_nodes+4 variables.
+ *
+ * @param enc The encoding.
+ * @param pos The path position.
+ * @param height The height.
+ * @param offset The node for a variable x, num_nodes for y_4, num_nodes+1 for y_6, num_nodes+2 for H and num_nodes+3 for E.
+ * @return int
+ */
+static int tn_variable_index(TunnelEncoding enc, int pos, int height, int offset)
+{
+    long diagonal = pos + height;
+    long cell = diagonal * (diagonal + 1) / 2 + height;
+    long index = cell * (enc->num_nodes + 4) + offset;
+    assert(index < MAX_INDEXED_VAR);
+    return (int)index;
+}
+
+/**
+ * @brief Gets the effect of @p action on the height and the top of the stack.
+ *
+ * @param action An action.
+ * @param top The protocol that @p action requires on top of the stack (0 for 4, 1 for 6).
+ * @param delta Set to the variation of the height.
+ * @param next_top Set to the protocol on top of the stack after @p action. For a pop, it is the protocol the action requires under the top.
+ */
+static void tn_action_effect(stack_action action, int *top, int *delta, int *next_top)
+{
+    switch (action)
+    {
+    case transmit_4: *top = 0; *delta = 0; *next_top = 0; break;
+    case transmit_6: *top = 1; *delta = 0; *next_top = 1; break;
+    case push_4_4: *top = 0; *delta = 1; *next_top = 0; break;
+    case push_4_6: *top = 0; *delta = 1; *next_top = 1; break;
+    case push_6_4: *top = 1; *delta = 1; *next_top = 0; break;
+    case push_6_6: *top = 1; *delta = 1; *next_top = 1; break;
+    // pop_a_b removes the top b and requires a under it.
+    case pop_4_4: *top = 0; *delta = -1; *next_top = 0; break;
+    case pop_4_6: *top = 1; *delta = -1; *next_top = 0; break;
+    case pop_6_4: *top = 0; *delta = -1; *next_top = 1; break;
+    default: *top = 1; *delta = -1; *next_top = 1; break;
+    }
+}
+
+/**
+ * @brief Computes which states (node, pos, height, top of stack) can be part of a path: those reachable from an initial state in pos steps (forward layers),
+ * and from which a final state can be reached at the end of the path (backward layers). Both passes follow the actions of the nodes, and only keep track of
+ * the top of the stack (the cells under it are not checked when popping), so every state of an actual path is live.
+ * With several pairs, the passes start from all their initial nodes and from all their final nodes at once: a state is live for the encoding if it
+ * is live for some path between any two of them, which includes the states of the paths of every pair.
+ *
+ * @param enc The encoding, its table live is filled.
+ * @param any_length If true, the path may end at any position from 1 to enc->length, otherwise it ends at enc->length.
+ * @param num_pairs The number of pairs of initial and final nodes.
+ * @param initials The initial nodes of the pairs.
+ * @param finals The final nodes of the pairs.
+ */
+static void tn_compute_live_states(TunnelEncoding enc, bool any_length, int num_pairs, const int *initials, const int *finals)
+{
+    int num_nodes = enc->num_nodes;
+    int stack_size = enc->stack_size;
+    int layer = stack_size * num_nodes;
+    int num_states = (enc->length + 1) * layer;
+    unsigned char *forward = enc->live;
+    unsigned char *backward = (unsigned char *)calloc(num_states, sizeof(unsigned char));
+
+    for (int pair = 0; pair < num_pairs; pair++)
+        forward[initials[pair]] = LIVE_TOP_4;
+    for (int pos = 0; pos < enc->length; pos++)
+        for (int h = 0; h < stack_size; h++)
+            for (int u = 0; u < num_nodes; u++)
+            {
+                unsigned char tops = forward[pos * layer + h * num_nodes + u];
+                if (tops == 0)
+                    continue;
+                int num_successors;
+                const int *successors = tn_successors(enc->network, u, &num_successors);
+                int actions = tn_get_node_actions(enc->network, u);
+                for (int action = 0; action < NumActions; action++)
+                {
+                    int top, delta, next_top;
+                    tn_action_effect(action, &top, &delta, &next_top);
+                    if (!(actions & (1 << action)) || !(tops & (1 << top)) || h + delta < 0 || h + delta >= stack_size)
+                        continue;
+                    unsigned char *next = forward + (pos + 1) * layer + (h + delta) * num_nodes;
+                    for (int i = 0; i < num_successors; i++)
+                        next[successors[i]] |= 1 << next_top;
+                }
+            }
+
+    for (int pair = 0; pair < num_pairs; pair++)
+        backward[enc->length * layer + finals[pair]] = LIVE_TOP_4;
+    for (int pos = enc->length - 1; pos >= 0; pos--)
+    {
+        for (int pair = 0; any_length && pos > 0 && pair < num_pairs; pair++)
+            backward[pos * layer + finals[pair]] = LIVE_TOP_4;
+        for (int h = 0; h < stack_size; h++)
+            for (int u = 0; u < num_nodes; u++)
+            {
+                int num_successors;
+                const int *successors = tn_successors(enc->network, u, &num_successors);
+                int actions = tn_get_node_actions(enc->network, u);
+                for (int action = 0; action < NumActions; action++)
+                {
+                    int top, delta, next_top;
+                    tn_action_effect(action, &top, &delta, &next_top);
+                    if (!(actions & (1 << action)) || h + delta < 0 || h + delta >= stack_size)
+                        continue;
+                    const unsigned char *next = backward + (pos + 1) * layer + (h + delta) * num_nodes;
+                    for (int i = 0; i < num_successors; i++)
+                        if (next[successors[i]] & (1 << next_top))
+                        {
+                            backward[pos * layer + h * num_nodes + u] |= 1 << top;
+                            break;
+                        }
+                }
+            }
+    }
+
+    for (int pos = 0; pos <= enc->length; pos++)
+    {
+        enc->max_height[pos] = -1;
+        for (int h = 0; h < stack_size; h++)
+        {
+            unsigned char cell = 0;
+            for (int u = 0; u < num_nodes; u++)
+            {
+                int state = pos * layer + h * num_nodes + u;
+                forward[state] &= backward[state];
+                cell |= forward[state];
+            }
+            enc->live_cells[pos * stack_size + h] = cell;
+            if (cell != 0)
+                enc->max_height[pos] = h;
+        }
+    }
+    free(backward);
+}
+
+/**
+ * @brief Creates an encoding of paths of size @p length, whose live states are those of paths of size @p length, or of any size up to @p length if @p any_length,
+ * between the initial and final nodes of some pair.
  *
  * @param ctx The solver context.
+ * @param network A Tunnel Network.
+ * @param length The size of the target path.
+ * @param any_length Whether the path may be shorter than @p length.
+ * @param num_pairs The number of pairs of initial and final nodes.
+ * @param initials The initial nodes of the pairs.
+ * @param finals The final nodes of the pairs.
+ * @return TunnelEncoding
+ */
+static TunnelEncoding tn_encoding_create_with_ends(Z3_context ctx, const TunnelNetwork network, int length, bool any_length, int num_pairs, const int *initials,
+                                                   const int *finals)
+{
+    TunnelEncoding enc = (TunnelEncoding)malloc(sizeof(*enc));
+    enc->ctx = ctx;
+    enc->network = network;
+    enc->length = length;
+    enc->num_nodes = tn_get_num_nodes(network);
+    enc->stack_size = get_stack_size(length);
+    enc->compact = current_stack_encoding == tn_stack_compact;
+    int num_cells = (length + 1) * enc->stack_size;
+    enc->path_vars = (Z3_ast *)calloc(num_cells * enc->num_nodes, sizeof(Z3_ast));
+    enc->stack_vars = (Z3_ast *)calloc(num_cells * 2, sizeof(Z3_ast));
+    enc->height_vars = (Z3_ast *)calloc(num_cells, sizeof(Z3_ast));
+    enc->prefix_vars = (Z3_ast *)calloc(num_cells, sizeof(Z3_ast));
+    enc->live = (unsigned char *)calloc(num_cells * enc->num_nodes, sizeof(unsigned char));
+    enc->live_cells = (unsigned char *)malloc(num_cells * sizeof(unsigned char));
+    enc->max_height = (int *)malloc((length + 1) * sizeof(int));
+    enc->scratch = arena_create(TN_SCRATCH_BLOCK_SIZE);
+    tn_compute_live_states(enc, any_length, num_pairs, initials, finals);
+    return enc;
+}
+
+TunnelEncoding tn_encoding_create(Z3_context ctx, const TunnelNetwork network, int length)
+{
+    int initial = tn_get_initial(network);
+    int final = tn_get_final(network);
+    return tn_encoding_create_with_ends(ctx, network, length, false, 1, &initial, &final);
+}
+
+TunnelEncoding tn_encoding_create_up_to(Z3_context ctx, const TunnelNetwork network, int max_length)
+{
+    int initial = tn_get_initial(network);
+    int final = tn_get_final(network);
+    return tn_encoding_create_with_ends(ctx, network, max_length, true, 1, &initial, &final);
+}
+
+TunnelEncoding tn_encoding_create_for_pairs(Z3_context ctx, const TunnelNetwork network, int max_length, int num_pairs, const int *initials, const int *finals)
+{
+    return tn_encoding_create_with_ends(ctx, network, max_length, true, num_pairs, initials, finals);
+}
+
+void tn_encoding_delete(TunnelEncoding enc)
+{
+    free(enc->path_vars);
+    free(enc->stack_vars);
+    free(enc->height_vars);
+    free(enc->prefix_vars);
+    free(enc->live);
+    free(enc->live_cells);
+    free(enc->max_height);
+    arena_delete(enc->scratch);
+    free(enc);
+}
+
+/**
+ * @brief Allocates a temporary array of @p size formulae for a formula builder. It is valid until the scratch arena of @p enc is reset, after the part
+ * of the reduction being built (by tn_reduction, tn_state_constraints and tn_transition_constraints), so builders do not free it.
+ *
+ * @param enc The encoding.
+ * @param size The number of formulae.
+ * @return Z3_ast* The array.
+ */
+static Z3_ast *tn_scratch(TunnelEncoding enc, int size)
+{
+    return (Z3_ast *)arena_alloc(enc->scratch, (size_t)size * sizeof(Z3_ast));
+}
+
+/**
+ * @brief Gets the possible tops of the stack of the state (@p node, @p pos, @p height) (see tn_compute_live_states).
+ *
+ * @param enc The encoding.
+ * @param node A node.
+ * @param pos The path position.
+ * @param height A height.
+ * @return unsigned char A mask of LIVE_TOP_4 and LIVE_TOP_6, 0 if no path goes through that state.
+ */
+static unsigned char tn_live_tops(TunnelEncoding enc, int node, int pos, int height)
+{
+    return enc->live[(pos * enc->stack_size + height) * enc->num_nodes + node];
+}
+
+/**
+ * @brief Tells if some state of height @p height at position @p pos is live.
+ *
+ * @param enc The encoding.
+ * @param pos The path position.
+ * @param height A height.
+ * @return bool
+ */
+static bool tn_live_cell(TunnelEncoding enc, int pos, int height)
+{
+    return enc->live_cells[pos * enc->stack_size + height] != 0;
+}
+
+/**
+ * @brief Gets the variable "x_{node,pos,stack_height}" of the reduction (described in the subject). It is the constant false if the state is dead.
+ *
+ * @param enc The encoding.
  * @param node A node.
  * @param pos The path position.
  * @param stack_height The highest cell occupied of the stack at that position.
  * @return Z3_ast
  */
-Z3_ast tn_path_variable(Z3_context ctx, int node, int pos, int stack_height)
+Z3_ast tn_path_variable(TunnelEncoding enc, int node, int pos, int stack_height)
 {
-    char name[60];
-    snprintf(name, 60, "node %d,pos %d, height %d", node, pos, stack_height);
-    return mk_bool_var(ctx, name);
+    if (!tn_live_tops(enc, node, pos, stack_height))
+        return Z3_mk_false(enc->ctx);
+    Z3_ast *var = &enc->path_vars[(pos * enc->stack_size + stack_height) * enc->num_nodes + node];
+    if (*var == NULL)
+        *var = mk_indexed_bool_var(enc->ctx, tn_variable_index(enc, pos, stack_height, node));
+    return *var;
 }
 
 /**
- * @brief Creates the variable "y_{pos,height,4}" of the reduction (described in the subject).
+ * @brief Gets the variable "y_{pos,height,protocol}" of the reduction.
  *
- * @param ctx The solver context.
+ * @param enc The encoding.
  * @param pos The path position.
  * @param height The height of the cell described.
+ * @param protocol 0 for 4, 1 for 6.
  * @return Z3_ast
  */
-Z3_ast tn_4_variable(Z3_context ctx, int pos, int height)
+static Z3_ast tn_stack_variable(TunnelEncoding enc, int pos, int height, int protocol)
 {
-    char name[60];
-    snprintf(name, 60, "4 at height %d on pos %d", height, pos);
-    return mk_bool_var(ctx, name);
+    Z3_ast *var = &enc->stack_vars[(pos * enc->stack_size + height) * 2 + protocol];
+    if (*var == NULL)
+        *var = mk_indexed_bool_var(enc->ctx, tn_variable_index(enc, pos, height, enc->num_nodes + protocol));
+    return *var;
 }
 
 /**
- * @brief Creates the variable "y_{pos,height,6}" of the reduction (described in the subject).
+ * @brief Gets the variable "y_{pos,height,4}" of the reduction (described in the subject). With compact cells, it is the negation of y_{pos,height,6}.
  *
- * @param ctx The solver context.
+ * @param enc The encoding.
  * @param pos The path position.
  * @param height The height of the cell described.
  * @return Z3_ast
  */
-Z3_ast tn_6_variable(Z3_context ctx, int pos, int height)
+Z3_ast tn_4_variable(TunnelEncoding enc, int pos, int height)
 {
-    char name[60];
-    snprintf(name, 60, "6 at height %d on pos %d", height, pos);
-    return mk_bool_var(ctx, name);
+    // A compact cell only has the variable y_{pos,height,6}.
+    if (enc->compact)
+        return Z3_mk_not(enc->ctx, tn_stack_variable(enc, pos, height, 1));
+    return tn_stack_variable(enc, pos, height, 0);
 }
 
 /**
- * @brief Wrapper to have the correct size of the array representing the stack (correct cells of the stack will be from 0 to (get_stack_size(length)-1)).
+ * @brief Gets the variable "y_{pos,height,6}" of the reduction (described in the subject).
  *
- * @param length The length of the sought path.
- * @return int
+ * @param enc The encoding.
+ * @param pos The path position.
+ * @param height The height of the cell described.
+ * @return Z3_ast
  */
-int get_stack_size(int length)
+Z3_ast tn_6_variable(TunnelEncoding enc, int pos, int height)
 {
-    return length / 2 + 1;
+    return tn_stack_variable(enc, pos, height, 1);
 }
 
 /**
- * @brief Checks if ANY node is active at (pos, height)
+ * @brief Gets the variable "H_{pos,height}": some node is active at (pos, height). It is only meaningful together with tn_height_definitions(enc, pos).
+ * It is the constant false if no state of that height is live.
  *
- * @param ctx The solver context.
- * @param num_nodes The number of nodes.
+ * @param enc The encoding.
+ * @param pos The path position.
  * @param height The height of the cell described.
  * @return Z3_ast
  */
-Z3_ast tn_any_node_at(Z3_context ctx, int num_nodes, int pos, int height) {
-    Z3_ast *nodes = malloc(num_nodes * sizeof(Z3_ast));
-    for(int i=0; i<num_nodes; i++) {
-        nodes[i] = tn_path_variable(ctx, i, pos, height);
+Z3_ast tn_any_node_at(TunnelEncoding enc, int pos, int height) {
+    if (!tn_live_cell(enc, pos, height))
+        return Z3_mk_false(enc->ctx);
+    Z3_ast *var = &enc->height_vars[pos * enc->stack_size + height];
+    if (*var == NULL)
+        *var = mk_indexed_bool_var(enc->ctx, tn_variable_index(enc, pos, height, enc->num_nodes + 2));
+    return *var;
+}
+
+Z3_ast tn_height_definitions(TunnelEncoding enc, int pos)
+{
+    Z3_context ctx = enc->ctx;
+    int stack_size = enc->stack_size;
+    int num_nodes = enc->num_nodes;
+    Z3_ast *definitions = tn_scratch(enc, stack_size);
+    Z3_ast *nodes = tn_scratch(enc, num_nodes);
+    int count = 0;
+    for (int h = 0; h < stack_size; h++) {
+        // A height without live state has H_{pos,h} = false, and needs no definition.
+        if (!tn_live_cell(enc, pos, h))
+            continue;
+        int num_live = 0;
+        for (int i = 0; i < num_nodes; i++)
+            if (tn_live_tops(enc, i, pos, h))
+                nodes[num_live++] = tn_path_variable(enc, i, pos, h);
+        // H_{pos,h} <-> OR_u x_{u,pos,h}
+        definitions[count++] = Z3_mk_iff(ctx, tn_any_node_at(enc, pos, h), Z3_mk_or(ctx, num_live, nodes));
     }
-    Z3_ast res = Z3_mk_or(ctx, num_nodes, nodes);
-    free(nodes);
+    Z3_ast res = Z3_mk_and(ctx, count, definitions);
     return res;
 }
 
 // --- SAT Formulas ---
 
 /**
- * @brief φ1 : Existence, single operation, and single height.
- * 
- * @param ctx The solver context.
- * @param network The graph
- * @param length The length of the sought path.
+ * @brief Existence and uniqueness of the pair (node, height) at position @p pos (the part of φ1 for a single position).
+ *
+ * @param enc The encoding.
+ * @param pos The position constrained.
  * @return Z3_ast
  */
-Z3_ast tn_exist_uniqueOp_uniqueHeight(Z3_context ctx, const TunnelNetwork network, int length)
+static Z3_ast tn_unique_state_at(TunnelEncoding enc, int pos)
 {
-    int stack_size = get_stack_size(length);
-    int num_nodes = tn_get_num_nodes(network);
-    // Total number of variables x(op, i, h) for a given position i
+    Z3_context ctx = enc->ctx;
+    int stack_size = enc->stack_size;
+    int num_nodes = enc->num_nodes;
+    // Total number of variables x(op, pos, h) for a given position pos
     int num_vars = stack_size * num_nodes;
-    int num_positions = length + 1; 
-
-    Z3_ast *pos_constraints = malloc(num_positions * sizeof(Z3_ast));
-
-    for (int i = 0; i <= length; i++) {
-        // Collect all variables x(op, i, h) for this position
-        Z3_ast *vars = malloc(num_vars * sizeof(Z3_ast));
-        int idx = 0;
-        for (int h = 0; h < stack_size; h++) {
-            for (int op = 0; op < num_nodes; op++) {
-                // x(op, i, h): true if at position i we are at operation "op" with height "h"
-                vars[idx++] = tn_path_variable(ctx, op, i, h);
-            }
-        }
-        // 1. At least one variable is true
-        Z3_ast existence = Z3_mk_or(ctx, num_vars, vars);
-        // 2. At most one variable is true
-        int num_pairs = num_vars * (num_vars - 1) / 2;
-        Z3_ast *clauses = malloc(num_pairs * sizeof(Z3_ast));
-        int c = 0;
-        for (int p = 0; p < num_vars; p++) {
-            for (int q = p + 1; q < num_vars; q++) {
-                //cannot both be true at the same time.
-                Z3_ast not_both[2] = { Z3_mk_not(ctx, vars[p]), Z3_mk_not(ctx, vars[q]) };
-                clauses[c++] = Z3_mk_or(ctx, 2, not_both);
-            }
+
+    // Collect all variables x(op, pos, h) for this position
+    Z3_ast *vars = tn_scratch(enc, num_vars);
+    int idx = 0;
+    for (int h = 0; h < stack_size; h++) {
+        for (int op = 0; op < num_nodes; op++) {
+            // x(op, pos, h): true if at position pos we are at operation "op" with height "h". Dead states are false.
+            if (tn_live_tops(enc, op, pos, h))
+                vars[idx++] = tn_path_variable(enc, op, pos, h);
         }
-        Z3_ast uniq = Z3_mk_and(ctx, num_pairs, clauses);
+    }
+    // At least one and at most one variable is true (the at-most-one encoding is chosen by Z3Tools).
+    Z3_ast res = uniqueFormula(ctx, vars, idx);
+    return res;
+}
+
+/**
+ * @brief φ1 : Existence, single operation, and single height.
+ * 
+ * @param enc The encoding.
+ * @return Z3_ast
+ */
+Z3_ast tn_exist_uniqueOp_uniqueHeight(TunnelEncoding enc)
+{
+    Z3_context ctx = enc->ctx;
+    int num_positions = enc->length + 1; 
 
-        pos_constraints[i] = Z3_mk_and(ctx, 2, (Z3_ast[]){existence, uniq});
+    Z3_ast *pos_constraints = tn_scratch(enc, num_positions);
 
-        free(vars);
-        free(clauses);
-    }
+    for (int i = 0; i <= enc->length; i++)
+        pos_constraints[i] = tn_unique_state_at(enc, i);
 
     Z3_ast result = Z3_mk_and(ctx, num_positions, pos_constraints);
-    free(pos_constraints);
     return result;
 }
 
+Z3_ast tn_initial_stack(TunnelEncoding enc)
+{
+    return tn_initial_stack_at(enc, tn_get_initial(enc->network));
+}
+
+Z3_ast tn_final_stack(TunnelEncoding enc, int pos)
+{
+    return tn_final_stack_at(enc, tn_get_final(enc->network), pos);
+}
+
+Z3_ast tn_initial_stack_at(TunnelEncoding enc, int node)
+{
+    Z3_context ctx = enc->ctx;
+    return Z3_mk_and(ctx, 2, (Z3_ast[]){
+        tn_path_variable(enc, node, 0, 0),
+        tn_4_variable(enc, 0, 0)
+    });
+}
+
+Z3_ast tn_final_stack_at(TunnelEncoding enc, int node, int pos)
+{
+    Z3_context ctx = enc->ctx;
+    return Z3_mk_and(ctx, 2, (Z3_ast[]){
+        tn_path_variable(enc, node, pos, 0),
+        tn_4_variable(enc, pos, 0)
+    });
+}
+
 /**
  * @brief φ2 : Initial and final stack
  * 
- * @param ctx The solver context.
- * @param network The graph
- * @param length The length of the sought path.
+ * @param enc The encoding.
  * @return Z3_ast
  */
-Z3_ast tn_init_final_stack(Z3_context ctx, const TunnelNetwork network, int length)
+Z3_ast tn_init_final_stack(TunnelEncoding enc)
 {
-    int init  = tn_get_initial(network);
-    int final = tn_get_final(network);
-
-    Z3_ast init_state = Z3_mk_and(ctx, 2, (Z3_ast[]){
-        tn_path_variable(ctx, init, 0, 0),
-        tn_4_variable(ctx, 0, 0)
-    });
-
-    Z3_ast final_state = Z3_mk_and(ctx, 2, (Z3_ast[]){
-        tn_path_variable(ctx, final, length, 0),
-        tn_4_variable(ctx, length, 0)
-    });
+    Z3_context ctx = enc->ctx;
+    Z3_ast init_state = tn_initial_stack(enc);
+    Z3_ast final_state = tn_final_stack(enc, enc->length);
 
     return Z3_mk_and(ctx, 2, (Z3_ast[]){ init_state, final_state });
 }
@@ -165,40 +531,44 @@ Z3_ast tn_init_final_stack(Z3_context ctx, const TunnelNetwork network, int leng
 /**
  * @brief φ3 : Stack height transition rule for Transmission
  * 
- * @param ctx The solver context.
- * @param length The length of the sought path.
+ * @param enc The encoding.
  * @param pos The current position of the path.
  * @return Z3_ast
  */
-Z3_ast tn_transition_stack_height(Z3_context ctx, TunnelNetwork network, int length, int pos)
+Z3_ast tn_transition_stack_height(TunnelEncoding enc, int pos)
 {
-    int stack_size = get_stack_size(length);
-    int num_nodes = tn_get_num_nodes(network);
+    Z3_context ctx = enc->ctx;
+    int stack_size = enc->stack_size;
+    int num_nodes = enc->num_nodes;
     // We will generate one constraint per (u, h)
-    Z3_ast *constraints = malloc(num_nodes * stack_size * sizeof(Z3_ast));
+    Z3_ast *constraints = tn_scratch(enc, num_nodes * stack_size);
     int count = 0;
 
     //is there ANY node at height h at step pos+1? If true, height h is preserved → potential Transmission transition.
-    Z3_ast next_any_h[stack_size];
-    for(int h=0; h<stack_size; h++) next_any_h[h] = tn_any_node_at(ctx, num_nodes, pos+1, h);
+    Z3_ast *next_any_h = tn_scratch(enc, stack_size);
+    for(int h=0; h<stack_size; h++) next_any_h[h] = tn_any_node_at(enc, pos+1, h);
 
     //for each height h and each node u
     for (int h = 0; h < stack_size; h++) {
+        if (!tn_live_cell(enc, pos + 1, h))
+            continue;
         for (int u = 0; u < num_nodes; u++) {
+            if (!tn_live_tops(enc, u, pos, h))
+                continue;
             // We are at node u at step pos with height h AND at step pos+1 there is some node at the SAME height h
             // height is preserved → Transmission
             Z3_ast premise = Z3_mk_and(ctx, 2, (Z3_ast[]){
-                tn_path_variable(ctx, u, pos, h),
+                tn_path_variable(enc, u, pos, h),
                 next_any_h[h] 
             });
 
             // Stack content at (pos, h)
-            Z3_ast y4 = tn_4_variable(ctx, pos, h);
-            Z3_ast y6 = tn_6_variable(ctx, pos, h);
+            Z3_ast y4 = tn_4_variable(enc, pos, h);
+            Z3_ast y6 = tn_6_variable(enc, pos, h);
             
             // Check whether node u allows the required transmission type.
-            Z3_ast can_t4 = tn_node_has_action(network, u, transmit_4) ? Z3_mk_true(ctx) : Z3_mk_false(ctx);
-            Z3_ast can_t6 = tn_node_has_action(network, u, transmit_6) ? Z3_mk_true(ctx) : Z3_mk_false(ctx);
+            Z3_ast can_t4 = tn_node_has_action(enc->network, u, transmit_4) ? Z3_mk_true(ctx) : Z3_mk_false(ctx);
+            Z3_ast can_t6 = tn_node_has_action(enc->network, u, transmit_6) ? Z3_mk_true(ctx) : Z3_mk_false(ctx);
 
             //If the content is 4, node u must allow transmit_4.
             Z3_ast valid_4 = Z3_mk_implies(ctx, y4, can_t4);
@@ -211,183 +581,184 @@ Z3_ast tn_transition_stack_height(Z3_context ctx, TunnelNetwork network, int len
         }
     }
     Z3_ast res = Z3_mk_and(ctx, count, constraints);
-    free(constraints);
     return res;
 }
 
 /**
  * @brief φ4 : Stack height transition rule for Encapsulation
  *
- * @param ctx The solver context.
- * @param length The length of the sought path.
+ * @param enc The encoding.
  * @param pos The current position in the path.
  * @return Z3_ast
  */
-Z3_ast tn_encapsulation_stack_height(Z3_context ctx, TunnelNetwork network, int length, int pos){
-    int stack_size = get_stack_size(length);
+Z3_ast tn_encapsulation_stack_height(TunnelEncoding enc, int pos){
+    Z3_context ctx = enc->ctx;
+    int stack_size = enc->stack_size;
     if (stack_size <= 1) return Z3_mk_true(ctx);
-    int num_nodes = tn_get_num_nodes(network);
+    int num_nodes = enc->num_nodes;
     // We will generate one constraint per (u, h)
-    Z3_ast *constraints = malloc(num_nodes * (stack_size-1) * sizeof(Z3_ast));
+    Z3_ast *constraints = tn_scratch(enc, num_nodes * (stack_size-1));
     int count = 0;
 
     // Is there ANY node at height h+1 at step pos+1 ? Can the stack increase by one level?
-    Z3_ast next_any_h_plus[stack_size];
-    for(int h=0; h<stack_size-1; h++) next_any_h_plus[h] = tn_any_node_at(ctx, num_nodes, pos+1, h+1);
+    Z3_ast *next_any_h_plus = tn_scratch(enc, stack_size);
+    for(int h=0; h<stack_size-1; h++) next_any_h_plus[h] = tn_any_node_at(enc, pos+1, h+1);
 
     //for each height h (except the top one) and each node u
     for (int h = 0; h < stack_size - 1; h++) {
+        if (!tn_live_cell(enc, pos + 1, h + 1))
+            continue;
         for(int u=0; u < num_nodes; u++) {
+            if (!tn_live_tops(enc, u, pos, h))
+                continue;
             // Premise: We are at u at h, and in the next step we are at h+1 (Push)
             Z3_ast premise = Z3_mk_and(ctx, 2, (Z3_ast[]){
-                tn_path_variable(ctx, u, pos, h),
+                tn_path_variable(enc, u, pos, h),
                 next_any_h_plus[h]
             });
 
             // Stack content before the PUSH (h, pos)
-            Z3_ast y4_curr = tn_4_variable(ctx, pos, h);
-            Z3_ast y6_curr = tn_6_variable(ctx, pos, h);
+            Z3_ast y4_curr = tn_4_variable(enc, pos, h);
+            Z3_ast y6_curr = tn_6_variable(enc, pos, h);
             // Stack content after the PUSH (h+1, pos+1)
-            Z3_ast y4_next = tn_4_variable(ctx, pos+1, h+1);
-            Z3_ast y6_next = tn_6_variable(ctx, pos+1, h+1);
+            Z3_ast y4_next = tn_4_variable(enc, pos+1, h+1);
+            Z3_ast y6_next = tn_6_variable(enc, pos+1, h+1);
 
             // PUSH 4 → 4
             Z3_ast c1 = Z3_mk_implies(ctx, Z3_mk_and(ctx, 2, (Z3_ast[]){y4_curr, y4_next}), 
-                        tn_node_has_action(network, u, push_4_4) ? Z3_mk_true(ctx) : Z3_mk_false(ctx));
+                        tn_node_has_action(enc->network, u, push_4_4) ? Z3_mk_true(ctx) : Z3_mk_false(ctx));
             
             // PUSH 4 → 6
             Z3_ast c2 = Z3_mk_implies(ctx, Z3_mk_and(ctx, 2, (Z3_ast[]){y4_curr, y6_next}), 
-                        tn_node_has_action(network, u, push_4_6) ? Z3_mk_true(ctx) : Z3_mk_false(ctx));
+                        tn_node_has_action(enc->network, u, push_4_6) ? Z3_mk_true(ctx) : Z3_mk_false(ctx));
             // PUSH 6 → 4
             Z3_ast c3 = Z3_mk_implies(ctx, Z3_mk_and(ctx, 2, (Z3_ast[]){y6_curr, y4_next}), 
-                        tn_node_has_action(network, u, push_6_4) ? Z3_mk_true(ctx) : Z3_mk_false(ctx));
+                        tn_node_has_action(enc->network, u, push_6_4) ? Z3_mk_true(ctx) : Z3_mk_false(ctx));
             // PUSH 6 → 6
             Z3_ast c4 = Z3_mk_implies(ctx, Z3_mk_and(ctx, 2, (Z3_ast[]){y6_curr, y6_next}), 
-                        tn_node_has_action(network, u, push_6_6) ? Z3_mk_true(ctx) : Z3_mk_false(ctx));
+                        tn_node_has_action(enc->network, u, push_6_6) ? Z3_mk_true(ctx) : Z3_mk_false(ctx));
 
             constraints[count++] = Z3_mk_implies(ctx, premise, Z3_mk_and(ctx, 4, (Z3_ast[]){c1, c2, c3, c4}));
         }
     }
     Z3_ast res = Z3_mk_and(ctx, count, constraints);
-    free(constraints);
     return res;
 }
 
 /**
  * @brief φ5 : Stack height transition rule for Decapsulation
  * 
- * @param ctx The solver context.
- * @param length The length of the sought path.
+ * @param enc The encoding.
  * @param pos The current position in the path.
  * @return Z3_ast
  */
-Z3_ast tn_decapsulation_stack_height(Z3_context ctx, TunnelNetwork network, int length, int pos)
+Z3_ast tn_decapsulation_stack_height(TunnelEncoding enc, int pos)
 {
-    int stack_size = get_stack_size(length);
+    Z3_context ctx = enc->ctx;
+    int stack_size = enc->stack_size;
     if (stack_size <= 1) return Z3_mk_true(ctx);
-    int num_nodes = tn_get_num_nodes(network);
+    int num_nodes = enc->num_nodes;
     // We will generate one constraint per (u, h)
-    Z3_ast *constraints = malloc(num_nodes * (stack_size-1) * sizeof(Z3_ast));
+    Z3_ast *constraints = tn_scratch(enc, num_nodes * (stack_size-1));
     int count = 0;
 
-    Z3_ast next_any_h_minus[stack_size];
-    for(int h=1; h<stack_size; h++) next_any_h_minus[h] = tn_any_node_at(ctx, num_nodes, pos+1, h-1);
+    Z3_ast *next_any_h_minus = tn_scratch(enc, stack_size);
+    for(int h=1; h<stack_size; h++) next_any_h_minus[h] = tn_any_node_at(enc, pos+1, h-1);
 
     for (int h = 1; h < stack_size; h++) {
+        if (!tn_live_cell(enc, pos + 1, h - 1))
+            continue;
         for(int u=0; u < num_nodes; u++) {
+            if (!tn_live_tops(enc, u, pos, h))
+                continue;
             //Condition : We are at u at h, and in the next step we are at h-1 (Pop)
             Z3_ast premise = Z3_mk_and(ctx, 2, (Z3_ast[]){
-                tn_path_variable(ctx, u, pos, h),
+                tn_path_variable(enc, u, pos, h),
                 next_any_h_minus[h]
             });
 
-            Z3_ast y4_top = tn_4_variable(ctx, pos, h); 
-            Z3_ast y6_top = tn_6_variable(ctx, pos, h);
-            Z3_ast y4_under = tn_4_variable(ctx, pos, h-1);
-            Z3_ast y6_under = tn_6_variable(ctx, pos, h-1);
+            Z3_ast y4_top = tn_4_variable(enc, pos, h); 
+            Z3_ast y6_top = tn_6_variable(enc, pos, h);
+            Z3_ast y4_under = tn_4_variable(enc, pos, h-1);
+            Z3_ast y6_under = tn_6_variable(enc, pos, h-1);
             
             // Cas 1: Top 4, Under 4 (44↓4) -> pop_4_4
             Z3_ast c1 = Z3_mk_implies(ctx, Z3_mk_and(ctx, 2, (Z3_ast[]){y4_top, y4_under}), 
-                        tn_node_has_action(network, u, pop_4_4) ? Z3_mk_true(ctx) : Z3_mk_false(ctx));
+                        tn_node_has_action(enc->network, u, pop_4_4) ? Z3_mk_true(ctx) : Z3_mk_false(ctx));
             
             // Cas 2: Top 4, Under 6 (64↓6) -> It's pop_6_4 (you remove 4 to reveal 6)
             Z3_ast c2 = Z3_mk_implies(ctx, Z3_mk_and(ctx, 2, (Z3_ast[]){y4_top, y6_under}), 
-                        tn_node_has_action(network, u, pop_6_4) ? Z3_mk_true(ctx) : Z3_mk_false(ctx));
+                        tn_node_has_action(enc->network, u, pop_6_4) ? Z3_mk_true(ctx) : Z3_mk_false(ctx));
             
             // Cas 3: Top 6, Under 4 (46↓4) -> It's pop_4_6 (remove 6 to reveal 4)
             Z3_ast c3 = Z3_mk_implies(ctx, Z3_mk_and(ctx, 2, (Z3_ast[]){y6_top, y4_under}), 
-                        tn_node_has_action(network, u, pop_4_6) ? Z3_mk_true(ctx) : Z3_mk_false(ctx));
+                        tn_node_has_action(enc->network, u, pop_4_6) ? Z3_mk_true(ctx) : Z3_mk_false(ctx));
             
             // Cas 4: Top 6, Under 6 (66↓6) -> pop_6_6
             Z3_ast c4 = Z3_mk_implies(ctx, Z3_mk_and(ctx, 2, (Z3_ast[]){y6_top, y6_under}), 
-                        tn_node_has_action(network, u, pop_6_6) ? Z3_mk_true(ctx) : Z3_mk_false(ctx));
+                        tn_node_has_action(enc->network, u, pop_6_6) ? Z3_mk_true(ctx) : Z3_mk_false(ctx));
 
             constraints[count++] = Z3_mk_implies(ctx, premise, Z3_mk_and(ctx, 4, (Z3_ast[]){c1, c2, c3, c4}));
         }
     }
     Z3_ast res = Z3_mk_and(ctx, count, constraints);
-    free(constraints);
     return res;
 }
 
 /**
  * @brief φ6 : Stack content coherence (exactly with one protocol (4 or 6))
  * 
- * @param ctx The solver context.
- * @param length The length of the sought path.
+ * @param enc The encoding.
  * @param pos The current position in the path.
  * @return Z3_ast 
  */
-Z3_ast tn_stack_content_coherence(Z3_context ctx, int length, int pos){
-    int stack_size = get_stack_size(length);
-    Z3_ast *constraints = malloc(stack_size * sizeof(Z3_ast));
-
-    for (int h = 0; h < stack_size; h++) {
-        Z3_ast y4 = tn_4_variable(ctx, pos, h);
-        Z3_ast y6 = tn_6_variable(ctx, pos, h);
+Z3_ast tn_stack_content_coherence(TunnelEncoding enc, int pos){
+    Z3_context ctx = enc->ctx;
+    // A compact cell always holds exactly one protocol.
+    if (enc->compact)
+        return Z3_mk_true(ctx);
+    int stack_size = enc->stack_size;
+    Z3_ast *constraints = tn_scratch(enc, stack_size);
+    // The cells above the highest live height are never read.
+    int num_cells = enc->max_height[pos] + 1;
+
+    for (int h = 0; h < num_cells; h++) {
+        Z3_ast y4 = tn_4_variable(enc, pos, h);
+        Z3_ast y6 = tn_6_variable(enc, pos, h);
         constraints[h] = Z3_mk_xor(ctx, y4, y6);
     }
-    Z3_ast result = Z3_mk_and(ctx, stack_size, constraints);
-    free(constraints);
+    Z3_ast result = Z3_mk_and(ctx, num_cells, constraints);
     return result;
 }
 
 /**
  * @brief φ7 :  Conditions necessary for an operation to be feasible
  * 
- * @param ctx The solver context.
- * @param network The graph.
- * @param length The length of the sought path.
+ * @param enc The encoding.
  * @param pos The current position in the path.
  * @return Z3_ast 
  */
-Z3_ast tn_operation_feasibility(Z3_context ctx, TunnelNetwork network, int length, int pos){
-    int stack_size = get_stack_size(length);
-    int num_nodes = tn_get_num_nodes(network);
-    Z3_ast *constraints = malloc(num_nodes * stack_size * sizeof(Z3_ast));
+Z3_ast tn_operation_feasibility(TunnelEncoding enc, int pos){
+    Z3_context ctx = enc->ctx;
+    int stack_size = enc->stack_size;
+    int num_nodes = enc->num_nodes;
+    // Up to two constraints per node and height (a node without any action forbids both tops).
+    Z3_ast *constraints = tn_scratch(enc, 2 * num_nodes * stack_size + 1);
     int count = 0;
 
     for(int h=0; h<stack_size; h++) {
         for(int u=0; u<num_nodes; u++) {
+            // Only the tops with which a live state can act (they require an action of u, see tn_compute_live_states) are allowed.
+            unsigned char tops = tn_live_tops(enc, u, pos, h);
+            if (tops == 0)
+                continue;
             // x_{u,pos,h} : node u is active at position pos and height h
-            Z3_ast active = tn_path_variable(ctx, u, pos, h);
+            Z3_ast active = tn_path_variable(enc, u, pos, h);
             // y_{pos,h,4} and y_{pos,h,6}: the top of the stack is respectively 4 or 6
-            Z3_ast y4 = tn_4_variable(ctx, pos, h);
-            Z3_ast y6 = tn_6_variable(ctx, pos, h);
-
-            //operations can only be executed if the top-of-stack is 4.
-            bool can_input_4 = tn_node_has_action(network, u, transmit_4) ||
-                               tn_node_has_action(network, u, push_4_4) ||
-                               tn_node_has_action(network, u, push_4_6) ||
-                               tn_node_has_action(network, u, pop_4_4) ||
-                               tn_node_has_action(network, u, pop_6_4); // pop_6_4 signifie Top=4, Under=6
-
-            //These operations can only be executed if the top-of-stack is 6.                  
-            bool can_input_6 = tn_node_has_action(network, u, transmit_6) ||
-                               tn_node_has_action(network, u, push_6_4) ||
-                               tn_node_has_action(network, u, push_6_6) ||
-                               tn_node_has_action(network, u, pop_4_6) || // pop_4_6 signifie Top=6, Under=4
-                               tn_node_has_action(network, u, pop_6_6);
+            Z3_ast y4 = tn_4_variable(enc, pos, h);
+            Z3_ast y6 = tn_6_variable(enc, pos, h);
+            bool can_input_4 = tops & LIVE_TOP_4;
+            bool can_input_6 = tops & LIVE_TOP_6;
             // If node u cannot use top=4, forbid y4 whenever active is true
             if (!can_input_4) {
                 constraints[count++] = Z3_mk_implies(ctx, active, Z3_mk_not(ctx, y4));
@@ -399,61 +770,95 @@ Z3_ast tn_operation_feasibility(Z3_context ctx, TunnelNetwork network, int lengt
         }
     }
     Z3_ast res = Z3_mk_and(ctx, count, constraints);
-    free(constraints);
     return res;
 }
 
 /**
- * @brief Builds a conjunction expressing that the lower part of the stack 
- *        (prefix 0..limit-1) remains identical between positions pos and next_pos.
+ * @brief Gets the variable "E_{pos,height}": the cells 0..height of the stack are the same at @p pos and @p pos+1. It is only meaningful together with
+ * tn_prefix_definitions(enc, pos).
+ *
+ * @param enc The encoding.
+ * @param pos The path position.
+ * @param height The highest cell compared.
+ * @return Z3_ast
+ */
+static Z3_ast tn_prefix_variable(TunnelEncoding enc, int pos, int height)
+{
+    Z3_ast *var = &enc->prefix_vars[pos * enc->stack_size + height];
+    if (*var == NULL)
+        *var = mk_indexed_bool_var(enc->ctx, tn_variable_index(enc, pos, height, enc->num_nodes + 3));
+    return *var;
+}
+
+/**
+ * @brief Defines the variables E_{pos,k} as a chain, each one extending the previous one by a cell:
+ * E_{pos,0} ↔ (y[pos,0,4] ↔ y[pos+1,0,4]) ∧ (y[pos,0,6] ↔ y[pos+1,0,6]) and E_{pos,k} ↔ E_{pos,k-1} ∧ (y[pos,k,4] ↔ y[pos+1,k,4]) ∧ (y[pos,k,6] ↔ y[pos+1,k,6])
+ * (without the equivalences of the variables y_4 for compact cells).
  *
- * @details This function creates the formula: ( y[pos,k,a] ↔ y[pos+1,k,a] )
- * for both possible contents (4 and 6).
+ * @details Every preservation constraint at @p pos is then a single literal, instead of a conjunction of up to stack_size cells, which makes φ8-φ10
+ * linear in the size of the stack at each position. Only the cells up to the highest live height at @p pos are compared (no higher prefix is used).
  *
- * @param ctx       The solver context.
- * @param pos       The current position in the path.
- * @param next_pos  The next position (pos+1).
- * @param limit     The number of stack cells to preserve (prefix size).
- * @return Z3_ast 
+ * @param enc The encoding.
+ * @param pos The current position in the path.
+ * @return Z3_ast
  */
-Z3_ast tn_prefix_equal(Z3_context ctx, int pos, int next_pos, int limit){
-    if (limit <= 0) {
-        return Z3_mk_true(ctx);
+static Z3_ast tn_prefix_definitions(TunnelEncoding enc, int pos)
+{
+    Z3_context ctx = enc->ctx;
+    int num_cells = enc->max_height[pos] + 1;
+    Z3_ast *definitions = tn_scratch(enc, num_cells + 1);
+
+    for (int k = 0; k < num_cells; k++) {
+        Z3_ast same[3];
+        int num_same = 0;
+        same[num_same++] = Z3_mk_iff(ctx, tn_6_variable(enc, pos, k), tn_6_variable(enc, pos + 1, k));
+        // The variables y_4 of a compact cell are the negations of its variable y_6.
+        if (!enc->compact)
+            same[num_same++] = Z3_mk_iff(ctx, tn_4_variable(enc, pos, k), tn_4_variable(enc, pos + 1, k));
+        if (k > 0)
+            same[num_same++] = tn_prefix_variable(enc, pos, k - 1);
+        definitions[k] = Z3_mk_iff(ctx, tn_prefix_variable(enc, pos, k), Z3_mk_and(ctx, num_same, same));
     }
+    Z3_ast res = Z3_mk_and(ctx, num_cells, definitions);
+    return res;
+}
 
-    Z3_ast *eqs = malloc(limit * sizeof(Z3_ast));
-    for (int k = 0; k < limit; k++) {
-        eqs[k] = Z3_mk_and(ctx, 2, (Z3_ast[]){
-            Z3_mk_iff(ctx, tn_4_variable(ctx, pos, k), tn_4_variable(ctx, next_pos, k)),
-            Z3_mk_iff(ctx, tn_6_variable(ctx, pos, k), tn_6_variable(ctx, next_pos, k))
-        });
+/**
+ * @brief Expresses that the lower part of the stack (prefix 0..limit-1) remains identical between positions pos and pos+1.
+ *
+ * @param enc       The encoding.
+ * @param pos       The current position in the path.
+ * @param limit     The number of stack cells to preserve (prefix size), at most the highest live height at @p pos plus one.
+ * @return Z3_ast The variable E_{pos,limit-1} (see tn_prefix_definitions), or true if @p limit is 0.
+ */
+static Z3_ast tn_prefix_equal(TunnelEncoding enc, int pos, int limit){
+    if (limit <= 0) {
+        return Z3_mk_true(enc->ctx);
     }
-    Z3_ast res = Z3_mk_and(ctx, limit, eqs);
-    free(eqs);
-    return res;
+    return tn_prefix_variable(enc, pos, limit - 1);
 }
 
 /**
  * @brief φ8-Transmission: preservation of stack contents when the height remains the same.
  *
- * @details If the stack height is h at both pos and pos+1, then the lower part of the stack
- * (0..h-1) must stay identical.
+ * @details If the stack height is h at both pos and pos+1, then the whole stack
+ * (0..h, the top included) must stay identical.
  *
- * @param ctx       The solver context.
- * @param num_nodes Number of nodes in the network (used for ∃ over x variables).
+ * @param enc       The encoding.
  * @param pos       Current position.
  * @param h         Current stack height.
  * @return Z3_ast
  */
-static Z3_ast tn_stack_preservation_transmission(Z3_context ctx, int num_nodes, int pos, int h) 
+static Z3_ast tn_stack_preservation_transmission(TunnelEncoding enc, int pos, int h) 
 {
+    Z3_context ctx = enc->ctx;
     // Condition: stack height = h at pos AND at pos+1
-    Z3_ast any_at_h = tn_any_node_at(ctx, num_nodes, pos,   h);
-    Z3_ast next_at_h = tn_any_node_at(ctx, num_nodes, pos+1, h);
+    Z3_ast any_at_h = tn_any_node_at(enc, pos,   h);
+    Z3_ast next_at_h = tn_any_node_at(enc, pos+1, h);
     Z3_ast trans_cond = Z3_mk_and(ctx, 2, (Z3_ast[]){ any_at_h, next_at_h });
 
-    // Preserve cells 0..h-1
-    Z3_ast trans_preserves = tn_prefix_equal(ctx, pos, pos+1, h);
+    // Preserve cells 0..h: a transmission does not change the top either
+    Z3_ast trans_preserves = tn_prefix_equal(enc, pos, h+1);
 
     return Z3_mk_implies(ctx, trans_cond, trans_preserves);
 }
@@ -464,27 +869,27 @@ static Z3_ast tn_stack_preservation_transmission(Z3_context ctx, int num_nodes,
  * @details When encapsulating, a new element is pushed on top of the stack. 
  * Therefore stack cells 0..h must remain identical.
  *
- * @param ctx         The solver context.
- * @param num_nodes   Number of graph nodes.
- * @param stack_size  Maximum stack size.
+ * @param enc         The encoding.
  * @param pos         Current position.
  * @param h           Current stack height.
  * @return Z3_ast
  */
-static Z3_ast tn_stack_preservation_encapsulation(Z3_context ctx, int num_nodes, int stack_size, int pos, int h) 
+static Z3_ast tn_stack_preservation_encapsulation(TunnelEncoding enc, int pos, int h) 
 {
-    Z3_ast any_at_h = tn_any_node_at(ctx, num_nodes, pos, h);
+    Z3_context ctx = enc->ctx;
+    int stack_size = enc->stack_size;
+    Z3_ast any_at_h = tn_any_node_at(enc, pos, h);
     // True only if h+1 is a valid height
     Z3_ast next_at_h_plus = Z3_mk_false(ctx);
 
     if (h + 1 < stack_size) {
-        next_at_h_plus = tn_any_node_at(ctx, num_nodes, pos+1, h+1);
+        next_at_h_plus = tn_any_node_at(enc, pos+1, h+1);
     }
 
     Z3_ast enc_cond = Z3_mk_and(ctx, 2, (Z3_ast[]){ any_at_h, next_at_h_plus });
 
     // Preserve stack cells 0..h (h+1 cells)
-    Z3_ast enc_preserves = tn_prefix_equal(ctx, pos, pos+1, h+1);
+    Z3_ast enc_preserves = tn_prefix_equal(enc, pos, h+1);
 
     return Z3_mk_implies(ctx, enc_cond, enc_preserves);
 }
@@ -495,25 +900,25 @@ static Z3_ast tn_stack_preservation_encapsulation(Z3_context ctx, int num_nodes,
  * @details When popping the top element, the new top becomes cell h-1,
  * therefore the lower cells 0..h-1 must remain identical.
  *
- * @param ctx         The solver context.
- * @param num_nodes   Number of graph nodes.
+ * @param enc         The encoding.
  * @param pos         Current position.
  * @param h           Current stack height.
  * @return Z3_ast
  */
-static Z3_ast tn_stack_preservation_decapsulation(Z3_context ctx, int num_nodes, int pos, int h) 
+static Z3_ast tn_stack_preservation_decapsulation(TunnelEncoding enc, int pos, int h) 
 {
-    Z3_ast any_at_h = tn_any_node_at(ctx, num_nodes, pos,   h);
+    Z3_context ctx = enc->ctx;
+    Z3_ast any_at_h = tn_any_node_at(enc, pos,   h);
     // True only if h-1 is a valid height
     Z3_ast next_at_h_minus = Z3_mk_false(ctx);
 
     if (h - 1 >= 0) {
-        next_at_h_minus = tn_any_node_at(ctx, num_nodes, pos+1, h-1);
+        next_at_h_minus = tn_any_node_at(enc, pos+1, h-1);
     }
 
     Z3_ast dec_cond = Z3_mk_and(ctx, 2, (Z3_ast[]){ any_at_h, next_at_h_minus });
     // Preserve cells 0..h-1
-    Z3_ast dec_preserves = tn_prefix_equal(ctx, pos, pos+1, h);
+    Z3_ast dec_preserves = tn_prefix_equal(enc, pos, h);
 
     return Z3_mk_implies(ctx, dec_cond, dec_preserves);
 }
@@ -521,50 +926,63 @@ static Z3_ast tn_stack_preservation_decapsulation(Z3_context ctx, int num_nodes,
 // --- Global Stack Preservation Feature ---
 
 /**
- * @brief φ8  φ9  φ10 : Stack preservation logic for Transmission, Encapsulation, and Decapsulation
- * 
- * @param ctx The solver context.
- * @param network The graph
- * @param length The length of the sought path.
+ * @brief φ8  φ9  φ10 at a single position: stack preservation between @p pos and @p pos+1, for every height.
+ *
+ * @param enc The encoding.
+ * @param pos The current position in the path.
  * @return Z3_ast
  */
-Z3_ast tn_stack_preservation_logic(Z3_context ctx, const TunnelNetwork network, int length){
-    int stack_size = get_stack_size(length);
-    int num_nodes  = tn_get_num_nodes(network);
-    int num_pos    = length;
+static Z3_ast tn_stack_preservation_pos(TunnelEncoding enc, int pos)
+{
+    Z3_context ctx = enc->ctx;
+    int stack_size = enc->stack_size;
+    Z3_ast *h_constraints = tn_scratch(enc, stack_size + 1);
+
+    int count = 0;
+    h_constraints[count++] = tn_prefix_definitions(enc, pos);
 
-    Z3_ast *constraints = malloc(num_pos * sizeof(Z3_ast));
+    for (int h = 0; h < stack_size; h++) {
+        // Every case requires a live state at (pos, h).
+        if (!tn_live_cell(enc, pos, h))
+            continue;
 
-    for (int pos = 0; pos < num_pos - 1; pos++) {
-        Z3_ast *h_constraints = malloc(stack_size * sizeof(Z3_ast));
+        // Combine the 3 possible cases for this height
+        Z3_ast c1 = tn_stack_preservation_transmission(
+            enc, pos, h
+        );
 
-        for (int h = 0; h < stack_size; h++) {
+        Z3_ast c2 = tn_stack_preservation_encapsulation(
+            enc, pos, h
+        );
 
-            // Combine the 3 possible cases for this height
-            Z3_ast c1 = tn_stack_preservation_transmission(
-                ctx, num_nodes, pos, h
-            );
+        Z3_ast c3 = tn_stack_preservation_decapsulation(
+            enc, pos, h
+        );
 
-            Z3_ast c2 = tn_stack_preservation_encapsulation(
-                ctx, num_nodes, stack_size, pos, h
-            );
+        h_constraints[count++] = Z3_mk_and(ctx, 3, (Z3_ast[]){ c1, c2, c3 });
+    }
 
-            Z3_ast c3 = tn_stack_preservation_decapsulation(
-                ctx, num_nodes, pos, h
-            );
+    Z3_ast res = Z3_mk_and(ctx, count, h_constraints);
+    return res;
+}
 
-            h_constraints[h] = Z3_mk_and(ctx, 3, (Z3_ast[]){ c1, c2, c3 });
-        }
+/**
+ * @brief φ8  φ9  φ10 : Stack preservation logic for Transmission, Encapsulation, and Decapsulation
+ * 
+ * @param enc The encoding.
+ * @return Z3_ast
+ */
+Z3_ast tn_stack_preservation_logic(TunnelEncoding enc){
+    Z3_context ctx = enc->ctx;
+    int num_pos = enc->length;
 
-        constraints[pos] = Z3_mk_and(ctx, stack_size, h_constraints);
-        free(h_constraints);
-    }
+    Z3_ast *constraints = tn_scratch(enc, num_pos);
 
-    // Last position does not impose constraints
-    constraints[num_pos - 1] = Z3_mk_true(ctx);
+    // Every transition pos -> pos+1 of the path, including the one reaching the final node
+    for (int pos = 0; pos < num_pos; pos++)
+        constraints[pos] = tn_stack_preservation_pos(enc, pos);
 
     Z3_ast res = Z3_mk_and(ctx, num_pos, constraints);
-    free(constraints);
     return res;
 }
 
@@ -573,38 +991,39 @@ Z3_ast tn_stack_preservation_logic(Z3_context ctx, const TunnelNetwork network,
  * @details If x_{op,pos,h} is true, then at pos+1 the path must move to some successor
  *          op' of op in the graph, with a valid stack height transition (h-1, h, or h+1).
  *          If no successor is valid for this state, the state is forbidden.
- * @param ctx The solver context.
- * @param network The tunnel network graph.
- * @param length The length of the path being constructed.
+ * @param enc The encoding.
  * @param pos The current path position.
  * @param h The current stack height.
  * @param u The current operation (node).
  * @return Z3_ast
  */
 
-static Z3_ast tn_edge_node_constraint(Z3_context ctx, const TunnelNetwork network, int length, int pos, int h, int u){
-    int num_nodes  = tn_get_num_nodes(network);
-    int stack_size = get_stack_size(length);
+static Z3_ast tn_edge_node_constraint(TunnelEncoding enc, int pos, int h, int u){
+    Z3_context ctx = enc->ctx;
+    int stack_size = enc->stack_size;
 
-    Z3_ast current = tn_path_variable(ctx, u, pos, h);
+    Z3_ast current = tn_path_variable(enc, u, pos, h);
 
-    Z3_ast *valid_next = malloc(num_nodes * 3 * sizeof(Z3_ast));
+    int num_successors;
+    const int *successors = tn_successors(enc->network, u, &num_successors);
+    Z3_ast *valid_next = tn_scratch(enc, num_successors * 3 + 1);
     int v_count = 0;
 
-    for (int v = 0; v < num_nodes; v++) {
-        if (tn_is_edge(network, u, v)) {
-            // Transmission (h)
-            valid_next[v_count++] = tn_path_variable(ctx, v, pos + 1, h);
+    // Dead next states are false, they are left out of the disjunction.
+    for (int i = 0; i < num_successors; i++) {
+        int v = successors[i];
+        // Transmission (h)
+        if (tn_live_tops(enc, v, pos + 1, h))
+            valid_next[v_count++] = tn_path_variable(enc, v, pos + 1, h);
 
-            // Push (h+1)
-            if (h + 1 < stack_size) {
-                valid_next[v_count++] = tn_path_variable(ctx, v, pos + 1, h + 1);
-            }
+        // Push (h+1)
+        if (h + 1 < stack_size && tn_live_tops(enc, v, pos + 1, h + 1)) {
+            valid_next[v_count++] = tn_path_variable(enc, v, pos + 1, h + 1);
+        }
 
-            // Pop (h-1)
-            if (h - 1 >= 0) {
-                valid_next[v_count++] = tn_path_variable(ctx, v, pos + 1, h - 1);
-            }
+        // Pop (h-1)
+        if (h - 1 >= 0 && tn_live_tops(enc, v, pos + 1, h - 1)) {
+            valid_next[v_count++] = tn_path_variable(enc, v, pos + 1, h - 1);
         }
     }
     Z3_ast result;
@@ -614,8 +1033,6 @@ static Z3_ast tn_edge_node_constraint(Z3_context ctx, const TunnelNetwork networ
         Z3_ast valid_or = Z3_mk_or(ctx, v_count, valid_next);
         result = Z3_mk_implies(ctx, current, valid_or);
     }
-
-    free(valid_next);
     return result;
 }
 
@@ -624,24 +1041,25 @@ static Z3_ast tn_edge_node_constraint(Z3_context ctx, const TunnelNetwork networ
  * @details Builds the conjunction of all local constraints (op, pos, h)
  *          over every operation op in the graph, enforcing valid transitions for
  *          any active operation at this height.
- * @param ctx The solver context.
- * @param network The tunnel network graph.
- * @param length The length of the path being constructed.
+ * @param enc The encoding.
  * @param pos The current path position.
  * @param h The stack height for which constraints are generated.
  * @return Z3_ast
  */
 
-static Z3_ast tn_edge_height_constraint(Z3_context ctx, const TunnelNetwork network, int length, int pos, int h){
-    int num_nodes = tn_get_num_nodes(network);
-    Z3_ast *node_constraints = malloc(num_nodes * sizeof(Z3_ast));
+static Z3_ast tn_edge_height_constraint(TunnelEncoding enc, int pos, int h){
+    Z3_context ctx = enc->ctx;
+    int num_nodes = enc->num_nodes;
+    Z3_ast *node_constraints = tn_scratch(enc, num_nodes);
+    int count = 0;
 
+    // A dead state is false: it needs no constraint.
     for (int u = 0; u < num_nodes; u++) {
-        node_constraints[u] = tn_edge_node_constraint(ctx, network, length, pos, h, u);
+        if (tn_live_tops(enc, u, pos, h))
+            node_constraints[count++] = tn_edge_node_constraint(enc, pos, h, u);
     }
 
-    Z3_ast res = Z3_mk_and(ctx, num_nodes, node_constraints);
-    free(node_constraints);
+    Z3_ast res = Z3_mk_and(ctx, count, node_constraints);
     return res;
 }
 
@@ -650,23 +1068,21 @@ static Z3_ast tn_edge_height_constraint(Z3_context ctx, const TunnelNetwork netw
  * @details Builds the conjunction of all height-level constraints (pos, h)
  *          over every stack height h, ensuring that every possible height at this
  *          position must follow a valid graph transition at pos+1.
- * @param ctx The solver context.
- * @param network The tunnel network graph.
- * @param length The length of the path being constructed.
+ * @param enc The encoding.
  * @param pos The current path position.
  * @return Z3_ast
  */
 
-static Z3_ast tn_edge_pos_constraint(Z3_context ctx, const TunnelNetwork network, int length, int pos){
-    int stack_size = get_stack_size(length);
-    Z3_ast *height_constraints = malloc(stack_size * sizeof(Z3_ast));
+static Z3_ast tn_edge_pos_constraint(TunnelEncoding enc, int pos){
+    Z3_context ctx = enc->ctx;
+    int stack_size = enc->stack_size;
+    Z3_ast *height_constraints = tn_scratch(enc, stack_size);
 
     for (int h = 0; h < stack_size; h++) {
-        height_constraints[h] = tn_edge_height_constraint(ctx, network, length, pos, h);
+        height_constraints[h] = tn_edge_height_constraint(enc, pos, h);
     }
 
     Z3_ast res = Z3_mk_and(ctx, stack_size, height_constraints);
-    free(height_constraints);
     return res;
 }
 
@@ -676,151 +1092,347 @@ static Z3_ast tn_edge_pos_constraint(Z3_context ctx, const TunnelNetwork network
  *          with a stack height compatible with push, pop, or transmission. This function
  *          aggregates all local constraints over every position, height, and operation,
  *          producing the global edge constraint.
- * @param ctx The solver context.
- * @param network The tunnel network graph.
- * @param length The length of the sought path.
+ * @param enc The encoding.
  * @return Z3_ast
  */
-Z3_ast tn_edge_constraints(Z3_context ctx, const TunnelNetwork network, int length){
-    int num_pos = length;
-    Z3_ast *pos_constraints = malloc(num_pos * sizeof(Z3_ast));
+Z3_ast tn_edge_constraints(TunnelEncoding enc){
+    Z3_context ctx = enc->ctx;
+    int num_pos = enc->length;
+    Z3_ast *pos_constraints = tn_scratch(enc, num_pos);
 
     for (int pos = 0; pos < num_pos; pos++) {
-        pos_constraints[pos] = tn_edge_pos_constraint(ctx, network, length, pos);
+        pos_constraints[pos] = tn_edge_pos_constraint(enc, pos);
     }
 
     Z3_ast result = Z3_mk_and(ctx, num_pos, pos_constraints);
-    free(pos_constraints);
     return result;
 }
 
 //------------------------------------------------------------------------------------------------------------------
 // --- Main Reduction ---
 Z3_ast tn_reduction(Z3_context ctx, const TunnelNetwork network, int length){
-    Z3_ast f1 = tn_exist_uniqueOp_uniqueHeight(ctx, network, length);
-    Z3_ast f2 = tn_init_final_stack(ctx, network, length);
+    struct timespec start;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    double times[10];
+    TunnelEncoding enc = tn_encoding_create(ctx, network, length);
+    Z3_ast f1 = tn_exist_uniqueOp_uniqueHeight(enc);
+    // The temporary arrays of a part are given back once it is built, for the next one.
+    arena_reset(enc->scratch);
+    // The creation of the encoding (the live states) is counted in φ1.
+    times[0] = statistics_lap(&start);
+    Z3_ast f2 = tn_init_final_stack(enc);
+    arena_reset(enc->scratch);
+    times[1] = statistics_lap(&start);
     
-    Z3_ast *f3_parts = malloc(length * sizeof(Z3_ast));
-    for (int pos = 0; pos < length; pos++) f3_parts[pos] = tn_transition_stack_height(ctx, network, length, pos);
+    Z3_ast *f3_parts = tn_scratch(enc, length);
+    for (int pos = 0; pos < length; pos++) f3_parts[pos] = tn_transition_stack_height(enc, pos);
     Z3_ast f3 = Z3_mk_and(ctx, length, f3_parts);
-    free(f3_parts);
+    arena_reset(enc->scratch);
+    times[2] = statistics_lap(&start);
 
-    Z3_ast *f4_parts = malloc(length * sizeof(Z3_ast));
-    for (int pos = 0; pos < length; pos++) f4_parts[pos] = tn_encapsulation_stack_height(ctx, network, length, pos);
+    Z3_ast *f4_parts = tn_scratch(enc, length);
+    for (int pos = 0; pos < length; pos++) f4_parts[pos] = tn_encapsulation_stack_height(enc, pos);
     Z3_ast f4 = Z3_mk_and(ctx, length, f4_parts);
-    free(f4_parts);
+    arena_reset(enc->scratch);
+    times[3] = statistics_lap(&start);
 
-    Z3_ast *f5_parts = malloc(length * sizeof(Z3_ast));
-    for (int pos = 0; pos < length; pos++) f5_parts[pos] = tn_decapsulation_stack_height(ctx, network, length, pos);
+    Z3_ast *f5_parts = tn_scratch(enc, length);
+    for (int pos = 0; pos < length; pos++) f5_parts[pos] = tn_decapsulation_stack_height(enc, pos);
     Z3_ast f5 = Z3_mk_and(ctx, length, f5_parts);
-    free(f5_parts);
+    arena_reset(enc->scratch);
+    times[4] = statistics_lap(&start);
 
     int num_pos_stack = length + 1;
-    Z3_ast *f6_parts = malloc(num_pos_stack * sizeof(Z3_ast));
-    for (int pos = 0; pos <= length; pos++) f6_parts[pos] = tn_stack_content_coherence(ctx, length, pos);
+    Z3_ast *f6_parts = tn_scratch(enc, num_pos_stack);
+    for (int pos = 0; pos <= length; pos++) f6_parts[pos] = tn_stack_content_coherence(enc, pos);
     Z3_ast f6 = Z3_mk_and(ctx, num_pos_stack, f6_parts);
-    free(f6_parts);
+    arena_reset(enc->scratch);
+    times[5] = statistics_lap(&start);
 
-    Z3_ast *f7_parts = malloc(length * sizeof(Z3_ast));
-    for (int pos = 0; pos < length; pos++) f7_parts[pos] = tn_operation_feasibility(ctx, network, length, pos);
+    Z3_ast *f7_parts = tn_scratch(enc, length);
+    for (int pos = 0; pos < length; pos++) f7_parts[pos] = tn_operation_feasibility(enc, pos);
     Z3_ast f7 = Z3_mk_and(ctx, length, f7_parts);
-    free(f7_parts);
+    arena_reset(enc->scratch);
+    times[6] = statistics_lap(&start);
+
+    Z3_ast f_preservation = tn_stack_preservation_logic(enc);
+    arena_reset(enc->scratch);
+    times[7] = statistics_lap(&start);
+
+    Z3_ast f_edges = tn_edge_constraints(enc);
+    arena_reset(enc->scratch);
+    times[8] = statistics_lap(&start);
+
+    Z3_ast *heights_parts = tn_scratch(enc, num_pos_stack);
+    for (int pos = 0; pos <= length; pos++) heights_parts[pos] = tn_height_definitions(enc, pos);
+    Z3_ast f_heights = Z3_mk_and(ctx, num_pos_stack, heights_parts);
+    arena_reset(enc->scratch);
+    times[9] = statistics_lap(&start);
+
+    tn_encoding_delete(enc);
+
+    Z3_ast all[10] = { f1, f2, f3, f4, f5, f6, f7, f_preservation, f_edges, f_heights }; 
+    const char *names[10] = {"phi1_unique", "phi2_ends", "phi3_transmit", "phi4_push", "phi5_pop", "phi6_coherence", "phi7_feasibility",
+                             "phi8_10_preservation", "phi11_edges", "heights"};
+    statistics_print_formula(ctx, "tunnel", length, 10, names, all, times);
+    return Z3_mk_and(ctx, 10, all);
+}
 
-    Z3_ast f_preservation = tn_stack_preservation_logic(ctx, network, length);
+Z3_ast tn_state_constraints(TunnelEncoding enc, int pos)
+{
+    Z3_context ctx = enc->ctx;
+    Z3_ast parts[3] = {
+        tn_unique_state_at(enc, pos),
+        tn_stack_content_coherence(enc, pos),
+        tn_height_definitions(enc, pos)
+    };
+    Z3_ast res = Z3_mk_and(ctx, 3, parts);
+    arena_reset(enc->scratch);
+    return res;
+}
 
-    Z3_ast f_edges = tn_edge_constraints(ctx, network, length);
+Z3_ast tn_transition_constraints(TunnelEncoding enc, int pos)
+{
+    Z3_context ctx = enc->ctx;
+    Z3_ast parts[6] = {
+        tn_transition_stack_height(enc, pos),
+        tn_encapsulation_stack_height(enc, pos),
+        tn_decapsulation_stack_height(enc, pos),
+        tn_operation_feasibility(enc, pos),
+        tn_stack_preservation_pos(enc, pos),
+        tn_edge_pos_constraint(enc, pos)
+    };
+    Z3_ast res = Z3_mk_and(ctx, 6, parts);
+    arena_reset(enc->scratch);
+    return res;
+}
 
-    Z3_ast all[9] = { f1, f2, f3, f4, f5, f6, f7, f_preservation, f_edges }; 
-    return Z3_mk_and(ctx, 9, all);
+Z3_ast *tn_state_cubes(TunnelEncoding enc, int pos, int *num_cubes)
+{
+    Z3_ast *cubes = (Z3_ast *)malloc((enc->stack_size * enc->num_nodes + 1) * sizeof(Z3_ast));
+    *num_cubes = 0;
+    for (int h = 0; h < enc->stack_size; h++)
+        for (int node = 0; node < enc->num_nodes; node++)
+            if (tn_live_tops(enc, node, pos, h))
+                cubes[(*num_cubes)++] = tn_path_variable(enc, node, pos, h);
+    return cubes;
 }
 
-void tn_get_path_from_model(Z3_context ctx, Z3_model model, TunnelNetwork network, int bound, tn_step *path)
+// --- Decoding ---
+
+/**
+ * @brief Bit of a stack cell whose variable y_4 is true in a model.
+ */
+#define MODEL_CELL_4 1
+
+/**
+ * @brief Bit of a stack cell whose variable y_6 is true in a model.
+ */
+#define MODEL_CELL_6 2
+
+/**
+ * @brief The atoms of the reduction true in a model, for the positions 0 to length. Reading them needs no encoding (whose live states are costly to compute):
+ * only the names of the variables, which depend on the number of nodes.
+ *
+ */
+typedef struct
 {
-    int num_nodes = tn_get_num_nodes(network);
-    int stack_size = get_stack_size(bound);
-    for (int pos = 0; pos < bound; pos++)
+    int num_nodes;         ///< The number of nodes of the network.
+    int stack_size;        ///< The number of cells of the stack.
+    bool compact;          ///< Whether a stack cell is a single variable (see tn_stack_compact).
+    int *nodes;            ///< The node of a true variable x at each position, -1 if there is none.
+    int *heights;          ///< Its height.
+    int *num_states;       ///< The number of true variables x at each position (1 in a model of the reduction).
+    unsigned char *states; ///< Whether each variable x is true, indexed [pos][height][node], or NULL if not asked for.
+    unsigned char *cells;  ///< MODEL_CELL_4 and MODEL_CELL_6 for the true variables y, indexed [pos][height].
+} TunnelModel;
+
+/**
+ * @brief Integer square root.
+ *
+ * @param value A non-negative number.
+ * @return long The largest number whose square is at most @p value.
+ */
+static long tn_isqrt(long value)
+{
+    long root = value;
+    long next = (root + 1) / 2;
+    while (next < root)
+    {
+        root = next;
+        next = (root + value / root) / 2;
+    }
+    return root;
+}
+
+/**
+ * @brief Inverse of tn_variable_index.
+ *
+ * @param num_nodes The number of nodes of the network.
+ * @param index The integer name of a variable of the reduction.
+ * @param pos Set to its path position.
+ * @param height Set to its height.
+ * @param offset Set to its offset (see tn_variable_index).
+ */
+static void tn_variable_of_index(int num_nodes, int index, int *pos, int *height, int *offset)
+{
+    long cell = index / (num_nodes + 4);
+    *offset = index % (num_nodes + 4);
+    long diagonal = (tn_isqrt(8 * cell + 1) - 1) / 2;
+    *height = (int)(cell - diagonal * (diagonal + 1) / 2);
+    *pos = (int)(diagonal - *height);
+}
+
+/**
+ * @brief Reads the atoms of the reduction true in @p model, in a single pass over the true variables of @p model (see true_indexed_vars_in_model).
+ *
+ * @param ctx The solver context.
+ * @param model A model of the reduction (a model of the reduction of another length over the same network is read too, as its variables have the same names).
+ * @param network The network.
+ * @param length The last position read.
+ * @param all_states Whether to fill the table of the true variables x, and not only the last one seen at each position.
+ * @return TunnelModel The atoms, to be freed with tn_model_delete.
+ */
+static TunnelModel tn_model_read(Z3_context ctx, Z3_model model, TunnelNetwork network, int length, bool all_states)
+{
+    TunnelModel atoms;
+    atoms.num_nodes = tn_get_num_nodes(network);
+    atoms.stack_size = get_stack_size(length);
+    atoms.compact = current_stack_encoding == tn_stack_compact;
+    int num_positions = length + 1;
+    int num_cells = num_positions * atoms.stack_size;
+    atoms.nodes = (int *)malloc(num_positions * sizeof(int));
+    atoms.heights = (int *)malloc(num_positions * sizeof(int));
+    atoms.num_states = (int *)calloc(num_positions, sizeof(int));
+    atoms.states = all_states ? (unsigned char *)calloc(num_cells * atoms.num_nodes + 1, 1) : NULL;
+    atoms.cells = (unsigned char *)calloc(num_cells + 1, 1);
+    for (int pos = 0; pos < num_positions; pos++)
     {
-        int src = -1;
-        int src_height = -1;
-        int tgt = -1;
-        int tgt_height = -1;
-        for (int n = 0; n < num_nodes; n++)
+        atoms.nodes[pos] = -1;
+        atoms.heights[pos] = -1;
+    }
+
+    int num_true;
+    int *indices = true_indexed_vars_in_model(ctx, model, &num_true);
+    for (int i = 0; i < num_true; i++)
+    {
+        int pos, height, offset;
+        tn_variable_of_index(atoms.num_nodes, indices[i], &pos, &height, &offset);
+        if (pos >= num_positions || height >= atoms.stack_size)
+            continue;
+        if (offset < atoms.num_nodes)
         {
-            for (int height = 0; height < stack_size; height++)
-            {
-                if (value_of_var_in_model(ctx, model, tn_path_variable(ctx, n, pos, height)))
-                {
-                    src = n;
-                    src_height = height;
-                }
-                if (value_of_var_in_model(ctx, model, tn_path_variable(ctx, n, pos + 1, height)))
-                {
-                    tgt = n;
-                    tgt_height = height;
-                }
-            }
+            atoms.nodes[pos] = offset;
+            atoms.heights[pos] = height;
+            atoms.num_states[pos]++;
+            if (all_states)
+                atoms.states[(pos * atoms.stack_size + height) * atoms.num_nodes + offset] = 1;
         }
+        else if (offset == atoms.num_nodes)
+            atoms.cells[pos * atoms.stack_size + height] |= MODEL_CELL_4;
+        else if (offset == atoms.num_nodes + 1)
+            atoms.cells[pos * atoms.stack_size + height] |= MODEL_CELL_6;
+    }
+    free(indices);
+    return atoms;
+}
+
+/**
+ * @brief Deallocates the tables of @p atoms.
+ *
+ * @param atoms The atoms of a model.
+ */
+static void tn_model_delete(TunnelModel *atoms)
+{
+    free(atoms->nodes);
+    free(atoms->heights);
+    free(atoms->num_states);
+    free(atoms->states);
+    free(atoms->cells);
+}
+
+/**
+ * @brief Tells if the cell (@p pos, @p height) holds 4 in the model read in @p atoms, i.e. the value of tn_4_variable(enc, pos, height).
+ *
+ * @param atoms The atoms of a model.
+ * @param pos A path position.
+ * @param height A height.
+ * @return bool
+ */
+static bool tn_model_is_4(const TunnelModel *atoms, int pos, int height)
+{
+    // No state at pos: the model is not one of the reduction.
+    if (height < 0)
+        return false;
+    unsigned char cell = atoms->cells[pos * atoms->stack_size + height];
+    // A compact cell holds 4 when its variable y_6 is false.
+    return atoms->compact ? !(cell & MODEL_CELL_6) : (cell & MODEL_CELL_4) != 0;
+}
+
+void tn_get_path_from_model(Z3_context ctx, Z3_model model, TunnelNetwork network, int bound, tn_step *path)
+{
+    TunnelModel atoms = tn_model_read(ctx, model, network, bound, false);
+    for (int pos = 0; pos < bound; pos++)
+    {
+        int src = atoms.nodes[pos];
+        int src_height = atoms.heights[pos];
+        int tgt = atoms.nodes[pos + 1];
+        int tgt_height = atoms.heights[pos + 1];
         int action = 0;
         if (src_height == tgt_height)
         {
-            if (value_of_var_in_model(ctx, model, tn_4_variable(ctx, pos, src_height)))
+            if (tn_model_is_4(&atoms, pos, src_height))
                 action = transmit_4;
             else
                 action = transmit_6;
         }
         else if (src_height == tgt_height - 1)
         {
-            if (value_of_var_in_model(ctx, model, tn_4_variable(ctx, pos, src_height)))
+            if (tn_model_is_4(&atoms, pos, src_height))
             {
-                if (value_of_var_in_model(ctx, model, tn_4_variable(ctx, pos + 1, tgt_height)))
+                if (tn_model_is_4(&atoms, pos + 1, tgt_height))
                     action = push_4_4;
                 else
                     action = push_4_6;
             }
-            else if (value_of_var_in_model(ctx, model, tn_4_variable(ctx, pos + 1, tgt_height)))
+            else if (tn_model_is_4(&atoms, pos + 1, tgt_height))
                 action = push_6_4;
             else
                 action = push_6_6;
         }
         else if (src_height == tgt_height + 1)
         {
+            if (tn_model_is_4(&atoms, pos, src_height))
             {
-                if (value_of_var_in_model(ctx, model, tn_4_variable(ctx, pos, src_height)))
-                {
-                    if (value_of_var_in_model(ctx, model, tn_4_variable(ctx, pos + 1, tgt_height)))
-                        action = pop_4_4;
-                    else
-                        action = pop_6_4;
-                }
-                else if (value_of_var_in_model(ctx, model, tn_4_variable(ctx, pos + 1, tgt_height)))
-                    action = pop_4_6;
+                if (tn_model_is_4(&atoms, pos + 1, tgt_height))
+                    action = pop_4_4;
                 else
-                    action = pop_6_6;
+                    action = pop_6_4;
             }
+            else if (tn_model_is_4(&atoms, pos + 1, tgt_height))
+                action = pop_4_6;
+            else
+                action = pop_6_6;
         }
         path[pos] = tn_step_create(action, src, tgt);
     }
+    tn_model_delete(&atoms);
 }
 
 void tn_print_model(Z3_context ctx, Z3_model model, TunnelNetwork network, int bound)
 {
-    int num_nodes = tn_get_num_nodes(network);
-    int stack_size = get_stack_size(bound);
+    TunnelModel atoms = tn_model_read(ctx, model, network, bound, true);
+    int num_nodes = atoms.num_nodes;
+    int stack_size = atoms.stack_size;
     for (int pos = 0; pos < bound + 1; pos++)
     {
         printf("At pos %d:\nState: ", pos);
-        int num_seen = 0;
+        int num_seen = atoms.num_states[pos];
+        int top = num_seen == 0 ? stack_size - 1 : atoms.heights[pos];
         for (int node = 0; node < num_nodes; node++)
-        {
             for (int height = 0; height < stack_size; height++)
-            {
-                if (value_of_var_in_model(ctx, model, tn_path_variable(ctx, node, pos, height)))
-                {
+                if (atoms.states[(pos * stack_size + height) * num_nodes + node])
                     printf("(%s,%d) ", tn_get_node_name(network, node), height);
-                    num_seen++;
-                }
-            }
-        }
         if (num_seen == 0)
             printf("No node at that position !\n");
         else
@@ -832,9 +1444,16 @@ void tn_print_model(Z3_context ctx, Z3_model model, TunnelNetwork network, int b
         bool above_top = false;
         for (int height = 0; height < stack_size; height++)
         {
-            if (value_of_var_in_model(ctx, model, tn_4_variable(ctx, pos, height)))
+            unsigned char cell = atoms.cells[pos * stack_size + height];
+            bool is_4 = tn_model_is_4(&atoms, pos, height);
+            // tn_6_variable is y_6 in both encodings.
+            bool is_6 = (cell & MODEL_CELL_6) != 0;
+            // A compact cell is always 4 or 6: the cells above the top are not constrained, and shown empty.
+            if (atoms.compact && height > top)
+                printf("| ");
+            else if (is_4)
             {
-                if (value_of_var_in_model(ctx, model, tn_6_variable(ctx, pos, height)))
+                if (is_6)
                 {
                     printf("|X");
                     misdefined = true;
@@ -846,7 +1465,7 @@ void tn_print_model(Z3_context ctx, Z3_model model, TunnelNetwork network, int b
                         misdefined = true;
                 }
             }
-            else if (value_of_var_in_model(ctx, model, tn_6_variable(ctx, pos, height)))
+            else if (is_6)
             {
                 printf("|6");
                 if (above_top)
@@ -862,5 +1481,6 @@ void tn_print_model(Z3_context ctx, Z3_model model, TunnelNetwork network, int b
         if (misdefined)
             printf("Warning: ill-defined stack\n");
     }
+    tn_model_delete(&atoms);
     return;
 }
@@ -0,0 +1,154 @@
+#include "Arena.h"
+#include <stdlib.h>
+#include <string.h>
+#include <stdalign.h>
+#include <sys/mman.h>
+
+/**
+ * @brief A block of an arena. The memory given by the arena follows the header.
+ *
+ */
+typedef struct ArenaBlock_s
+{
+    struct ArenaBlock_s *previous; ///< The block filled before this one.
+    size_t size;                   ///< The number of bytes after the header.
+    size_t used;                   ///< The number of bytes already given.
+    alignas(max_align_t) char data[];
+} ArenaBlock;
+
+/**
+ * @brief A memory mapping owned by an arena (the cells are allocated in the arena itself).
+ *
+ */
+typedef struct ArenaMapping_s
+{
+    struct ArenaMapping_s *next; ///< The mapping attached before this one.
+    void *address;               ///< The start of the mapping.
+    size_t length;               ///< Its length.
+} ArenaMapping;
+
+struct Arena_s
+{
+    ArenaBlock *current;    ///< The block being filled (the others are reachable from it).
+    ArenaMapping *mappings; ///< The mappings to release with the arena.
+    size_t block_size;   ///< The size of new blocks.
+    size_t total;        ///< The number of bytes of all the blocks.
+};
+
+/**
+ * @brief Adds a block of at least @p size bytes to @p arena, and makes it the current one.
+ *
+ * @param arena An arena.
+ * @param size A number of bytes.
+ * @return ArenaBlock* The new block, or NULL in case of no memory.
+ */
+static ArenaBlock *arena_add_block(Arena arena, size_t size)
+{
+    if (size < arena->block_size)
+        size = arena->block_size;
+    ArenaBlock *block = (ArenaBlock *)malloc(sizeof(ArenaBlock) + size);
+    if (block == NULL)
+        return NULL;
+    block->previous = arena->current;
+    block->size = size;
+    block->used = 0;
+    arena->current = block;
+    arena->total += size;
+    return block;
+}
+
+Arena arena_create(size_t block_size)
+{
+    Arena arena = (Arena)malloc(sizeof(*arena));
+    if (arena == NULL)
+        return NULL;
+    arena->current = NULL;
+    arena->mappings = NULL;
+    arena->block_size = block_size > 0 ? block_size : 4096;
+    arena->total = 0;
+    return arena;
+}
+
+void *arena_alloc(Arena arena, size_t size)
+{
+    // Every allocation keeps the next one aligned.
+    size = (size + alignof(max_align_t) - 1) & ~(alignof(max_align_t) - 1);
+    ArenaBlock *block = arena->current;
+    if (block == NULL || block->size - block->used < size)
+    {
+        block = arena_add_block(arena, size);
+        if (block == NULL)
+            return NULL;
+    }
+    void *result = block->data + block->used;
+    block->used += size;
+    return result;
+}
+
+char *arena_strdup(Arena arena, const char *string)
+{
+    size_t length = strlen(string) + 1;
+    char *copy = (char *)arena_alloc(arena, length);
+    if (copy != NULL)
+        memcpy(copy, string, length);
+    return copy;
+}
+
+bool arena_attach_mapping(Arena arena, void *address, size_t length)
+{
+    ArenaMapping *mapping = (ArenaMapping *)arena_alloc(arena, sizeof(ArenaMapping));
+    if (mapping == NULL)
+        return false;
+    mapping->address = address;
+    mapping->length = length;
+    mapping->next = arena->mappings;
+    arena->mappings = mapping;
+    return true;
+}
+
+void arena_reset(Arena arena)
+{
+    for (ArenaMapping *mapping = arena->mappings; mapping != NULL; mapping = mapping->next)
+        munmap(mapping->address, mapping->length);
+    arena->mappings = NULL;
+    ArenaBlock *block = arena->current;
+    if (block == NULL)
+        return;
+    if (block->previous == NULL)
+    {
+        block->used = 0;
+        return;
+    }
+    // The blocks are merged into one, so that the same allocations then fit in it.
+    size_t total = arena->total;
+    while (block != NULL)
+    {
+        ArenaBlock *previous = block->previous;
+        free(block);
+        block = previous;
+    }
+    arena->current = NULL;
+    arena->total = 0;
+    arena_add_block(arena, total);
+}
+
+size_t arena_get_size(Arena arena)
+{
+    return arena->total;
+}
+
+void arena_delete(Arena arena)
+{
+    if (arena == NULL)
+        return;
+    for (ArenaMapping *mapping = arena->mappings; mapping != NULL; mapping = mapping->next)
+        munmap(mapping->address, mapping->length);
+    ArenaBlock *block = arena->current;
+    while (block != NULL)
+    {
+        ArenaBlock *previous = block->previous;
+        free(block);
+        block = previous;
+    }
+    free(arena);
+}
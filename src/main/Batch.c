@@ -0,0 +1,449 @@
+#include "Batch.h"
+#include "Graph.h"
+#include "Parsing.h"
+#include "Z3Tools.h"
+#ifdef COLOURING
+#include "ColouredGraph.h"
+#include "ColouringReduction.h"
+#endif
+#ifdef TUNNEL
+#include "TunnelNetwork.h"
+#include "TunnelReduction.h"
+#include "TunnelIncremental.h"
+#endif
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <time.h>
+#include <dirent.h>
+#include <sys/stat.h>
+
+/**
+ * @brief Number of instances a worker solves with the same context before recreating it (a context keeps every formula built in it).
+ */
+#define BATCH_INSTANCES_PER_CONTEXT 64
+
+/**
+ * @brief The result of one instance.
+ *
+ */
+typedef struct
+{
+    const char *result; ///< "sat", "unsat", "unknown" or "error".
+    int length;         ///< For Tunnel, the size of the path found (0 if none).
+    double build_time;  ///< Time spent building formulae, in seconds.
+    double solve_time;  ///< Time spent solving, in seconds.
+} BatchResult;
+
+/**
+ * @brief A growable list of file names.
+ *
+ */
+typedef struct
+{
+    char **names;
+    int size;
+    int capacity;
+} BatchFiles;
+
+/**
+ * @brief State shared by the workers. Fields after lock are protected by it.
+ *
+ */
+typedef struct
+{
+    const BatchConfig *config;
+    BatchFiles *files;
+    pthread_mutex_t lock;
+    int next_file; ///< The next file to hand out.
+} BatchQueue;
+
+bool batch_format_of_string(const char *name, batch_format *format)
+{
+    if (strcmp(name, "csv") == 0)
+        *format = batch_csv;
+    else if (strcmp(name, "jsonl") == 0)
+        *format = batch_jsonl;
+    else
+        return false;
+    return true;
+}
+
+/**
+ * @brief Appends a copy of @p name to @p files.
+ *
+ * @param files A list of file names.
+ * @param name A file name.
+ */
+static void batch_add_file(BatchFiles *files, const char *name)
+{
+    if (files->size == files->capacity)
+    {
+        files->capacity = files->capacity == 0 ? 16 : 2 * files->capacity;
+        files->names = (char **)realloc(files->names, files->capacity * sizeof(char *));
+    }
+    files->names[files->size++] = strdup(name);
+}
+
+/**
+ * @brief Comparison of file names for qsort.
+ *
+ * @param a A pointer towards a file name.
+ * @param b A pointer towards a file name.
+ * @return int
+ */
+static int batch_compare_names(const void *a, const void *b)
+{
+    return strcmp(*(char *const *)a, *(char *const *)b);
+}
+
+/**
+ * @brief Appends the .dot files of directory @p directory to @p files, sorted by name.
+ *
+ * @param files A list of file names.
+ * @param directory The name of a directory.
+ */
+static void batch_add_directory(BatchFiles *files, const char *directory)
+{
+    DIR *dir = opendir(directory);
+    if (dir == NULL)
+    {
+        batch_add_file(files, directory);
+        return;
+    }
+    int first = files->size;
+    struct dirent *entry;
+    while ((entry = readdir(dir)) != NULL)
+    {
+        size_t length = strlen(entry->d_name);
+        if (length < 4 || strcmp(entry->d_name + length - 4, ".dot") != 0)
+            continue;
+        char path[strlen(directory) + length + 2];
+        snprintf(path, sizeof(path), "%s/%s", directory, entry->d_name);
+        batch_add_file(files, path);
+    }
+    closedir(dir);
+    qsort(files->names + first, files->size - first, sizeof(char *), batch_compare_names);
+}
+
+/**
+ * @brief Appends the files listed in manifest @p manifest (one per line) to @p files.
+ *
+ * @param files A list of file names.
+ * @param manifest The name of a manifest.
+ */
+static void batch_add_manifest(BatchFiles *files, const char *manifest)
+{
+    FILE *file = fopen(manifest, "r");
+    if (file == NULL)
+    {
+        batch_add_file(files, manifest);
+        return;
+    }
+    char *line = NULL;
+    size_t capacity = 0;
+    while (getline(&line, &capacity, file) != -1)
+    {
+        line[strcspn(line, "\r\n")] = '\0';
+        if (line[0] == '\0' || line[0] == '#')
+            continue;
+        batch_add_file(files, line);
+    }
+    free(line);
+    fclose(file);
+}
+
+/**
+ * @brief Expands the inputs into the list of the files to solve.
+ *
+ * @param inputs Names of files, directories or manifests.
+ * @param num_inputs The size of @p inputs.
+ * @param files The list filled.
+ */
+static void batch_expand_inputs(char **inputs, int num_inputs, BatchFiles *files)
+{
+    for (int i = 0; i < num_inputs; i++)
+    {
+        struct stat st;
+        if (inputs[i][0] == '@')
+            batch_add_manifest(files, inputs[i] + 1);
+        else if (stat(inputs[i], &st) == 0 && S_ISDIR(st.st_mode))
+            batch_add_directory(files, inputs[i]);
+        else
+            batch_add_file(files, inputs[i]);
+    }
+}
+
+/**
+ * @brief Wall-clock time elapsed since @p start.
+ *
+ * @param start A time taken with clock_gettime(CLOCK_MONOTONIC, ...).
+ * @return double The time elapsed, in seconds.
+ */
+static double batch_seconds_since(struct timespec start)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (double)(now.tv_sec - start.tv_sec) + (double)(now.tv_nsec - start.tv_nsec) / 1e9;
+}
+
+/**
+ * @brief Solves @p formula in a fresh solver of @p ctx.
+ *
+ * @param ctx The context of the worker.
+ * @param formula A formula.
+ * @return Z3_lbool
+ */
+static Z3_lbool batch_check(Z3_context ctx, Z3_ast formula)
+{
+    Z3_solver solver = mk_solver(ctx);
+    Z3_solver_assert(ctx, solver, formula);
+    Z3_lbool result = Z3_solver_check(ctx, solver);
+    Z3_solver_dec_ref(ctx, solver);
+    return result;
+}
+
+/**
+ * @brief Gets the name of a result of the solver.
+ *
+ * @param result A result.
+ * @return const char*
+ */
+static const char *batch_string_of_lbool(Z3_lbool result)
+{
+    if (result == Z3_L_TRUE)
+        return "sat";
+    if (result == Z3_L_FALSE)
+        return "unsat";
+    return "unknown";
+}
+
+#ifdef COLOURING
+/**
+ * @brief Solves the Colouring problem on @p graph.
+ *
+ * @param ctx The context of the worker.
+ * @param graph The graph.
+ * @param config The configuration.
+ * @return BatchResult
+ */
+static BatchResult batch_solve_colouring(Z3_context ctx, Graph graph, const BatchConfig *config)
+{
+    BatchResult result = {"unknown", 0, 0, 0};
+    ColouredGraph coloured_graph = cg_initialize(graph);
+    struct timespec start;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    Z3_ast formula = colouring_reduction(ctx, coloured_graph, config->value);
+    result.build_time = batch_seconds_since(start);
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    result.result = batch_string_of_lbool(batch_check(ctx, formula));
+    result.solve_time = batch_seconds_since(start);
+    cg_delete(coloured_graph);
+    return result;
+}
+#endif
+
+#ifdef TUNNEL
+/**
+ * @brief Solves the Tunnel problem on @p graph: looks for the smallest size from 1 to the bound having a path.
+ *
+ * @param ctx The context of the worker.
+ * @param graph The graph.
+ * @param config The configuration.
+ * @return BatchResult
+ */
+static BatchResult batch_solve_tunnel(Z3_context ctx, Graph graph, const BatchConfig *config)
+{
+    BatchResult result = {"unsat", 0, 0, 0};
+    TunnelNetwork network = tn_initialize(graph);
+    TunnelIncremental inc_solver = config->incremental ? tn_incremental_create(ctx, network, config->value) : NULL;
+    for (int l = 1; l <= config->value; l++)
+    {
+        struct timespec start;
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        Z3_lbool isSat;
+        if (config->incremental)
+            isSat = tn_incremental_solve(inc_solver, l, NULL);
+        else
+        {
+            Z3_ast formula = tn_reduction(ctx, network, l);
+            result.build_time += batch_seconds_since(start);
+            clock_gettime(CLOCK_MONOTONIC, &start);
+            isSat = batch_check(ctx, formula);
+        }
+        result.solve_time += batch_seconds_since(start);
+        if (isSat == Z3_L_FALSE)
+            continue;
+        result.result = batch_string_of_lbool(isSat);
+        if (isSat == Z3_L_TRUE)
+            result.length = l;
+        break;
+    }
+    if (inc_solver != NULL)
+        tn_incremental_delete(inc_solver);
+    tn_delete(network);
+    return result;
+}
+#endif
+
+/**
+ * @brief Writes @p string as a JSON string.
+ *
+ * @param output The output.
+ * @param string A string.
+ */
+static void batch_print_json_string(FILE *output, const char *string)
+{
+    fputc('"', output);
+    for (const char *c = string; *c != '\0'; c++)
+    {
+        if (*c == '"' || *c == '\\')
+            fputc('\\', output);
+        if ((unsigned char)*c < 0x20)
+            fprintf(output, "\\u%04x", *c);
+        else
+            fputc(*c, output);
+    }
+    fputc('"', output);
+}
+
+/**
+ * @brief Writes @p string as a CSV field (quoted if needed).
+ *
+ * @param output The output.
+ * @param string A string.
+ */
+static void batch_print_csv_field(FILE *output, const char *string)
+{
+    if (strpbrk(string, ",\"\n") == NULL)
+    {
+        fputs(string, output);
+        return;
+    }
+    fputc('"', output);
+    for (const char *c = string; *c != '\0'; c++)
+    {
+        if (*c == '"')
+            fputc('"', output);
+        fputc(*c, output);
+    }
+    fputc('"', output);
+}
+
+/**
+ * @brief Writes the line of the result of @p file.
+ *
+ * @param config The configuration.
+ * @param file The name of the input.
+ * @param result Its result.
+ */
+static void batch_print_result(const BatchConfig *config, const char *file, BatchResult result)
+{
+    const char *problem = config->problem == batch_colouring ? "Colouring" : "Tunnel";
+    FILE *output = config->output;
+    if (config->format == batch_csv)
+    {
+        batch_print_csv_field(output, file);
+        fprintf(output, ",%s,%s,%d,", problem, result.result, config->value);
+        if (result.length > 0)
+            fprintf(output, "%d", result.length);
+        fprintf(output, ",%g,%g\n", result.build_time, result.solve_time);
+    }
+    else
+    {
+        fprintf(output, "{\"file\": ");
+        batch_print_json_string(output, file);
+        fprintf(output, ", \"problem\": \"%s\", \"result\": \"%s\", \"bound\": %d, \"length\": ", problem, result.result, config->value);
+        if (result.length > 0)
+            fprintf(output, "%d", result.length);
+        else
+            fprintf(output, "null");
+        fprintf(output, ", \"build_time\": %g, \"solve_time\": %g}\n", result.build_time, result.solve_time);
+    }
+    fflush(output);
+}
+
+/**
+ * @brief Body of a worker: takes the next file, parses it and solves it, until no file is left.
+ *
+ * @param arg The BatchQueue.
+ * @return void* NULL.
+ */
+static void *batch_worker(void *arg)
+{
+    BatchQueue *queue = (BatchQueue *)arg;
+    const BatchConfig *config = queue->config;
+    Z3_context ctx = NULL;
+    int instances_in_context = 0;
+
+    pthread_mutex_lock(&queue->lock);
+    while (queue->next_file < queue->files->size)
+    {
+        char *file = queue->files->names[queue->next_file++];
+        BatchResult result = {"error", 0, 0, 0};
+        // The parser is not known to be thread-safe: parsing is done under the lock.
+        // A file that cannot be read or parsed is reported as an error.
+        Graph graph;
+        bool parsed = try_get_graph_from_file(file, &graph);
+        pthread_mutex_unlock(&queue->lock);
+
+        if (parsed)
+        {
+            if (ctx == NULL || instances_in_context == BATCH_INSTANCES_PER_CONTEXT)
+            {
+                if (ctx != NULL)
+                    Z3_del_context(ctx);
+                ctx = make_context();
+                instances_in_context = 0;
+            }
+            instances_in_context++;
+#ifdef COLOURING
+            if (config->problem == batch_colouring)
+                result = batch_solve_colouring(ctx, graph, config);
+#endif
+#ifdef TUNNEL
+            if (config->problem == batch_tunnel)
+                result = batch_solve_tunnel(ctx, graph, config);
+#endif
+        }
+
+        pthread_mutex_lock(&queue->lock);
+        if (parsed)
+            graph_delete(graph);
+        batch_print_result(config, file, result);
+    }
+    pthread_mutex_unlock(&queue->lock);
+
+    if (ctx != NULL)
+        Z3_del_context(ctx);
+    return NULL;
+}
+
+int batch_run(char **inputs, int num_inputs, const BatchConfig *config)
+{
+    BatchFiles files = {NULL, 0, 0};
+    batch_expand_inputs(inputs, num_inputs, &files);
+
+    if (config->format == batch_csv)
+        fprintf(config->output, "file,problem,result,bound,length,build_time,solve_time\n");
+
+    BatchQueue queue;
+    queue.config = config;
+    queue.files = &files;
+    queue.next_file = 0;
+    pthread_mutex_init(&queue.lock, NULL);
+
+    int num_threads = config->num_threads < files.size ? config->num_threads : files.size;
+    pthread_t threads[num_threads > 0 ? num_threads : 1];
+    for (int i = 0; i < num_threads; i++)
+        pthread_create(&threads[i], NULL, batch_worker, &queue);
+    for (int i = 0; i < num_threads; i++)
+        pthread_join(threads[i], NULL);
+
+    pthread_mutex_destroy(&queue.lock);
+    int num_files = files.size;
+    for (int i = 0; i < files.size; i++)
+        free(files.names[i]);
+    free(files.names);
+    return num_files;
+}
@@ -0,0 +1,530 @@
+/**
+ * @file Bench.c
+ * @brief Benchmark of the reductions: runs every instance of graphs/Colouring and graphs/TunnelNetwork, and generated instances of growing size,
+ *        for a matrix of bounds, several times each. Reports the median and the 95th percentile of the wall-clock time of each phase
+ *        (parse, initialize, reduction, solve, decode) as JSON, one instance and bound per line, so that two reports can be diffed.
+ * @version 1
+ * @date 2025-12-05
+ *
+ * @copyright Creative Commons.
+ *
+ */
+
+#include "Graph.h"
+#include "Parsing.h"
+#include "Z3Tools.h"
+#ifdef COLOURING
+#include "ColouredGraph.h"
+#include "ColouringReduction.h"
+#endif
+#ifdef TUNNEL
+#include "TunnelNetwork.h"
+#include "TunnelReduction.h"
+#endif
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <dirent.h>
+#include <unistd.h>
+#include <getopt.h>
+
+/**
+ * @brief Maximal size of the lists of bounds and scales.
+ */
+#define BENCH_MAX_VALUES 32
+
+/**
+ * @brief The phases timed for each run.
+ *
+ */
+typedef enum
+{
+    bench_parse,
+    bench_initialize,
+    bench_reduction,
+    bench_solve,
+    bench_decode,
+    NumBenchPhases
+} bench_phase;
+
+/**
+ * @brief The names of the phases in the report.
+ */
+static const char *bench_phase_names[NumBenchPhases] = {"parse", "initialize", "reduction", "solve", "decode"};
+
+/**
+ * @brief The problems benchmarked.
+ *
+ */
+typedef enum
+{
+    bench_colouring, ///< The bound is the number of colours.
+    bench_tunnel     ///< The bound is the size of the path.
+} bench_problem;
+
+/**
+ * @brief The configuration of the benchmark.
+ *
+ */
+typedef struct
+{
+    int repeats;                                 ///< The number of runs of each instance and bound.
+    int num_colours[BENCH_MAX_VALUES];           ///< The bounds of the Colouring instances.
+    int num_colour_bounds;                       ///< The size of num_colours.
+    int lengths[BENCH_MAX_VALUES];               ///< The bounds of the Tunnel instances.
+    int num_lengths;                             ///< The size of lengths.
+    int scales[BENCH_MAX_VALUES];                ///< The sizes of the generated instances.
+    int num_scales;                              ///< The size of scales.
+    FILE *output;                                ///< Where the report is written.
+    bool first_record;                           ///< true until a record has been written.
+} BenchConfig;
+
+void usage()
+{
+    printf("Usage: graphProblemBench [options]\n");
+    printf(" Runs the reductions on the instances of graphs/Colouring and graphs/TunnelNetwork and on generated instances, and writes a JSON report of the wall-clock time of each phase (median and 95th percentile, in milliseconds).\n");
+    printf("Options:\n");
+    printf(" -h         Displays this help\n");
+    printf(" -g DIR     Directory containing Colouring and TunnelNetwork (default: graphs)\n");
+    printf(" -r N       Runs each instance and bound N times (default: 5)\n");
+    printf(" -c LIST    Comma separated numbers of colours tried on the Colouring instances (default: 3,4)\n");
+    printf(" -l LIST    Comma separated sizes of paths tried on the Tunnel instances (default: 4,8,17)\n");
+    printf(" -s LIST    Comma separated scales of the generated instances, 0 for none (default: 4,8,16)\n");
+    printf("            A scale n gives a Colouring graph with 25n nodes and a Tunnel network whose shortest path has size 2n+1, tried with 2n and 2n+1.\n");
+#ifdef TUNNEL
+    printf(" -y ENC     Encoding of the stack cells of the Tunnel reduction: \"pair\" (default) or \"compact\" (see --stack of graphProblemSolver)\n");
+#endif
+    printf(" -p PROFILE Configuration of Z3: \"default\", \"sat\", \"preprocess\" or \"parallel\" (see --profile of graphProblemSolver)\n");
+    printf(" -t MS      Time limit of each call to Z3, in milliseconds, past which it answers unknown (default: none)\n");
+    printf(" -o FILE    Writes the report in FILE instead of the standard output\n");
+}
+
+/**
+ * @brief Reads a comma separated list of positive integers.
+ *
+ * @param string The list.
+ * @param values Set to the values.
+ * @return int The number of values, or -1 if @p string is not a valid list.
+ */
+static int bench_parse_list(const char *string, int *values)
+{
+    int size = 0;
+    const char *current = string;
+    while (*current != '\0')
+    {
+        char *end;
+        long value = strtol(current, &end, 10);
+        if (end == current || value < 0 || size == BENCH_MAX_VALUES || (*end != ',' && *end != '\0'))
+            return -1;
+        if (value > 0)
+            values[size++] = (int)value;
+        current = *end == ',' ? end + 1 : end;
+    }
+    return size;
+}
+
+/**
+ * @brief Wall-clock time elapsed since @p start.
+ *
+ * @param start A time taken with clock_gettime(CLOCK_MONOTONIC, ...).
+ * @return double The time elapsed, in milliseconds.
+ */
+static double bench_milliseconds_since(struct timespec start)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (double)(now.tv_sec - start.tv_sec) * 1e3 + (double)(now.tv_nsec - start.tv_nsec) / 1e6;
+}
+
+/**
+ * @brief Comparison of doubles for qsort.
+ *
+ * @param a A pointer towards a double.
+ * @param b A pointer towards a double.
+ * @return int
+ */
+static int bench_compare_times(const void *a, const void *b)
+{
+    double x = *(const double *)a;
+    double y = *(const double *)b;
+    return (x > y) - (x < y);
+}
+
+/**
+ * @brief Solves @p formula in a fresh solver of @p ctx.
+ *
+ * @param ctx A context.
+ * @param formula A formula.
+ * @param model Set to the model if the formula is satisfiable (to be released with Z3_model_dec_ref).
+ * @return Z3_lbool
+ */
+static Z3_lbool bench_check(Z3_context ctx, Z3_ast formula, Z3_model *model)
+{
+    Z3_solver solver = mk_solver(ctx);
+    Z3_solver_assert(ctx, solver, formula);
+    Z3_lbool result = Z3_solver_check(ctx, solver);
+    if (result == Z3_L_TRUE)
+    {
+        *model = Z3_solver_get_model(ctx, solver);
+        Z3_model_inc_ref(ctx, *model);
+    }
+    Z3_solver_dec_ref(ctx, solver);
+    return result;
+}
+
+/**
+ * @brief Runs every phase once on the instance in @p file.
+ *
+ * @param problem The problem.
+ * @param file A file in dot format.
+ * @param bound The bound.
+ * @param times Set to the time of each phase, in milliseconds.
+ * @param num_nodes Set to the number of nodes of the instance.
+ * @param num_edges Set to the number of edges of the instance.
+ * @return Z3_lbool The answer of the solver.
+ */
+static Z3_lbool bench_run_once(bench_problem problem, const char *file, int bound, double *times, int *num_nodes, int *num_edges)
+{
+    struct timespec start;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    Graph graph = get_graph_from_file((char *)file);
+    times[bench_parse] = bench_milliseconds_since(start);
+    *num_nodes = graph_num_nodes(graph);
+    *num_edges = graph_num_edges(graph);
+
+    // The context is created outside of the phases, and a new one for each run so that nothing is cached from one run to the next.
+    Z3_context ctx = make_context();
+    Z3_model model = NULL;
+    Z3_lbool result = Z3_L_UNDEF;
+    times[bench_decode] = 0;
+#ifdef COLOURING
+    if (problem == bench_colouring)
+    {
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        ColouredGraph coloured_graph = cg_initialize(graph);
+        times[bench_initialize] = bench_milliseconds_since(start);
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        Z3_ast formula = colouring_reduction(ctx, coloured_graph, bound);
+        times[bench_reduction] = bench_milliseconds_since(start);
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        result = bench_check(ctx, formula, &model);
+        times[bench_solve] = bench_milliseconds_since(start);
+        if (result == Z3_L_TRUE)
+        {
+            clock_gettime(CLOCK_MONOTONIC, &start);
+            colour_graph_from_model(ctx, model, coloured_graph, bound);
+            times[bench_decode] = bench_milliseconds_since(start);
+        }
+        cg_delete(coloured_graph);
+    }
+#endif
+#ifdef TUNNEL
+    if (problem == bench_tunnel)
+    {
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        TunnelNetwork network = tn_initialize(graph);
+        times[bench_initialize] = bench_milliseconds_since(start);
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        Z3_ast formula = tn_reduction(ctx, network, bound);
+        times[bench_reduction] = bench_milliseconds_since(start);
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        result = bench_check(ctx, formula, &model);
+        times[bench_solve] = bench_milliseconds_since(start);
+        if (result == Z3_L_TRUE)
+        {
+            tn_step *path = (tn_step *)malloc(bound * sizeof(tn_step));
+            clock_gettime(CLOCK_MONOTONIC, &start);
+            tn_get_path_from_model(ctx, model, network, bound, path);
+            times[bench_decode] = bench_milliseconds_since(start);
+            free(path);
+        }
+        tn_delete(network);
+    }
+#endif
+    if (model != NULL)
+        Z3_model_dec_ref(ctx, model);
+    Z3_del_context(ctx);
+    graph_delete(graph);
+    return result;
+}
+
+/**
+ * @brief Runs the instance in @p file config->repeats times with @p bound, and writes its record in the report.
+ *
+ * @param config The configuration.
+ * @param problem The problem.
+ * @param file A file in dot format.
+ * @param name The name of the instance in the report.
+ * @param bound The bound.
+ */
+static void bench_instance(BenchConfig *config, bench_problem problem, const char *file, const char *name, int bound)
+{
+    double *samples[NumBenchPhases];
+    for (int phase = 0; phase < NumBenchPhases; phase++)
+        samples[phase] = (double *)malloc(config->repeats * sizeof(double));
+    Z3_lbool result = Z3_L_UNDEF;
+    int num_nodes = 0;
+    int num_edges = 0;
+    for (int run = 0; run < config->repeats; run++)
+    {
+        double times[NumBenchPhases];
+        result = bench_run_once(problem, file, bound, times, &num_nodes, &num_edges);
+        for (int phase = 0; phase < NumBenchPhases; phase++)
+            samples[phase][run] = times[phase];
+    }
+
+    fprintf(config->output, "%s\n    {\"problem\": \"%s\", \"instance\": \"%s\", \"nodes\": %d, \"edges\": %d, \"bound\": %d, \"result\": \"%s\"",
+            config->first_record ? "" : ",", problem == bench_colouring ? "colouring" : "tunnel", name, num_nodes, num_edges, bound,
+            result == Z3_L_TRUE ? "sat" : result == Z3_L_FALSE ? "unsat" : "unknown");
+    config->first_record = false;
+    for (int phase = 0; phase < NumBenchPhases; phase++)
+    {
+        // The median and the 95th percentile (nearest rank) of the runs.
+        double *times = samples[phase];
+        int n = config->repeats;
+        qsort(times, n, sizeof(double), bench_compare_times);
+        double median = n % 2 == 1 ? times[n / 2] : (times[n / 2 - 1] + times[n / 2]) / 2;
+        double p95 = times[(95 * n + 99) / 100 - 1];
+        fprintf(config->output, ", \"%s\": {\"median\": %.3f, \"p95\": %.3f}", bench_phase_names[phase], median, p95);
+        free(times);
+    }
+    fprintf(config->output, "}");
+    fflush(config->output);
+}
+
+/**
+ * @brief Runs every .dot file of @p directory, in the order of their names, with each bound of @p bounds.
+ *
+ * @param config The configuration.
+ * @param problem The problem of the instances of @p directory.
+ * @param directory The name of a directory.
+ * @param bounds The bounds.
+ * @param num_bounds The size of @p bounds.
+ */
+static void bench_directory(BenchConfig *config, bench_problem problem, const char *directory, const int *bounds, int num_bounds)
+{
+    struct dirent **entries;
+    int num_entries = scandir(directory, &entries, NULL, alphasort);
+    if (num_entries < 0)
+    {
+        fprintf(stderr, "Warning: cannot read directory %s, skipped.\n", directory);
+        return;
+    }
+    for (int i = 0; i < num_entries; i++)
+    {
+        size_t length = strlen(entries[i]->d_name);
+        if (length >= 4 && strcmp(entries[i]->d_name + length - 4, ".dot") == 0)
+        {
+            char path[strlen(directory) + length + 2];
+            snprintf(path, sizeof(path), "%s/%s", directory, entries[i]->d_name);
+            for (int b = 0; b < num_bounds; b++)
+                bench_instance(config, problem, path, path, bounds[b]);
+        }
+        free(entries[i]);
+    }
+    free(entries);
+}
+
+/**
+ * @brief Writes in @p file a 3-colourable graph with @p num_nodes nodes: the nodes are split in three classes, and two nodes of different classes
+ *        are linked with probability 1/16, drawn from a fixed pseudo-random sequence so that the graph only depends on @p num_nodes.
+ *
+ * @param file A file open for writing.
+ * @param num_nodes The number of nodes.
+ */
+static void bench_write_colouring(FILE *file, int num_nodes)
+{
+    unsigned int seed = (unsigned int)num_nodes;
+    fprintf(file, "graph G%d {\n", num_nodes);
+    for (int node = 0; node < num_nodes; node++)
+        fprintf(file, "%d;\n", node);
+    for (int source = 0; source < num_nodes; source++)
+        for (int target = source + 1; target < num_nodes; target++)
+        {
+            seed = seed * 1103515245 + 12345;
+            if (source % 3 != target % 3 && (seed >> 16) % 16 == 0)
+                fprintf(file, "%d -- %d;\n", source, target);
+        }
+    fprintf(file, "}\n");
+}
+
+/**
+ * @brief Writes in @p file a Tunnel network whose shortest path has size 2 @p depth + 1: the path encapsulates @p depth times then decapsulates
+ *        @p depth times. Each encapsulation can be delayed by a detour, and each decapsulation can go back to the first encapsulation.
+ *
+ * @param file A file open for writing.
+ * @param depth The number of encapsulations.
+ */
+static void bench_write_tunnel(FILE *file, int depth)
+{
+    fprintf(file, "digraph T%d {\n", depth);
+    fprintf(file, "s [shape=square][label=\"4→4\"]\n");
+    fprintf(file, "end [shape=invtriangle][label=\"4→4\"]\n");
+    for (int i = 0; i < depth; i++)
+        fprintf(file, "u%d [label=\"4↑44\"]\nw%d [label=\"4→4\"]\nd%d [label=\"44↓4\"]\n", i, i, i);
+    fprintf(file, "s -> u0;\n");
+    for (int i = 0; i < depth; i++)
+    {
+        if (i + 1 < depth)
+            fprintf(file, "u%d -> u%d;\nu%d -> w%d;\nw%d -> u%d;\nd%d -> d%d;\n", i, i + 1, i, i, i, i + 1, i, i + 1);
+        fprintf(file, "d%d -> u0;\n", i);
+    }
+    fprintf(file, "u%d -> d0;\nd%d -> end;\n}\n", depth - 1, depth - 1);
+}
+
+/**
+ * @brief Generates the instances of each scale of config->scales in a temporary directory, and runs them.
+ *
+ * @param config The configuration.
+ */
+static void bench_generated(BenchConfig *config)
+{
+    if (config->num_scales == 0)
+        return;
+    char directory[] = "/tmp/coca_bench_XXXXXX";
+    if (mkdtemp(directory) == NULL)
+    {
+        fprintf(stderr, "Warning: cannot create a temporary directory, generated instances skipped.\n");
+        return;
+    }
+    char path[sizeof(directory) + 32];
+    char name[64];
+    for (int s = 0; s < config->num_scales; s++)
+    {
+        int scale = config->scales[s];
+#ifdef COLOURING
+        snprintf(path, sizeof(path), "%s/colouring.dot", directory);
+        FILE *file = fopen(path, "w");
+        bench_write_colouring(file, 25 * scale);
+        fclose(file);
+        snprintf(name, sizeof(name), "generated/colouring_%d", 25 * scale);
+        for (int b = 0; b < config->num_colour_bounds; b++)
+            bench_instance(config, bench_colouring, path, name, config->num_colours[b]);
+        unlink(path);
+#endif
+#ifdef TUNNEL
+        snprintf(path, sizeof(path), "%s/tunnel.dot", directory);
+        FILE *network = fopen(path, "w");
+        bench_write_tunnel(network, scale);
+        fclose(network);
+        snprintf(name, sizeof(name), "generated/tunnel_%d", scale);
+        bench_instance(config, bench_tunnel, path, name, 2 * scale);
+        bench_instance(config, bench_tunnel, path, name, 2 * scale + 1);
+        unlink(path);
+#endif
+    }
+    rmdir(directory);
+}
+
+int main(int argc, char *argv[])
+{
+    BenchConfig config = {5, {3, 4}, 2, {4, 8, 17}, 3, {4, 8, 16}, 3, stdout, true};
+    const char *graphs = "graphs";
+    const char *output_name = NULL;
+    const char *profile_name = "default";
+    unsigned timeout = 0;
+
+    int option;
+    while ((option = getopt(argc, argv, "hg:r:c:l:s:y:p:t:o:")) != -1)
+    {
+        switch (option)
+        {
+        case 'h':
+            usage();
+            return 0;
+        case 'g':
+            graphs = optarg;
+            break;
+        case 'r':
+            config.repeats = atoi(optarg);
+            if (config.repeats <= 0)
+            {
+                printf("Invalid number of repeats %s. Exiting.\n", optarg);
+                return 1;
+            }
+            break;
+        case 'c':
+            config.num_colour_bounds = bench_parse_list(optarg, config.num_colours);
+            break;
+        case 'l':
+            config.num_lengths = bench_parse_list(optarg, config.lengths);
+            break;
+        case 's':
+            config.num_scales = bench_parse_list(optarg, config.scales);
+            break;
+#ifdef TUNNEL
+        case 'y':
+        {
+            tn_stack_encoding stack_encoding;
+            if (!tn_stack_encoding_of_string(optarg, &stack_encoding))
+            {
+                printf("Unknown stack encoding %s. Exiting.\n", optarg);
+                return 1;
+            }
+            tn_set_stack_encoding(stack_encoding);
+        }
+        break;
+#endif
+        case 'p':
+        {
+            solver_profile profile;
+            if (!solver_profile_of_string(optarg, &profile))
+            {
+                printf("Unknown solver profile %s. Exiting.\n", optarg);
+                return 1;
+            }
+            set_solver_profile(profile);
+            profile_name = optarg;
+        }
+        break;
+        case 't':
+            timeout = atoi(optarg) > 0 ? atoi(optarg) : 0;
+            set_solver_limits(timeout, 0);
+            break;
+        case 'o':
+            output_name = optarg;
+            break;
+        default:
+            usage();
+            return 1;
+        }
+        if (config.num_colour_bounds < 0 || config.num_lengths < 0 || config.num_scales < 0)
+        {
+            printf("Invalid list %s. Exiting.\n", optarg);
+            return 1;
+        }
+    }
+
+    if (output_name != NULL)
+    {
+        config.output = fopen(output_name, "w");
+        if (config.output == NULL)
+        {
+            printf("Cannot open %s. Exiting.\n", output_name);
+            return 1;
+        }
+    }
+
+    fprintf(config.output, "{\n  \"repeats\": %d,\n  \"unit\": \"ms\",\n", config.repeats);
+    fprintf(config.output, "  \"solver_profile\": \"%s\",\n  \"timeout_ms\": %u,\n", profile_name, timeout);
+#ifdef TUNNEL
+    fprintf(config.output, "  \"stack_encoding\": \"%s\",\n", tn_get_stack_encoding() == tn_stack_compact ? "compact" : "pair");
+#endif
+    fprintf(config.output, "  \"runs\": [");
+    char directory[strlen(graphs) + 16];
+#ifdef COLOURING
+    snprintf(directory, sizeof(directory), "%s/Colouring", graphs);
+    bench_directory(&config, bench_colouring, directory, config.num_colours, config.num_colour_bounds);
+#endif
+#ifdef TUNNEL
+    snprintf(directory, sizeof(directory), "%s/TunnelNetwork", graphs);
+    bench_directory(&config, bench_tunnel, directory, config.lengths, config.num_lengths);
+#endif
+    bench_generated(&config);
+    fprintf(config.output, "\n  ]\n}\n");
+
+    if (output_name != NULL)
+        fclose(config.output);
+    return 0;
+}
@@ -0,0 +1,420 @@
+#include "CnfTools.h"
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdbool.h>
+#include <string.h>
+#include <unistd.h>
+
+struct CnfFormula_s
+{
+    Z3_context ctx;
+    int num_vars;              ///< The number of variables (numbered from 1 to num_vars).
+    int num_clauses;           ///< The number of clauses.
+    int *literals;             ///< The clauses, each ended by 0.
+    int num_literals;          ///< The number of cells used in literals (terminating zeros included).
+    int literals_capacity;     ///< The number of cells allocated in literals.
+    Z3_func_decl *inputs;      ///< inputs[v] is the Z3 variable represented by v, or NULL if v was introduced by the transformation.
+    int inputs_capacity;       ///< The number of cells allocated in inputs.
+    int *literal_of_ast;       ///< literal_of_ast[id] is the literal equivalent to the formula of Z3 id id, or 0 if it was not translated yet.
+    unsigned ast_capacity;     ///< The number of cells allocated in literal_of_ast.
+    int true_literal;          ///< A variable forced to true, or 0 if none was needed yet.
+};
+
+CnfFormula cnf_create(Z3_context ctx)
+{
+    CnfFormula cnf = (CnfFormula)malloc(sizeof(*cnf));
+    cnf->ctx = ctx;
+    cnf->num_vars = 0;
+    cnf->num_clauses = 0;
+    cnf->literals_capacity = 1024;
+    cnf->literals = (int *)malloc(cnf->literals_capacity * sizeof(int));
+    cnf->num_literals = 0;
+    cnf->inputs_capacity = 256;
+    cnf->inputs = (Z3_func_decl *)calloc(cnf->inputs_capacity, sizeof(Z3_func_decl));
+    cnf->ast_capacity = 1024;
+    cnf->literal_of_ast = (int *)calloc(cnf->ast_capacity, sizeof(int));
+    cnf->true_literal = 0;
+    return cnf;
+}
+
+void cnf_delete(CnfFormula cnf)
+{
+    free(cnf->literals);
+    free(cnf->inputs);
+    free(cnf->literal_of_ast);
+    free(cnf);
+}
+
+int cnf_get_num_vars(CnfFormula cnf)
+{
+    return cnf->num_vars;
+}
+
+int cnf_get_num_clauses(CnfFormula cnf)
+{
+    return cnf->num_clauses;
+}
+
+/**
+ * @brief Creates a new variable.
+ *
+ * @param cnf A set of clauses.
+ * @param input The Z3 variable it represents, or NULL for an auxiliary variable.
+ * @return int The variable.
+ */
+static int cnf_new_var(CnfFormula cnf, Z3_func_decl input)
+{
+    cnf->num_vars++;
+    if (cnf->num_vars >= cnf->inputs_capacity)
+    {
+        int old_capacity = cnf->inputs_capacity;
+        cnf->inputs_capacity *= 2;
+        cnf->inputs = (Z3_func_decl *)realloc(cnf->inputs, cnf->inputs_capacity * sizeof(Z3_func_decl));
+        memset(cnf->inputs + old_capacity, 0, (cnf->inputs_capacity - old_capacity) * sizeof(Z3_func_decl));
+    }
+    cnf->inputs[cnf->num_vars] = input;
+    return cnf->num_vars;
+}
+
+/**
+ * @brief Appends a literal to the clause being written (0 ends it).
+ *
+ * @param cnf A set of clauses.
+ * @param literal A literal, or 0.
+ */
+static void cnf_push(CnfFormula cnf, int literal)
+{
+    if (cnf->num_literals == cnf->literals_capacity)
+    {
+        cnf->literals_capacity *= 2;
+        cnf->literals = (int *)realloc(cnf->literals, cnf->literals_capacity * sizeof(int));
+    }
+    cnf->literals[cnf->num_literals++] = literal;
+    if (literal == 0)
+        cnf->num_clauses++;
+}
+
+/**
+ * @brief Adds the clause made of the @p size literals of @p clause.
+ *
+ * @param cnf A set of clauses.
+ * @param clause An array of literals.
+ * @param size The size of @p clause.
+ */
+static void cnf_add_clause(CnfFormula cnf, const int *clause, int size)
+{
+    for (int i = 0; i < size; i++)
+        cnf_push(cnf, clause[i]);
+    cnf_push(cnf, 0);
+}
+
+/**
+ * @brief A variable forced to true by a unit clause, created on first use.
+ *
+ * @param cnf A set of clauses.
+ * @return int
+ */
+static int cnf_true(CnfFormula cnf)
+{
+    if (cnf->true_literal == 0)
+    {
+        cnf->true_literal = cnf_new_var(cnf, NULL);
+        cnf_add_clause(cnf, &cnf->true_literal, 1);
+    }
+    return cnf->true_literal;
+}
+
+static int cnf_literal_of(CnfFormula cnf, Z3_ast formula);
+
+/**
+ * @brief Translates the arguments of @p app.
+ *
+ * @param cnf A set of clauses.
+ * @param app An application.
+ * @param num_args Set to the number of arguments.
+ * @return int* The literals of the arguments (to be freed).
+ */
+static int *cnf_arguments(CnfFormula cnf, Z3_app app, int *num_args)
+{
+    *num_args = Z3_get_app_num_args(cnf->ctx, app);
+    int *args = (int *)malloc((*num_args + 1) * sizeof(int));
+    for (int i = 0; i < *num_args; i++)
+        args[i] = cnf_literal_of(cnf, Z3_get_app_arg(cnf->ctx, app, i));
+    return args;
+}
+
+/**
+ * @brief Defines a fresh variable g equivalent to the conjunction (or disjunction if @p disjunction) of the @p num_args literals of @p args.
+ *
+ * @param cnf A set of clauses.
+ * @param args An array of literals, with one cell more than @p num_args.
+ * @param num_args The number of literals.
+ * @param disjunction true for a disjunction, false for a conjunction.
+ * @return int The variable g.
+ */
+static int cnf_define_junction(CnfFormula cnf, int *args, int num_args, bool disjunction)
+{
+    // A disjunction is the negation of the conjunction of the negations.
+    int sign = disjunction ? -1 : 1;
+    int g = cnf_new_var(cnf, NULL);
+    for (int i = 0; i < num_args; i++)
+        cnf_add_clause(cnf, (int[]){-sign * g, sign * args[i]}, 2);
+    for (int i = 0; i < num_args; i++)
+        args[i] = -sign * args[i];
+    args[num_args] = sign * g;
+    cnf_add_clause(cnf, args, num_args + 1);
+    return g;
+}
+
+/**
+ * @brief Defines a fresh variable g equivalent to if @p c then @p a else @p b.
+ *
+ * @param cnf A set of clauses.
+ * @param c A literal.
+ * @param a A literal.
+ * @param b A literal.
+ * @return int The variable g.
+ */
+static int cnf_define_ite(CnfFormula cnf, int c, int a, int b)
+{
+    int g = cnf_new_var(cnf, NULL);
+    cnf_add_clause(cnf, (int[]){-c, -a, g}, 3);
+    cnf_add_clause(cnf, (int[]){-c, a, -g}, 3);
+    cnf_add_clause(cnf, (int[]){c, -b, g}, 3);
+    cnf_add_clause(cnf, (int[]){c, b, -g}, 3);
+    return g;
+}
+
+/**
+ * @brief Translates @p formula, which has not been translated yet.
+ *
+ * @param cnf A set of clauses.
+ * @param formula A propositional formula.
+ * @return int A literal equivalent to @p formula.
+ */
+static int cnf_translate(CnfFormula cnf, Z3_ast formula)
+{
+    Z3_context ctx = cnf->ctx;
+    if (Z3_get_ast_kind(ctx, formula) != Z3_APP_AST || Z3_get_sort_kind(ctx, Z3_get_sort(ctx, formula)) != Z3_BOOL_SORT)
+    {
+        fprintf(stderr, "Error: %s is not a propositional formula, it cannot be translated into clauses.\n", Z3_ast_to_string(ctx, formula));
+        exit(EXIT_FAILURE);
+    }
+    Z3_app app = Z3_to_app(ctx, formula);
+    Z3_func_decl decl = Z3_get_app_decl(ctx, app);
+    Z3_decl_kind kind = Z3_get_decl_kind(ctx, decl);
+
+    if (kind == Z3_OP_UNINTERPRETED && Z3_get_app_num_args(ctx, app) == 0)
+        return cnf_new_var(cnf, decl);
+    if (kind == Z3_OP_TRUE)
+        return cnf_true(cnf);
+    if (kind == Z3_OP_FALSE)
+        return -cnf_true(cnf);
+
+    int num_args;
+    int *args = cnf_arguments(cnf, app, &num_args);
+    int result = 0;
+    switch (kind)
+    {
+    case Z3_OP_NOT:
+        result = -args[0];
+        break;
+    case Z3_OP_AND:
+        result = cnf_define_junction(cnf, args, num_args, false);
+        break;
+    case Z3_OP_OR:
+        result = cnf_define_junction(cnf, args, num_args, true);
+        break;
+    case Z3_OP_IMPLIES:
+        args[0] = -args[0];
+        result = cnf_define_junction(cnf, args, 2, true);
+        break;
+    case Z3_OP_IFF:
+    case Z3_OP_EQ:
+        if (num_args == 2)
+        {
+            result = cnf_define_ite(cnf, args[0], args[1], -args[1]);
+            break;
+        }
+        // fallthrough
+    case Z3_OP_XOR:
+        if (num_args == 2)
+        {
+            result = cnf_define_ite(cnf, args[0], -args[1], args[1]);
+            break;
+        }
+        // fallthrough
+    case Z3_OP_ITE:
+        if (num_args == 3)
+        {
+            result = cnf_define_ite(cnf, args[0], args[1], args[2]);
+            break;
+        }
+        // fallthrough
+    default:
+        fprintf(stderr, "Error: unsupported connective in %s, it cannot be translated into clauses (if it is a pseudo-boolean constraint, use another at most one encoding).\n", Z3_ast_to_string(ctx, formula));
+        exit(EXIT_FAILURE);
+    }
+    free(args);
+    return result;
+}
+
+/**
+ * @brief The literal equivalent to @p formula, translating it on first use.
+ *
+ * @param cnf A set of clauses.
+ * @param formula A propositional formula.
+ * @return int
+ */
+static int cnf_literal_of(CnfFormula cnf, Z3_ast formula)
+{
+    unsigned id = Z3_get_ast_id(cnf->ctx, formula);
+    if (id >= cnf->ast_capacity)
+    {
+        unsigned old_capacity = cnf->ast_capacity;
+        while (id >= cnf->ast_capacity)
+            cnf->ast_capacity *= 2;
+        cnf->literal_of_ast = (int *)realloc(cnf->literal_of_ast, cnf->ast_capacity * sizeof(int));
+        memset(cnf->literal_of_ast + old_capacity, 0, (cnf->ast_capacity - old_capacity) * sizeof(int));
+    }
+    if (cnf->literal_of_ast[id] == 0)
+    {
+        int literal = cnf_translate(cnf, formula);
+        cnf->literal_of_ast[id] = literal;
+    }
+    return cnf->literal_of_ast[id];
+}
+
+void cnf_add_formula(CnfFormula cnf, Z3_ast formula)
+{
+    Z3_context ctx = cnf->ctx;
+    if (Z3_get_ast_kind(ctx, formula) == Z3_APP_AST)
+    {
+        Z3_app app = Z3_to_app(ctx, formula);
+        Z3_decl_kind kind = Z3_get_decl_kind(ctx, Z3_get_app_decl(ctx, app));
+        // Top-level conjunctions are split, and top-level disjunctions become clauses directly, without defining a variable for them.
+        if (kind == Z3_OP_AND)
+        {
+            int num_args = Z3_get_app_num_args(ctx, app);
+            for (int i = 0; i < num_args; i++)
+                cnf_add_formula(cnf, Z3_get_app_arg(ctx, app, i));
+            return;
+        }
+        if (kind == Z3_OP_OR || kind == Z3_OP_IMPLIES)
+        {
+            int num_args;
+            int *args = cnf_arguments(cnf, app, &num_args);
+            if (kind == Z3_OP_IMPLIES)
+                args[0] = -args[0];
+            cnf_add_clause(cnf, args, num_args);
+            free(args);
+            return;
+        }
+    }
+    int literal = cnf_literal_of(cnf, formula);
+    cnf_add_clause(cnf, &literal, 1);
+}
+
+void cnf_write_dimacs(CnfFormula cnf, FILE *file)
+{
+    fprintf(file, "p cnf %d %d\n", cnf->num_vars, cnf->num_clauses);
+    for (int i = 0; i < cnf->num_literals; i++)
+    {
+        if (cnf->literals[i] == 0)
+            fprintf(file, "0\n");
+        else
+            fprintf(file, "%d ", cnf->literals[i]);
+    }
+}
+
+/**
+ * @brief Builds the model giving to each input variable of @p cnf its value in @p values.
+ *
+ * @param cnf A set of clauses.
+ * @param values values[v] is 1 if v is true.
+ * @return Z3_model
+ */
+static Z3_model cnf_model_of_values(CnfFormula cnf, const char *values)
+{
+    Z3_context ctx = cnf->ctx;
+    Z3_model model = Z3_mk_model(ctx);
+    Z3_model_inc_ref(ctx, model);
+    for (int v = 1; v <= cnf->num_vars; v++)
+        if (cnf->inputs[v] != NULL)
+            Z3_add_const_interp(ctx, model, cnf->inputs[v], values[v] ? Z3_mk_true(ctx) : Z3_mk_false(ctx));
+    return model;
+}
+
+Z3_lbool cnf_solve(CnfFormula cnf, const char *solver, Z3_model *model)
+{
+    char file_name[] = "/tmp/graphProblemSolverXXXXXX";
+    int fd = mkstemp(file_name);
+    if (fd == -1)
+    {
+        perror("Error: cannot create the DIMACS file");
+        return Z3_L_UNDEF;
+    }
+    FILE *file = fdopen(fd, "w");
+    cnf_write_dimacs(cnf, file);
+    fclose(file);
+
+    int length = strlen(solver) + strlen(file_name) + 2;
+    char command[length];
+    snprintf(command, length, "%s %s", solver, file_name);
+    FILE *output = popen(command, "r");
+    if (output == NULL)
+    {
+        perror("Error: cannot run the SAT solver");
+        unlink(file_name);
+        return Z3_L_UNDEF;
+    }
+
+    Z3_lbool result = Z3_L_UNDEF;
+    char *values = (char *)calloc(cnf->num_vars + 1, sizeof(char));
+    char *line = NULL;
+    size_t line_capacity = 0;
+    while (getline(&line, &line_capacity, output) != -1)
+    {
+        if (strncmp(line, "s SATISFIABLE", 13) == 0)
+            result = Z3_L_TRUE;
+        else if (strncmp(line, "s UNSATISFIABLE", 15) == 0)
+            result = Z3_L_FALSE;
+        else if (line[0] == 'v')
+        {
+            char *current = line + 1;
+            char *end;
+            for (long literal = strtol(current, &end, 10); end != current; literal = strtol(current, &end, 10))
+            {
+                if (literal > 0 && literal <= cnf->num_vars)
+                    values[literal] = 1;
+                current = end;
+            }
+        }
+    }
+    free(line);
+    pclose(output);
+    unlink(file_name);
+
+    switch (result)
+    {
+    case Z3_L_FALSE:
+        fprintf(stderr, "Warning: Formula unsatisfiable, no model produced, if you try to use it, it will probably crash.\n");
+        break;
+    case Z3_L_UNDEF:
+        printf("Warning: %s gave no answer.\n", solver);
+        break;
+    case Z3_L_TRUE:
+        *model = cnf_model_of_values(cnf, values);
+    }
+    free(values);
+    return result;
+}
+
+Z3_lbool cnf_solve_formula(Z3_context ctx, Z3_ast formula, const char *solver, Z3_model *model)
+{
+    CnfFormula cnf = cnf_create(ctx);
+    cnf_add_formula(cnf, formula);
+    Z3_lbool result = cnf_solve(cnf, solver, model);
+    cnf_delete(cnf);
+    return result;
+}
@@ -0,0 +1,605 @@
+/**
+ * @file Generator.c
+ * @brief Generator of scalable instances in dot format: Tunnel networks (random sparse networks, nested tunnels, grids, backbones with tunnels)
+ *        and k-colourable graphs, of any number of nodes. The instances only depend on their parameters and on the seed.
+ * @version 1
+ * @date 2025-12-05
+ *
+ * @copyright Creative Commons.
+ *
+ */
+
+#include "Graph.h"
+#include "Arena.h"
+#ifdef TUNNEL
+#include "TunnelNetwork.h"
+#endif
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <getopt.h>
+
+/**
+ * @brief The families of instances.
+ *
+ */
+typedef enum
+{
+    gen_random,   ///< Tunnel: random sparse network, with random actions.
+    gen_nested,   ///< Tunnel: a path encapsulating a given depth of tunnels then decapsulating them, with detours and loops.
+    gen_grid,     ///< Tunnel: a grid with random actions, from the top left corner to the bottom right corner.
+    gen_backbone, ///< Tunnel: a chain of transmissions, with tunnels between its nodes as shortcuts.
+    gen_colouring ///< Colouring: a random graph whose nodes are split in k classes, with no edge inside a class.
+} gen_family;
+
+/**
+ * @brief The parameters of the generation, and the state of the pseudo-random generator.
+ *
+ */
+typedef struct
+{
+    gen_family family;
+    int num_nodes;   ///< The number of nodes of the instance (the families may round it).
+    int degree;      ///< The average number of successors (neighbours for Colouring) of a node.
+    int six_percent; ///< For Tunnel: the percentage of 6 among the protocols of the actions.
+    int num_colours; ///< For Colouring: the number of classes.
+    uint64_t state;  ///< The state of the pseudo-random generator.
+} GenConfig;
+
+/**
+ * @brief A graph under construction: its arcs are collected, then indexed by gen_finish.
+ *
+ */
+typedef struct
+{
+    Graph graph;
+    bool directed;
+    int num_arcs; ///< The number of arcs collected (twice the number of edges for an undirected graph).
+    int capacity;
+    int *sources;
+    int *targets;
+} GenGraph;
+
+void usage()
+{
+    printf("Usage: graphGenerator [options]\n");
+    printf(" Writes a generated instance in dot format.\n");
+    printf("Options:\n");
+    printf(" -h         Displays this help\n");
+    printf(" -F FAMILY  The family of the instance (default: random):\n");
+    printf("            random: Tunnel network with random actions and random successors\n");
+    printf("            nested: Tunnel network whose shortest path goes through (n-2)/3 nested tunnels, with detours and loops\n");
+    printf("            grid: Tunnel network on a square grid, with random actions\n");
+    printf("            backbone: Tunnel network made of a chain of transmissions, with tunnels between its nodes\n");
+    printf("            colouring: k-colourable graph\n");
+    printf(" -n N       The number of nodes (default: 100)\n");
+    printf(" -s SEED    The seed of the pseudo-random generator (default: 1)\n");
+    printf(" -d D       The average number of successors (neighbours for colouring) of a node (default: 3)\n");
+    printf(" -m P       The percentage of 6 among the protocols of the actions of Tunnel networks (default: 50)\n");
+    printf(" -k K       The number of colours of a colouring graph (default: 3)\n");
+    printf(" -o FILE    Writes the instance in FILE instead of the standard output\n");
+}
+
+/**
+ * @brief Draws a pseudo-random number (splitmix64, so that instances do not depend on the C library).
+ *
+ * @param config The configuration.
+ * @return uint64_t
+ */
+static uint64_t gen_next(GenConfig *config)
+{
+    uint64_t z = (config->state += 0x9E3779B97F4A7C15ULL);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return z ^ (z >> 31);
+}
+
+/**
+ * @brief Draws a number between 0 and @p bound - 1.
+ *
+ * @param config The configuration.
+ * @param bound A positive integer.
+ * @return int
+ */
+static int gen_below(GenConfig *config, int bound)
+{
+    return (int)(gen_next(config) % (uint64_t)bound);
+}
+
+/**
+ * @brief Draws true with probability @p percent %.
+ *
+ * @param config The configuration.
+ * @param percent A percentage.
+ * @return bool
+ */
+static bool gen_chance(GenConfig *config, int percent)
+{
+    return gen_below(config, 100) < percent;
+}
+
+/**
+ * @brief Initializes a graph with @p num_nodes nodes, without parameters nor edges. Everything is allocated in the arena of the graph.
+ *
+ * @param gen The graph under construction.
+ * @param name The name of the graph.
+ * @param num_nodes The number of nodes.
+ * @param directed Whether the edges are arcs.
+ * @param prefix The names of the nodes are the prefix followed by their index.
+ */
+static void gen_create(GenGraph *gen, const char *name, int num_nodes, bool directed, const char *prefix)
+{
+    Graph *graph = &gen->graph;
+    graph->arena = arena_create(1 << 16);
+    graph->name = arena_strdup(graph->arena, name);
+    graph->numNodes = num_nodes;
+    graph->numEdges = 0;
+    graph->nodes = (char **)graph_alloc(graph, num_nodes * sizeof(char *));
+    graph->parameters = (parameterList **)graph_alloc(graph, num_nodes * sizeof(parameterList *));
+    graph->edges = (bool *)graph_alloc(graph, (size_t)num_nodes * num_nodes * sizeof(bool));
+    memset(graph->edges, 0, (size_t)num_nodes * num_nodes * sizeof(bool));
+    for (int node = 0; node < num_nodes; node++)
+    {
+        char node_name[strlen(prefix) + 16];
+        snprintf(node_name, sizeof(node_name), "%s%d", prefix, node);
+        graph->nodes[node] = arena_strdup(graph->arena, node_name);
+        graph->parameters[node] = NULL;
+    }
+    gen->directed = directed;
+    gen->num_arcs = 0;
+    gen->capacity = 0;
+    gen->sources = NULL;
+    gen->targets = NULL;
+}
+
+/**
+ * @brief Adds the parameter (@p name, @p value) at the end of the parameters of @p node.
+ *
+ * @param gen The graph under construction.
+ * @param node A node.
+ * @param name The name of the parameter.
+ * @param value The value of the parameter (with its quotes if it needs some).
+ */
+static void gen_add_parameter(GenGraph *gen, int node, const char *name, const char *value)
+{
+    Arena arena = gen->graph.arena;
+    parameterList **last = &gen->graph.parameters[node];
+    while (*last != NULL)
+        last = &(*last)->next;
+    *last = parameter_list_create_in_arena(arena, arena_strdup(arena, name), arena_strdup(arena, value));
+}
+
+/**
+ * @brief Adds the edge from @p source to @p target, unless it is a loop or already present.
+ *
+ * @param gen The graph under construction.
+ * @param source A node.
+ * @param target A node.
+ * @return bool true if the edge was added.
+ */
+static bool gen_add_edge(GenGraph *gen, int source, int target)
+{
+    Graph *graph = &gen->graph;
+    if (source == target || graph->edges[(size_t)source * graph->numNodes + target])
+        return false;
+    if (gen->num_arcs + 2 > gen->capacity)
+    {
+        gen->capacity = gen->capacity == 0 ? 1024 : 2 * gen->capacity;
+        gen->sources = (int *)realloc(gen->sources, gen->capacity * sizeof(int));
+        gen->targets = (int *)realloc(gen->targets, gen->capacity * sizeof(int));
+    }
+    graph->edges[(size_t)source * graph->numNodes + target] = true;
+    gen->sources[gen->num_arcs] = source;
+    gen->targets[gen->num_arcs++] = target;
+    if (!gen->directed)
+    {
+        graph->edges[(size_t)target * graph->numNodes + source] = true;
+        gen->sources[gen->num_arcs] = target;
+        gen->targets[gen->num_arcs++] = source;
+    }
+    graph->numEdges++;
+    return true;
+}
+
+/**
+ * @brief Builds the index of the edges of the graph, and releases what was only needed for the construction.
+ *
+ * @param gen The graph under construction.
+ * @return Graph The graph.
+ */
+static Graph gen_finish(GenGraph *gen)
+{
+    parameterList **parameters = (parameterList **)calloc(gen->num_arcs + 1, sizeof(parameterList *));
+    graph_build_adjacency(&gen->graph, gen->num_arcs, gen->sources, gen->targets, parameters);
+    free(parameters);
+    free(gen->sources);
+    free(gen->targets);
+    return gen->graph;
+}
+
+#ifdef TUNNEL
+/**
+ * @brief Draws a protocol: 6 with probability config->six_percent %, 4 otherwise.
+ *
+ * @param config The configuration.
+ * @return bool true for 6.
+ */
+static bool gen_protocol(GenConfig *config)
+{
+    return gen_chance(config, config->six_percent);
+}
+
+/**
+ * @brief The transmission of @p six (6 if true, 4 otherwise).
+ */
+static stack_action gen_transmit(bool six)
+{
+    return transmit_4 + six;
+}
+
+/**
+ * @brief The encapsulation of @p pushed_six over a top @p top_six.
+ */
+static stack_action gen_push(bool top_six, bool pushed_six)
+{
+    return push_4_4 + 2 * top_six + pushed_six;
+}
+
+/**
+ * @brief The decapsulation of a top @p top_six over @p under_six.
+ */
+static stack_action gen_pop(bool under_six, bool top_six)
+{
+    return pop_4_4 + 2 * under_six + top_six;
+}
+
+/**
+ * @brief Draws an action: a transmission with probability 1/2, an encapsulation or a decapsulation with probability 1/4 each.
+ *
+ * @param config The configuration.
+ * @return stack_action
+ */
+static stack_action gen_random_action(GenConfig *config)
+{
+    int kind = gen_below(config, 4);
+    bool first = gen_protocol(config);
+    bool second = gen_protocol(config);
+    if (kind <= 1)
+        return gen_transmit(first);
+    if (kind == 2)
+        return gen_push(first, second);
+    return gen_pop(first, second);
+}
+
+/**
+ * @brief Sets the label of @p node to the actions of @p actions (a set of stack_action).
+ *
+ * @param gen The graph under construction.
+ * @param node A node.
+ * @param actions A set of actions, bit a being set iff action a is in the set.
+ */
+static void gen_set_actions(GenGraph *gen, int node, int actions)
+{
+    char label[NumActions * 16 + 3] = "\"";
+    for (stack_action action = 0; action < NumActions; action++)
+        if (actions & (1 << action))
+        {
+            if (label[1] != '\0')
+                strcat(label, "\\n");
+            strcat(label, tn_string_of_stack_action(action));
+        }
+    strcat(label, "\"");
+    gen_add_parameter(gen, node, "label", label);
+}
+
+/**
+ * @brief Sets the initial and the final node of the network.
+ *
+ * @param gen The graph under construction.
+ * @param initial A node.
+ * @param final A node.
+ */
+static void gen_set_ends(GenGraph *gen, int initial, int final)
+{
+    gen_add_parameter(gen, initial, "shape", "square");
+    gen_add_parameter(gen, final, "shape", "invtriangle");
+}
+
+/**
+ * @brief Random sparse network: each node has one or two random actions and config->degree random successors.
+ *        The initial node transmits 4, so that the stack can leave it. Node 0 is initial and the last node is final.
+ *
+ * @param config The configuration.
+ * @param gen The graph under construction.
+ */
+static void gen_random_network(GenConfig *config, GenGraph *gen)
+{
+    int num_nodes = gen->graph.numNodes;
+    gen_set_ends(gen, 0, num_nodes - 1);
+    for (int node = 0; node < num_nodes; node++)
+    {
+        int actions = 1 << gen_random_action(config);
+        if (gen_chance(config, 50))
+            actions |= 1 << gen_random_action(config);
+        if (node == 0)
+            actions |= 1 << transmit_4;
+        gen_set_actions(gen, node, actions);
+    }
+    for (int node = 0; node < num_nodes; node++)
+        for (int i = 0; i < config->degree; i++)
+            gen_add_edge(gen, node, gen_below(config, num_nodes));
+}
+
+/**
+ * @brief Nested tunnels: the shortest path from s goes through u_0 to u_{D-1}, each encapsulating a random protocol, then through d_0 to d_{D-1},
+ *        decapsulating them, to the final node: it has size 2D+1, D being (n-2)/3, and the stack reaches height D.
+ *        Each u_i can be left through a detour w_i transmitting its protocol, and each d_j may go back to a random u_i.
+ *
+ * @param config The configuration.
+ * @param gen The graph under construction. Its nodes are s, then the u_i, w_i and d_i interleaved, then the final node.
+ */
+static void gen_nested_network(GenConfig *config, GenGraph *gen)
+{
+    int num_nodes = gen->graph.numNodes;
+    int depth = (num_nodes - 2) / 3;
+    int initial = 0;
+    int final = num_nodes - 1;
+    // protocols[i] is the cell at height i on the shortest path, the first one being 4.
+    bool *protocols = (bool *)malloc((depth + 1) * sizeof(bool));
+    protocols[0] = false;
+    for (int i = 1; i <= depth; i++)
+        protocols[i] = gen_protocol(config);
+
+    gen_set_ends(gen, initial, final);
+    gen_set_actions(gen, initial, 1 << transmit_4);
+    gen_set_actions(gen, final, 1 << transmit_4);
+    for (int i = 0; i < depth; i++)
+    {
+        int up = 1 + 3 * i;
+        int detour = up + 1;
+        int down = up + 2;
+        gen_set_actions(gen, up, 1 << gen_push(protocols[i], protocols[i + 1]));
+        gen_set_actions(gen, detour, 1 << gen_transmit(protocols[i + 1]));
+        gen_set_actions(gen, down, 1 << gen_pop(protocols[depth - 1 - i], protocols[depth - i]));
+        // The last encapsulation leads to the first decapsulation.
+        int next = i + 1 < depth ? up + 3 : 3;
+        gen_add_edge(gen, up, next);
+        gen_add_edge(gen, up, detour);
+        gen_add_edge(gen, detour, next);
+        gen_add_edge(gen, down, i + 1 < depth ? down + 3 : final);
+        if (gen_chance(config, 50))
+            gen_add_edge(gen, down, 1 + 3 * gen_below(config, depth));
+    }
+    // The nodes left by the rounding are only reachable from the final node.
+    for (int node = 3 * depth + 1; node < final; node++)
+    {
+        gen_set_actions(gen, node, 1 << gen_random_action(config));
+        gen_add_edge(gen, final, node);
+    }
+    gen_add_edge(gen, initial, depth == 0 ? final : 1);
+    free(protocols);
+}
+
+/**
+ * @brief Grid: the nodes form rows of width the square root of n, each linked to its right and bottom neighbours, and with probability 1/4 to its
+ *        left and top ones. Each node has a random action, and transmits 4 with probability 1/2 (always for the initial node, the top left one).
+ *        The final node is the last one.
+ *
+ * @param config The configuration.
+ * @param gen The graph under construction.
+ */
+static void gen_grid_network(GenConfig *config, GenGraph *gen)
+{
+    int num_nodes = gen->graph.numNodes;
+    int width = 1;
+    while ((width + 1) * (width + 1) <= num_nodes)
+        width++;
+    gen_set_ends(gen, 0, num_nodes - 1);
+    for (int node = 0; node < num_nodes; node++)
+    {
+        int actions = node == 0 ? 0 : 1 << gen_random_action(config);
+        if (node == 0 || gen_chance(config, 50))
+            actions |= 1 << transmit_4;
+        gen_set_actions(gen, node, actions);
+        int column = node % width;
+        if (column + 1 < width && node + 1 < num_nodes)
+        {
+            gen_add_edge(gen, node, node + 1);
+            if (gen_chance(config, 25))
+                gen_add_edge(gen, node + 1, node);
+        }
+        if (node + width < num_nodes)
+        {
+            gen_add_edge(gen, node, node + width);
+            if (gen_chance(config, 25))
+                gen_add_edge(gen, node + width, node);
+        }
+    }
+}
+
+/**
+ * @brief Backbone: a quarter of the nodes form a chain transmitting 4, from the initial to the final node. The others form tunnels of 1 to 8 nodes:
+ *        an encapsulation of a random protocol entered from a node of the chain, transmissions of that protocol, and a decapsulation leading to a
+ *        later node of the chain.
+ *
+ * @param config The configuration.
+ * @param gen The graph under construction. Its nodes are the chain, then the tunnels.
+ */
+static void gen_backbone_network(GenConfig *config, GenGraph *gen)
+{
+    int num_nodes = gen->graph.numNodes;
+    int chain = num_nodes / 4 < 2 ? (num_nodes < 2 ? num_nodes : 2) : num_nodes / 4;
+    gen_set_ends(gen, 0, chain - 1);
+    for (int node = 0; node < chain; node++)
+    {
+        gen_set_actions(gen, node, 1 << transmit_4);
+        if (node + 1 < chain)
+            gen_add_edge(gen, node, node + 1);
+    }
+    int node = chain;
+    while (node < num_nodes)
+    {
+        int length = 1 + gen_below(config, 8);
+        if (length > num_nodes - node)
+            length = num_nodes - node;
+        bool protocol = gen_protocol(config);
+        int entry = gen_below(config, chain);
+        int exit = entry + gen_below(config, chain - entry);
+        if (length == 1)
+            gen_set_actions(gen, node, 1 << transmit_4);
+        else
+        {
+            gen_set_actions(gen, node, 1 << gen_push(false, protocol));
+            for (int inner = node + 1; inner < node + length - 1; inner++)
+                gen_set_actions(gen, inner, 1 << gen_transmit(protocol));
+            gen_set_actions(gen, node + length - 1, 1 << gen_pop(false, protocol));
+        }
+        gen_add_edge(gen, entry, node);
+        for (int inner = node; inner < node + length - 1; inner++)
+            gen_add_edge(gen, inner, inner + 1);
+        gen_add_edge(gen, node + length - 1, exit);
+        node += length;
+    }
+}
+#endif
+
+/**
+ * @brief k-colourable graph: each node gets a random class among config->num_colours, and n*d/2 random edges are drawn between nodes of different classes.
+ *
+ * @param config The configuration.
+ * @param gen The graph under construction.
+ */
+static void gen_colouring_graph(GenConfig *config, GenGraph *gen)
+{
+    int num_nodes = gen->graph.numNodes;
+    int *classes = (int *)malloc((num_nodes + 1) * sizeof(int));
+    for (int node = 0; node < num_nodes; node++)
+        classes[node] = gen_below(config, config->num_colours);
+    long num_edges = (long)num_nodes * config->degree / 2;
+    // Gives up after a number of draws when the graph is too dense for the classes.
+    for (long draw = 0; gen->graph.numEdges < num_edges && draw < 16 * num_edges; draw++)
+    {
+        int source = gen_below(config, num_nodes);
+        int target = gen_below(config, num_nodes);
+        if (classes[source] != classes[target])
+            gen_add_edge(gen, source, target);
+    }
+    free(classes);
+}
+
+int main(int argc, char *argv[])
+{
+    GenConfig config = {gen_random, 100, 3, 50, 3, 1};
+    const char *output_name = NULL;
+    const char *family_names[] = {"random", "nested", "grid", "backbone", "colouring"};
+
+    int option;
+    while ((option = getopt(argc, argv, "hF:n:s:d:m:k:o:")) != -1)
+    {
+        switch (option)
+        {
+        case 'h':
+            usage();
+            return 0;
+        case 'F':
+        {
+            int family = 0;
+            while (family <= gen_colouring && strcmp(optarg, family_names[family]) != 0)
+                family++;
+            if (family > gen_colouring)
+            {
+                printf("Unknown family %s. Exiting.\n", optarg);
+                return 1;
+            }
+            config.family = family;
+            break;
+        }
+        case 'n':
+            config.num_nodes = atoi(optarg);
+            break;
+        case 's':
+            config.state = strtoull(optarg, NULL, 10);
+            break;
+        case 'd':
+            config.degree = atoi(optarg);
+            break;
+        case 'm':
+            config.six_percent = atoi(optarg);
+            break;
+        case 'k':
+            config.num_colours = atoi(optarg);
+            break;
+        case 'o':
+            output_name = optarg;
+            break;
+        default:
+            usage();
+            return 1;
+        }
+    }
+    if (config.num_nodes < 2 || config.degree < 0 || config.six_percent < 0 || config.six_percent > 100 || config.num_colours < 1)
+    {
+        printf("Invalid parameters: there must be at least 2 nodes, a percentage between 0 and 100 and at least one colour. Exiting.\n");
+        return 1;
+    }
+#ifndef TUNNEL
+    if (config.family != gen_colouring)
+    {
+        printf("Tunnel networks are not supported by this build. Exiting.\n");
+        return 1;
+    }
+#endif
+
+    char name[64];
+    snprintf(name, sizeof(name), "%s_%d_%llu", family_names[config.family], config.num_nodes, (unsigned long long)config.state);
+    GenGraph gen;
+    gen_create(&gen, name, config.num_nodes, config.family != gen_colouring, config.family == gen_colouring ? "" : "n");
+    switch (config.family)
+    {
+#ifdef TUNNEL
+    case gen_random:
+        gen_random_network(&config, &gen);
+        break;
+    case gen_nested:
+        gen_nested_network(&config, &gen);
+        break;
+    case gen_grid:
+        gen_grid_network(&config, &gen);
+        break;
+    case gen_backbone:
+        gen_backbone_network(&config, &gen);
+        break;
+#endif
+    default:
+        gen_colouring_graph(&config, &gen);
+    }
+    Graph graph = gen_finish(&gen);
+
+    FILE *output = stdout;
+    if (output_name != NULL)
+    {
+        output = fopen(output_name, "w");
+        if (output == NULL)
+        {
+            printf("Cannot open %s. Exiting.\n", output_name);
+            graph_delete(graph);
+            return 1;
+        }
+    }
+    if (gen.directed)
+    {
+        fprintf(output, "digraph %s{\n", name);
+        digraph_fill_dot_content(graph, output);
+    }
+    else
+    {
+        fprintf(output, "graph %s{\n", name);
+        graph_fill_dot_content(graph, output);
+    }
+    fprintf(output, "}\n");
+    if (output_name != NULL)
+        fclose(output);
+    graph_delete(graph);
+    return 0;
+}
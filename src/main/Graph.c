@@ -12,6 +12,7 @@
  */
 
 #include "Graph.h"
+#include "Hash.h"
 #include <stdio.h>
 #include <string.h>
 #include <stdlib.h>
@@ -33,6 +34,17 @@ parameterList *parameter_list_add_parameter(parameterList *list, char *name, cha
 	return list;
 }
 
+parameterList *parameter_list_create_in_arena(Arena arena, char *name, char *value)
+{
+	parameterList *list = (parameterList *)arena_alloc(arena, sizeof(parameterList));
+	if (list == NULL)
+		return NULL;
+	list->name = name;
+	list->value = value;
+	list->next = NULL;
+	return list;
+}
+
 parameterList *parameter_lists_merge(parameterList *head, parameterList *tail)
 {
 	if (head == NULL)
@@ -118,10 +130,21 @@ void graph_print(Graph graph)
 Graph graph_copy(Graph graph)
 {
 	Graph copy;
-	copy.name = graph.name;
+	copy.arena = NULL;
+	copy.name = NULL;
+	if (graph.name != NULL)
+	{
+		copy.name = (char *)malloc((strlen(graph.name) + 1) * sizeof(char));
+		strcpy(copy.name, graph.name);
+	}
 	copy.numNodes = graph.numNodes;
 	copy.numEdges = graph.numEdges;
 	copy.nodes = (char **)malloc(copy.numNodes * sizeof(char *));
+	for (int i = 0; i < copy.numNodes; i++)
+	{
+		copy.nodes[i] = (char *)malloc((strlen(graph.nodes[i]) + 1) * sizeof(char));
+		strcpy(copy.nodes[i], graph.nodes[i]);
+	}
 	copy.edges = (bool *)malloc(copy.numNodes * copy.numNodes * sizeof(bool));
 
 	for (int i = 0; i < copy.numNodes * copy.numNodes; i++)
@@ -131,15 +154,42 @@ Graph graph_copy(Graph graph)
 	for (int i = 0; i < graph.numNodes; i++)
 		copy.parameters[i] = parameter_list_copy(graph.parameters[i]);
 
-	copy.edge_parameters = (parameterList **)malloc(graph.numNodes * graph.numNodes * sizeof(parameterList *));
-	for (int i = 0; i < graph.numNodes * graph.numNodes; i++)
-		copy.edge_parameters[i] = parameter_list_copy(graph.edge_parameters[i]);
+	int num_arcs = graph.successor_offsets[graph.numNodes];
+	copy.numEdgeParameterLists = graph.numEdgeParameterLists;
+	copy.edge_parameter_lists = (parameterList **)malloc((copy.numEdgeParameterLists + 1) * sizeof(parameterList *));
+	for (int i = 0; i < copy.numEdgeParameterLists; i++)
+		copy.edge_parameter_lists[i] = parameter_list_copy(graph.edge_parameter_lists[i]);
+	copy.edge_parameters = (int *)malloc((num_arcs + 1) * sizeof(int));
+	memcpy(copy.edge_parameters, graph.edge_parameters, num_arcs * sizeof(int));
+
+	copy.successor_offsets = (int *)malloc((copy.numNodes + 1) * sizeof(int));
+	memcpy(copy.successor_offsets, graph.successor_offsets, (copy.numNodes + 1) * sizeof(int));
+	copy.successors = (int *)malloc((num_arcs + 1) * sizeof(int));
+	memcpy(copy.successors, graph.successors, num_arcs * sizeof(int));
+	copy.predecessor_offsets = (int *)malloc((copy.numNodes + 1) * sizeof(int));
+	memcpy(copy.predecessor_offsets, graph.predecessor_offsets, (copy.numNodes + 1) * sizeof(int));
+	copy.predecessors = (int *)malloc((num_arcs + 1) * sizeof(int));
+	memcpy(copy.predecessors, graph.predecessors, num_arcs * sizeof(int));
 
 	return copy;
 }
 
+void *graph_alloc(Graph *graph, size_t size)
+{
+	if (size == 0)
+		size = 1;
+	return graph->arena != NULL ? arena_alloc(graph->arena, size) : malloc(size);
+}
+
 void graph_delete(Graph graph)
 {
+	// Everything belongs to the arena.
+	if (graph.arena != NULL)
+	{
+		arena_delete(graph.arena);
+		return;
+	}
+
 	if (graph.edges != NULL)
 		free(graph.edges);
 	if (graph.nodes != NULL)
@@ -157,10 +207,16 @@ void graph_delete(Graph graph)
 		parameter_list_delete(graph.parameters[i]);
 	free(graph.parameters);
 
-	for (int i = 0; i < graph.numNodes * graph.numNodes; i++)
-		parameter_list_delete(graph.edge_parameters[i]);
+	for (int i = 0; i < graph.numEdgeParameterLists; i++)
+		parameter_list_delete(graph.edge_parameter_lists[i]);
+	free(graph.edge_parameter_lists);
 	free(graph.edge_parameters);
 
+	free(graph.successor_offsets);
+	free(graph.successors);
+	free(graph.predecessor_offsets);
+	free(graph.predecessors);
+
 	graph.numEdges = 0;
 	graph.numNodes = 0;
 	free(graph.name);
@@ -188,7 +244,202 @@ bool graph_is_edge(Graph graph, int source, int target)
 
 parameterList *graph_get_edge_parameter(Graph graph, int source, int target)
 {
-	return graph.edge_parameters[(source * graph.numNodes) + target];
+	// The successors of source are sorted: binary search of target.
+	int low = graph.successor_offsets[source];
+	int high = graph.successor_offsets[source + 1];
+	while (low < high)
+	{
+		int middle = (low + high) / 2;
+		if (graph.successors[middle] == target)
+			return graph.edge_parameters[middle] < 0 ? NULL : graph.edge_parameter_lists[graph.edge_parameters[middle]];
+		if (graph.successors[middle] < target)
+			low = middle + 1;
+		else
+			high = middle;
+	}
+	return NULL;
+}
+
+const int *graph_successors(Graph graph, int node, int *count)
+{
+	*count = graph.successor_offsets[node + 1] - graph.successor_offsets[node];
+	return graph.successors + graph.successor_offsets[node];
+}
+
+const int *graph_predecessors(Graph graph, int node, int *count)
+{
+	*count = graph.predecessor_offsets[node + 1] - graph.predecessor_offsets[node];
+	return graph.predecessors + graph.predecessor_offsets[node];
+}
+
+/**
+ * @brief An arc of the list given to graph_build_adjacency.
+ *
+ */
+typedef struct
+{
+	int target;				  ///< The target of the arc.
+	int rank;				  ///< Its position in the list.
+	parameterList *parameters; ///< Its parameters.
+} graph_arc;
+
+/**
+ * @brief Comparison of arcs of the same source for qsort: by target, then by position in the list.
+ *
+ * @param a A pointer towards a graph_arc.
+ * @param b A pointer towards a graph_arc.
+ * @return int
+ */
+static int graph_compare_arcs(const void *a, const void *b)
+{
+	const graph_arc *arc1 = (const graph_arc *)a;
+	const graph_arc *arc2 = (const graph_arc *)b;
+	if (arc1->target != arc2->target)
+		return arc1->target - arc2->target;
+	return arc1->rank - arc2->rank;
+}
+
+/**
+ * @brief Hash of the names and values of @p list (FNV-1a).
+ *
+ * @param list A list of parameters.
+ * @return uint64_t
+ */
+static uint64_t graph_hash_parameter_list(parameterList *list)
+{
+	uint64_t hash = HASH_INIT;
+	for (; list != NULL; list = list->next)
+	{
+		hash = hash_string(hash, list->name);
+		hash = hash_bytes(hash, "=", 1);
+		hash = hash_string(hash, list->value);
+		hash = hash_bytes(hash, ";", 1);
+	}
+	return hash;
+}
+
+/**
+ * @brief Tells if @p list1 and @p list2 have the same names and values in the same order.
+ *
+ * @param list1 A list of parameters.
+ * @param list2 A list of parameters.
+ * @return bool
+ */
+static bool graph_parameter_lists_equal(parameterList *list1, parameterList *list2)
+{
+	while (list1 != list2)
+	{
+		if (list1 == NULL || list2 == NULL || strcmp(list1->name, list2->name) != 0 || strcmp(list1->value, list2->value) != 0)
+			return false;
+		list1 = list1->next;
+		list2 = list2->next;
+	}
+	return true;
+}
+
+/**
+ * @brief Fills the edge parameters of @p graph, copying each distinct list of @p parameters once (or sharing it if it belongs to the arena of @p graph).
+ *
+ * @param graph A graph.
+ * @param num_arcs The number of arcs of @p graph.
+ * @param parameters The parameters of each arc, aligned with graph->successors (owned by graph->arena if it is not NULL, not owned otherwise).
+ */
+static void graph_intern_edge_parameters(Graph *graph, int num_arcs, parameterList **parameters)
+{
+	// Open addressing table of the indices of the distinct lists, at most half full.
+	int capacity = 1;
+	while (capacity < 2 * num_arcs)
+		capacity *= 2;
+	int *table = (int *)malloc(capacity * sizeof(int));
+	for (int i = 0; i < capacity; i++)
+		table[i] = -1;
+	// Originals of the distinct lists, to compare without going through the copies.
+	parameterList **originals = (parameterList **)malloc((num_arcs > 0 ? num_arcs : 1) * sizeof(parameterList *));
+
+	graph->numEdgeParameterLists = 0;
+	graph->edge_parameter_lists = (parameterList **)graph_alloc(graph, num_arcs * sizeof(parameterList *));
+	graph->edge_parameters = (int *)graph_alloc(graph, num_arcs * sizeof(int));
+	for (int arc = 0; arc < num_arcs; arc++)
+	{
+		if (parameters[arc] == NULL)
+		{
+			graph->edge_parameters[arc] = -1;
+			continue;
+		}
+		int slot = graph_hash_parameter_list(parameters[arc]) & (capacity - 1);
+		while (table[slot] != -1 && !graph_parameter_lists_equal(originals[table[slot]], parameters[arc]))
+			slot = (slot + 1) & (capacity - 1);
+		if (table[slot] == -1)
+		{
+			table[slot] = graph->numEdgeParameterLists;
+			originals[graph->numEdgeParameterLists] = parameters[arc];
+			graph->edge_parameter_lists[graph->numEdgeParameterLists++] = graph->arena != NULL ? parameters[arc] : parameter_list_copy(parameters[arc]);
+		}
+		graph->edge_parameters[arc] = table[slot];
+	}
+	free(table);
+	free(originals);
+}
+
+void graph_build_adjacency(Graph *graph, int num_arcs, const int *sources, const int *targets, parameterList **parameters)
+{
+	int num_nodes = graph->numNodes;
+
+	// Counting sort of the arcs by source, then sort of each row by target.
+	int *offsets = (int *)calloc(num_nodes + 1, sizeof(int));
+	for (int arc = 0; arc < num_arcs; arc++)
+		offsets[sources[arc] + 1]++;
+	for (int node = 0; node < num_nodes; node++)
+		offsets[node + 1] += offsets[node];
+	int *fill = (int *)malloc(num_nodes * sizeof(int));
+	memcpy(fill, offsets, num_nodes * sizeof(int));
+	graph_arc *arcs = (graph_arc *)malloc((num_arcs > 0 ? num_arcs : 1) * sizeof(graph_arc));
+	for (int arc = 0; arc < num_arcs; arc++)
+		arcs[fill[sources[arc]]++] = (graph_arc){targets[arc], arc, parameters[arc]};
+	free(fill);
+
+	// Repeated arcs are merged, keeping the parameters of the last occurrence.
+	graph->successor_offsets = (int *)graph_alloc(graph, (num_nodes + 1) * sizeof(int));
+	graph->successors = (int *)graph_alloc(graph, num_arcs * sizeof(int));
+	parameterList **arc_parameters = (parameterList **)malloc((num_arcs > 0 ? num_arcs : 1) * sizeof(parameterList *));
+	int size = 0;
+	for (int node = 0; node < num_nodes; node++)
+	{
+		graph->successor_offsets[node] = size;
+		qsort(arcs + offsets[node], offsets[node + 1] - offsets[node], sizeof(graph_arc), graph_compare_arcs);
+		for (int arc = offsets[node]; arc < offsets[node + 1]; arc++)
+		{
+			if (size > graph->successor_offsets[node] && graph->successors[size - 1] == arcs[arc].target)
+			{
+				arc_parameters[size - 1] = arcs[arc].parameters;
+				continue;
+			}
+			graph->successors[size] = arcs[arc].target;
+			arc_parameters[size] = arcs[arc].parameters;
+			size++;
+		}
+	}
+	graph->successor_offsets[num_nodes] = size;
+	free(arcs);
+	free(offsets);
+
+	graph_intern_edge_parameters(graph, size, arc_parameters);
+	free(arc_parameters);
+
+	// Predecessors: going through the sources in increasing order gives sorted rows.
+	graph->predecessor_offsets = (int *)graph_alloc(graph, (num_nodes + 1) * sizeof(int));
+	memset(graph->predecessor_offsets, 0, (num_nodes + 1) * sizeof(int));
+	graph->predecessors = (int *)graph_alloc(graph, size * sizeof(int));
+	for (int arc = 0; arc < size; arc++)
+		graph->predecessor_offsets[graph->successors[arc] + 1]++;
+	for (int node = 0; node < num_nodes; node++)
+		graph->predecessor_offsets[node + 1] += graph->predecessor_offsets[node];
+	fill = (int *)malloc((num_nodes > 0 ? num_nodes : 1) * sizeof(int));
+	memcpy(fill, graph->predecessor_offsets, num_nodes * sizeof(int));
+	for (int node = 0; node < num_nodes; node++)
+		for (int arc = graph->successor_offsets[node]; arc < graph->successor_offsets[node + 1]; arc++)
+			graph->predecessors[fill[graph->successors[arc]]++] = node;
+	free(fill);
 }
 
 parameterList *graph_get_node_parameter(Graph graph, int node)
@@ -223,16 +474,16 @@ void graph_fill_dot_content(Graph graph, FILE *file)
 		}
 		fprintf(file, ";\n");
 	}
+	// The successors are sorted: the edges come in the same order as with a scan of the matrix, without its quadratic cost.
 	for (int node = 0; node < num_nodes; node++)
 	{
-		for (int node2 = 0; node2 < node; node2++)
+		int count;
+		const int *successors = graph_successors(graph, node, &count);
+		for (int i = 0; i < count && successors[i] < node; i++)
 		{
-			if (graph_is_edge(graph, node, node2))
-			{
-				fprintf(file, "%s -- %s", graph_get_node_name(graph, node), graph_get_node_name(graph, node2));
-				fprintf(file, ";\n");
-				// todo : edge parameters
-			}
+			fprintf(file, "%s -- %s", graph_get_node_name(graph, node), graph_get_node_name(graph, successors[i]));
+			fprintf(file, ";\n");
+			// todo : edge parameters
 		}
 	}
 }
@@ -261,15 +512,14 @@ void digraph_fill_dot_content(Graph graph, FILE *file)
 	}
 	for (int node = 0; node < num_nodes; node++)
 	{
-		for (int node2 = 0; node2 < num_nodes; node2++)
+		int count;
+		const int *successors = graph_successors(graph, node, &count);
+		for (int i = 0; i < count; i++)
 		{
-			if (graph_is_edge(graph, node, node2))
-			{
-				fprintf(file, "%s -> %s", graph_get_node_name(graph, node), graph_get_node_name(graph, node2));
-				fprintf(file, ";\n");
+			fprintf(file, "%s -> %s", graph_get_node_name(graph, node), graph_get_node_name(graph, successors[i]));
+			fprintf(file, ";\n");
 
-				// todo : edge parameters.
-			}
+			// todo : edge parameters.
 		}
 	}
 }
\ No newline at end of file
@@ -0,0 +1,21 @@
+#include "Hash.h"
+
+/**
+ * @brief The FNV-1a prime of 64-bit hashes.
+ */
+#define HASH_PRIME 1099511628211ULL
+
+uint64_t hash_bytes(uint64_t hash, const void *bytes, size_t size)
+{
+    const unsigned char *byte = (const unsigned char *)bytes;
+    for (size_t i = 0; i < size; i++)
+        hash = (hash ^ byte[i]) * HASH_PRIME;
+    return hash;
+}
+
+uint64_t hash_string(uint64_t hash, const char *string)
+{
+    for (; *string != '\0'; string++)
+        hash = (hash ^ (unsigned char)*string) * HASH_PRIME;
+    return hash;
+}
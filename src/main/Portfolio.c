@@ -0,0 +1,144 @@
+#include "Portfolio.h"
+#include <stdlib.h>
+#include <stdio.h>
+#include <pthread.h>
+#include <time.h>
+
+/**
+ * @brief Delay between two interruptions of the reduction while waiting for it to stop (an interruption is lost if Z3 is not solving yet).
+ */
+#define INTERRUPT_PERIOD_NS 1000000
+
+struct Portfolio_s
+{
+    pthread_mutex_t lock;
+    pthread_cond_t finished_cond; ///< Signaled each time an engine finishes.
+    bool finished[2];             ///< finished[engine] is true once the task of the engine has returned.
+    int winner;                   ///< The first engine to finish, or -1.
+    atomic_bool stop[2];          ///< stop[engine] is raised when the engine has to stop.
+    Z3_context ctx;               ///< The context of the reduction, or NULL.
+    portfolio_task tasks[2];
+    void *data;
+};
+
+/**
+ * @brief The argument of the thread of an engine.
+ *
+ */
+typedef struct
+{
+    Portfolio portfolio;
+    portfolio_engine engine;
+} portfolio_thread_arg;
+
+/**
+ * @brief Body of the thread of an engine: runs its task, then records that it finished.
+ *
+ * @param arg A portfolio_thread_arg.
+ * @return void* NULL.
+ */
+static void *portfolio_thread(void *arg)
+{
+    Portfolio portfolio = ((portfolio_thread_arg *)arg)->portfolio;
+    portfolio_engine engine = ((portfolio_thread_arg *)arg)->engine;
+    portfolio->tasks[engine](portfolio, portfolio->data);
+
+    pthread_mutex_lock(&portfolio->lock);
+    portfolio->finished[engine] = true;
+    if (portfolio->winner == -1)
+        portfolio->winner = engine;
+    pthread_cond_broadcast(&portfolio->finished_cond);
+    pthread_mutex_unlock(&portfolio->lock);
+    return NULL;
+}
+
+/**
+ * @brief Asks @p engine to stop, and waits until it did.
+ *
+ * @param portfolio The race.
+ * @param engine An engine.
+ * @pre The lock of @p portfolio is held.
+ */
+static void portfolio_cancel(Portfolio portfolio, portfolio_engine engine)
+{
+    atomic_store(&portfolio->stop[engine], true);
+    while (!portfolio->finished[engine])
+    {
+        if (engine == engine_reduction && portfolio->ctx != NULL)
+            Z3_interrupt(portfolio->ctx);
+        struct timespec deadline;
+        clock_gettime(CLOCK_REALTIME, &deadline);
+        deadline.tv_nsec += INTERRUPT_PERIOD_NS;
+        if (deadline.tv_nsec >= 1000000000)
+        {
+            deadline.tv_sec++;
+            deadline.tv_nsec -= 1000000000;
+        }
+        pthread_cond_timedwait(&portfolio->finished_cond, &portfolio->lock, &deadline);
+    }
+}
+
+portfolio_engine portfolio_race(portfolio_task brute_force, portfolio_task reduction, void *data)
+{
+    struct Portfolio_s portfolio;
+    pthread_mutex_init(&portfolio.lock, NULL);
+    pthread_cond_init(&portfolio.finished_cond, NULL);
+    portfolio.finished[engine_brute_force] = portfolio.finished[engine_reduction] = false;
+    portfolio.winner = -1;
+    atomic_init(&portfolio.stop[engine_brute_force], false);
+    atomic_init(&portfolio.stop[engine_reduction], false);
+    portfolio.ctx = NULL;
+    portfolio.tasks[engine_brute_force] = brute_force;
+    portfolio.tasks[engine_reduction] = reduction;
+    portfolio.data = data;
+
+    pthread_t threads[2];
+    portfolio_thread_arg args[2];
+    for (int engine = 0; engine < 2; engine++)
+    {
+        args[engine] = (portfolio_thread_arg){&portfolio, engine};
+        pthread_create(&threads[engine], NULL, portfolio_thread, &args[engine]);
+    }
+
+    pthread_mutex_lock(&portfolio.lock);
+    while (portfolio.winner == -1)
+        pthread_cond_wait(&portfolio.finished_cond, &portfolio.lock);
+    portfolio_engine winner = portfolio.winner;
+    portfolio_cancel(&portfolio, winner == engine_brute_force ? engine_reduction : engine_brute_force);
+    pthread_mutex_unlock(&portfolio.lock);
+
+    for (int engine = 0; engine < 2; engine++)
+        pthread_join(threads[engine], NULL);
+    pthread_cond_destroy(&portfolio.finished_cond);
+    pthread_mutex_destroy(&portfolio.lock);
+    return winner;
+}
+
+const atomic_bool *portfolio_stop_flag(Portfolio portfolio, portfolio_engine engine)
+{
+    return &portfolio->stop[engine];
+}
+
+void portfolio_set_context(Portfolio portfolio, Z3_context ctx)
+{
+    pthread_mutex_lock(&portfolio->lock);
+    portfolio->ctx = ctx;
+    pthread_mutex_unlock(&portfolio->lock);
+}
+
+bool portfolio_claim(Portfolio portfolio)
+{
+    pthread_mutex_lock(&portfolio->lock);
+    bool claimed = !atomic_load(&portfolio->stop[engine_reduction]);
+    if (claimed)
+        portfolio->ctx = NULL;
+    pthread_mutex_unlock(&portfolio->lock);
+    return claimed;
+}
+
+char *portfolio_string_of_engine(portfolio_engine engine)
+{
+    if (engine == engine_brute_force)
+        return "brute force";
+    return "reduction";
+}
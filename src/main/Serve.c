@@ -0,0 +1,787 @@
+#include "Serve.h"
+#include "Graph.h"
+#include "Parsing.h"
+#include "Z3Tools.h"
+#include "TunnelNetwork.h"
+#include "TunnelReduction.h"
+#include "TunnelIncremental.h"
+#include "TunnelBinary.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <ctype.h>
+#include <signal.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+/**
+ * @brief A pair of initial and final nodes asked on a cached network, with its incremental solver and what is already known of its sizes.
+ *
+ */
+typedef struct
+{
+    int initial;              ///< The initial node.
+    int final;                ///< The final node.
+    TunnelNetwork network;    ///< The network with these nodes (it shares the graph of the cached network).
+    TunnelIncremental solver; ///< The incremental solver, NULL if no size is left to check.
+    int max_length;           ///< The largest size @p solver can check.
+    int unsat_up_to;          ///< The sizes 1 to unsat_up_to have no path.
+    int length;               ///< The size of the shortest path (0 if none is known).
+    tn_step *path;            ///< The shortest path, of size length (NULL if none is known).
+} ServeRoute;
+
+/**
+ * @brief A cached network.
+ *
+ */
+typedef struct
+{
+    uint64_t hash;          ///< The hash of the content of its file.
+    Graph graph;            ///< The graph supporting the network.
+    TunnelNetwork network;  ///< The network, with the initial and final nodes of its file.
+    Z3_context ctx;         ///< The context of the solvers of its routes.
+    ServeRoute *routes;     ///< The routes asked on the network.
+    int num_routes;         ///< The number of routes.
+    int capacity;           ///< The size of routes.
+    unsigned long last_use; ///< The number of the last request using the network.
+} ServeNetwork;
+
+/**
+ * @brief The state of the service.
+ *
+ */
+typedef struct
+{
+    const ServeConfig *config;  ///< The configuration.
+    ServeNetwork *networks;     ///< The cached networks (config->max_networks slots).
+    int num_networks;           ///< The number of cached networks.
+    unsigned long num_requests; ///< The number of requests read so far.
+    bool stopped;               ///< true once a request asked to stop the service.
+} ServeCache;
+
+/**
+ * @brief A request, as read from its line.
+ *
+ */
+typedef struct
+{
+    char *id;              ///< The value of "id" (NULL if absent).
+    bool id_is_string;     ///< true if "id" is a string, false if it is a JSON literal (written back as is).
+    char *file;            ///< The file of the network.
+    int bound;             ///< The largest size of path tried.
+    char *initial;         ///< The initial node (NULL to keep the one of the file).
+    bool initial_is_index; ///< true if @p initial is a node index, false if it is a node name.
+    char *final;           ///< The final node (NULL to keep the one of the file).
+    bool final_is_index;   ///< true if @p final is a node index, false if it is a node name.
+    bool stop;             ///< true if the request asks to stop the service.
+} ServeRequest;
+
+// --- Requests ---
+
+/**
+ * @brief Skips the JSON white space starting at @p c.
+ *
+ * @param c A position in a line.
+ * @return const char* The first character that is not a white space.
+ */
+static const char *serve_skip_spaces(const char *c)
+{
+    while (*c == ' ' || *c == '\t' || *c == '\r' || *c == '\n')
+        c++;
+    return c;
+}
+
+/**
+ * @brief Writes the UTF-8 encoding of the code point @p code (of the basic multilingual plane) at @p out.
+ *
+ * @param out Where the encoding is written.
+ * @param code A code point lower than 0x10000.
+ * @return char* The position after the encoding.
+ */
+static char *serve_put_utf8(char *out, unsigned code)
+{
+    if (code < 0x80)
+        *out++ = (char)code;
+    else if (code < 0x800)
+    {
+        *out++ = (char)(0xc0 | (code >> 6));
+        *out++ = (char)(0x80 | (code & 0x3f));
+    }
+    else
+    {
+        *out++ = (char)(0xe0 | (code >> 12));
+        *out++ = (char)(0x80 | ((code >> 6) & 0x3f));
+        *out++ = (char)(0x80 | (code & 0x3f));
+    }
+    return out;
+}
+
+/**
+ * @brief Reads the JSON string starting at @p c, and unescapes it.
+ *
+ * @param c The position of the opening quote.
+ * @param value Set to the string read (to be freed), or NULL if it is invalid.
+ * @return const char* The position after the closing quote, or NULL if the string is invalid.
+ */
+static const char *serve_parse_string(const char *c, char **value)
+{
+    c++;
+    // An escape is never shorter than the characters it stands for.
+    char *out = (char *)malloc(strlen(c) + 1);
+    *value = out;
+    for (; *c != '"'; c++)
+    {
+        if (*c == '\0' || (unsigned char)*c < 0x20)
+            break;
+        if (*c != '\\')
+        {
+            *out++ = *c;
+            continue;
+        }
+        c++;
+        const char *escapes = "\"\\/bfnrt";
+        const char *unescaped = "\"\\/\b\f\n\r\t";
+        const char *escape = *c != '\0' ? strchr(escapes, *c) : NULL;
+        if (escape != NULL)
+        {
+            *out++ = unescaped[escape - escapes];
+            continue;
+        }
+        if (*c != 'u' || !isxdigit((unsigned char)c[1]) || !isxdigit((unsigned char)c[2]) || !isxdigit((unsigned char)c[3]) || !isxdigit((unsigned char)c[4]))
+            break;
+        char digits[5] = {c[1], c[2], c[3], c[4], '\0'};
+        out = serve_put_utf8(out, (unsigned)strtoul(digits, NULL, 16));
+        c += 4;
+    }
+    if (*c != '"')
+    {
+        free(*value);
+        *value = NULL;
+        return NULL;
+    }
+    *out = '\0';
+    return c + 1;
+}
+
+/**
+ * @brief Reads the JSON number or literal (true, false, null) starting at @p c.
+ *
+ * @param c A position in a line.
+ * @param value Set to the text of the value (to be freed), or NULL if it is invalid.
+ * @return const char* The position after the value, or NULL if it is invalid.
+ */
+static const char *serve_parse_literal(const char *c, char **value)
+{
+    const char *end = c;
+    while (isalnum((unsigned char)*end) || *end == '-' || *end == '+' || *end == '.')
+        end++;
+    *value = NULL;
+    if (end == c)
+        return NULL;
+    char *text = strndup(c, end - c);
+    bool valid = strcmp(text, "true") == 0 || strcmp(text, "false") == 0 || strcmp(text, "null") == 0;
+    if (!valid && (isdigit((unsigned char)*text) || *text == '-'))
+    {
+        char *number_end;
+        strtod(text, &number_end);
+        valid = *number_end == '\0';
+    }
+    if (!valid)
+    {
+        free(text);
+        return NULL;
+    }
+    *value = text;
+    return end;
+}
+
+/**
+ * @brief Reads the integer @p value.
+ *
+ * @param value The text of a JSON number.
+ * @param result Set to the integer.
+ * @return bool false if @p value is not an integer.
+ */
+static bool serve_int_of_string(const char *value, int *result)
+{
+    char *end;
+    long number = strtol(value, &end, 10);
+    if (*end != '\0' || number < 0 || number > 1 << 20)
+        return false;
+    *result = (int)number;
+    return true;
+}
+
+/**
+ * @brief Puts the member @p key of a request in @p request.
+ *
+ * @param request The request.
+ * @param key The name of the member.
+ * @param value Its value, owned by @p request from now on.
+ * @param is_string true if @p value is a string, false if it is a number or a literal.
+ * @return const char* An error message, or NULL if the member is valid.
+ */
+static const char *serve_set_member(ServeRequest *request, const char *key, char *value, bool is_string)
+{
+    char **field = NULL;
+    bool *kind = NULL;
+    if (strcmp(key, "id") == 0)
+    {
+        field = &request->id;
+        kind = &request->id_is_string;
+        *kind = is_string;
+    }
+    else if (strcmp(key, "initial") == 0 || strcmp(key, "final") == 0)
+    {
+        bool initial = strcmp(key, "initial") == 0;
+        field = initial ? &request->initial : &request->final;
+        kind = initial ? &request->initial_is_index : &request->final_is_index;
+        *kind = !is_string;
+    }
+    else if (strcmp(key, "file") == 0 && is_string)
+        field = &request->file;
+    else if (strcmp(key, "file") == 0)
+    {
+        free(value);
+        return "\"file\" must be a string";
+    }
+    else if (strcmp(key, "bound") == 0)
+    {
+        bool valid = !is_string && serve_int_of_string(value, &request->bound) && request->bound >= 1;
+        free(value);
+        return valid ? NULL : "\"bound\" must be a positive integer";
+    }
+    else if (strcmp(key, "stop") == 0)
+    {
+        request->stop = !is_string && strcmp(value, "true") == 0;
+        free(value);
+        return NULL;
+    }
+    else
+    {
+        // Unknown members are ignored, so that clients can add their own.
+        free(value);
+        return NULL;
+    }
+    free(*field);
+    *field = value;
+    return NULL;
+}
+
+/**
+ * @brief Reads the request of @p line: a JSON object whose members are strings, numbers or literals.
+ *
+ * @param line A line.
+ * @param request Filled with the members of the request.
+ * @return const char* An error message, or NULL if the request is valid.
+ */
+static const char *serve_parse_request(const char *line, ServeRequest *request)
+{
+    const char *c = serve_skip_spaces(line);
+    if (*c != '{')
+        return "a request must be a JSON object";
+    c = serve_skip_spaces(c + 1);
+    while (*c != '}')
+    {
+        char *key;
+        if (*c != '"' || (c = serve_parse_string(c, &key)) == NULL)
+            return "invalid member name";
+        c = serve_skip_spaces(c);
+        if (*c != ':')
+        {
+            free(key);
+            return "missing ':' after a member name";
+        }
+        c = serve_skip_spaces(c + 1);
+        bool is_string = *c == '"';
+        char *value;
+        c = is_string ? serve_parse_string(c, &value) : serve_parse_literal(c, &value);
+        if (c == NULL)
+        {
+            free(key);
+            return "invalid value (only strings, numbers, true, false and null are accepted)";
+        }
+        const char *error = serve_set_member(request, key, value, is_string);
+        free(key);
+        if (error != NULL)
+            return error;
+        c = serve_skip_spaces(c);
+        if (*c == ',')
+            c = serve_skip_spaces(c + 1);
+        else if (*c != '}')
+            return "missing ',' or '}' after a member";
+    }
+    if (*serve_skip_spaces(c + 1) != '\0')
+        return "characters after the end of the request";
+    if (request->file == NULL && !request->stop)
+        return "missing \"file\"";
+    return NULL;
+}
+
+/**
+ * @brief Frees the members of @p request.
+ *
+ * @param request A request.
+ */
+static void serve_request_clear(ServeRequest *request)
+{
+    free(request->id);
+    free(request->file);
+    free(request->initial);
+    free(request->final);
+}
+
+// --- Cache ---
+
+/**
+ * @brief Deletes the routes, the context and the network of a cached network.
+ *
+ * @param entry A cached network.
+ */
+static void serve_network_delete(ServeNetwork *entry)
+{
+    for (int i = 0; i < entry->num_routes; i++)
+    {
+        ServeRoute *route = &entry->routes[i];
+        if (route->solver != NULL)
+            tn_incremental_delete(route->solver);
+        tn_delete(route->network);
+        free(route->path);
+    }
+    free(entry->routes);
+    Z3_del_context(entry->ctx);
+    tn_delete(entry->network);
+    graph_delete(entry->graph);
+}
+
+/**
+ * @brief Gets the cached network of the content of @p file, reading it (and dropping the least recently used network if the cache is full) if needed.
+ *
+ * @param cache The cache.
+ * @param file The file of a network, in dot format or written by tn_save_binary (with the .tnb extension).
+ * @param cached Set to true if the network was in the cache.
+ * @param error Set to an error message if @p file cannot be read or parsed.
+ * @return ServeNetwork* The cached network, or NULL if @p file cannot be read or parsed.
+ */
+static ServeNetwork *serve_get_network(ServeCache *cache, const char *file, bool *cached, const char **error)
+{
+    uint64_t hash;
+    if (access(file, R_OK) != 0 || !tn_hash_file(file, &hash))
+    {
+        *error = "the file cannot be read";
+        return NULL;
+    }
+    for (int i = 0; i < cache->num_networks; i++)
+        if (cache->networks[i].hash == hash)
+        {
+            *cached = true;
+            cache->networks[i].last_use = cache->num_requests;
+            return &cache->networks[i];
+        }
+
+    ServeNetwork entry = {.hash = hash, .routes = NULL, .num_routes = 0, .capacity = 0, .last_use = cache->num_requests};
+    size_t length = strlen(file);
+    if (length > 4 && strcmp(file + length - 4, ".tnb") == 0)
+    {
+        entry.network = tn_load_binary(file, NULL, &entry.graph);
+        if (entry.network == NULL)
+        {
+            *error = "the file is not a valid binary Tunnel network";
+            return NULL;
+        }
+    }
+    else
+    {
+        // The parser is given a copy: it does not take a const name.
+        char name[length + 1];
+        strcpy(name, file);
+        if (!try_get_graph_from_file(name, &entry.graph))
+        {
+            *error = "the file is not a valid graphviz file";
+            return NULL;
+        }
+        entry.network = tn_initialize(entry.graph);
+    }
+    entry.ctx = make_context();
+
+    int slot = cache->num_networks;
+    if (slot == cache->config->max_networks)
+    {
+        slot = 0;
+        for (int i = 1; i < cache->num_networks; i++)
+            if (cache->networks[i].last_use < cache->networks[slot].last_use)
+                slot = i;
+        serve_network_delete(&cache->networks[slot]);
+    }
+    else
+        cache->num_networks++;
+    cache->networks[slot] = entry;
+    *cached = false;
+    return &cache->networks[slot];
+}
+
+/**
+ * @brief Finds the node @p node of @p network.
+ *
+ * @param network A network.
+ * @param node The name or the index of a node.
+ * @param is_index true if @p node is an index.
+ * @param result Set to the node.
+ * @return bool false if @p network has no such node.
+ */
+static bool serve_find_node(TunnelNetwork network, const char *node, bool is_index, int *result)
+{
+    int num_nodes = tn_get_num_nodes(network);
+    if (is_index)
+        return serve_int_of_string(node, result) && *result < num_nodes;
+    for (int n = 0; n < num_nodes; n++)
+        if (strcmp(tn_get_node_name(network, n), node) == 0)
+        {
+            *result = n;
+            return true;
+        }
+    return false;
+}
+
+/**
+ * @brief Gets the route from @p initial to @p final of a cached network, creating it if needed.
+ *
+ * @param entry A cached network.
+ * @param initial The initial node.
+ * @param final The final node.
+ * @param cached Set to true if the route was already asked.
+ * @return ServeRoute* The route.
+ */
+static ServeRoute *serve_get_route(ServeNetwork *entry, int initial, int final, bool *cached)
+{
+    for (int i = 0; i < entry->num_routes; i++)
+        if (entry->routes[i].initial == initial && entry->routes[i].final == final)
+        {
+            *cached = true;
+            return &entry->routes[i];
+        }
+    if (entry->num_routes == entry->capacity)
+    {
+        entry->capacity = entry->capacity > 0 ? 2 * entry->capacity : 4;
+        entry->routes = (ServeRoute *)realloc(entry->routes, entry->capacity * sizeof(ServeRoute));
+    }
+
+    // The route has its own copy of the network: the encoding of the solver depends on the initial and final nodes.
+    int num_nodes = tn_get_num_nodes(entry->network);
+    int *actions = (int *)malloc((num_nodes > 0 ? num_nodes : 1) * sizeof(int));
+    for (int node = 0; node < num_nodes; node++)
+        actions[node] = tn_get_node_actions(entry->network, node);
+    ServeRoute *route = &entry->routes[entry->num_routes++];
+    route->initial = initial;
+    route->final = final;
+    route->network = tn_initialize_with_actions(*tn_get_graph(entry->network), initial, final, actions);
+    route->solver = NULL;
+    route->max_length = 0;
+    route->unsat_up_to = 0;
+    route->length = 0;
+    route->path = NULL;
+    free(actions);
+    *cached = false;
+    return route;
+}
+
+// --- Solving ---
+
+/**
+ * @brief Looks for the shortest path of size at most @p bound of @p route. Only the sizes not yet decided are checked, with the incremental solver of
+ *        the route (recreated if it cannot check sizes up to @p bound).
+ *
+ * @param entry The cached network of @p route.
+ * @param route A route.
+ * @param bound The largest size of path tried.
+ * @param min_length The smallest number of sizes a new solver is created for.
+ * @param checked Set to true if the solver was called.
+ * @return const char* "sat", "unsat" or "unknown".
+ */
+static const char *serve_solve(ServeNetwork *entry, ServeRoute *route, int bound, int min_length, bool *checked)
+{
+    if (route->length > 0)
+        return route->length <= bound ? "sat" : "unsat";
+    if (route->unsat_up_to >= bound)
+        return "unsat";
+
+    *checked = true;
+    if (route->solver != NULL && route->max_length < bound)
+    {
+        tn_incremental_delete(route->solver);
+        route->solver = NULL;
+    }
+    if (route->solver == NULL)
+    {
+        route->max_length = bound > min_length ? bound : min_length;
+        route->solver = tn_incremental_create(entry->ctx, route->network, route->max_length);
+    }
+    for (int l = route->unsat_up_to + 1; l <= bound; l++)
+    {
+        Z3_model model;
+        Z3_lbool result = tn_incremental_solve(route->solver, l, &model);
+        if (result == Z3_L_FALSE)
+        {
+            route->unsat_up_to = l;
+            continue;
+        }
+        if (result == Z3_L_UNDEF)
+            return "unknown";
+        route->path = (tn_step *)malloc(l * sizeof(tn_step));
+        tn_get_path_from_model(entry->ctx, model, route->network, l, route->path);
+        Z3_model_dec_ref(entry->ctx, model);
+        route->length = l;
+        // Every later request on the route is answered by the path: the solver is not needed anymore.
+        tn_incremental_delete(route->solver);
+        route->solver = NULL;
+        return "sat";
+    }
+    return "unsat";
+}
+
+// --- Results ---
+
+/**
+ * @brief Writes @p string as a JSON string.
+ *
+ * @param output The output.
+ * @param string A string.
+ */
+static void serve_print_json_string(FILE *output, const char *string)
+{
+    fputc('"', output);
+    for (const char *c = string; *c != '\0'; c++)
+    {
+        if (*c == '"' || *c == '\\')
+            fputc('\\', output);
+        if ((unsigned char)*c < 0x20)
+            fprintf(output, "\\u%04x", *c);
+        else
+            fputc(*c, output);
+    }
+    fputc('"', output);
+}
+
+/**
+ * @brief Writes the result line of a request.
+ *
+ * @param output The output.
+ * @param request The request.
+ * @param result "sat", "unsat", "unknown", "error" or "stopped".
+ * @param route The route of the request (NULL for an error).
+ * @param reused What was taken from the cache.
+ * @param time The time spent on the request, in seconds.
+ * @param error The error message (NULL if none).
+ */
+static void serve_print_result(FILE *output, const ServeRequest *request, const char *result, const ServeRoute *route, const char *reused, double time,
+                               const char *error)
+{
+    fprintf(output, "{\"id\": ");
+    if (request->id == NULL)
+        fprintf(output, "null");
+    else if (request->id_is_string)
+        serve_print_json_string(output, request->id);
+    else
+        fputs(request->id, output);
+    fprintf(output, ", \"file\": ");
+    if (request->file != NULL)
+        serve_print_json_string(output, request->file);
+    else
+        fprintf(output, "null");
+    fprintf(output, ", \"result\": \"%s\", \"bound\": %d, ", result, request->bound);
+    if (strcmp(result, "sat") == 0)
+    {
+        fprintf(output, "\"length\": %d, \"path\": [", route->length);
+        for (int i = 0; i < route->length; i++)
+        {
+            const tn_step *step = &route->path[i];
+            fprintf(output, "%s{\"source\": ", i > 0 ? ", " : "");
+            serve_print_json_string(output, tn_get_node_name(route->network, step->source));
+            fprintf(output, ", \"action\": \"%s\", \"target\": ", tn_string_of_stack_action(step->action));
+            serve_print_json_string(output, tn_get_node_name(route->network, step->target));
+            fprintf(output, "}");
+        }
+        fprintf(output, "]");
+    }
+    else
+        fprintf(output, "\"length\": null, \"path\": null");
+    fprintf(output, ", \"reused\": \"%s\", \"time\": %g", reused, time);
+    if (error != NULL)
+    {
+        fprintf(output, ", \"error\": ");
+        serve_print_json_string(output, error);
+    }
+    fprintf(output, "}\n");
+    fflush(output);
+}
+
+/**
+ * @brief Wall-clock time elapsed since @p start.
+ *
+ * @param start A time taken with clock_gettime(CLOCK_MONOTONIC, ...).
+ * @return double The time elapsed, in seconds.
+ */
+static double serve_seconds_since(struct timespec start)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (double)(now.tv_sec - start.tv_sec) + (double)(now.tv_nsec - start.tv_nsec) / 1e9;
+}
+
+/**
+ * @brief Answers the request of @p line.
+ *
+ * @param cache The cache.
+ * @param line A line holding a request.
+ * @param output Where the result is written.
+ */
+static void serve_request(ServeCache *cache, const char *line, FILE *output)
+{
+    struct timespec start;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    cache->num_requests++;
+
+    ServeRequest request = {NULL, false, NULL, cache->config->bound, NULL, false, NULL, false, false};
+    const char *error = serve_parse_request(line, &request);
+    const char *result = "error";
+    const char *reused = "none";
+    ServeRoute *route = NULL;
+    if (error == NULL && request.stop)
+    {
+        cache->stopped = true;
+        result = "stopped";
+    }
+    else if (error == NULL)
+    {
+        bool cached = false;
+        ServeNetwork *entry = serve_get_network(cache, request.file, &cached, &error);
+        if (entry != NULL)
+        {
+            if (cached)
+                reused = "network";
+            int initial = tn_get_initial(entry->network);
+            int final = tn_get_final(entry->network);
+            if (request.initial != NULL && !serve_find_node(entry->network, request.initial, request.initial_is_index, &initial))
+                error = "the network has no such initial node";
+            else if (request.final != NULL && !serve_find_node(entry->network, request.final, request.final_is_index, &final))
+                error = "the network has no such final node";
+            else
+            {
+                route = serve_get_route(entry, initial, final, &cached);
+                if (cached)
+                    reused = "solver";
+                bool checked = false;
+                result = serve_solve(entry, route, request.bound, cache->config->bound, &checked);
+                if (!checked)
+                    reused = "answer";
+            }
+        }
+    }
+    serve_print_result(output, &request, result, route, reused, serve_seconds_since(start), error);
+    serve_request_clear(&request);
+}
+
+/**
+ * @brief Answers every request of @p input until its end, or until a request stops the service. Blank lines are skipped.
+ *
+ * @param cache The cache.
+ * @param input Where the requests are read, one per line.
+ * @param output Where the results are written.
+ * @return int The number of requests answered.
+ */
+static int serve_stream(ServeCache *cache, FILE *input, FILE *output)
+{
+    char *line = NULL;
+    size_t capacity = 0;
+    int num_served = 0;
+    while (!cache->stopped && getline(&line, &capacity, input) != -1)
+    {
+        if (*serve_skip_spaces(line) == '\0')
+            continue;
+        serve_request(cache, line, output);
+        num_served++;
+    }
+    free(line);
+    return num_served;
+}
+
+/**
+ * @brief Serves the connections to the Unix socket @p path, one after the other, until a request stops the service.
+ *
+ * @param cache The cache.
+ * @param path The path of the socket (an existing file there is replaced).
+ * @return int The number of requests answered, or -1 if the socket could not be opened.
+ */
+static int serve_socket(ServeCache *cache, const char *path)
+{
+    struct sockaddr_un address;
+    memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    if (strlen(path) >= sizeof(address.sun_path))
+    {
+        printf("The socket path %s is too long.\n", path);
+        return -1;
+    }
+    strcpy(address.sun_path, path);
+    unlink(path);
+    int server = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (server < 0 || bind(server, (struct sockaddr *)&address, sizeof(address)) != 0 || listen(server, 16) != 0)
+    {
+        printf("Could not listen on the socket %s.\n", path);
+        if (server >= 0)
+            close(server);
+        return -1;
+    }
+    // A client leaving before reading its results must not end the service.
+    signal(SIGPIPE, SIG_IGN);
+    printf("Listening on %s.\n", path);
+    fflush(stdout);
+
+    int num_served = 0;
+    while (!cache->stopped)
+    {
+        int client = accept(server, NULL, NULL);
+        if (client < 0)
+            continue;
+        FILE *input = fdopen(client, "r");
+        FILE *output = fdopen(dup(client), "w");
+        num_served += serve_stream(cache, input, output);
+        fclose(output);
+        fclose(input);
+    }
+    close(server);
+    unlink(path);
+    return num_served;
+}
+
+int serve_run(const ServeConfig *config)
+{
+    ServeCache cache;
+    cache.config = config;
+    cache.networks = (ServeNetwork *)malloc(config->max_networks * sizeof(ServeNetwork));
+    cache.num_networks = 0;
+    cache.num_requests = 0;
+    cache.stopped = false;
+
+    int num_served;
+    if (config->socket != NULL)
+        num_served = serve_socket(&cache, config->socket);
+    else
+    {
+        // The results are the only output on the standard output: what the solvers print goes to the standard error.
+        fflush(stdout);
+        FILE *output = fdopen(dup(STDOUT_FILENO), "w");
+        dup2(STDERR_FILENO, STDOUT_FILENO);
+        num_served = serve_stream(&cache, stdin, output);
+        fclose(output);
+    }
+
+    for (int i = 0; i < cache.num_networks; i++)
+        serve_network_delete(&cache.networks[i]);
+    free(cache.networks);
+    return num_served;
+}
@@ -0,0 +1,154 @@
+#include "Statistics.h"
+#include "Z3Tools.h"
+#include "CnfTools.h"
+#include <stdlib.h>
+#include <string.h>
+
+/**
+ * @brief Where the statistics are written, NULL if they are disabled.
+ */
+static FILE *statistics_output = NULL;
+
+void set_statistics_output(FILE *output)
+{
+    statistics_output = output;
+}
+
+bool statistics_enabled(void)
+{
+    return statistics_output != NULL;
+}
+
+double statistics_lap(struct timespec *start)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    double elapsed = (double)(now.tv_sec - start->tv_sec) * 1e3 + (double)(now.tv_nsec - start->tv_nsec) / 1e6;
+    *start = now;
+    return elapsed;
+}
+
+/**
+ * @brief Counts the distinct AST nodes and the distinct variables of @p formula (a formula is a DAG: shared sub-formulae are counted once).
+ *
+ * @param ctx The solver context.
+ * @param formula A formula.
+ * @param num_variables Set to the number of variables.
+ * @return int The number of nodes.
+ */
+static int statistics_count_nodes(Z3_context ctx, Z3_ast formula, int *num_variables)
+{
+    AstIdSet visited = ast_id_set_create();
+    int capacity = 1024;
+    int size = 0;
+    Z3_ast *stack = (Z3_ast *)malloc(capacity * sizeof(Z3_ast));
+    stack[size++] = formula;
+    ast_id_set_add(visited, Z3_get_ast_id(ctx, formula));
+    *num_variables = 0;
+    while (size > 0)
+    {
+        Z3_ast ast = stack[--size];
+        if (!Z3_is_app(ctx, ast))
+            continue;
+        Z3_app app = Z3_to_app(ctx, ast);
+        unsigned num_args = Z3_get_app_num_args(ctx, app);
+        if (num_args == 0 && Z3_get_decl_kind(ctx, Z3_get_app_decl(ctx, app)) == Z3_OP_UNINTERPRETED)
+            (*num_variables)++;
+        for (unsigned i = 0; i < num_args; i++)
+        {
+            Z3_ast arg = Z3_get_app_arg(ctx, app, i);
+            if (!ast_id_set_add(visited, Z3_get_ast_id(ctx, arg)))
+                continue;
+            if (size == capacity)
+            {
+                capacity *= 2;
+                stack = (Z3_ast *)realloc(stack, capacity * sizeof(Z3_ast));
+            }
+            stack[size++] = arg;
+        }
+    }
+    int num_nodes = ast_id_set_size(visited);
+    free(stack);
+    ast_id_set_delete(visited);
+    return num_nodes;
+}
+
+/**
+ * @brief Writes the measures of one formula as the members of a JSON object.
+ *
+ * @param ctx The solver context.
+ * @param name The name of the formula.
+ * @param formula The formula.
+ * @param time Its build time, in milliseconds.
+ */
+static void statistics_print_part(Z3_context ctx, const char *name, Z3_ast formula, double time)
+{
+    int num_variables;
+    int num_nodes = statistics_count_nodes(ctx, formula, &num_variables);
+    int num_clauses = -1;
+    if (get_amo_encoding() != amo_native)
+    {
+        CnfFormula cnf = cnf_create(ctx);
+        cnf_add_formula(cnf, formula);
+        num_clauses = cnf_get_num_clauses(cnf);
+        cnf_delete(cnf);
+    }
+    fprintf(statistics_output, "{\"name\": \"%s\", \"ms\": %.3f, \"ast_nodes\": %d, \"variables\": %d, \"clauses\": %d}", name, time, num_nodes, num_variables,
+            num_clauses);
+}
+
+void statistics_print_formula(Z3_context ctx, const char *reduction, int bound, int num_parts, const char *const *names, const Z3_ast *parts, const double *times)
+{
+    if (statistics_output == NULL)
+        return;
+    // A whole line at once: the reductions may be built by several threads.
+    flockfile(statistics_output);
+    fprintf(statistics_output, "{\"reduction\": \"%s\", \"bound\": %d, \"parts\": [", reduction, bound);
+    double total_time = 0;
+    for (int part = 0; part < num_parts; part++)
+    {
+        if (part > 0)
+            fprintf(statistics_output, ", ");
+        statistics_print_part(ctx, names[part], parts[part], times[part]);
+        total_time += times[part];
+    }
+    fprintf(statistics_output, "], \"total\": ");
+    statistics_print_part(ctx, "total", Z3_mk_and(ctx, num_parts, parts), total_time);
+    fprintf(statistics_output, "}\n");
+    fflush(statistics_output);
+    funlockfile(statistics_output);
+}
+
+void statistics_print_solver(Z3_context ctx, Z3_solver solver, Z3_lbool result, double time)
+{
+    if (statistics_output == NULL)
+        return;
+    Z3_stats stats = Z3_solver_get_statistics(ctx, solver);
+    Z3_stats_inc_ref(ctx, stats);
+    // The names depend on the engine used by Z3 ("conflicts" or "sat conflicts", "sat propagations 2ary" and "sat propagations nary"...): they are summed.
+    unsigned long long conflicts = 0;
+    unsigned long long decisions = 0;
+    unsigned long long propagations = 0;
+    double memory = 0;
+    for (unsigned i = 0; i < Z3_stats_size(ctx, stats); i++)
+    {
+        const char *key = Z3_stats_get_key(ctx, stats, i);
+        if (!Z3_stats_is_uint(ctx, stats, i))
+        {
+            if (strcmp(key, "max memory") == 0)
+                memory = Z3_stats_get_double_value(ctx, stats, i);
+            continue;
+        }
+        unsigned value = Z3_stats_get_uint_value(ctx, stats, i);
+        if (strstr(key, "conflicts") != NULL)
+            conflicts += value;
+        else if (strstr(key, "decisions") != NULL)
+            decisions += value;
+        else if (strstr(key, "propagations") != NULL)
+            propagations += value;
+    }
+    Z3_stats_dec_ref(ctx, stats);
+    fprintf(statistics_output, "{\"solver\": \"z3\", \"result\": \"%s\", \"ms\": %.3f, \"conflicts\": %llu, \"decisions\": %llu, \"propagations\": %llu, \"max_memory_mb\": %.2f}\n",
+            result == Z3_L_TRUE ? "sat" : result == Z3_L_FALSE ? "unsat" : "unknown", time, conflicts, decisions, propagations, memory);
+    fflush(statistics_output);
+}
@@ -1,17 +1,166 @@
 
 #include "Z3Tools.h"
+#include "Statistics.h"
 #include <stdlib.h>
 #include <stdio.h>
 #include <stdbool.h>
+#include <string.h>
+#include <unistd.h>
+
+/**
+ * @brief The configuration of the solvers created by mk_solver.
+ */
+static solver_profile current_solver_profile = solver_default;
+
+/**
+ * @brief The number of threads of solver_parallel, 0 for the number of processors.
+ */
+static unsigned current_solver_threads = 0;
+
+/**
+ * @brief The time limit of each call to a solver, in milliseconds (0 for none).
+ */
+static unsigned current_solver_timeout = 0;
+
+/**
+ * @brief The memory limit of the SAT engine, in megabytes (0 for none).
+ */
+static unsigned current_solver_memory = 0;
+
+/**
+ * @brief The number of threads used by solver_parallel.
+ *
+ * @return unsigned current_solver_threads, or the number of processors if it is 0.
+ */
+static unsigned effective_solver_threads(void)
+{
+    if (current_solver_threads > 0)
+        return current_solver_threads;
+    long processors = sysconf(_SC_NPROCESSORS_ONLN);
+    return processors > 0 ? (unsigned)processors : 1;
+}
+
+/**
+ * @brief Sets the global parameters of Z3 needed by the current profile. They are global to every context, hence only changed by the setters, which are
+ *        called before any context is created.
+ */
+static void update_global_solver_params(void)
+{
+    bool parallel = current_solver_profile == solver_parallel;
+    char threads[16];
+    snprintf(threads, sizeof(threads), "%u", effective_solver_threads());
+    Z3_global_param_set("parallel.enable", parallel ? "true" : "false");
+    Z3_global_param_set("parallel.threads.max", threads);
+}
+
+void set_solver_profile(solver_profile profile)
+{
+    current_solver_profile = profile;
+    update_global_solver_params();
+}
+
+solver_profile get_solver_profile(void)
+{
+    return current_solver_profile;
+}
+
+bool solver_profile_of_string(const char *name, solver_profile *profile)
+{
+    const char *names[] = {"default", "sat", "preprocess", "parallel"};
+    for (int prof = solver_default; prof <= solver_parallel; prof++)
+    {
+        if (strcmp(name, names[prof]) == 0)
+        {
+            *profile = prof;
+            return true;
+        }
+    }
+    return false;
+}
+
+void set_solver_threads(unsigned threads)
+{
+    current_solver_threads = threads;
+    update_global_solver_params();
+}
+
+void set_solver_limits(unsigned timeout, unsigned memory)
+{
+    current_solver_timeout = timeout;
+    current_solver_memory = memory;
+}
 
 Z3_context make_context(void)
 {
     Z3_config config = Z3_mk_config();
+    if (current_solver_timeout > 0)
+    {
+        char timeout[16];
+        snprintf(timeout, sizeof(timeout), "%u", current_solver_timeout);
+        Z3_set_param_value(config, "timeout", timeout);
+    }
     Z3_context ctx = Z3_mk_context(config);
     Z3_del_config(config);
     return ctx;
 }
 
+/**
+ * @brief Creates the solver of the tactics of solver_preprocess.
+ *
+ * @param ctx The solver context.
+ * @return Z3_solver The solver.
+ */
+static Z3_solver mk_preprocessing_solver(Z3_context ctx)
+{
+    const char *names[] = {"simplify", "propagate-values", "solve-eqs", "elim-uncnstr", "simplify", "smt"};
+    int num_tactics = sizeof(names) / sizeof(names[0]);
+    Z3_tactic tactic = Z3_mk_tactic(ctx, names[num_tactics - 1]);
+    Z3_tactic_inc_ref(ctx, tactic);
+    for (int i = num_tactics - 2; i >= 0; i--)
+    {
+        Z3_tactic first = Z3_mk_tactic(ctx, names[i]);
+        Z3_tactic_inc_ref(ctx, first);
+        Z3_tactic both = Z3_tactic_and_then(ctx, first, tactic);
+        Z3_tactic_inc_ref(ctx, both);
+        Z3_tactic_dec_ref(ctx, first);
+        Z3_tactic_dec_ref(ctx, tactic);
+        tactic = both;
+    }
+    Z3_solver solver = Z3_mk_solver_from_tactic(ctx, tactic);
+    Z3_tactic_dec_ref(ctx, tactic);
+    return solver;
+}
+
+Z3_solver mk_solver(Z3_context ctx)
+{
+    Z3_solver solver;
+    switch (current_solver_profile)
+    {
+    case solver_sat:
+        solver = Z3_mk_solver_for_logic(ctx, Z3_mk_string_symbol(ctx, "QF_FD"));
+        break;
+    case solver_preprocess:
+        solver = mk_preprocessing_solver(ctx);
+        break;
+    default:
+        solver = Z3_mk_solver(ctx);
+        break;
+    }
+    Z3_solver_inc_ref(ctx, solver);
+
+    Z3_params params = Z3_mk_params(ctx);
+    Z3_params_inc_ref(ctx, params);
+    if (current_solver_timeout > 0)
+        Z3_params_set_uint(ctx, params, Z3_mk_string_symbol(ctx, "timeout"), current_solver_timeout);
+    if (current_solver_memory > 0)
+        Z3_params_set_uint(ctx, params, Z3_mk_string_symbol(ctx, "max_memory"), current_solver_memory);
+    if (current_solver_profile == solver_parallel)
+        Z3_params_set_uint(ctx, params, Z3_mk_string_symbol(ctx, "threads"), effective_solver_threads());
+    Z3_solver_set_params(ctx, solver, params);
+    Z3_params_dec_ref(ctx, params);
+    return solver;
+}
+
 Z3_ast mk_var(Z3_context ctx, const char *name, Z3_sort ty)
 {
     Z3_symbol s = Z3_mk_string_symbol(ctx, name);
@@ -24,57 +173,239 @@ Z3_ast mk_bool_var(Z3_context ctx, const char *name)
     return mk_var(ctx, name, ty);
 }
 
-int inner_at_most(Z3_context ctx, Z3_ast *formulae, int size, Z3_ast *result)
+Z3_ast mk_indexed_bool_var(Z3_context ctx, int index)
+{
+    Z3_symbol s = Z3_mk_int_symbol(ctx, index);
+    return Z3_mk_const(ctx, s, Z3_mk_bool_sort(ctx));
+}
+
+/**
+ * @brief The encoding used by at_most_formula and uniqueFormula.
+ */
+static amo_encoding current_amo_encoding = amo_auto;
+
+/**
+ * @brief Size up to which amo_auto uses the pairwise encoding (it is then no bigger than the linear ones and needs no auxiliary variable).
+ */
+#define AMO_AUTO_PAIRWISE_LIMIT 6
+
+/**
+ * @brief Size of the groups of the commander encoding.
+ */
+#define AMO_COMMANDER_GROUP 3
+
+void set_amo_encoding(amo_encoding encoding)
+{
+    current_amo_encoding = encoding;
+}
+
+amo_encoding get_amo_encoding(void)
 {
+    return current_amo_encoding;
+}
+
+bool amo_encoding_of_string(const char *name, amo_encoding *encoding)
+{
+    const char *names[] = {"auto", "pairwise", "sequential", "commander", "native"};
+    for (int enc = amo_auto; enc <= amo_native; enc++)
+    {
+        if (strcmp(name, names[enc]) == 0)
+        {
+            *encoding = enc;
+            return true;
+        }
+    }
+    return false;
+}
+
+/**
+ * @brief Creates a fresh auxiliary variable (never equal to a variable created by mk_bool_var).
+ *
+ * @param ctx The solver context.
+ * @param prefix A prefix for the name of the variable.
+ * @return Z3_ast The variable.
+ */
+static Z3_ast mk_fresh_bool_var(Z3_context ctx, const char *prefix)
+{
+    return Z3_mk_fresh_const(ctx, prefix, Z3_mk_bool_sort(ctx));
+}
+
+/**
+ * @brief Creates the clause ¬@p a ∨ ¬@p b.
+ *
+ * @param ctx The solver context.
+ * @param a A formula.
+ * @param b A formula.
+ * @return Z3_ast The clause.
+ */
+static Z3_ast mk_not_both(Z3_context ctx, Z3_ast a, Z3_ast b)
+{
+    Z3_ast subFor[2];
+    subFor[0] = Z3_mk_not(ctx, a);
+    subFor[1] = Z3_mk_not(ctx, b);
+    return Z3_mk_or(ctx, 2, subFor);
+}
+
+/**
+ * @brief Pairwise encoding: for each pair, not both are true.
+ *
+ * @param ctx The solver context.
+ * @param formulae The formulae.
+ * @param size The number of formulae.
+ * @return Z3_ast The obtained formula.
+ */
+static Z3_ast at_most_pairwise(Z3_context ctx, Z3_ast *formulae, int size)
+{
+    int num_pairs = size * (size - 1) / 2;
+    Z3_ast *result = (Z3_ast *)malloc((num_pairs + 1) * sizeof(Z3_ast));
     int count = 0;
     for (int i = 0; i < size; i++)
     {
         for (int j = i + 1; j < size; j++)
         {
-            Z3_ast subFor[2];
-            subFor[0] = Z3_mk_not(ctx, formulae[i]);
-            subFor[1] = Z3_mk_not(ctx, formulae[j]);
-            result[count] = Z3_mk_or(ctx, 2, subFor);
+            result[count] = mk_not_both(ctx, formulae[i], formulae[j]);
             count++;
         }
     }
-    return count;
+    Z3_ast res = Z3_mk_and(ctx, count, result);
+    free(result);
+    return res;
+}
+
+/**
+ * @brief Sequential counter encoding: s_i is true if one of the i+1 first formulae is true, and a formula cannot be true if one before it is.
+ *
+ * @param ctx The solver context.
+ * @param formulae The formulae.
+ * @param size The number of formulae.
+ * @return Z3_ast The obtained formula.
+ * @pre @p size >= 2.
+ */
+static Z3_ast at_most_sequential(Z3_context ctx, Z3_ast *formulae, int size)
+{
+    Z3_ast *result = (Z3_ast *)malloc(3 * size * sizeof(Z3_ast));
+    int count = 0;
+    Z3_ast previous = mk_fresh_bool_var(ctx, "amo_seq");
+    result[count++] = Z3_mk_implies(ctx, formulae[0], previous);
+    for (int i = 1; i < size - 1; i++)
+    {
+        Z3_ast current = mk_fresh_bool_var(ctx, "amo_seq");
+        result[count++] = Z3_mk_implies(ctx, formulae[i], current);
+        result[count++] = Z3_mk_implies(ctx, previous, current);
+        result[count++] = mk_not_both(ctx, formulae[i], previous);
+        previous = current;
+    }
+    result[count++] = mk_not_both(ctx, formulae[size - 1], previous);
+    Z3_ast res = Z3_mk_and(ctx, count, result);
+    free(result);
+    return res;
+}
+
+/**
+ * @brief Commander encoding: formulae are split in groups with at most one true formula each, every true formula sets its group commander,
+ * and at most one commander is true (recursively).
+ *
+ * @param ctx The solver context.
+ * @param formulae The formulae.
+ * @param size The number of formulae.
+ * @return Z3_ast The obtained formula.
+ */
+static Z3_ast at_most_commander(Z3_context ctx, Z3_ast *formulae, int size)
+{
+    if (size <= AMO_COMMANDER_GROUP + 1)
+        return at_most_pairwise(ctx, formulae, size);
+    int num_groups = (size + AMO_COMMANDER_GROUP - 1) / AMO_COMMANDER_GROUP;
+    Z3_ast *commanders = (Z3_ast *)malloc(num_groups * sizeof(Z3_ast));
+    Z3_ast *result = (Z3_ast *)malloc((size + num_groups + 1) * sizeof(Z3_ast));
+    int count = 0;
+    for (int group = 0; group < num_groups; group++)
+    {
+        int first = group * AMO_COMMANDER_GROUP;
+        int group_size = size - first < AMO_COMMANDER_GROUP ? size - first : AMO_COMMANDER_GROUP;
+        commanders[group] = mk_fresh_bool_var(ctx, "amo_cmd");
+        for (int i = first; i < first + group_size; i++)
+            result[count++] = Z3_mk_implies(ctx, formulae[i], commanders[group]);
+        result[count++] = at_most_pairwise(ctx, formulae + first, group_size);
+    }
+    result[count++] = at_most_commander(ctx, commanders, num_groups);
+    Z3_ast res = Z3_mk_and(ctx, count, result);
+    free(result);
+    free(commanders);
+    return res;
+}
+
+/**
+ * @brief Resolves amo_auto into an actual encoding depending on @p size.
+ *
+ * @param size The number of formulae.
+ * @return amo_encoding The encoding to use.
+ */
+static amo_encoding effective_amo_encoding(int size)
+{
+    if (current_amo_encoding != amo_auto)
+        return current_amo_encoding;
+    if (size <= AMO_AUTO_PAIRWISE_LIMIT)
+        return amo_pairwise;
+    return amo_sequential;
 }
 
 Z3_ast at_most_formula(Z3_context ctx, Z3_ast *formulae, int size)
 {
-    Z3_ast result[size * size];
-    int count = inner_at_most(ctx, formulae, size, result);
-    return Z3_mk_and(ctx, count, result);
+    if (size <= 1)
+        return Z3_mk_true(ctx);
+    switch (effective_amo_encoding(size))
+    {
+    case amo_sequential:
+        return at_most_sequential(ctx, formulae, size);
+    case amo_commander:
+        return at_most_commander(ctx, formulae, size);
+    case amo_native:
+        return Z3_mk_atmost(ctx, size, formulae, 1);
+    default:
+        return at_most_pairwise(ctx, formulae, size);
+    }
 }
 
 Z3_ast uniqueFormula(Z3_context ctx, Z3_ast *formulae, int size)
 {
-    Z3_ast result[size * size];
+    if (effective_amo_encoding(size) == amo_native && size > 0)
+    {
+        int *coeffs = (int *)malloc(size * sizeof(int));
+        for (int i = 0; i < size; i++)
+            coeffs[i] = 1;
+        Z3_ast res = Z3_mk_pbeq(ctx, size, formulae, coeffs, 1);
+        free(coeffs);
+        return res;
+    }
+    Z3_ast result[2];
     result[0] = Z3_mk_or(ctx, size, formulae);
-    int count = inner_at_most(ctx, formulae, size, result + 1);
-    return Z3_mk_and(ctx, count + 1, result);
+    result[1] = at_most_formula(ctx, formulae, size);
+    return Z3_mk_and(ctx, 2, result);
 }
 
 Z3_lbool is_formula_sat(Z3_context ctx, Z3_ast formula)
 {
-    Z3_solver s = Z3_mk_solver(ctx);
-    Z3_solver_inc_ref(ctx, s);
+    Z3_solver s = mk_solver(ctx);
     Z3_solver_assert(ctx, s, formula);
 
+    struct timespec start;
+    clock_gettime(CLOCK_MONOTONIC, &start);
     Z3_lbool result = Z3_solver_check(ctx, s);
+    statistics_print_solver(ctx, s, result, statistics_lap(&start));
     Z3_solver_dec_ref(ctx, s);
     return result;
 }
 
 Z3_model get_model_from_sat_formula(Z3_context ctx, Z3_ast formula)
 {
-    Z3_solver s = Z3_mk_solver(ctx);
-    Z3_solver_inc_ref(ctx, s);
+    Z3_solver s = mk_solver(ctx);
     Z3_solver_assert(ctx, s, formula);
 
     Z3_model m = 0;
+    struct timespec start;
+    clock_gettime(CLOCK_MONOTONIC, &start);
     Z3_lbool result = Z3_solver_check(ctx, s);
+    statistics_print_solver(ctx, s, result, statistics_lap(&start));
 
     switch (result)
     {
@@ -96,13 +427,21 @@ Z3_model get_model_from_sat_formula(Z3_context ctx, Z3_ast formula)
     return m;
 }
 
-Z3_lbool solve_formula(Z3_context ctx, Z3_ast formula, Z3_model *model)
+Z3_lbool check_formula(Z3_context ctx, Z3_solver solver, Z3_ast formula)
 {
-    Z3_solver s = Z3_mk_solver(ctx);
-    Z3_solver_inc_ref(ctx, s);
-    Z3_solver_assert(ctx, s, formula);
+    Z3_solver_assert(ctx, solver, formula);
 
-    Z3_lbool result = Z3_solver_check(ctx, s);
+    struct timespec start;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    Z3_lbool result = Z3_solver_check(ctx, solver);
+    statistics_print_solver(ctx, solver, result, statistics_lap(&start));
+    return result;
+}
+
+Z3_lbool solve_formula(Z3_context ctx, Z3_ast formula, Z3_model *model)
+{
+    Z3_solver s = mk_solver(ctx);
+    Z3_lbool result = check_formula(ctx, s, formula);
 
     switch (result)
     {
@@ -140,3 +479,222 @@ bool value_of_var_in_model(Z3_context ctx, Z3_model model, Z3_ast variable)
     fprintf(stderr, "Error: Used on a non-boolean formula, or other unknown error\n");
     exit(1);
 }
+
+int *true_indexed_vars_in_model(Z3_context ctx, Z3_model model, int *num_true)
+{
+    unsigned num_consts = Z3_model_get_num_consts(ctx, model);
+    int *indices = (int *)malloc((num_consts + 1) * sizeof(int));
+    Z3_ast true_ast = Z3_mk_true(ctx);
+    *num_true = 0;
+    for (unsigned i = 0; i < num_consts; i++)
+    {
+        Z3_func_decl decl = Z3_model_get_const_decl(ctx, model, i);
+        Z3_symbol name = Z3_get_decl_name(ctx, decl);
+        if (Z3_get_symbol_kind(ctx, name) != Z3_INT_SYMBOL)
+            continue;
+        if (Z3_model_get_const_interp(ctx, model, decl) == true_ast)
+            indices[(*num_true)++] = Z3_get_symbol_int(ctx, name);
+    }
+    return indices;
+}
+
+struct AstIdSet_s
+{
+    unsigned *slots;   ///< Open addressing, an id being stored plus one so that 0 marks an empty slot.
+    unsigned capacity; ///< A power of two.
+    unsigned size;
+};
+
+AstIdSet ast_id_set_create(void)
+{
+    AstIdSet set = (AstIdSet)malloc(sizeof(*set));
+    set->capacity = 1024;
+    set->size = 0;
+    set->slots = (unsigned *)calloc(set->capacity, sizeof(unsigned));
+    return set;
+}
+
+/**
+ * @brief Inserts @p id in @p slots, which has room for it.
+ *
+ * @param slots The slots of a set.
+ * @param capacity The number of slots (a power of two).
+ * @param id An AST id.
+ * @return bool false if @p id was already there.
+ */
+static bool ast_id_set_insert(unsigned *slots, unsigned capacity, unsigned id)
+{
+    unsigned slot = (id * 2654435761u) & (capacity - 1);
+    while (slots[slot] != 0)
+    {
+        if (slots[slot] == id + 1)
+            return false;
+        slot = (slot + 1) & (capacity - 1);
+    }
+    slots[slot] = id + 1;
+    return true;
+}
+
+bool ast_id_set_add(AstIdSet set, unsigned id)
+{
+    if (2 * (set->size + 1) > set->capacity)
+    {
+        unsigned *slots = (unsigned *)calloc(2 * set->capacity, sizeof(unsigned));
+        for (unsigned i = 0; i < set->capacity; i++)
+            if (set->slots[i] != 0)
+                ast_id_set_insert(slots, 2 * set->capacity, set->slots[i] - 1);
+        free(set->slots);
+        set->slots = slots;
+        set->capacity *= 2;
+    }
+    if (!ast_id_set_insert(set->slots, set->capacity, id))
+        return false;
+    set->size++;
+    return true;
+}
+
+int ast_id_set_size(AstIdSet set)
+{
+    return (int)set->size;
+}
+
+void ast_id_set_delete(AstIdSet set)
+{
+    free(set->slots);
+    free(set);
+}
+
+/**
+ * @brief Tells if @p ast is written inline (a constant, a variable, or a conjunction or disjunction of nothing) rather than by a definition.
+ *
+ * @param ctx The solver context.
+ * @param ast A formula.
+ * @return bool
+ */
+static bool smt2_is_leaf(Z3_context ctx, Z3_ast ast)
+{
+    return Z3_get_app_num_args(ctx, Z3_to_app(ctx, ast)) == 0;
+}
+
+/**
+ * @brief Writes the SMT-LIB name of @p ast: true or false (also for an empty conjunction or disjunction), the name of a variable (quoted, so that any name is valid), or the name of its definition.
+ *
+ * @param ctx The solver context.
+ * @param ast A formula.
+ * @param file A file open for writing.
+ */
+static void smt2_write_name(Z3_context ctx, Z3_ast ast, FILE *file)
+{
+    if (!smt2_is_leaf(ctx, ast))
+    {
+        fprintf(file, "t%u", Z3_get_ast_id(ctx, ast));
+        return;
+    }
+    Z3_func_decl decl = Z3_get_app_decl(ctx, Z3_to_app(ctx, ast));
+    Z3_decl_kind kind = Z3_get_decl_kind(ctx, decl);
+    if (kind == Z3_OP_TRUE || kind == Z3_OP_AND)
+    {
+        fprintf(file, "true");
+        return;
+    }
+    if (kind == Z3_OP_FALSE || kind == Z3_OP_OR)
+    {
+        fprintf(file, "false");
+        return;
+    }
+    Z3_symbol symbol = Z3_get_decl_name(ctx, decl);
+    if (Z3_get_symbol_kind(ctx, symbol) == Z3_INT_SYMBOL)
+        fprintf(file, "|#%d|", Z3_get_symbol_int(ctx, symbol));
+    else
+        fprintf(file, "|%s|", Z3_get_symbol_string(ctx, symbol));
+}
+
+/**
+ * @brief Writes the definition of the connective @p ast, whose arguments are already written.
+ *
+ * @param ctx The solver context.
+ * @param ast A formula which is not a leaf.
+ * @param file A file open for writing.
+ */
+static void smt2_write_definition(Z3_context ctx, Z3_ast ast, FILE *file)
+{
+    Z3_app app = Z3_to_app(ctx, ast);
+    Z3_func_decl decl = Z3_get_app_decl(ctx, app);
+    fprintf(file, "(define-fun t%u () Bool (", Z3_get_ast_id(ctx, ast));
+    // The indexed connectives (pseudo-boolean constraints) keep their parameters: (_ at-most 1), (_ pbeq 1 1 1).
+    unsigned num_parameters = Z3_get_decl_num_parameters(ctx, decl);
+    if (num_parameters > 0)
+        fprintf(file, "(_ ");
+    fprintf(file, "%s", Z3_get_symbol_string(ctx, Z3_get_decl_name(ctx, decl)));
+    for (unsigned i = 0; i < num_parameters; i++)
+        if (Z3_get_decl_parameter_kind(ctx, decl, i) == Z3_PARAMETER_INT)
+            fprintf(file, " %d", Z3_get_decl_int_parameter(ctx, decl, i));
+    if (num_parameters > 0)
+        fprintf(file, ")");
+    unsigned num_args = Z3_get_app_num_args(ctx, app);
+    for (unsigned i = 0; i < num_args; i++)
+    {
+        fprintf(file, " ");
+        smt2_write_name(ctx, Z3_get_app_arg(ctx, app, i), file);
+    }
+    fprintf(file, "))\n");
+}
+
+/**
+ * @brief A node of the formula being traversed, and the next of its arguments to traverse.
+ *
+ */
+typedef struct
+{
+    Z3_ast ast;
+    unsigned next_arg;
+} Smt2Frame;
+
+void write_formula_smt2(Z3_context ctx, Z3_ast formula, FILE *file)
+{
+    AstIdSet visited = ast_id_set_create();
+    int capacity = 1024;
+    int size = 0;
+    Smt2Frame *stack = (Smt2Frame *)malloc(capacity * sizeof(Smt2Frame));
+    stack[size++] = (Smt2Frame){formula, 0};
+    ast_id_set_add(visited, Z3_get_ast_id(ctx, formula));
+
+    // Depth-first traversal without recursion (the formulae can be very deep): a node is written once all its arguments are.
+    while (size > 0)
+    {
+        Smt2Frame *top = &stack[size - 1];
+        if (smt2_is_leaf(ctx, top->ast))
+        {
+            if (Z3_get_decl_kind(ctx, Z3_get_app_decl(ctx, Z3_to_app(ctx, top->ast))) == Z3_OP_UNINTERPRETED)
+            {
+                fprintf(file, "(declare-const ");
+                smt2_write_name(ctx, top->ast, file);
+                fprintf(file, " Bool)\n");
+            }
+            size--;
+            continue;
+        }
+        Z3_app app = Z3_to_app(ctx, top->ast);
+        if (top->next_arg == Z3_get_app_num_args(ctx, app))
+        {
+            smt2_write_definition(ctx, top->ast, file);
+            size--;
+            continue;
+        }
+        Z3_ast arg = Z3_get_app_arg(ctx, app, top->next_arg++);
+        if (!ast_id_set_add(visited, Z3_get_ast_id(ctx, arg)))
+            continue;
+        if (size == capacity)
+        {
+            capacity *= 2;
+            stack = (Smt2Frame *)realloc(stack, capacity * sizeof(Smt2Frame));
+        }
+        stack[size++] = (Smt2Frame){arg, 0};
+    }
+    free(stack);
+    ast_id_set_delete(visited);
+
+    fprintf(file, "(assert ");
+    smt2_write_name(ctx, formula, file);
+    fprintf(file, ")\n(check-sat)\n");
+}
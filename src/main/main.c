@@ -12,6 +12,11 @@
 #include "Graph.h"
 #include "Parsing.h"
 #include "Z3Tools.h"
+#include "CnfTools.h"
+#include "Portfolio.h"
+#include "Batch.h"
+#include "Serve.h"
+#include "Statistics.h"
 #include "Parser.h"
 #ifdef REPARTITION
 #include "RepartitionGraph.h"
@@ -32,12 +37,16 @@
 #include "TunnelNetwork.h"
 #include "TunnelBF.h"
 #include "TunnelReduction.h"
+#include "TunnelIncremental.h"
+#include "TunnelParallel.h"
+#include "TunnelBinary.h"
 #endif
 #include <stdio.h>
 #include <stdlib.h>
 #include <time.h>
 #include <string.h>
 #include <unistd.h>
+#include <getopt.h>
 #include <sys/types.h>
 #include <sys/stat.h>
 
@@ -76,7 +85,7 @@ void usage()
     printf(". If not present or given another string, defaults to Tunnel Problem.\n");
     printf(" -c VAL     Fixes the value associated with the problem if some value is expected in the problem.");
 #ifdef COLOURING
-    printf(" Colouring interprets this as the number of colours for the colouring, and defaults to 3 if absent or not a number.");
+    printf(" Colouring interprets this as the number of colours for the colouring, and defaults to 3 if absent or not a number. With \"auto\", Colouring computes the chromatic number instead (not with --portfolio nor --batch).");
 #endif
 #ifdef REPARTITION
     printf(" Repartition expects no value and will ignore this option.");
@@ -91,17 +100,529 @@ void usage()
     printf(" -v         Activate verbose mode (displays parsed graphs)\n");
     printf(" -B         Solves the problem using the brute force algorithm\n");
     printf(" -R         Solves the problem using a reduction\n");
+#if defined(COLOURING) || defined(TUNNEL)
+    printf(" --portfolio Only for Colouring and Tunnel: runs the brute force and the reduction (with Z3) on two threads, reports the answer of the first one to finish and cancels the other one.\n");
+    printf(" --batch    Only for Colouring and Tunnel: solves the problem with its reduction on every input (files, directories containing .dot files, or @FILE for a file listing one input per line), with the number of threads given by -j, and writes one result line per input (see --format). Other outputs are disabled.\n");
+    printf(" --format FMT Format of the results of --batch: \"csv\" (default) or \"jsonl\".\n");
+#endif
+#ifdef COLOURING
+    printf(" --symmetry Only for Colouring with a reduction: adds symmetry-breaking constraints (the nodes of a clique get fixed colours, and the other colours appear in order).\n");
+#endif
+#ifdef TUNNEL
+    printf(" -I         Only for Tunnel with -R: uses a single incremental solver for every size instead of computing a new formula for each size (-F is then ignored).\n");
+    printf(" --search STRATEGY Only for Tunnel with -R: order in which the sizes are tried to find the shortest path. Valid options are \"linear\" (default: every size from 1), \"exponential\" (paths of size at most 1, 2, 4... then a binary search) and \"descending\" (paths of size at most the bound, then shorter than the last path found). The last two use the incremental solver (as -I) and a logarithmic number of calls to it.\n");
+    printf(" --stack ENC Only for Tunnel with -R: encoding of the stack cells. Valid options are \"pair\" (default: a variable for 4 and a variable for 6 in each cell, exactly one of them true) and \"compact\" (a single variable per cell, true for 6 and false for 4).\n");
+    printf(" --cubes    Only for Tunnel with -R: only decides the size given by -c, by cube and conquer: the paths are split by their state at the middle position, and the cubes are solved on the number of threads given by -j, each thread with its own Z3 context, until one of them has a path (-I, -F, -M and -S are then ignored).\n");
+    printf(" --serve    Only for Tunnel: answers requests read as JSON Lines on the standard input (or on the socket given by --socket) and writes one JSON result line per request, without input files. A request gives the \"file\" of a network, and optionally a \"bound\" (default: the one of -c), an \"initial\" and a \"final\" node (names, or indices) instead of those of the file, and an \"id\" copied into the result; {\"stop\": true} ends the service. The networks are kept parsed (by the hash of their content), with one incremental solver per pair of initial and final nodes, so that repeated queries only check the sizes not decided yet.\n");
+    printf(" --socket PATH Only with --serve: listens on the Unix socket PATH instead of the standard input, and serves its connections one after the other.\n");
+    printf(" --pairs LIST Only for Tunnel with -B or -R: solves the problem for each pair of the comma-separated list of INITIAL:FINAL node names instead of the initial and final nodes of the file, where * stands for every node (e.g. \"s:*\" for all the pairs from s), and the pairs of a node with itself are left out. The brute force explores the paths from each initial node once for all its final nodes, and the reduction uses a single incremental solver for every pair, sharing all the constraints except the initial and final ones (--portfolio, -I, -j, --search and --cubes are then ignored).\n");
+    printf(" --cache    Only for Tunnel: keeps the parsed network of the input FILE in the binary file FILE.tnb, written on the first run and loaded (without parsing) by the next ones as long as FILE does not change. An input whose name ends with .tnb is always loaded as such a binary file.\n");
+    printf(" -j NUM     Number of threads. With --batch: number of inputs solved at the same time. Otherwise, only for Tunnel with -R (without -I): solves the sizes from 1 to the bound on NUM threads at the same time, each with its own Z3 context, and keeps the smallest size having a path (-F, -M and -S are then ignored).\n");
+#endif
+    printf(" --stats    Writes, as one JSON object per line, the build time, the number of AST nodes, of variables and of clauses of each part of the formulae of the reductions, and the statistics of Z3 (conflicts, decisions, propagations, memory) after each call to it. Ignored by --batch and --serve.\n");
+    printf(" -A ENC     Selects the encoding of the \"at most one\" constraints of the reductions. Valid options are \"auto\" (default: pairwise for small sets, sequential otherwise), \"pairwise\", \"sequential\", \"commander\" and \"native\" (pseudo-boolean constraints of Z3).\n");
+    printf(" --profile NAME Selects the configuration of Z3. Valid options are \"default\" (the general solver), \"sat\" (the solver for finite domains, which goes straight to the SAT engine), \"preprocess\" (simplifications of the formula before solving it) and \"parallel\" (the parallel engines of Z3, on the number of threads given by --solver-threads).\n");
+    printf(" --solver-threads NUM Number of threads of the \"parallel\" profile [if not present: the number of processors].\n");
+    printf(" --timeout MS Time limit of each call to Z3, in milliseconds: past it, the call ends unable to decide (so that --batch cannot get stuck on one input).\n");
+    printf(" --memory MB Memory limit of the SAT engine of Z3 for each call, in megabytes: past it, the call ends unable to decide.\n");
+    printf(" -S SOLVER  Selects the SAT solver used by the reduction: \"z3\" (default), or the command of an external DIMACS solver (e.g. \"cadical\", \"kissat\", \"glucose -model\"), called with the DIMACS file as last argument and expected to answer in the SAT competition format. Not used with -I.\n");
     printf(" -F         Displays the formula computed ");
 #ifdef SUBJECT
     printf("(obviously not in this version)");
 #endif
-    printf(". Only active if -R is active. Writes it in a file in the folder 'sol' (see option -o)\n");
+    printf(". Only active if -R is active. Writes it in SMT-LIB 2 format (each shared sub-formula defined once) in a .smt2 file in the folder 'sol' (see option -o), and its clauses in DIMACS format in a .cnf file if -S selects an external solver\n");
     printf(" -M         Displays the model of the satisfied formula, to help understanding why it is true, especially when there are variables not representing a part of the solution.\n");
     printf(" -t         Displays the solution found [if not present, only displays the existence of the solution].\n");
     printf(" -f         Writes the result with colors in a .dot file. See next option for the name. These files will be produced in the folder 'sol'.\n");
-    printf(" -o NAME    Writes the output graph in \"NAME_Brute.dot\" or \"NAME_SAT.dot\" depending of the algorithm used and the formula in \"NAME.formula\". [if not present: \"default_SAT.dot\", \"default_Brute.dot\" and \"default.formula\"]\n");
+    printf(" -o NAME    Writes the output graph in \"NAME_Brute.dot\" or \"NAME_SAT.dot\" depending of the algorithm used and the formula in \"NAME.smt2\". [if not present: \"default_SAT.dot\", \"default_Brute.dot\" and \"default.smt2\"]\n");
+}
+
+/**
+ * @brief Writes @p formula in SMT-LIB 2 format in the file @p nameFile, through a large buffer.
+ *
+ * @param ctx The solver context.
+ * @param formula A formula.
+ * @param nameFile The name of the file.
+ */
+void write_formula_file(Z3_context ctx, Z3_ast formula, const char *nameFile)
+{
+    FILE *file = fopen(nameFile, "w");
+    setvbuf(file, NULL, _IOFBF, 1 << 20);
+    write_formula_smt2(ctx, formula, file);
+    fclose(file);
+}
+
+/**
+ * @brief Writes the clauses of @p formula in DIMACS format in the file @p nameFile.
+ *
+ * @param ctx The solver context.
+ * @param formula A propositional formula.
+ * @param nameFile The name of the file.
+ */
+void write_dimacs_file(Z3_context ctx, Z3_ast formula, const char *nameFile)
+{
+    CnfFormula cnf = cnf_create(ctx);
+    cnf_add_formula(cnf, formula);
+    FILE *file = fopen(nameFile, "w");
+    cnf_write_dimacs(cnf, file);
+    fclose(file);
+    printf("Clauses (%d variables, %d clauses) printed in %s\n", cnf_get_num_vars(cnf), cnf_get_num_clauses(cnf), nameFile);
+    cnf_delete(cnf);
+}
+
+/**
+ * @brief Codes of the options that only have a long name.
+ *
+ */
+enum longOption
+{
+    OptPortfolio = 256,
+    OptBatch,
+    OptFormat,
+    OptCache,
+    OptSearch,
+    OptSymmetry,
+    OptStats,
+    OptStack,
+    OptProfile,
+    OptTimeout,
+    OptMemory,
+    OptSolverThreads,
+    OptCubes,
+    OptServe,
+    OptSocket,
+    OptPairs
+};
+
+/**
+ * @brief Long options of the program.
+ *
+ */
+static const struct option long_options[] = {
+    {"portfolio", no_argument, NULL, OptPortfolio},
+    {"batch", no_argument, NULL, OptBatch},
+    {"format", required_argument, NULL, OptFormat},
+    {"cache", no_argument, NULL, OptCache},
+    {"search", required_argument, NULL, OptSearch},
+    {"symmetry", no_argument, NULL, OptSymmetry},
+    {"stats", no_argument, NULL, OptStats},
+    {"stack", required_argument, NULL, OptStack},
+    {"profile", required_argument, NULL, OptProfile},
+    {"timeout", required_argument, NULL, OptTimeout},
+    {"memory", required_argument, NULL, OptMemory},
+    {"solver-threads", required_argument, NULL, OptSolverThreads},
+    {"cubes", no_argument, NULL, OptCubes},
+    {"serve", no_argument, NULL, OptServe},
+    {"socket", required_argument, NULL, OptSocket},
+    {"pairs", required_argument, NULL, OptPairs},
+    {NULL, 0, NULL, 0}};
+
+/**
+ * @brief Wall-clock time elapsed since @p start (the processor time given by clock() counts every thread).
+ *
+ * @param start A time taken with clock_gettime(CLOCK_MONOTONIC, ...).
+ * @return double The time elapsed, in seconds.
+ */
+double seconds_since(struct timespec start)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (double)(now.tv_sec - start.tv_sec) + (double)(now.tv_nsec - start.tv_nsec) / 1e9;
+}
+
+#ifdef TUNNEL
+/**
+ * @brief Gets the network of the input @p file through its binary cache: a file ending with .tnb is loaded directly, and for another one,
+ *        the cache FILE.tnb is loaded if it was written from the current content of @p file, and (re)written otherwise.
+ *
+ * @param file The name of the input.
+ * @param cache true if the cache of a .dot input is used.
+ * @param graph Set to the graph supporting the network.
+ * @param verbose Tells where the network comes from.
+ * @return TunnelNetwork The network, or NULL if @p file must simply be parsed.
+ */
+TunnelNetwork tn_load_input(char *file, bool cache, Graph *graph, bool verbose)
+{
+    size_t length = strlen(file);
+    if (length > 4 && strcmp(file + length - 4, ".tnb") == 0)
+    {
+        TunnelNetwork network = tn_load_binary(file, NULL, graph);
+        if (network == NULL)
+        {
+            printf("file %s is not a valid binary Tunnel network. Exiting.\n", file);
+            exit(-1);
+        }
+        return network;
+    }
+    uint64_t hash;
+    if (!cache || !tn_hash_file(file, &hash))
+        return NULL;
+
+    char cacheName[length + 5];
+    snprintf(cacheName, length + 5, "%s.tnb", file);
+    TunnelNetwork network = tn_load_binary(cacheName, &hash, graph);
+    if (network != NULL)
+    {
+        if (verbose)
+            printf("Network loaded from the cache %s.\n", cacheName);
+        return network;
+    }
+    *graph = get_graph_from_file(file);
+    network = tn_initialize(*graph);
+    if (!tn_save_binary(network, hash, cacheName))
+        printf("Warning: could not write the cache %s.\n", cacheName);
+    else if (verbose)
+        printf("Network saved in the cache %s.\n", cacheName);
+    return network;
+}
+#endif
+
+#ifdef TUNNEL
+/**
+ * @brief Finds the node named @p name in @p network.
+ *
+ * @param network A network.
+ * @param name A node name.
+ * @return int The node, or -1 if there is none.
+ */
+int tn_find_node(TunnelNetwork network, const char *name)
+{
+    for (int node = 0; node < tn_get_num_nodes(network); node++)
+        if (strcmp(tn_get_node_name(network, node), name) == 0)
+            return node;
+    return -1;
 }
 
+/**
+ * @brief Reads the pairs of --pairs: a comma-separated list of INITIAL:FINAL node names, where * stands for every node. The pairs whose initial and final
+ *        nodes are the same are left out (a path never goes twice through the same state).
+ *
+ * @param network The network.
+ * @param list The list (it is cut by the reading).
+ * @param initials Set to the initial nodes of the pairs (to be freed).
+ * @param finals Set to the final nodes of the pairs (to be freed).
+ * @return int The number of pairs, or -1 if the list names a node that does not exist.
+ */
+int tn_parse_pairs(TunnelNetwork network, char *list, int **initials, int **finals)
+{
+    int num_nodes = tn_get_num_nodes(network);
+    int num_pairs = 0;
+    int capacity = 16;
+    *initials = (int *)malloc(capacity * sizeof(int));
+    *finals = (int *)malloc(capacity * sizeof(int));
+    char *lex = NULL;
+    for (char *item = strtok_r(list, ",", &lex); item != NULL; item = strtok_r(NULL, ",", &lex))
+    {
+        char *separator = strchr(item, ':');
+        if (separator == NULL)
+        {
+            printf("The pair %s of --pairs is not of the form INITIAL:FINAL.\n", item);
+            return -1;
+        }
+        *separator = '\0';
+        const char *names[2] = {item, separator + 1};
+        int first[2], last[2];
+        for (int side = 0; side < 2; side++)
+        {
+            if (strcmp(names[side], "*") == 0)
+            {
+                first[side] = 0;
+                last[side] = num_nodes - 1;
+                continue;
+            }
+            first[side] = last[side] = tn_find_node(network, names[side]);
+            if (first[side] < 0)
+            {
+                printf("The network has no node %s (in --pairs).\n", names[side]);
+                return -1;
+            }
+        }
+        for (int initial = first[0]; initial <= last[0]; initial++)
+            for (int final = first[1]; final <= last[1]; final++)
+            {
+                if (initial == final)
+                    continue;
+                if (num_pairs == capacity)
+                {
+                    capacity *= 2;
+                    *initials = (int *)realloc(*initials, capacity * sizeof(int));
+                    *finals = (int *)realloc(*finals, capacity * sizeof(int));
+                }
+                (*initials)[num_pairs] = initial;
+                (*finals)[num_pairs] = final;
+                num_pairs++;
+            }
+    }
+    return num_pairs;
+}
+
+/**
+ * @brief Prints the answer of each pair.
+ *
+ * @param network The network.
+ * @param num_pairs The number of pairs.
+ * @param initials The initial nodes of the pairs.
+ * @param finals The final nodes of the pairs.
+ * @param lengths The size of the shortest path of each pair, 0 if it has none and -1 if it is unknown.
+ * @param paths The shortest path of each pair.
+ * @param bound The largest size tried.
+ * @param displayTerminal Whether the paths are displayed.
+ */
+void tn_print_pairs(TunnelNetwork network, int num_pairs, const int *initials, const int *finals, const int *lengths, tn_step *const *paths, int bound,
+                    bool displayTerminal)
+{
+    for (int pair = 0; pair < num_pairs; pair++)
+    {
+        printf("%s -> %s: ", tn_get_node_name(network, initials[pair]), tn_get_node_name(network, finals[pair]));
+        if (lengths[pair] < 0)
+            printf("not able to decide if there is a simple path of size at most %d.\n", bound);
+        else if (lengths[pair] == 0)
+            printf("there is no simple path of size at most %d.\n", bound);
+        else
+        {
+            printf("there is a simple path of size %d.\n", lengths[pair]);
+            if (displayTerminal)
+                tn_print_path(network, paths[pair], lengths[pair]);
+        }
+    }
+}
+
+/**
+ * @brief Solves the problem for each pair of initial and final nodes (--pairs), with the brute force and/or the reduction.
+ *
+ * @param network The network.
+ * @param num_pairs The number of pairs.
+ * @param initials The initial nodes of the pairs.
+ * @param finals The final nodes of the pairs.
+ * @param bound The largest size tried.
+ * @param bruteForce Whether the brute force is used.
+ * @param reduction Whether the reduction is used.
+ * @param displayTerminal Whether the paths are displayed.
+ */
+void tn_solve_pairs(TunnelNetwork network, int num_pairs, const int *initials, const int *finals, int bound, bool bruteForce, bool reduction,
+                    bool displayTerminal)
+{
+    int *lengths = (int *)malloc((num_pairs > 0 ? num_pairs : 1) * sizeof(int));
+    tn_step *steps = (tn_step *)malloc(((size_t)num_pairs * bound > 0 ? (size_t)num_pairs * bound : 1) * sizeof(tn_step));
+    tn_step **paths = (tn_step **)malloc((num_pairs > 0 ? num_pairs : 1) * sizeof(tn_step *));
+    for (int pair = 0; pair < num_pairs; pair++)
+        paths[pair] = steps + (size_t)pair * bound;
+
+    if (bruteForce)
+    {
+        printf("\n*******************\n*** Brute Force ***\n*******************\n\n");
+        struct timespec start;
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        // One exploration per initial node, for the final nodes of all its pairs.
+        bool *done = (bool *)calloc(num_pairs > 0 ? num_pairs : 1, sizeof(bool));
+        int *group = (int *)malloc((num_pairs > 0 ? num_pairs : 1) * sizeof(int));
+        int *targets = (int *)malloc((num_pairs > 0 ? num_pairs : 1) * sizeof(int));
+        int *target_lengths = (int *)malloc((num_pairs > 0 ? num_pairs : 1) * sizeof(int));
+        tn_step **target_paths = (tn_step **)malloc((num_pairs > 0 ? num_pairs : 1) * sizeof(tn_step *));
+        int num_explorations = 0;
+        for (int pair = 0; pair < num_pairs; pair++)
+        {
+            if (done[pair])
+                continue;
+            int num_targets = 0;
+            for (int other = pair; other < num_pairs; other++)
+                if (!done[other] && initials[other] == initials[pair])
+                {
+                    done[other] = true;
+                    group[num_targets] = other;
+                    targets[num_targets] = finals[other];
+                    target_paths[num_targets] = paths[other];
+                    num_targets++;
+                }
+            tn_brute_force_targets(network, initials[pair], num_targets, targets, bound, target_lengths, target_paths);
+            for (int i = 0; i < num_targets; i++)
+                lengths[group[i]] = target_lengths[i];
+            num_explorations++;
+        }
+        printf("Brute force computed the %d pairs with %d explorations in %g seconds:\n", num_pairs, num_explorations, seconds_since(start));
+        tn_print_pairs(network, num_pairs, initials, finals, lengths, paths, bound, displayTerminal);
+        free(done);
+        free(group);
+        free(targets);
+        free(target_lengths);
+        free(target_paths);
+    }
+
+    if (reduction)
+    {
+        printf("\n************************\n*** Reduction to SAT ***\n************************\n\n");
+        struct timespec start;
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        Z3_context ctx = make_context();
+        TunnelIncremental inc_solver = tn_incremental_create_for_pairs(ctx, network, bound, num_pairs, initials, finals);
+        Z3_lbool *results = (Z3_lbool *)malloc((num_pairs > 0 ? num_pairs : 1) * sizeof(Z3_lbool));
+        Z3_model *models = (Z3_model *)malloc((num_pairs > 0 ? num_pairs : 1) * sizeof(Z3_model));
+        tn_incremental_solve_pairs(inc_solver, num_pairs, initials, finals, results, lengths, models);
+        for (int pair = 0; pair < num_pairs; pair++)
+        {
+            if (results[pair] == Z3_L_UNDEF)
+                lengths[pair] = -1;
+            if (results[pair] != Z3_L_TRUE)
+                continue;
+            tn_get_path_from_model(ctx, models[pair], network, lengths[pair], paths[pair]);
+            Z3_model_dec_ref(ctx, models[pair]);
+        }
+        printf("The %d pairs were solved with a single incremental solver and %d calls to it in %g seconds:\n", num_pairs,
+               tn_incremental_get_num_checks(inc_solver), seconds_since(start));
+        tn_print_pairs(network, num_pairs, initials, finals, lengths, paths, bound, displayTerminal);
+        free(results);
+        free(models);
+        tn_incremental_delete(inc_solver);
+        Z3_del_context(ctx);
+    }
+
+    free(lengths);
+    free(steps);
+    free(paths);
+}
+#endif
+
+#ifdef COLOURING
+/**
+ * @brief Data of a portfolio race on the Colouring problem. Each engine writes only its own results.
+ *
+ */
+typedef struct
+{
+    ColouredGraph graph;       ///< The graph (its colours are written by the brute force only).
+    int num_colours;           ///< The number of colours.
+    bool brute_force_result;   ///< The answer of the brute force.
+    Z3_context ctx;            ///< The context of the reduction.
+    Z3_model model;            ///< The model found by the reduction.
+    Z3_lbool reduction_result; ///< The answer of the reduction.
+} ColouringRace;
+
+/**
+ * @brief Brute force engine of a race on the Colouring problem.
+ *
+ * @param portfolio The race.
+ * @param data A ColouringRace.
+ */
+void colouring_race_brute_force(Portfolio portfolio, void *data)
+{
+    ColouringRace *race = (ColouringRace *)data;
+    race->brute_force_result = colouring_brute_force_interruptible(race->graph, race->num_colours, portfolio_stop_flag(portfolio, engine_brute_force));
+}
+
+/**
+ * @brief Reduction engine of a race on the Colouring problem. The context is kept for decoding the model after the race.
+ *
+ * @param portfolio The race.
+ * @param data A ColouringRace.
+ */
+void colouring_race_reduction(Portfolio portfolio, void *data)
+{
+    ColouringRace *race = (ColouringRace *)data;
+    race->ctx = make_context();
+    portfolio_set_context(portfolio, race->ctx);
+    Z3_ast formula = colouring_reduction(race->ctx, race->graph, race->num_colours);
+    Z3_solver solver = mk_solver(race->ctx);
+    race->reduction_result = check_formula(race->ctx, solver, formula);
+    // The model is read only if the brute force did not finish first: the context may be interrupted until then.
+    if (!portfolio_claim(portfolio))
+        race->reduction_result = Z3_L_UNDEF;
+    else if (race->reduction_result == Z3_L_TRUE)
+    {
+        race->model = Z3_solver_get_model(race->ctx, solver);
+        Z3_model_inc_ref(race->ctx, race->model);
+    }
+    Z3_solver_dec_ref(race->ctx, solver);
+}
+#endif
+
+#ifdef TUNNEL
+/**
+ * @brief Data of a portfolio race on the Tunnel problem. Each engine writes only its own results.
+ *
+ */
+typedef struct
+{
+    TunnelNetwork network;      ///< The network.
+    int bound;                  ///< The maximal size of the path.
+    bool incremental;           ///< Whether the reduction uses the incremental solver.
+    int brute_force_length;     ///< The size of the path found by the brute force (0 if none).
+    tn_step *brute_force_path;  ///< The path found by the brute force.
+    Z3_lbool reduction_result;  ///< The answer of the reduction.
+    int reduction_length;       ///< The size of the path found by the reduction (0 if none).
+    tn_step *reduction_path;    ///< The path found by the reduction.
+} TunnelRace;
+
+/**
+ * @brief Brute force engine of a race on the Tunnel problem.
+ *
+ * @param portfolio The race.
+ * @param data A TunnelRace.
+ */
+void tn_race_brute_force(Portfolio portfolio, void *data)
+{
+    TunnelRace *race = (TunnelRace *)data;
+    race->brute_force_length = tn_brute_force_interruptible(race->network, race->bound, race->brute_force_path, portfolio_stop_flag(portfolio, engine_brute_force));
+}
+
+/**
+ * @brief Reduction engine of a race on the Tunnel problem: tries every size from 1 to the bound, and decodes the first path found.
+ *
+ * @param portfolio The race.
+ * @param data A TunnelRace.
+ */
+void tn_race_reduction(Portfolio portfolio, void *data)
+{
+    TunnelRace *race = (TunnelRace *)data;
+    const atomic_bool *stop = portfolio_stop_flag(portfolio, engine_reduction);
+    Z3_context ctx = make_context();
+    portfolio_set_context(portfolio, ctx);
+    TunnelIncremental inc_solver = race->incremental ? tn_incremental_create(ctx, race->network, race->bound) : NULL;
+
+    race->reduction_result = Z3_L_FALSE;
+    race->reduction_length = 0;
+    for (int l = 1; l <= race->bound && !atomic_load(stop); l++)
+    {
+        Z3_solver solver = NULL;
+        Z3_lbool isSat;
+        if (race->incremental)
+            isSat = tn_incremental_solve(inc_solver, l, NULL);
+        else
+        {
+            solver = mk_solver(ctx);
+            isSat = check_formula(ctx, solver, tn_reduction(ctx, race->network, l));
+        }
+        if (isSat != Z3_L_FALSE)
+        {
+            // The model is read only if the brute force did not finish first: the context may be interrupted until then.
+            race->reduction_result = portfolio_claim(portfolio) ? isSat : Z3_L_UNDEF;
+            if (race->reduction_result == Z3_L_TRUE)
+            {
+                Z3_model model;
+                if (race->incremental)
+                    model = tn_incremental_get_model(inc_solver);
+                else
+                {
+                    model = Z3_solver_get_model(ctx, solver);
+                    Z3_model_inc_ref(ctx, model);
+                }
+                race->reduction_length = l;
+                tn_get_path_from_model(ctx, model, race->network, l, race->reduction_path);
+                Z3_model_dec_ref(ctx, model);
+            }
+        }
+        if (solver != NULL)
+            Z3_solver_dec_ref(ctx, solver);
+        if (isSat != Z3_L_FALSE)
+            break;
+    }
+
+    if (inc_solver != NULL)
+        tn_incremental_delete(inc_solver);
+    portfolio_set_context(portfolio, NULL);
+    Z3_del_context(ctx);
+}
+#endif
+
 enum problemType
 {
     Repartition,
@@ -126,6 +647,24 @@ int main(int argc, char *argv[])
     bool bruteForce = false;
     bool reduction = false;
     bool printModel = false;
+    bool incremental = false;
+    bool portfolio = false;
+    bool cubes = false;
+    bool serve = false;
+    char *socketPath = NULL;
+    char *pairList = NULL;
+    int num_threads = 1;
+    bool batch = false;
+    bool cache = false;
+    bool stats = false;
+    unsigned timeout = 0;
+    unsigned memory = 0;
+#ifdef TUNNEL
+    tn_search_strategy strategy = tn_search_linear;
+#endif
+    batch_format format = batch_csv;
+    amo_encoding encoding = amo_auto;
+    char *satSolver = NULL;
     char *problem_parameter = "";
     char *solutionName = "default";
     /*char *realArgs[argc];
@@ -133,7 +672,7 @@ int main(int argc, char *argv[])
 
     int option;
 
-    while ((option = getopt(argc, argv, ":hP:c:vFBGRMtfo:")) != -1)
+    while ((option = getopt_long(argc, argv, ":hP:c:vFBGRIj:A:S:Mtfo:", long_options, NULL)) != -1)
     {
         switch (option)
         {
@@ -165,6 +704,85 @@ int main(int argc, char *argv[])
         case 'R':
             reduction = true;
             break;
+        case 'I':
+            incremental = true;
+            break;
+        case 'j':
+            num_threads = atoi(optarg);
+            if (num_threads < 1)
+                num_threads = 1;
+            break;
+        case OptPortfolio:
+            portfolio = true;
+            break;
+        case OptBatch:
+            batch = true;
+            break;
+        case OptCache:
+            cache = true;
+            break;
+        case OptStats:
+            stats = true;
+            break;
+#ifdef COLOURING
+        case OptSymmetry:
+            set_colouring_symmetry_breaking(true);
+            break;
+#endif
+#ifdef TUNNEL
+        case OptCubes:
+            cubes = true;
+            break;
+        case OptServe:
+            serve = true;
+            break;
+        case OptSocket:
+            socketPath = optarg;
+            break;
+        case OptPairs:
+            pairList = optarg;
+            break;
+        case OptSearch:
+            if (!tn_search_strategy_of_string(optarg, &strategy))
+                printf("unknown search strategy: %s. Using linear.\n", optarg);
+            break;
+        case OptStack:
+        {
+            tn_stack_encoding stack_encoding = tn_stack_pair;
+            if (!tn_stack_encoding_of_string(optarg, &stack_encoding))
+                printf("unknown stack encoding: %s. Using pair.\n", optarg);
+            tn_set_stack_encoding(stack_encoding);
+        }
+        break;
+#endif
+        case OptProfile:
+        {
+            solver_profile profile = solver_default;
+            if (!solver_profile_of_string(optarg, &profile))
+                printf("unknown solver profile: %s. Using default.\n", optarg);
+            set_solver_profile(profile);
+        }
+        break;
+        case OptSolverThreads:
+            set_solver_threads(atoi(optarg) > 0 ? atoi(optarg) : 0);
+            break;
+        case OptTimeout:
+            timeout = atoi(optarg) > 0 ? atoi(optarg) : 0;
+            break;
+        case OptMemory:
+            memory = atoi(optarg) > 0 ? atoi(optarg) : 0;
+            break;
+        case OptFormat:
+            if (!batch_format_of_string(optarg, &format))
+                printf("unknown result format: %s. Using csv.\n", optarg);
+            break;
+        case 'A':
+            if (!amo_encoding_of_string(optarg, &encoding))
+                printf("unknown at most one encoding: %s. Using auto.\n", optarg);
+            break;
+        case 'S':
+            satSolver = strcmp(optarg, "z3") == 0 ? NULL : optarg;
+            break;
         case 'F':
             // printf("Don't insist, I'm not showing you the solution of the assignment yet!\n");
             printformula = true;
@@ -187,16 +805,81 @@ int main(int argc, char *argv[])
         }
     }
 
+    if (satSolver != NULL && encoding == amo_native)
+    {
+        printf("The native at most one encoding cannot be written in clauses. Using auto.\n");
+        encoding = amo_auto;
+    }
+    set_amo_encoding(encoding);
+    set_solver_limits(timeout, memory);
+    if (stats && !batch && !serve)
+        set_statistics_output(stdout);
+
+#ifdef TUNNEL
+    if (serve)
+    {
+        if (problem != Tunnel)
+        {
+            printf("The service mode only supports the Tunnel problem. Exiting.\n");
+            return 0;
+        }
+        ServeConfig config = {.bound = strcmp(problem_parameter, "") != 0 ? atoi(problem_parameter) : 10, .max_networks = 16, .socket = socketPath};
+        if (config.bound < 1)
+            config.bound = 10;
+        return serve_run(&config) < 0 ? EXIT_FAILURE : EXIT_SUCCESS;
+    }
+#endif
+
     if (argc - optind < 1)
     {
         printf("No argument given. Exiting.\n");
         return 0;
     }
 
+    if (batch)
+    {
+        BatchConfig config = {.incremental = incremental, .num_threads = num_threads, .format = format, .output = stdout};
+        bool has_value = strcmp(problem_parameter, "") != 0;
+        if (problem == Colouring && strcmp(problem_parameter, "auto") == 0)
+        {
+            printf("The batch mode needs a number of colours. Exiting.\n");
+            return 0;
+        }
+        if (problem == Colouring)
+        {
+            config.problem = batch_colouring;
+            config.value = has_value ? atoi(problem_parameter) : 3;
+        }
+        else if (problem == Tunnel)
+        {
+            config.problem = batch_tunnel;
+            config.value = has_value ? atoi(problem_parameter) : 10;
+        }
+        else
+        {
+            printf("The batch mode only supports the Colouring and Tunnel problems. Exiting.\n");
+            return 0;
+        }
+        batch_run(argv + optind, argc - optind, &config);
+        return 0;
+    }
+
     int num_graphs = argc - optind;
     Graph graphs[argc - optind];
+#ifdef TUNNEL
+    TunnelNetwork cachedNetwork = NULL;
+#endif
     for (int i = optind; i < argc; i++)
     {
+#ifdef TUNNEL
+        // Only the first input is used by the Tunnel problem.
+        if (problem == Tunnel && i == optind)
+        {
+            cachedNetwork = tn_load_input(argv[i], cache, &graphs[0], verbose);
+            if (cachedNetwork != NULL)
+                continue;
+        }
+#endif
         graphs[i - optind] = get_graph_from_file(argv[i]);
         // graph_print(graphs[i - optind]);
         // printf("\nA\n");
@@ -262,11 +945,9 @@ int main(int argc, char *argv[])
                     mkdir("./sol", 0777);
                 int length = strlen(solutionName) + 13;
                 char nameFile[length];
-                snprintf(nameFile, length, "sol/%s.formula", solutionName);
-                FILE *file = fopen(nameFile, "w");
-                fprintf(file, "%s\n", Z3_ast_to_string(ctx, formula));
-                fclose(file);
-                printf("Formula printed in sol/%s.formula\n", solutionName);
+                snprintf(nameFile, length, "sol/%s.smt2", solutionName);
+                write_formula_file(ctx, formula, nameFile);
+                printf("Formula printed in sol/%s.smt2\n", solutionName);
 #else
                 printf("Nah, I'm not displaying the formula in the given executable\n");
 #endif
@@ -331,10 +1012,11 @@ int main(int argc, char *argv[])
         printf("\n*************************\n*** Colouring Problem ***\n*************************\n\n");
 
         int num_colours = 3;
-        if (strcmp(problem_parameter, "") != 0)
+        bool chromatic = strcmp(problem_parameter, "auto") == 0;
+        if (strcmp(problem_parameter, "") != 0 && !chromatic)
             num_colours = atoi(problem_parameter);
 
-        if (verbose)
+        if (verbose && !chromatic)
             printf("We will try to colour the following graph with %d colours\n", num_colours);
 
         ColouredGraph coloured_graph = cg_initialize(graph);
@@ -342,7 +1024,94 @@ int main(int argc, char *argv[])
         if (verbose)
             cg_print(coloured_graph);
 
-        if (bruteForce)
+        if (portfolio && chromatic)
+            printf("The portfolio needs a number of colours: -c auto is ignored by --portfolio.\n");
+
+        if (bruteForce && chromatic)
+        {
+            printf("\n*******************\n*** Brute Force ***\n*******************\n\n");
+            clock_t start = clock();
+            int res = colouring_chromatic_brute_force(coloured_graph);
+            printf("Brute force computed the chromatic number in %g seconds:\n", (double)(clock() - start) / CLOCKS_PER_SEC);
+            printf("The chromatic number of this graph is %d.\n", res);
+            if (displayTerminal)
+                cg_print_colors(coloured_graph);
+            if (outputFile)
+            {
+                int length = strlen(solutionName) + 12;
+                char nameFile[length];
+                snprintf(nameFile, length, "%s_Brute", solutionName);
+                cg_create_dot(coloured_graph, nameFile);
+                printf("Solution printed in sol/%s.dot.\n", nameFile);
+            }
+        }
+
+        if (reduction && chromatic)
+        {
+            printf("\n************************\n*** Reduction to SAT ***\n************************\n\n");
+            Z3_context ctx = make_context();
+            clock_t start = clock();
+            ChromaticResult result;
+            Z3_lbool isSat = colouring_chromatic_number(ctx, coloured_graph, &result);
+            printf("greedy bounds: clique of size %d, colouring with %d colours\n", result.clique_size, result.greedy_colours);
+            printf("chromatic number computed with %d calls to the solver in %g seconds\n", result.num_checks, (double)(clock() - start) / CLOCKS_PER_SEC);
+            if (isSat == Z3_L_TRUE)
+                printf("The chromatic number of this graph is %d.\n", result.num_colours);
+            else
+                printf("Not able to decide if the chromatic number of this graph is smaller than %d.\n", result.num_colours);
+            if (displayTerminal)
+                cg_print_colors(coloured_graph);
+            if (outputFile)
+            {
+                int length = strlen(solutionName) + 12;
+                char nameFile[length];
+                snprintf(nameFile, length, "%s_Sat", solutionName);
+                cg_create_dot(coloured_graph, nameFile);
+                printf("Solution printed in sol/%s.dot.\n", nameFile);
+            }
+            Z3_del_context(ctx);
+        }
+
+        if (portfolio && !chromatic)
+        {
+            printf("\n*****************\n*** Portfolio ***\n*****************\n\n");
+            ColouringRace race = {.graph = coloured_graph, .num_colours = num_colours, .ctx = NULL};
+            struct timespec start;
+            clock_gettime(CLOCK_MONOTONIC, &start);
+            portfolio_engine winner = portfolio_race(colouring_race_brute_force, colouring_race_reduction, &race);
+            printf("The %s finished first, in %g seconds.\n", portfolio_string_of_engine(winner), seconds_since(start));
+
+            bool res = race.brute_force_result;
+            if (winner == engine_reduction)
+            {
+                res = race.reduction_result == Z3_L_TRUE;
+                if (res)
+                    colour_graph_from_model(race.ctx, race.model, coloured_graph, num_colours);
+            }
+            if (winner == engine_reduction && race.reduction_result == Z3_L_UNDEF)
+                printf("Not able to decide if there is a %d-colouring of this graph.\n", num_colours);
+            else if (res)
+            {
+                printf("There is a %d-colouring of this graph.\n", num_colours);
+                if (displayTerminal)
+                    cg_print_colors(coloured_graph);
+                if (outputFile)
+                {
+                    int length = strlen(solutionName) + 12;
+                    char nameFile[length];
+                    snprintf(nameFile, length, "%s_Portfolio", solutionName);
+                    cg_create_dot(coloured_graph, nameFile);
+                    printf("Solution printed in sol/%s.dot.\n", nameFile);
+                }
+            }
+            else
+                printf("There is no %d-colouring of this graph.\n", num_colours);
+
+            if (race.ctx != NULL)
+                Z3_del_context(race.ctx);
+        }
+
+        if (bruteForce && !chromatic)
         {
             printf("\n*******************\n*** Brute Force ***\n*******************\n\n");
             clock_t start = clock();
@@ -367,7 +1136,7 @@ int main(int argc, char *argv[])
                 printf("There is no %d-colouring of this graph.\n", num_colours);
         }
 
-        if (reduction)
+        if (reduction && !chromatic)
         {
             printf("\n************************\n*** Reduction to SAT ***\n************************\n\n");
 
@@ -389,15 +1158,18 @@ int main(int argc, char *argv[])
                     mkdir("./sol", 0777);
                 int length = strlen(solutionName) + 13;
                 char nameFile[length];
-                snprintf(nameFile, length, "sol/%s.formula", solutionName);
-                FILE *file = fopen(nameFile, "w");
-                fprintf(file, "%s\n", Z3_ast_to_string(ctx, formula));
-                fclose(file);
-                printf("Formula printed in sol/%s.formula\n", solutionName);
+                snprintf(nameFile, length, "sol/%s.smt2", solutionName);
+                write_formula_file(ctx, formula, nameFile);
+                printf("Formula printed in sol/%s.smt2\n", solutionName);
+                if (satSolver != NULL)
+                {
+                    snprintf(nameFile, length, "sol/%s.cnf", solutionName);
+                    write_dimacs_file(ctx, formula, nameFile);
+                }
             }
 
             Z3_model model;
-            Z3_lbool isSat = solve_formula(ctx, formula, &model);
+            Z3_lbool isSat = satSolver != NULL ? cnf_solve_formula(ctx, formula, satSolver, &model) : solve_formula(ctx, formula, &model);
 
             clock_t timeSat = clock();
 
@@ -524,11 +1296,9 @@ int main(int argc, char *argv[])
                     mkdir("./sol", 0777);
                 int length = strlen(solutionName) + 13;
                 char nameFile[length];
-                snprintf(nameFile, length, "sol/%s.formula", solutionName);
-                FILE *file = fopen(nameFile, "w");
-                fprintf(file, "%s\n", Z3_ast_to_string(ctx, formula));
-                fclose(file);
-                printf("Formula printed in sol/%s.formula\n", solutionName);
+                snprintf(nameFile, length, "sol/%s.smt2", solutionName);
+                write_formula_file(ctx, formula, nameFile);
+                printf("Formula printed in sol/%s.smt2\n", solutionName);
 #else
                 printf("Nah, I'm not displaying the formula in the given executable\n");
 #endif
@@ -590,7 +1360,7 @@ int main(int argc, char *argv[])
     if (problem == Tunnel)
     {
         printf("\n*****************************************\n*** Tunnel Network Problem ***\n*****************************************\n\n");
-        TunnelNetwork network = tn_initialize(graph);
+        TunnelNetwork network = cachedNetwork != NULL ? cachedNetwork : tn_initialize(graph);
         if (verbose)
         {
             tn_print(network);
@@ -606,6 +1376,53 @@ int main(int argc, char *argv[])
             path[step] = tn_step_empty();
         }
 
+        if (pairList != NULL)
+        {
+            printf("\n*************\n*** Pairs ***\n*************\n\n");
+            int *initials;
+            int *finals;
+            int num_pairs = tn_parse_pairs(network, pairList, &initials, &finals);
+            if (num_pairs >= 0)
+                tn_solve_pairs(network, num_pairs, initials, finals, bound, bruteForce, reduction, displayTerminal);
+            free(initials);
+            free(finals);
+            // The pairs replace the initial and final nodes of the file: nothing else is solved.
+            portfolio = bruteForce = reduction = false;
+        }
+
+        if (portfolio)
+        {
+            printf("\n*****************\n*** Portfolio ***\n*****************\n\n");
+            tn_step brute_force_path[bound];
+            tn_step reduction_path[bound];
+            TunnelRace race = {.network = network, .bound = bound, .incremental = incremental, .brute_force_path = brute_force_path, .reduction_path = reduction_path};
+            struct timespec start;
+            clock_gettime(CLOCK_MONOTONIC, &start);
+            portfolio_engine winner = portfolio_race(tn_race_brute_force, tn_race_reduction, &race);
+            printf("The %s finished first, in %g seconds.\n", portfolio_string_of_engine(winner), seconds_since(start));
+
+            int res = winner == engine_brute_force ? race.brute_force_length : race.reduction_length;
+            tn_step *winner_path = winner == engine_brute_force ? brute_force_path : reduction_path;
+            if (winner == engine_reduction && race.reduction_result == Z3_L_UNDEF)
+                printf("Not able to decide if there is a simple path of size at most %d.\n", bound);
+            else if (res > 0)
+            {
+                printf("There is a simple path of size %d.\n", res);
+                if (displayTerminal)
+                    tn_print_path(network, winner_path, res);
+                if (outputFile)
+                {
+                    int length = strlen(solutionName) + 12;
+                    char nameFile[length];
+                    snprintf(nameFile, length, "%s_Portfolio", solutionName);
+                    tn_create_dot(network, winner_path, res, nameFile);
+                    printf("Solution printed in sol/%s.dot.\n", nameFile);
+                }
+            }
+            else
+                printf("There is no simple path of size at most %d.\n", bound);
+        }
+
         if (bruteForce)
         {
             printf("\n*******************\n*** Brute Force ***\n*******************\n\n");
@@ -640,44 +1457,184 @@ int main(int argc, char *argv[])
             printf("\n************************\n*** Reduction to SAT ***\n************************\n\n");
 
             Z3_context ctx = make_context();
+            TunnelIncremental inc_solver = NULL;
+            // Only paths of size at most some bound can be bisected: they are encoded with the activation literals of the incremental solver.
+            if (strategy != tn_search_linear)
+                incremental = true;
+            if (incremental && satSolver != NULL)
+                printf("-S is ignored with -I: the incremental solver is Z3.\n");
+
+            if (cubes)
+            {
+                struct timespec start;
+                clock_gettime(CLOCK_MONOTONIC, &start);
+                int num_cubes;
+                Z3_lbool isSat = tn_parallel_cubes(network, bound, num_threads, path, &num_cubes);
+                printf("size %d split into %d cubes solved on %d threads in %g seconds\n", bound, num_cubes, num_threads, seconds_since(start));
 
-            for (int l = 1; l <= bound; l++)
+                switch (isSat)
+                {
+                case Z3_L_FALSE:
+                    printf("No simple path of size %d exists\n", bound);
+                    break;
+
+                case Z3_L_UNDEF:
+                    printf("Not able to decide if there is a simple path of size %d.\n", bound);
+                    break;
+
+                case Z3_L_TRUE:
+                    printf("There is a simple path of size %d.\n", bound);
+
+                    if (displayTerminal)
+                        tn_print_path(network, path, bound);
+
+                    if (outputFile)
+                    {
+                        int length = strlen(solutionName) + 12;
+                        char nameFile[length];
+                        snprintf(nameFile, length, "%s_Sat", solutionName);
+                        tn_create_dot(network, path, bound, nameFile);
+                        printf("Solution printed in sol/%s.dot.\n", nameFile);
+                    }
+                }
+                goto TN_end;
+            }
+
+            if (num_threads > 1 && !incremental)
             {
-                printf("\n--- size %d ---\n", l);
+                struct timespec start;
+                clock_gettime(CLOCK_MONOTONIC, &start);
+                int res;
+                Z3_lbool isSat = tn_parallel_sweep(network, bound, num_threads, path, &res);
+                printf("sizes 1 to %d solved on %d threads in %g seconds\n", bound, num_threads, seconds_since(start));
+
+                switch (isSat)
+                {
+                case Z3_L_FALSE:
+                    printf("There is no simple path of size at most %d.\n", bound);
+                    break;
+
+                case Z3_L_UNDEF:
+                    printf("Not able to decide if there is a simple path of size at most %d.\n", bound);
+                    break;
+
+                case Z3_L_TRUE:
+                    printf("There is a simple path of size %d.\n", res);
 
+                    if (displayTerminal)
+                        tn_print_path(network, path, res);
+
+                    if (outputFile)
+                    {
+                        int length = strlen(solutionName) + 12;
+                        char nameFile[length];
+                        snprintf(nameFile, length, "%s_Sat", solutionName);
+                        tn_create_dot(network, path, res, nameFile);
+                        printf("Solution printed in sol/%s.dot.\n", nameFile);
+                    }
+                }
+                goto TN_end;
+            }
+
+            // The cubes and the parallel sweep have their own solvers: the incremental one is only created past them.
+            if (incremental)
+                inc_solver = tn_incremental_create(ctx, network, bound);
+
+            if (strategy != tn_search_linear)
+            {
                 clock_t start = clock();
+                Z3_model model;
+                int res;
+                Z3_lbool isSat = tn_incremental_search(inc_solver, strategy, &res, &model);
+                printf("sizes 1 to %d searched with %d calls to the solver in %g seconds\n", bound, tn_incremental_get_num_checks(inc_solver), (double)(clock() - start) / CLOCKS_PER_SEC);
+
+                switch (isSat)
+                {
+                case Z3_L_FALSE:
+                    printf("There is no simple path of size at most %d.\n", bound);
+                    break;
+
+                case Z3_L_UNDEF:
+                    printf("Not able to decide if there is a simple path of size at most %d.\n", bound);
+                    break;
+
+                case Z3_L_TRUE:
+                    printf("There is a simple path of size %d.\n", res);
+
+                    if (displayTerminal || outputFile || printModel)
+                        tn_get_path_from_model(ctx, model, network, res, path);
+
+                    if (displayTerminal)
+                        tn_print_path(network, path, res);
+                    if (printModel)
+                        tn_print_model(ctx, model, network, res);
+
+                    if (outputFile)
+                    {
+                        int length = strlen(solutionName) + 12;
+                        char nameFile[length];
+                        snprintf(nameFile, length, "%s_Sat", solutionName);
+                        tn_create_dot(network, path, res, nameFile);
+                        printf("Solution printed in sol/%s.dot.\n", nameFile);
+                    }
+                    Z3_model_dec_ref(ctx, model);
+                }
+                goto TN_end;
+            }
+
+            for (int l = 1; l <= bound; l++)
+            {
+                printf("\n--- size %d ---\n", l);
 
-                Z3_ast formula;
-                formula = tn_reduction(ctx, network, l);
+                Z3_model model;
+                Z3_lbool isSat;
 
-                clock_t timeFormula = clock();
+                if (incremental)
+                {
+                    clock_t start = clock();
 
-                printf("formula for size %d computed in %g seconds\n", l, (double)(timeFormula - start) / CLOCKS_PER_SEC);
+                    isSat = tn_incremental_solve(inc_solver, l, &model);
 
-                if (printformula)
+                    printf("size %d encoded and solved incrementally in %g seconds\n", l, (double)(clock() - start) / CLOCKS_PER_SEC);
+                }
+                else
                 {
+                    clock_t start = clock();
+
+                    Z3_ast formula;
+                    formula = tn_reduction(ctx, network, l);
+
+                    clock_t timeFormula = clock();
+
+                    printf("formula for size %d computed in %g seconds\n", l, (double)(timeFormula - start) / CLOCKS_PER_SEC);
+
+                    if (printformula)
+                    {
 #ifndef SUBJECT
-                    struct stat st = {0};
-                    if (stat("./sol", &st) == -1)
-                        mkdir("./sol", 0777);
-                    int length = strlen(solutionName) + 13;
-                    char nameFile[length];
-                    snprintf(nameFile, length, "sol/%s_%d.formula", solutionName, l);
-                    FILE *file = fopen(nameFile, "w");
-                    fprintf(file, "%s\n", Z3_ast_to_string(ctx, formula));
-                    fclose(file);
-                    printf("Formula for size %d printed in sol/%s_%d.formula\n", l, solutionName, l);
+                        struct stat st = {0};
+                        if (stat("./sol", &st) == -1)
+                            mkdir("./sol", 0777);
+                        int length = strlen(solutionName) + 24;
+                        char nameFile[length];
+                        snprintf(nameFile, length, "sol/%s_%d.smt2", solutionName, l);
+                        write_formula_file(ctx, formula, nameFile);
+                        printf("Formula for size %d printed in sol/%s_%d.smt2\n", l, solutionName, l);
+                        if (satSolver != NULL)
+                        {
+                            snprintf(nameFile, length, "sol/%s_%d.cnf", solutionName, l);
+                            write_dimacs_file(ctx, formula, nameFile);
+                        }
 #else
-                    printf("Nah, I'm not displaying the formula in the given executable\n");
+                        printf("Nah, I'm not displaying the formula in the given executable\n");
 #endif
-                }
+                    }
 
-                Z3_model model;
-                Z3_lbool isSat = solve_formula(ctx, formula, &model);
+                    isSat = satSolver != NULL ? cnf_solve_formula(ctx, formula, satSolver, &model) : solve_formula(ctx, formula, &model);
 
-                clock_t timeSat = clock();
+                    clock_t timeSat = clock();
 
-                printf("solution computed in %g seconds\n", (double)(timeSat - timeFormula) / CLOCKS_PER_SEC);
+                    printf("solution computed in %g seconds\n", (double)(timeSat - timeFormula) / CLOCKS_PER_SEC);
+                }
 
                 switch (isSat)
                 {
@@ -718,6 +1675,8 @@ int main(int argc, char *argv[])
             }
 
         TN_end:
+            if (inc_solver != NULL)
+                tn_incremental_delete(inc_solver);
             Z3_del_context(ctx);
         }
 
@@ -20,7 +20,7 @@
 
 int yyerror(GraphList *expression, yyscan_t scanner, const char *msg) {
     /* Add error handling routine as needed */
-    printf("Erreur: %s\n",msg);
+    fprintf(stderr, "Erreur: %s\n",msg);
     return 0;
 }
  
@@ -140,30 +140,37 @@ a_list : attr_assignment                { $$ = $1;}
     ;
 
 attr_assignment : idrhs T_EQ idrhs   { 
-      $$.parameters = parameter_list_add_parameter(NULL,$1,$3);
-             free($1); free($3);}
+      $$.parameters = parameter_list_create_in_arena(graph->arena,$1,$3);}
     ;
 								
-idrhs : T_ID        { $$ = (char*)malloc((strlen($1)+1)*sizeof(char)); strcpy($$,$1);
+idrhs : T_ID        { $$ = arena_strdup(graph->arena,$1);
                     }
-    | T_STRING      { $$ = (char*)malloc((strlen($1)+1)*sizeof(char)); strcpy($$,$1);
+    | T_STRING      { $$ = arena_strdup(graph->arena,$1);
                     }
 		;        
 
-node_stmt : node_id         { free($1); }
+node_stmt : node_id
     | node_id attr_list     {   
-                                add_parameters_to_node($1,$2.parameters,graph->nodes);
-                                free($1);
+                                add_parameters_to_indexed_node($1,$2.parameters,graph->nodeIndex);
                             }
     ;
 
 node_id : T_ID      { 
-                      $$ = (char*)malloc((strlen($1)+1)*sizeof(char)); strcpy($$,$1);
-                      if(graph->nodes == NULL) graph->nodes = addNode($1,NULL); else addOrUpdateNode($1,graph->nodes);
+                      /* the name of the node in the list is shared by all its occurrences. */
+                      SNodeList *node = addOrUpdateIndexedNode($1,&graph->nodes,graph->nodeIndex,graph->arena);
+                      if (node == NULL) {
+                          yyerror(graph, scanner, "out of memory");
+                          YYABORT;
+                      }
+                      $$ = node->node;
                     }
     | T_ID port     { 
-                      $$ = (char*)malloc((strlen($1)+1)*sizeof(char)); strcpy($$,$1);
-                      if(graph->nodes == NULL) graph->nodes = addNode($1,NULL); else addOrUpdateNode($1,graph->nodes);
+                      SNodeList *node = addOrUpdateIndexedNode($1,&graph->nodes,graph->nodeIndex,graph->arena);
+                      if (node == NULL) {
+                          yyerror(graph, scanner, "out of memory");
+                          YYABORT;
+                      }
+                      $$ = node->node;
                     }
     ;
 
@@ -181,12 +188,10 @@ port_angle : T_AT T_ID
     ;
 
 edge_stmt : node_id edgerhs         { //printf("edge seen: (%s,%s)\n",$1,$2);
-                                      graph->edges = addEdge($1,$2,graph->edges,NULL);
-                                      free($1); free($2);
+                                      graph->edges = addEdgeInArena(graph->arena,$1,$2,graph->edges,NULL);
                                     }
     | node_id edgerhs attr_list     { //printf("edge seen: (%s,%s)\n",$1,$2);
-                                      graph->edges = addEdge($1,$2,graph->edges,$3.parameters);
-                                      free($1); free($2);
+                                      graph->edges = addEdgeInArena(graph->arena,$1,$2,graph->edges,$3.parameters);
                                     }
     | subgraph edgerhs 
     | subgraph edgerhs attr_list 
@@ -196,8 +201,7 @@ edgerhs : edgeop node_id        { //printf("edge end seen\n");
                                   $$ = $2;
                                 }
     | edgeop node_id edgerhs    {
-                                  graph->edges = addEdge($2,$3,graph->edges,NULL);
-                                  free($3);
+                                  graph->edges = addEdgeInArena(graph->arena,$2,$3,graph->edges,NULL);
                                   $$ = $2;
                                 }
     ;
@@ -36,6 +36,17 @@ typedef struct tagSEdgeList
 
 SEdgeList *addEdge(char* n1, char* n2, SEdgeList *list, parameterList *parameters);
 
+/**
+ * @brief Same as addEdge, but the new edge is allocated in arena, and shares the names n1 and n2 instead of copying them.
+ * @param arena the arena owning the list.
+ * @param n1 the left node (must live as long as arena)
+ * @param n2 the right node (must live as long as arena)
+ * @param list the list to append to
+ * @param parameters the parameters of the edge
+ * @return the new list or NULL in case of no memory.
+ */
+SEdgeList *addEdgeInArena(Arena arena, char *n1, char *n2, SEdgeList *list, parameterList *parameters);
+
 /**
  * @brief Prints an EdgeList.
  * 
@@ -24,6 +24,8 @@ typedef struct tagGraphList
 	SNodeList *nodes;
     SEdgeList *edges;
     bool directed;
+    SNodeIndex *nodeIndex; ///< Index of nodes, only used during parsing.
+    Arena arena;           ///< Owns the name, the lists and their strings (they must not be deleted one by one).
 } GraphList;
 
 
@@ -18,6 +18,7 @@
 
 /**
  * @brief Creates a Graph object from a GraphList. Does NOT free the source, so it must be destroyed independently.
+ *        If source.arena is not NULL, the graph takes over the arena and shares the strings and parameters of the source: the lists of source must then not be deleted, they are released with the graph.
  * 
  * @param source the GraphList to reinterpret as a graph.
  * @return Graph the graph corresponding to the source.
@@ -52,6 +52,46 @@ void addOrUpdateNode(char *n, SNodeList *list);
  */
 void add_parameters_to_node(char *node, parameterList *parameters, SNodeList *list);
 
+/**
+ * @brief A hash table of the nodes of a list, indexed by their name, to find them without going through the list. Also keeps the last node of the list.
+ */
+typedef struct tagSNodeIndex SNodeIndex;
+
+/**
+ * @brief Creates an empty index.
+ *
+ * @return the index or NULL in case of no memory.
+ */
+SNodeIndex *createNodeIndex();
+
+/**
+ * @brief Deletes an index (not the nodes it refers to).
+ *
+ * @param index the index.
+ */
+void deleteNodeIndex(SNodeIndex *index);
+
+/**
+ * @brief Same as addOrUpdateNode, in constant expected time: if n is present in the list, does nothing. Otherwise, adds the node at the end of the list.
+ *        The new node and its name are allocated in arena.
+ *
+ * @param n the node to add.
+ * @param list the list to modify (*list may be NULL), whose nodes must all be in index.
+ * @param index the index of list, updated with the new node.
+ * @param arena the arena owning the list.
+ * @return the node named n in the list, or NULL in case of no memory.
+ */
+SNodeList *addOrUpdateIndexedNode(char *n, SNodeList **list, SNodeIndex *index, Arena arena);
+
+/**
+ * @brief Same as add_parameters_to_node, in constant expected time.
+ *
+ * @param node the node to which to add a parameter.
+ * @param parameters the list of parameters to add to node.
+ * @param index the index of the list of nodes.
+ */
+void add_parameters_to_indexed_node(char *node, parameterList *parameters, SNodeIndex *index);
+
 /**
  * @brief Prints a NodeList.
  *
@@ -54,6 +54,21 @@ SEdgeList *addEdge(char *n1, char *n2, SEdgeList *list, parameterList *parameter
     return b;
 }
 
+SEdgeList *addEdgeInArena(Arena arena, char *n1, char *n2, SEdgeList *list, parameterList *parameters)
+{
+    SEdgeList *b = (SEdgeList *)arena_alloc(arena, sizeof(SEdgeList));
+
+    if (b == NULL)
+        return NULL;
+
+    b->node1 = n1;
+    b->node2 = n2;
+    b->parameters = parameters;
+    b->next = list;
+
+    return b;
+}
+
 void printEdgeList(SEdgeList *e)
 {
     if (e == NULL)
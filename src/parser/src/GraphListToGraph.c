@@ -1,6 +1,7 @@
 #include "GraphListToGraph.h"
 #include "EdgeList.h"
 #include "NodeList.h"
+#include "Hash.h"
 #include <stdlib.h>
 #include <string.h>
 
@@ -22,10 +23,80 @@ int findNode(char **list, int size, char *target)
 	return -1;
 }
 
+/**
+ * @brief Hash table giving the index of a node from its name (open addressing, at most half full).
+ *
+ */
+typedef struct
+{
+	char **names;  ///< The names of the nodes (not owned).
+	int capacity;  ///< The number of slots (a power of 2).
+	int *slots;	   ///< The index of the node in each slot, -1 if empty.
+} NodeIndex;
+
+/**
+ * @brief Creates the index of the @p size names of @p names. If a name appears several times, its first occurrence is kept (as findNode).
+ *
+ * @param names the array of node names.
+ * @param size the size of names.
+ * @return NodeIndex the index, to be freed with nodeIndexDelete.
+ */
+static NodeIndex nodeIndexCreate(char **names, int size)
+{
+	NodeIndex index;
+	index.names = names;
+	index.capacity = 1;
+	while (index.capacity < 2 * size)
+		index.capacity *= 2;
+	index.slots = (int *)malloc(index.capacity * sizeof(int));
+	for (int i = 0; i < index.capacity; i++)
+		index.slots[i] = -1;
+	for (int node = 0; node < size; node++)
+	{
+		int slot = hash_string(HASH_INIT, names[node]) & (index.capacity - 1);
+		while (index.slots[slot] != -1 && strcmp(names[index.slots[slot]], names[node]) != 0)
+			slot = (slot + 1) & (index.capacity - 1);
+		if (index.slots[slot] == -1)
+			index.slots[slot] = node;
+	}
+	return index;
+}
+
+/**
+ * @brief Gets the index of the node named @p target.
+ *
+ * @param index the index.
+ * @param target the node to search.
+ * @return int the index of target, or -1 if there is no such node.
+ */
+static int nodeIndexFind(NodeIndex index, char *target)
+{
+	int slot = hash_string(HASH_INIT, target) & (index.capacity - 1);
+	while (index.slots[slot] != -1)
+	{
+		if (strcmp(index.names[index.slots[slot]], target) == 0)
+			return index.slots[slot];
+		slot = (slot + 1) & (index.capacity - 1);
+	}
+	return -1;
+}
+
+/**
+ * @brief Frees the memory used by @p index.
+ *
+ * @param index the index.
+ */
+static void nodeIndexDelete(NodeIndex index)
+{
+	free(index.slots);
+}
+
 Graph createGraph(GraphList source)
 {
 	Graph res;
 	res.name = source.name;
+	// The names and parameters of an arena-backed list are kept as they are, and the graph takes over the arena.
+	res.arena = source.arena;
 	res.numNodes = 0;
 	res.numEdges = 0;
 	SNodeList *explore = source.nodes;
@@ -40,27 +111,32 @@ Graph createGraph(GraphList source)
 
 	// printf("nodes: %d\n",count);
 
-	res.edges = (bool *)malloc(res.numNodes * res.numNodes * sizeof(bool));
-	res.nodes = (char **)malloc(res.numNodes * sizeof(char *));
+	res.edges = (bool *)graph_alloc(&res, res.numNodes * res.numNodes * sizeof(bool));
+	res.nodes = (char **)graph_alloc(&res, res.numNodes * sizeof(char *));
 
 	count = 0;
 	explore = source.nodes;
 
 	// Paramètres
 
-	res.parameters = (parameterList **)malloc(res.numNodes * sizeof(parameterList *));
-	res.edge_parameters = (parameterList **)malloc(res.numNodes * res.numNodes * sizeof(parameterList *));
-	for (int i = 0; i < res.numNodes * res.numNodes; i++)
-		res.edge_parameters[i] = NULL;
+	res.parameters = (parameterList **)graph_alloc(&res, res.numNodes * sizeof(parameterList *));
 
 	while (explore != NULL)
 	{
-		res.nodes[count] = (char *)malloc((strlen(explore->node) + 1) * sizeof(char));
-		strcpy(res.nodes[count], explore->node);
+		if (res.arena != NULL)
+		{
+			res.nodes[count] = explore->node;
+			res.parameters[count] = explore->parameters;
+		}
+		else
+		{
+			res.nodes[count] = (char *)malloc((strlen(explore->node) + 1) * sizeof(char));
+			strcpy(res.nodes[count], explore->node);
 
-		// Paramètres
+			// Paramètres
 
-		res.parameters[count] = parameter_list_copy(explore->parameters);
+			res.parameters[count] = parameter_list_copy(explore->parameters);
+		}
 
 		count++;
 		explore = explore->next;
@@ -70,22 +146,45 @@ Graph createGraph(GraphList source)
 		for (int j = 0; j < res.numNodes; j++)
 			res.edges[i * res.numNodes + j] = false;
 
+	// Arcs of the successor index (both directions for an undirected graph).
+	int num_list_edges = 0;
+	for (SEdgeList *edge = source.edges; edge != NULL; edge = edge->next)
+		num_list_edges++;
+	int max_arcs = (source.directed ? 1 : 2) * num_list_edges;
+	int *arc_sources = (int *)malloc((max_arcs > 0 ? max_arcs : 1) * sizeof(int));
+	int *arc_targets = (int *)malloc((max_arcs > 0 ? max_arcs : 1) * sizeof(int));
+	parameterList **arc_parameters = (parameterList **)malloc((max_arcs > 0 ? max_arcs : 1) * sizeof(parameterList *));
+	int num_arcs = 0;
+	NodeIndex index = nodeIndexCreate(res.nodes, res.numNodes);
+
 	SEdgeList *exploreBis = source.edges;
 	while (exploreBis != NULL)
 	{
 		int n1, n2;
-		n1 = findNode(res.nodes, res.numNodes, exploreBis->node1);
-		n2 = findNode(res.nodes, res.numNodes, exploreBis->node2);
+		n1 = nodeIndexFind(index, exploreBis->node1);
+		n2 = nodeIndexFind(index, exploreBis->node2);
 		res.edges[n1 * res.numNodes + n2] = true;
-		res.edge_parameters[n1 * res.numNodes + n2] = parameter_list_copy(exploreBis->parameters);
+		arc_sources[num_arcs] = n1;
+		arc_targets[num_arcs] = n2;
+		arc_parameters[num_arcs++] = exploreBis->parameters;
 		if (!source.directed)
 		{
 			res.edges[n2 * res.numNodes + n1] = true;
-			res.edge_parameters[n2 * res.numNodes + n1] = parameter_list_copy(exploreBis->parameters);
+			arc_sources[num_arcs] = n2;
+			arc_targets[num_arcs] = n1;
+			arc_parameters[num_arcs++] = exploreBis->parameters;
 		}
 		exploreBis = exploreBis->next;
 		res.numEdges++;
 	}
 
+	nodeIndexDelete(index);
+
+	// The parameters are shared (arena) or copied once per distinct list.
+	graph_build_adjacency(&res, num_arcs, arc_sources, arc_targets, arc_parameters);
+	free(arc_sources);
+	free(arc_targets);
+	free(arc_parameters);
+
 	return res;
 }
\ No newline at end of file
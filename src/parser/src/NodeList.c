@@ -11,6 +11,7 @@
  */
 
 #include "NodeList.h"
+#include "Hash.h"
 #include <stdbool.h>
 #include <stdio.h>
 #include <stdlib.h>
@@ -81,6 +82,118 @@ void add_parameters_to_node(char *node, parameterList *parameters, SNodeList *li
     list->parameters = parameter_lists_merge(list->parameters, parameters);
 }
 
+/**
+ * @brief The node index: open addressing table, at most half full.
+ */
+struct tagSNodeIndex
+{
+    SNodeList **slots; ///< The nodes of the table, NULL for an empty slot.
+    int capacity;      ///< The number of slots (a power of 2).
+    int size;          ///< The number of nodes in the table.
+    SNodeList *last;   ///< The last node of the list.
+};
+
+/**
+ * @brief Gets the slot of node n in index: the one containing it, or the empty one where it would be inserted.
+ *
+ * @param n a node name.
+ * @param index the index.
+ * @return the number of the slot.
+ */
+static int findNodeSlot(const char *n, SNodeIndex *index)
+{
+    int slot = hash_string(HASH_INIT, n) & (index->capacity - 1);
+    while (index->slots[slot] != NULL && strcmp(index->slots[slot]->node, n) != 0)
+        slot = (slot + 1) & (index->capacity - 1);
+    return slot;
+}
+
+/**
+ * @brief Doubles the capacity of index.
+ *
+ * @param index the index.
+ * @return false in case of no memory.
+ */
+static bool growNodeIndex(SNodeIndex *index)
+{
+    SNodeList **old_slots = index->slots;
+    int old_capacity = index->capacity;
+    index->slots = (SNodeList **)calloc(2 * old_capacity, sizeof(SNodeList *));
+    if (index->slots == NULL)
+    {
+        index->slots = old_slots;
+        return false;
+    }
+    index->capacity = 2 * old_capacity;
+    for (int slot = 0; slot < old_capacity; slot++)
+        if (old_slots[slot] != NULL)
+            index->slots[findNodeSlot(old_slots[slot]->node, index)] = old_slots[slot];
+    free(old_slots);
+    return true;
+}
+
+SNodeIndex *createNodeIndex()
+{
+    SNodeIndex *index = (SNodeIndex *)malloc(sizeof(SNodeIndex));
+    if (index == NULL)
+        return NULL;
+    index->capacity = 64;
+    index->size = 0;
+    index->last = NULL;
+    index->slots = (SNodeList **)calloc(index->capacity, sizeof(SNodeList *));
+    if (index->slots == NULL)
+    {
+        free(index);
+        return NULL;
+    }
+    return index;
+}
+
+void deleteNodeIndex(SNodeIndex *index)
+{
+    if (index == NULL)
+        return;
+    free(index->slots);
+    free(index);
+}
+
+SNodeList *addOrUpdateIndexedNode(char *n, SNodeList **list, SNodeIndex *index, Arena arena)
+{
+    int slot = findNodeSlot(n, index);
+    if (index->slots[slot] != NULL)
+        return index->slots[slot];
+    if (2 * (index->size + 1) > index->capacity)
+    {
+        if (!growNodeIndex(index))
+            return NULL;
+        slot = findNodeSlot(n, index);
+    }
+    SNodeList *node = (SNodeList *)arena_alloc(arena, sizeof(SNodeList));
+    if (node == NULL)
+        return NULL;
+    node->node = arena_strdup(arena, n);
+    if (node->node == NULL)
+        return NULL;
+    node->parameters = NULL;
+    node->next = NULL;
+    index->slots[slot] = node;
+    index->size++;
+    if (*list == NULL)
+        *list = node;
+    else
+        index->last->next = node;
+    index->last = node;
+    return node;
+}
+
+void add_parameters_to_indexed_node(char *node, parameterList *parameters, SNodeIndex *index)
+{
+    SNodeList *target = index->slots[findNodeSlot(node, index)];
+    if (target == NULL)
+        return;
+    target->parameters = parameter_lists_merge(target->parameters, parameters);
+}
+
 void printNodeList(SNodeList *e)
 {
     if (e == NULL)
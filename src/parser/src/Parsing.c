@@ -2,9 +2,62 @@
 #include "Parser.h"
 #include "Lexer.h"
 #include "GraphListToGraph.h"
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <stdlib.h>
 
 int yyparse(GraphList *expression, yyscan_t scanner);
 
+/**
+ * @brief Size of the blocks of the arena of a parse.
+ */
+#define PARSE_ARENA_BLOCK_SIZE (1 << 16)
+
+/**
+ * @brief Initializes an empty GraphList, with the arena that will own its lists.
+ *
+ * @return GraphList The empty GraphList.
+ */
+static GraphList emptyGraphList()
+{
+    GraphList expression;
+    expression.name = NULL;
+    expression.nodes = NULL;
+    expression.edges = NULL;
+    expression.directed = false;
+    expression.nodeIndex = NULL;
+    expression.arena = arena_create(PARSE_ARENA_BLOCK_SIZE);
+    return expression;
+}
+
+/**
+ * @brief Parses the input of @p scanner into @p expression.
+ *
+ * @param expression An empty GraphList.
+ * @param scanner A scanner whose buffer is set.
+ * @return bool false if there was a parse error.
+ */
+static bool parse(GraphList *expression, yyscan_t scanner)
+{
+    // The characters matched by no rule are echoed by the scanner: they go with the other messages of the parser, not in the results.
+    yyset_out(stderr, scanner);
+    // The index makes adding a node independent of the number of nodes already seen.
+    expression->nodeIndex = createNodeIndex();
+    int error = yyparse(expression, scanner);
+    deleteNodeIndex(expression->nodeIndex);
+    expression->nodeIndex = NULL;
+
+    if (error)
+    {
+        /* error parsing */
+        fprintf(stderr, "Error parsing\n");
+        return false;
+    }
+    return true;
+}
+
 /**
  * @brief Parses a string and return the GraphList described by it.
  * 
@@ -13,28 +66,21 @@ int yyparse(GraphList *expression, yyscan_t scanner);
  */
 GraphList getGraphList(const char *expr)
 {
-    GraphList expression;
+    GraphList expression = emptyGraphList();
     yyscan_t scanner;
     YY_BUFFER_STATE state;
 
-    expression.nodes = NULL;
-    expression.edges = NULL;
-
     if (yylex_init(&scanner))
     {
         /* could not initialize */
-        printf("Error initialization\n");
+        fprintf(stderr, "Error initialization\n");
         return expression;
     }
 
     state = yy_scan_string(expr, scanner);
 
-    if (yyparse(&expression, scanner))
-    {
-        /* error parsing */
-        printf("Error parsing\n");
+    if (!parse(&expression, scanner))
         return expression;
-    }
 
     yy_delete_buffer(state, scanner);
 
@@ -47,54 +93,152 @@ GraphList getGraphList(const char *expr)
  * @brief Parses a file and return the GraphList described by it.
  * 
  * @param toRead A file in graphviz format.
- * @return GraphList The parsed GraphList.
+ * @param parsed Set to false if there was an error, true otherwise.
+ * @return GraphList The parsed GraphList (only its beginning if there was an error).
  */
-GraphList getGraphListFromFile(FILE *toRead)
+GraphList getGraphListFromFile(FILE *toRead, bool *parsed)
 {
-    GraphList expression;
+    GraphList expression = emptyGraphList();
     yyscan_t scanner;
     YY_BUFFER_STATE state;
 
-    expression.nodes = NULL;
-    expression.edges = NULL;
-
     if (yylex_init(&scanner))
     {
         /* could not initialize */
-        printf("Error initialization\n");
+        fprintf(stderr, "Error initialization\n");
+        *parsed = false;
+        fclose(toRead);
         return expression;
     }
 
     state = yy_create_buffer(toRead, YY_BUF_SIZE, scanner);
     yy_switch_to_buffer(state, scanner);
 
-    if (yyparse(&expression, scanner))
+    *parsed = parse(&expression, scanner);
+
+    yy_delete_buffer(state, scanner);
+
+    yylex_destroy(scanner);
+
+    fclose(toRead);
+
+    return expression;
+}
+
+/**
+ * @brief Parses a buffer in place and return the GraphList described by it.
+ *
+ * @param buffer The content of a file in graphviz format, followed by two null bytes (flex writes in it while scanning, but restores it).
+ * @param size The size of the content, without the two null bytes.
+ * @param parsed Set to false if there was an error, true otherwise.
+ * @return GraphList The parsed GraphList (only its beginning if there was an error).
+ */
+static GraphList getGraphListFromBuffer(char *buffer, size_t size, bool *parsed)
+{
+    GraphList expression = emptyGraphList();
+    yyscan_t scanner;
+
+    if (yylex_init(&scanner))
     {
-        /* error parsing */
-        printf("Error parsing\n");
+        /* could not initialize */
+        fprintf(stderr, "Error initialization\n");
+        *parsed = false;
         return expression;
     }
 
+    YY_BUFFER_STATE state = yy_scan_buffer(buffer, size + 2, scanner);
+
+    *parsed = parse(&expression, scanner);
+
     yy_delete_buffer(state, scanner);
 
     yylex_destroy(scanner);
 
-    fclose(toRead);
-
     return expression;
 }
 
+/**
+ * @brief Maps the file @p fd of @p size bytes in memory (privately, so that it can be written to), followed by at least two null bytes.
+ *        The file is mapped over anonymous pages: the bytes after its end are zeros, even when the end falls on a page boundary.
+ *
+ * @param fd An open file.
+ * @param size Its size.
+ * @param mapped Set to the size of the mapping.
+ * @return char* The mapping, or NULL if it failed.
+ */
+static char *mapFile(int fd, size_t size, size_t *mapped)
+{
+    size_t page = (size_t)sysconf(_SC_PAGESIZE);
+    *mapped = ((size + 2 + page - 1) / page) * page;
+    char *buffer = (char *)mmap(NULL, *mapped, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (buffer == MAP_FAILED)
+        return NULL;
+    if (size > 0 && mmap(buffer, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_FIXED, fd, 0) == MAP_FAILED)
+    {
+        munmap(buffer, *mapped);
+        return NULL;
+    }
+    return buffer;
+}
+
+/**
+ * @brief Parses the open file @p fd of @p size bytes into @p graph, and closes it.
+ *
+ * @param fd An open file in graphviz format.
+ * @param size Its size.
+ * @param graph Set to the parsed Graph (only its beginning if there was an error).
+ * @return bool false if there was an error.
+ */
+static bool parseGraphFile(int fd, size_t size, Graph *graph)
+{
+    GraphList e;
+    bool parsed;
+    size_t mapped;
+    char *buffer = mapFile(fd, size, &mapped);
+    if (buffer != NULL)
+    {
+        e = getGraphListFromBuffer(buffer, size, &parsed);
+        munmap(buffer, mapped);
+        close(fd);
+    }
+    else
+        e = getGraphListFromFile(fdopen(fd, "r"), &parsed);
+
+    // The graph takes over the arena of e, and with it the lists.
+    *graph = createGraph(e);
+    return parsed;
+}
+
 Graph get_graph_from_file(char *toRead)
 {
-    FILE *file = fopen(toRead, "r");
-    if (file == NULL)
+    int fd = open(toRead, O_RDONLY);
+    struct stat status;
+    if (fd < 0 || fstat(fd, &status) != 0)
     {
         printf("file %s does not exist. Exiting.\n", toRead);
         exit(-1);
     }
-    GraphList e = getGraphListFromFile(file);
-    Graph graph = createGraph(e);
-    deleteExpression(e.edges);
-    deleteNodeList(e.nodes);
+
+    Graph graph;
+    parseGraphFile(fd, status.st_size, &graph);
     return graph;
 }
+
+bool try_get_graph_from_file(char *toRead, Graph *graph)
+{
+    int fd = open(toRead, O_RDONLY);
+    struct stat status;
+    if (fd < 0 || fstat(fd, &status) != 0)
+    {
+        if (fd >= 0)
+            close(fd);
+        return false;
+    }
+
+    if (!parseGraphFile(fd, status.st_size, graph))
+    {
+        graph_delete(*graph);
+        return false;
+    }
+    return true;
+}